@@ -7,6 +7,7 @@
 
 #include "platform/hal_io.h"
 #include "platform/hal_queue.h"
+#include "platform/hal_semaphore.h"
 #include "platform/hal_types.h"
 
 #include <stddef.h>
@@ -15,6 +16,8 @@
 #include <string.h>
 
 static struct config_parser parser;
+/* The callback may be invoked by multiple bundle processor shards */
+static Semaphore_t parser_semaphore;
 
 static void router_command_send(struct router_command *cmd, void *param)
 {
@@ -40,12 +43,20 @@ static void callback(struct bundle_adu data, void *param)
 		}
 	}
 
+	if (bundle_adu_flatten(&data) != UD3TN_OK) {
+		LOG("ConfigAgent: Could not flatten reassembled message");
+		bundle_adu_free_members(data);
+		return;
+	}
+
+	hal_semaphore_take_blocking(parser_semaphore);
 	config_parser_reset(&parser);
 	config_parser_read(
 		&parser,
 		data.payload,
 		data.length
 	);
+	hal_semaphore_release(parser_semaphore);
 	bundle_adu_free_members(data);
 }
 
@@ -54,6 +65,9 @@ int config_agent_setup(QueueIdentifier_t bundle_processor_signaling_queue,
 {
 	ASSERT(config_parser_init(&parser, &router_command_send,
 				  router_signaling_queue));
+	parser_semaphore = hal_semaphore_init_binary();
+	ASSERT(parser_semaphore != NULL);
+	hal_semaphore_release(parser_semaphore);
 	return bundle_processor_perform_agent_action(
 		bundle_processor_signaling_queue,
 		BP_SIGNAL_AGENT_REGISTER,
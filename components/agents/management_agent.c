@@ -20,6 +20,11 @@ static void callback(struct bundle_adu data, void *param)
 		bundle_adu_free_members(data);
 		return;
 	}
+	if (bundle_adu_flatten(&data) != UD3TN_OK) {
+		LOG("MgmgtAgent: Could not flatten reassembled payload.");
+		bundle_adu_free_members(data);
+		return;
+	}
 
 	switch ((enum management_command)data.payload[0]) {
 	default:
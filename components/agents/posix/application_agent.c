@@ -145,6 +145,9 @@ static size_t parse_aap(struct aap_parser *parser,
 struct write_socket_param {
 	int socket_fd;
 	int errno_;
+	/* Written in place of a NULL payload, if set */
+	const struct bundle_adu_segment *segments;
+	size_t segment_count;
 };
 
 static void write_to_socket(void *const p,
@@ -152,20 +155,41 @@ static void write_to_socket(void *const p,
 {
 	struct write_socket_param *const wsp = (struct write_socket_param *)p;
 	ssize_t result;
+	size_t i;
 
 	if (wsp->errno_)
 		return;
+	if (buffer == NULL && wsp->segments != NULL) {
+		// Reassembled payloads are sent without joining them
+		for (i = 0; i < wsp->segment_count; i++) {
+			result = tcp_send_all(
+				wsp->socket_fd,
+				&wsp->segments[i].buffer[
+					wsp->segments[i].offset],
+				wsp->segments[i].length
+			);
+			if (result == -1) {
+				wsp->errno_ = errno;
+				return;
+			}
+		}
+		return;
+	}
 	result = tcp_send_all(wsp->socket_fd, buffer, length);
 	if (result == -1)
 		wsp->errno_ = errno;
 }
 
-static int send_message(const int socket_fd,
-			const struct aap_message *const msg)
+static int send_message_segmented(const int socket_fd,
+				  const struct aap_message *const msg,
+				  const struct bundle_adu_segment *segments,
+				  const size_t segment_count)
 {
 	struct write_socket_param wsp = {
 		.socket_fd = socket_fd,
 		.errno_ = 0,
+		.segments = segments,
+		.segment_count = segment_count,
 	};
 
 	aap_serialize(msg, write_to_socket, &wsp);
@@ -174,6 +198,12 @@ static int send_message(const int socket_fd,
 	return -wsp.errno_;
 }
 
+static int send_message(const int socket_fd,
+			const struct aap_message *const msg)
+{
+	return send_message_segmented(socket_fd, msg, NULL, 0);
+}
+
 static void agent_msg_recv(struct bundle_adu data, void *param)
 {
 	struct application_agent_comm_config *const config = (
@@ -440,7 +470,12 @@ static int send_bundle(const int socket_fd, struct bundle_adu data)
 		.payload = data.payload,
 		.payload_length = data.length,
 	};
-	const int send_result = send_message(socket_fd, &bundle_msg);
+	const int send_result = send_message_segmented(
+		socket_fd,
+		&bundle_msg,
+		data.segments,
+		data.segment_count
+	);
 
 	bundle_adu_free_members(data);
 	return send_result;
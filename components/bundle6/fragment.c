@@ -37,20 +37,19 @@ struct bundle *bundle6_fragment_bundle(
 	if (!bundle_is_fragmented(working_bundle))
 		working_bundle->total_adu_length
 			= working_bundle->payload_block->length;
+	/* Reference the second part of the payload instead of copying it */
+	if (bundle_share_payload(working_bundle) != UD3TN_OK) {
+		bundle_free(remainder);
+		return NULL;
+	}
+	ASSERT(working_bundle->payload_block->buffer != NULL);
 	/* Set the payload block's properties */
 	remainder->payload_block->length
 		= working_bundle->payload_block->length - first_payload_length;
+	remainder->payload_block->buffer = payload_buffer_ref(
+		working_bundle->payload_block->buffer);
 	remainder->payload_block->data
-		= malloc(remainder->payload_block->length);
-	if (remainder->payload_block->data == NULL) {
-		bundle_free(remainder);
-		return NULL;
-	}
-	memcpy(
-		remainder->payload_block->data,
-		working_bundle->payload_block->data + first_payload_length,
-		remainder->payload_block->length
-	);
+		= working_bundle->payload_block->data + first_payload_length;
 	/* Find PL block position in working bundle */
 	/* Add following blocks to remainder */
 	cur_block = working_bundle->blocks;
@@ -65,12 +64,8 @@ struct bundle *bundle6_fragment_bundle(
 		}
 		cur_block = cur_block->next;
 	}
-	/* Shorten first fragment's PL block */
-	working_bundle->payload_block->data
-		= realloc(working_bundle->payload_block->data,
-			first_payload_length);
-	ASSERT(working_bundle->payload_block->data != NULL);
-	/* Set correct lengths and offsets */
+	/* Set correct lengths and offsets, the first fragment's PL block */
+	/* keeps referencing the start of the shared payload */
 	working_bundle->payload_block->length = first_payload_length;
 	remainder->fragment_offset
 		= working_bundle->fragment_offset + first_payload_length;
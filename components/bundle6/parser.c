@@ -3,6 +3,7 @@
 #include "ud3tn/bundle_storage_manager.h"
 #include "ud3tn/config.h"
 #include "ud3tn/common.h"
+#include "ud3tn/eid_table.h"
 
 #include <stddef.h>
 #include <stdlib.h>
@@ -19,6 +20,7 @@ struct parser *bundle6_parser_init(
 		return NULL;
 	state->send_callback = send_callback;
 	state->send_param = param;
+	state->admit_callback = NULL;
 	state->bundle = NULL;
 	state->dict = NULL;
 	state->basedata->status = PARSER_STATUS_ERROR;
@@ -36,6 +38,7 @@ enum ud3tn_result bundle6_parser_reset(struct bundle6_parser *state)
 	state->basedata->status = PARSER_STATUS_GOOD;
 	state->basedata->flags = PARSER_FLAG_NONE;
 	state->error = PARSER_ERROR_NONE;
+	state->discard = false;
 
 	state->current_stage = PARSER_STAGE_VERSION;
 	state->next_stage    = PARSER_STAGE_VERSION;
@@ -46,8 +49,10 @@ enum ud3tn_result bundle6_parser_reset(struct bundle6_parser *state)
 	state->primary_bytes_remaining = 0;
 	state->cur_bytes_remaining = 0;
 	state->current_index = 0;
-	state->current_size = bundle_storage_get_usage()
-		+ sizeof(struct bundle);
+	/* With an eviction policy, the storage makes room for the bundle */
+	state->current_size = sizeof(struct bundle);
+	if (bundle_storage_get_eviction_policy() == BUNDLE_STORAGE_EVICT_NONE)
+		state->current_size += bundle_storage_get_usage();
 	state->last_block = 0;
 
 	if (state->bundle != NULL)
@@ -150,6 +155,17 @@ fail:
 	return NULL;
 }
 
+static char *bundle6_read_interned_eid(
+	const char *dict, const size_t dict_len,
+	struct bundle6_eid_reference ref)
+{
+	char *eid = bundle6_read_eid(dict, dict_len, ref);
+	char *result = eid_intern(eid);
+
+	free(eid);
+	return result;
+}
+
 static bool bundle_is_valid(struct bundle *const bundle)
 {
 	return bundle->payload_block != NULL;
@@ -160,12 +176,20 @@ static inline void bundle6_parser_send_bundle(struct bundle6_parser *state)
 	struct bundle *ptr = state->bundle;
 
 	state->bundle = NULL;
-	if (state->send_callback == NULL || !bundle_is_valid(ptr))
+	if (state->send_callback == NULL || state->discard ||
+			!bundle_is_valid(ptr))
 		bundle_free(ptr);
 	else
 		state->send_callback(ptr, state->send_param);
 }
 
+static inline void bundle6_parser_admit(struct bundle6_parser *state)
+{
+	if (state->admit_callback != NULL &&
+			!state->admit_callback(state->bundle, state->send_param))
+		state->discard = true;
+}
+
 static inline void bundle6_parser_next(struct bundle6_parser *state)
 {
 	switch (state->next_stage) {
@@ -242,6 +266,9 @@ static inline void bundle6_parser_next(struct bundle6_parser *state)
 		sdnv_reset(&state->sdnv_state);
 		break;
 	case PARSER_STAGE_BLOCK_TYPE:
+		/* The primary block has been parsed completely */
+		if (state->current_block == PARSER_BLOCK_PRIMARY)
+			bundle6_parser_admit(state);
 		state->current_block = PARSER_BLOCK_GENERIC;
 		break;
 	case PARSER_STAGE_BLOCK_FLAGS:
@@ -264,6 +291,12 @@ static inline void bundle6_parser_next(struct bundle6_parser *state)
 		state->cur_bytes_remaining = 0;
 		state->basedata->next_bytes =
 			(*state->current_block_entry)->data->length;
+		if (state->discard) {
+			/* Skip the block data without storing it */
+			state->basedata->next_buffer = NULL;
+			state->basedata->flags |= PARSER_FLAG_BULK_READ;
+			break;
+		}
 		state->current_size += state->basedata->next_bytes;
 		if (state->current_size > BUNDLE_QUOTA) {
 			state->basedata->status = PARSER_STATUS_ERROR;
@@ -436,25 +469,26 @@ static void bundle6_parser_read_byte(struct bundle6_parser *state,
 			// Allocate EID references
 			//
 			// source
-			state->bundle->source = bundle6_read_eid(
+			state->bundle->source = bundle6_read_interned_eid(
 				state->dict, state->dict_length,
 				state->source_eidref
 			);
 			// destination
-			state->bundle->destination = bundle6_read_eid(
+			state->bundle->destination = bundle6_read_interned_eid(
 				state->dict, state->dict_length,
 				state->destination_eidref
 			);
 			// report-to
-			state->bundle->report_to = bundle6_read_eid(
+			state->bundle->report_to = bundle6_read_interned_eid(
 				state->dict, state->dict_length,
 				state->report_to_eidref
 			);
 			// custodian
-			state->bundle->current_custodian = bundle6_read_eid(
-				state->dict, state->dict_length,
-				state->custodian_eidref
-			);
+			state->bundle->current_custodian =
+				bundle6_read_interned_eid(
+					state->dict, state->dict_length,
+					state->custodian_eidref
+				);
 			if (state->bundle->source == NULL ||
 					state->bundle->destination == NULL ||
 					state->bundle->report_to == NULL ||
@@ -619,9 +653,10 @@ size_t bundle6_parser_read(struct bundle6_parser *parser,
 				break;
 
 			/* Perform bulk read operation directly */
-			memcpy(parser->basedata->next_buffer,
-				buffer + i,
-				parser->basedata->next_bytes);
+			if (parser->basedata->next_buffer != NULL)
+				memcpy(parser->basedata->next_buffer,
+					buffer + i,
+					parser->basedata->next_bytes);
 
 			/* Disables bulk read mode again */
 			parser->basedata->flags &= ~PARSER_FLAG_BULK_READ;
@@ -4,6 +4,7 @@
 #include "ud3tn/bundle.h"
 #include "ud3tn/common.h"
 #include "ud3tn/config.h"
+#include "ud3tn/eid_table.h"
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -42,15 +43,15 @@ struct bundle *bundle7_create_local(
 	if (bundle->payload_block == NULL || bundle->blocks == NULL)
 		goto fail;
 
-	bundle->source = strdup(source);
+	bundle->source = eid_intern(source);
 	if (bundle->source == NULL)
 		goto fail;
 
-	bundle->destination = strdup(destination);
+	bundle->destination = eid_intern(destination);
 	if (bundle->destination == NULL)
 		goto fail; // bundle_free takes care of source
 
-	bundle->report_to = strdup("dtn:none");
+	bundle->report_to = eid_intern("dtn:none");
 	if (bundle->report_to == NULL)
 		goto fail; // bundle_free takes care of source and destination
 
@@ -63,7 +63,7 @@ struct bundle *bundle7_fragment_bundle(struct bundle *working_bundle,
 		cur_block = cur_block->next;
 	}
 
-	// Copy second fragment to payload block
+	// Reference the second part of the payload from the new payload block
 	remainder->payload_block = bundle_block_create(
 		BUNDLE_BLOCK_TYPE_PAYLOAD
 	);
@@ -71,19 +71,18 @@ struct bundle *bundle7_fragment_bundle(struct bundle *working_bundle,
 		bundle_free(remainder);
 		return NULL;
 	}
-	remainder->payload_block->length
-		= working_bundle->payload_block->length - first_payload_length;
-	remainder->payload_block->data
-		= malloc(remainder->payload_block->length);
-	if (remainder->payload_block->data == NULL) {
+	if (bundle_share_payload(working_bundle) != UD3TN_OK) {
+		bundle_block_free(remainder->payload_block);
 		bundle_free(remainder);
 		return NULL;
 	}
-	memcpy(
-		remainder->payload_block->data,
-		working_bundle->payload_block->data + first_payload_length,
-		remainder->payload_block->length
-	);
+	assert(working_bundle->payload_block->buffer != NULL);
+	remainder->payload_block->length
+		= working_bundle->payload_block->length - first_payload_length;
+	remainder->payload_block->buffer = payload_buffer_ref(
+		working_bundle->payload_block->buffer);
+	remainder->payload_block->data
+		= working_bundle->payload_block->data + first_payload_length;
 
 	// Link last block with payload block
 	struct bundle_block_list *payload_entry = bundle_block_entry_create(
@@ -104,14 +103,8 @@ struct bundle *bundle7_fragment_bundle(struct bundle *working_bundle,
 		working_bundle->total_adu_length
 			= working_bundle->payload_block->length;
 
-	// Shorten first fragment's payload block
-	working_bundle->payload_block->data
-		= realloc(working_bundle->payload_block->data,
-			first_payload_length);
-
-	assert(working_bundle->payload_block->data != NULL);
-
-	// Set correct lengths and offsets
+	// Set correct lengths and offsets, the first fragment's payload block
+	// keeps referencing the start of the shared payload
 	working_bundle->payload_block->length = first_payload_length;
 	remainder->fragment_offset
 		= working_bundle->fragment_offset + first_payload_length;
@@ -2,6 +2,7 @@
 #include "bundle7/timestamp.h"
 
 #include "ud3tn/common.h"
+#include "ud3tn/eid_table.h"
 
 #include "compilersupport_p.h"  // Private TinyCBOR header, used for endianess
 
@@ -56,6 +57,7 @@ static CborError lifetime(struct bundle7_parser *, CborValue *);
 static CborError fragment_offset(struct bundle7_parser *, CborValue *);
 static CborError total_adu_length(struct bundle7_parser *, CborValue *);
 static CborError primary_block_crc(struct bundle7_parser *, CborValue *);
+static void primary_block_end(struct bundle7_parser *);
 
 
 // ----------------
@@ -101,9 +103,9 @@ CborError bundle_end(struct bundle7_parser *state, CborValue *it)
 	bundle = state->bundle;
 	state->bundle = NULL;
 
-	// Call "send" callback if set and all CRCs passed, otherwise discard
-	// parsed bundle silently
-	if (state->send_callback == NULL
+	// Call "send" callback if set, the bundle was admitted and all CRCs
+	// passed, otherwise discard parsed bundle silently
+	if (state->send_callback == NULL || state->discard
 		|| state->basedata->flags & PARSER_FLAG_CRC_INVALID)
 		bundle_free(bundle);
 	else
@@ -195,11 +197,13 @@ CborError parse_eid(struct bundle7_parser *state, CborValue *it, char **eid,
 	if (err)
 		return err;
 
-	// Allocate zero-copy reference
-	char *eid_ref = strdup(*eid);
+	// Replace the parsed string by a reference to the interned EID
+	char *interned = eid_intern(*eid);
 
 	free(*eid);
-	*eid = eid_ref;
+	*eid = interned;
+	if (interned == NULL)
+		return CborErrorOutOfMemory;
 
 	state->next = next;
 	return CborNoError;
@@ -258,11 +262,10 @@ CborError lifetime(struct bundle7_parser *state, CborValue *it)
 	else if (state->bundle->crc_type != BUNDLE_CRC_TYPE_NONE)
 		state->next = primary_block_crc;
 	else {
-		state->next = block_start;
-
 		// -1 Byte infinite array header
 		state->bundle->primary_block_length = state->bundle_size - 1 +
 			(it->ptr - last_ptr);
+		primary_block_end(state);
 	}
 
 	return err;
@@ -300,11 +303,10 @@ CborError total_adu_length(struct bundle7_parser *state, CborValue *it)
 	if (state->bundle->crc_type != BUNDLE_CRC_TYPE_NONE)
 		state->next = primary_block_crc;
 	else {
-		state->next = block_start;
-
 		// -1 Byte infinite array header
 		state->bundle->primary_block_length = state->bundle_size - 1 +
 			(it->ptr - last_ptr);
+		primary_block_end(state);
 	}
 
 	return err;
@@ -374,12 +376,28 @@ CborError primary_block_crc(struct bundle7_parser *state, CborValue *it)
 				= state->bundle_size - 1 + 5;
 	}
 
-	state->next = block_start;
+	primary_block_end(state);
 
 	return CborNoError;
 }
 
 
+/**
+ * Asks the admission callback whether the rest of the bundle is worth
+ * reading. Bundles with an invalid primary block CRC are dropped anyway.
+ */
+void primary_block_end(struct bundle7_parser *state)
+{
+	state->next = block_start;
+
+	if (state->basedata->flags & PARSER_FLAG_CRC_INVALID)
+		state->discard = true;
+	else if (state->admit_callback != NULL
+		&& !state->admit_callback(state->bundle, state->send_param))
+		state->discard = true;
+}
+
+
 // ----------------
 // Extension Blocks
 // ----------------
@@ -501,6 +519,12 @@ CborError block_crc(struct bundle7_parser *state, CborValue *it)
 	if (err)
 		return err;
 
+	// The block data of a discarded bundle has not been kept
+	if (state->discard) {
+		block_end(state, it);
+		return CborNoError;
+	}
+
 	// Feed CRC with raw CBOR block data
 	if (BLOCK(state)->crc_type == BUNDLE_CRC_TYPE_16) {
 		// Ensure correct CRC 16 checksum length
@@ -575,15 +599,19 @@ CborError block_data(struct bundle7_parser *state, CborValue *it)
 	// Block-specific data
 	// -------------------
 	//
-	BLOCK(state)->data = malloc(length);
-	if (BLOCK(state)->data == NULL)
-		return CborErrorOutOfMemory;
+	// The data of a discarded bundle is skipped without storing it and
+	// does not count towards the quota.
+	if (!state->discard) {
+		BLOCK(state)->data = malloc(length);
+		if (BLOCK(state)->data == NULL)
+			return CborErrorOutOfMemory;
+		state->bundle_size += length;
+	}
 
 	// Enable "bulk read" mode
 	state->basedata->next_buffer = BLOCK(state)->data;
 	state->basedata->next_bytes = length;
 	state->basedata->flags |= PARSER_FLAG_BULK_READ;
-	state->bundle_size += length;
 
 	if (BLOCK(state)->crc_type != BUNDLE_CRC_TYPE_NONE)
 		state->next = block_crc;
@@ -653,6 +681,7 @@ struct parser *bundle7_parser_init(struct bundle7_parser *state,
 	state->bundle_quota = BUNDLE7_DEFAULT_BUNDLE_QUOTA;
 	state->send_callback = send_callback;
 	state->send_param = param;
+	state->admit_callback = NULL;
 	state->bundle = NULL;
 	state->next = NULL;  // force reset to do its job
 
@@ -680,6 +709,7 @@ enum ud3tn_result bundle7_parser_reset(struct bundle7_parser *state)
 	state->parse = bundle_start;
 	state->flags = 0;
 	state->bundle_size = 0;
+	state->discard = false;
 
 	if (state->bundle != NULL)
 		bundle_reset(state->bundle);
@@ -746,11 +776,12 @@ size_t bundle7_parser_read(struct bundle7_parser *state,
 				break;
 			}
 
-			memcpy(
-				state->basedata->next_buffer,
-				buffer + parsed,
-				state->basedata->next_bytes
-			);
+			if (state->basedata->next_buffer != NULL)
+				memcpy(
+					state->basedata->next_buffer,
+					buffer + parsed,
+					state->basedata->next_bytes
+				);
 
 			parsed += state->basedata->next_bytes;
 
@@ -155,6 +155,9 @@ enum ud3tn_result cla_config_init(
 {
 	config->vtable = NULL;
 	config->bundle_agent_interface = bundle_agent_interface;
+#if HAL_EXECUTOR_WORKERS
+	config->event_driven_rx = false;
+#endif
 
 	return UD3TN_OK;
 }
@@ -175,7 +178,11 @@ enum ud3tn_result cla_link_init(struct cla_link *link, struct cla_config *config
 
 	link->tx_queue_handle = NULL;
 	link->tx_queue_sem = NULL;
-
+	cla_tx_window_init(&link->tx_window);
+	cla_tx_scheduler_init(&link->tx_scheduler);
+#if HAL_EXECUTOR_WORKERS
+	link->open_sides = 2;
+#endif
 
 	// Semaphores used for waiting for the tasks to exit
 	// NOTE: They are already locked on creation!
@@ -198,8 +205,10 @@ enum ud3tn_result cla_link_init(struct cla_link *link, struct cla_config *config
 	}
 	config->vtable->cla_rx_task_reset_parsers(link);
 
+	// Pushes within the window never block, even with a command for the
+	// finalization being queued
 	link->tx_queue_handle = hal_queue_create(
-		CONTACT_TX_TASK_QUEUE_LENGTH,
+		CLA_TX_WINDOW_MAX + 1,
 		sizeof(struct cla_contact_tx_task_command)
 	);
 	if (link->tx_queue_handle == NULL)
@@ -254,8 +263,8 @@ fail_rx_sem:
 void cla_link_wait_cleanup(struct cla_link *link)
 {
 	// Wait for graceful termination of tasks
-	hal_semaphore_take_blocking(link->rx_task_sem);
-	hal_semaphore_take_blocking(link->tx_task_sem);
+	cla_contact_rx_task_wait_exit(link);
+	cla_contact_tx_task_wait_exit(link);
 
 	// Clean up semaphores
 	hal_semaphore_delete(link->rx_task_sem);
@@ -278,6 +287,19 @@ void cla_link_wait_cleanup(struct cla_link *link)
 
 }
 
+#if HAL_EXECUTOR_WORKERS
+
+void cla_link_side_ended(struct cla_link *link)
+{
+	struct hal_work *const closed_work = link->closed_work;
+
+	if (__atomic_sub_fetch(&link->open_sides, 1, __ATOMIC_ACQ_REL) == 0 &&
+	    closed_work != NULL)
+		hal_work_submit(closed_work);
+}
+
+#endif /* HAL_EXECUTOR_WORKERS */
+
 char *cla_get_connect_addr(const char *cla_addr, const char *cla_name)
 {
 	const char *offset = strchr(cla_addr, ':');
@@ -312,7 +334,7 @@ void cla_generic_disconnect_handler(struct cla_link *link)
 	// RX task will delete itself
 	link->active = false;
 	// TX task will delete its queue and itself
-	cla_contact_tx_task_request_exit(link->tx_queue_handle);
+	cla_contact_tx_task_request_exit(link);
 	// The termination of the tasks means cla_link_wait_cleanup returns
 }
 
@@ -13,21 +13,56 @@
 #include "ud3tn/bundle_storage_manager.h"
 #include "ud3tn/common.h"
 #include "ud3tn/config.h"
+#include "ud3tn/eid_table.h"
 #include "ud3tn/task_tags.h"
 
 #include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 
 
+/*
+ * Event-driven links must not block the executor while the bundle processor
+ * is congested. Bundles which cannot be handed over right away are held back
+ * until the RX work item runs again.
+ */
+static void hand_over(struct rx_task_data *rx_data, bundleid_t id)
+{
+	struct cla_config *const config = rx_data->cla_config;
+	QueueIdentifier_t queue =
+		config->bundle_agent_interface->bundle_signaling_queue;
+
+#if HAL_EXECUTOR_WORKERS
+	if (config->event_driven_rx &&
+	    rx_data->pending_count < CLA_RX_PENDING_BUNDLES) {
+		if (rx_data->pending_count == 0 &&
+		    bundle_processor_try_inform(queue, id,
+						BP_SIGNAL_BUNDLE_INCOMING,
+						BUNDLE_SR_REASON_NO_INFO)
+				== UD3TN_OK)
+			return;
+		rx_data->pending_bundles[rx_data->pending_count++] = id;
+		return;
+	}
+#endif /* HAL_EXECUTOR_WORKERS */
+
+	bundle_processor_inform(queue, id, BP_SIGNAL_BUNDLE_INCOMING,
+				BUNDLE_SR_REASON_NO_INFO);
+}
+
 static void bundle_send(struct bundle *bundle, void *param)
 {
-	struct cla_config *const config = param;
+	struct rx_task_data *const rx_data = param;
+	struct cla_config *const config = rx_data->cla_config;
 	bundleid_t new_id;
 
 	ASSERT(bundle != NULL);
 
-	if (strncmp(config->bundle_agent_interface->local_eid,
-		    bundle->source,
-		    strlen(config->bundle_agent_interface->local_eid)) == 0) {
+	// The source has been interned by the parser, its length is known
+	if (eid_length(bundle->source) >= rx_data->local_eid_length &&
+	    memcmp(config->bundle_agent_interface->local_eid, bundle->source,
+		   rx_data->local_eid_length) == 0) {
 		LOGF("CLA: Dropping bundle from \"%s\" (EID spoofing detected)",
 		     bundle->source);
 		bundle_free(bundle);
@@ -48,32 +83,67 @@ static void bundle_send(struct bundle *bundle, void *param)
                (uint32_t)(bundle->sequence_number&0xFFFFFFFF)
         );
 
-		bundle_processor_inform(
-			config->bundle_agent_interface->bundle_signaling_queue,
-			new_id,
-			BP_SIGNAL_BUNDLE_INCOMING,
-			BUNDLE_SR_REASON_NO_INFO
-		);
+		hand_over(rx_data, new_id);
 	} else {
 		LOGF("CLA: Dropping bundle from \"%s\" (OOM?)", bundle->source);
 		bundle_free(bundle);
 	}
 }
 
+/*
+ * Decides after the primary block whether a bundle is worth receiving. Known
+ * bundles are skipped before their payload is read, as they would be dropped
+ * by the bundle processor anyway. Bundles requesting custody transfer or a
+ * reception report are still handed over as they have to be answered.
+ */
+static bool bundle_admit(const struct bundle *bundle, void *param)
+{
+	struct known_bundle_list *known_bundle_list;
+
+	(void)param;
+
+	if (bundle_storage_get_eviction_policy() == BUNDLE_STORAGE_EVICT_NONE &&
+	    bundle_storage_get_usage() >= BUNDLE_QUOTA) {
+		LOGF("CLA: Skipping bundle from \"%s\" (storage is full)",
+		     bundle->source);
+		return false;
+	}
+	if (HAS_FLAG(bundle->proc_flags, BUNDLE_FLAG_REPORT_RECEPTION) ||
+	    (bundle->protocol_version == 6 &&
+	     HAS_FLAG(bundle->proc_flags,
+		      BUNDLE_V6_FLAG_CUSTODY_TRANSFER_REQUESTED)))
+		return true;
+	if (bundle_processor_get_known_bundle_list(&known_bundle_list)
+			!= UD3TN_OK)
+		return true;
+	if (known_bundle_list_contains_primary(known_bundle_list, bundle)) {
+		LOGF("CLA: Skipping known bundle from \"%s\"", bundle->source);
+		return false;
+	}
+	return true;
+}
+
 enum ud3tn_result rx_task_data_init(struct rx_task_data *rx_data,
-				    void *cla_config)
+				    struct cla_config *cla_config)
 {
 	rx_data->payload_type = PAYLOAD_UNKNOWN;
 	rx_data->timeout_occured = false;
 	rx_data->input_buffer.end = &rx_data->input_buffer.start[0];
+	rx_data->bulk_read_offset = 0;
+	rx_data->pending_count = 0;
+	rx_data->cla_config = cla_config;
+	rx_data->local_eid_length = strlen(
+		cla_config->bundle_agent_interface->local_eid);
 
 	if (!bundle6_parser_init(&rx_data->bundle6_parser,
-				 &bundle_send, cla_config))
+				 &bundle_send, rx_data))
 		return UD3TN_FAIL;
 	if (!bundle7_parser_init(&rx_data->bundle7_parser,
-				 &bundle_send, cla_config))
+				 &bundle_send, rx_data))
 		return UD3TN_FAIL;
 	rx_data->bundle7_parser.bundle_quota = BUNDLE_QUOTA;
+	rx_data->bundle6_parser.admit_callback = &bundle_admit;
+	rx_data->bundle7_parser.admit_callback = &bundle_admit;
 
 	return UD3TN_OK;
 }
@@ -81,6 +151,7 @@ enum ud3tn_result rx_task_data_init(struct rx_task_data *rx_data,
 void rx_task_reset_parsers(struct rx_task_data *rx_data)
 {
 	rx_data->payload_type = PAYLOAD_UNKNOWN;
+	rx_data->bulk_read_offset = 0;
 
 	ASSERT(bundle6_parser_reset(&rx_data->bundle6_parser) == UD3TN_OK);
 	ASSERT(bundle7_parser_reset(&rx_data->bundle7_parser) == UD3TN_OK);
@@ -134,8 +205,11 @@ size_t select_bundle_parser_version(struct rx_task_data *rx_data,
  * Bytes in the current input buffer are considered and copied appropriately --
  * meaning that non-parsed input bytes are copied into the bulk read buffer and
  * the remaining bytes are read directly from the input stream.
+ *
+ * If the link is event-driven and no more data is available, the operation is
+ * interrupted and resumed by the next call.
  * @return Pointer to the position up to the input buffer is consumed after the
- *         operation.
+ *         operation, NULL if it has been interrupted.
  */
 static uint8_t *bulk_read(struct cla_link *link)
 {
@@ -156,13 +230,15 @@ static uint8_t *bulk_read(struct cla_link *link)
 	 *
 	 *
 	 */
-	if (parsed <= rx_data->input_buffer.end) {
+	if (rx_data->bulk_read_offset == 0 &&
+	    parsed <= rx_data->input_buffer.end) {
 		/* Fill bulk read buffer from input buffer. */
-		memcpy(
-			rx_data->cur_parser->next_buffer,
-			rx_data->input_buffer.start,
-			rx_data->cur_parser->next_bytes
-		);
+		if (rx_data->cur_parser->next_buffer != NULL)
+			memcpy(
+				rx_data->cur_parser->next_buffer,
+				rx_data->input_buffer.start,
+				rx_data->cur_parser->next_bytes
+			);
 	}
 
 	/*
@@ -184,19 +260,35 @@ static uint8_t *bulk_read(struct cla_link *link)
 	 *                    pointer for HAL read operation
 	 */
 	else {
-		size_t filled = rx_data->input_buffer.end -
-				rx_data->input_buffer.start;
-
-		/* Copy the whole input buffer to bulk read buffer. */
-		if (filled)
-			memcpy(
-				rx_data->cur_parser->next_buffer,
-				rx_data->input_buffer.start,
-				filled
-			);
+		/*
+		 * Copy the whole input buffer to bulk read buffer. If the
+		 * operation is resumed, it has been consumed before.
+		 */
+		if (rx_data->bulk_read_offset == 0) {
+			size_t filled = rx_data->input_buffer.end -
+					rx_data->input_buffer.start;
+
+			if (filled && rx_data->cur_parser->next_buffer != NULL)
+				memcpy(
+					rx_data->cur_parser->next_buffer,
+					rx_data->input_buffer.start,
+					filled
+				);
+			rx_data->bulk_read_offset = filled;
+			rx_data->input_buffer.end = rx_data->input_buffer.start;
+		}
 
-		size_t to_read = rx_data->cur_parser->next_bytes - filled;
-		uint8_t *pos = (uint8_t *)(rx_data->cur_parser->next_buffer) + filled;
+		size_t to_read = rx_data->cur_parser->next_bytes -
+				 rx_data->bulk_read_offset;
+		/*
+		 * If the bytes are to be discarded, the (already consumed)
+		 * input buffer serves as scratch space.
+		 */
+		const bool discard = rx_data->cur_parser->next_buffer == NULL;
+		uint8_t *pos = discard
+			? rx_data->input_buffer.start
+			: (uint8_t *)(rx_data->cur_parser->next_buffer) +
+				rx_data->bulk_read_offset;
 		size_t read;
 
 		while (to_read) {
@@ -205,7 +297,8 @@ static uint8_t *bulk_read(struct cla_link *link)
 				link->config->vtable->cla_read(
 					link,
 					pos,
-					to_read,
+					discard ? MIN(to_read, CLA_RX_BUFFER_SIZE)
+						: to_read,
 					&read
 				);
 
@@ -214,16 +307,24 @@ static uint8_t *bulk_read(struct cla_link *link)
 				link->config->vtable->cla_rx_task_reset_parsers(
 					link
 				);
+				rx_data->bulk_read_offset = 0;
 				return rx_data->input_buffer.end;
 			}
 
+			/* No data available at the moment, resume later. */
+			if (read == 0)
+				return NULL;
+
 			ASSERT(read <= to_read);
 			to_read -= read;
-			pos += read;
+			rx_data->bulk_read_offset += read;
+			if (!discard)
+				pos += read;
 		}
 
 		// We have read everything that was in the buffer (+ more,
 		// but that is not relevant to the caller).
+		rx_data->bulk_read_offset = 0;
 		parsed = rx_data->input_buffer.end;
 	}
 
@@ -254,7 +355,8 @@ static uint8_t *bulk_read(struct cla_link *link)
  * Reads a chunk of bytes into the input buffer and forwards the input buffer
  * to the specific parser.
  *
- * @return Number of bytes remaining in the input buffer after the operation.
+ * @return Pointer to the position up to the input buffer is consumed after the
+ *         operation, NULL if neither new nor parseable input was available.
  */
 static uint8_t *chunk_read(struct cla_link *link)
 {
@@ -319,81 +421,105 @@ static uint8_t *chunk_read(struct cla_link *link)
 		}
 	}
 
+	/* An event-driven link has to wait for more data. */
+	if (read == 0 && stream == rx_data->input_buffer.start &&
+	    !HAS_FLAG(rx_data->cur_parser->flags, PARSER_FLAG_BULK_READ))
+		return NULL;
+
 	return stream;
 }
 
-static void cla_contact_rx_task(void *const param)
+/**
+ * Reads and parses the next chunk of input.
+ *
+ * @return false if no input was available, which only happens for
+ *         event-driven links.
+ */
+static bool process_input(struct cla_link *link)
 {
-	struct cla_link *link = param;
 	struct rx_task_data *const rx_data = &link->rx_task_data;
-
 	uint8_t *parsed;
 
-	while (link->active) {
-		if (HAS_FLAG(rx_data->cur_parser->flags, PARSER_FLAG_BULK_READ))
-			parsed = bulk_read(link);
-		else
-			parsed = chunk_read(link);
+	if (HAS_FLAG(rx_data->cur_parser->flags, PARSER_FLAG_BULK_READ))
+		parsed = bulk_read(link);
+	else
+		parsed = chunk_read(link);
 
-		/* The whole input buffer was consumed, reset it. */
-		if (parsed == rx_data->input_buffer.end) {
-			rx_data->input_buffer.end = rx_data->input_buffer.start;
-		/*
-		 * Remove parsed bytes from input buffer by shifting
-		 * the parsed buffer bytes to the left.
-		 *
-		 *               remaining = 4
-		 * ---------------------------------------
-		 * | / | / | / | x | x | x | x |   |   |   ...
-		 * ---------------------------------------
-		 *               ^               ^
-		 *               |               |
-		 *               |               |
-		 *             parsed           end
-		 *
-		 * memmove:
-		 *     Copying takes place as if an intermediate buffer
-		 *     were used, allowing the destination and source to
-		 *     overlap.
-		 *
-		 * ---------------------------------------
-		 * | x | x | x | x |   |   |   |   |   |   ...
-		 * ---------------------------------------
-		 *                   ^
-		 *                   |
-		 *                   |
-		 *                  end
-		 */
-		} else if (parsed != rx_data->input_buffer.start) {
-			ASSERT(parsed > rx_data->input_buffer.start);
+	if (parsed == NULL)
+		return false;
+
+	/* The whole input buffer was consumed, reset it. */
+	if (parsed == rx_data->input_buffer.end) {
+		rx_data->input_buffer.end = rx_data->input_buffer.start;
+	/*
+	 * Remove parsed bytes from input buffer by shifting
+	 * the parsed buffer bytes to the left.
+	 *
+	 *               remaining = 4
+	 * ---------------------------------------
+	 * | / | / | / | x | x | x | x |   |   |   ...
+	 * ---------------------------------------
+	 *               ^               ^
+	 *               |               |
+	 *               |               |
+	 *             parsed           end
+	 *
+	 * memmove:
+	 *     Copying takes place as if an intermediate buffer
+	 *     were used, allowing the destination and source to
+	 *     overlap.
+	 *
+	 * ---------------------------------------
+	 * | x | x | x | x |   |   |   |   |   |   ...
+	 * ---------------------------------------
+	 *                   ^
+	 *                   |
+	 *                   |
+	 *                  end
+	 */
+	} else if (parsed != rx_data->input_buffer.start) {
+		ASSERT(parsed > rx_data->input_buffer.start);
 
-			memmove(rx_data->input_buffer.start,
-				parsed,
-				rx_data->input_buffer.end - parsed);
+		memmove(rx_data->input_buffer.start,
+			parsed,
+			rx_data->input_buffer.end - parsed);
 
-			/*
-			 * Move end pointer backwards for that amount of bytes
-			 * that were parsed.
-			 */
-			rx_data->input_buffer.end -=
-				parsed - rx_data->input_buffer.start;
 		/*
-		 * No bytes were parsed but the input buffer is full. We assume
-		 * that there was an attempt to send a too large value not
-		 * fitting into the input buffer.
-		 *
-		 * We discard the current buffer content and reset all parsers.
+		 * Move end pointer backwards for that amount of bytes
+		 * that were parsed.
 		 */
-		} else if (rx_data->input_buffer.end ==
-			 rx_data->input_buffer.start + CLA_RX_BUFFER_SIZE) {
-			LOG("RX: WARNING, RX buffer is full.");
-			link->config->vtable->cla_rx_task_reset_parsers(
-				link
-			);
-			rx_data->input_buffer.end = rx_data->input_buffer.start;
-		}
+		rx_data->input_buffer.end -=
+			parsed - rx_data->input_buffer.start;
+	/*
+	 * No bytes were parsed but the input buffer is full. We assume
+	 * that there was an attempt to send a too large value not
+	 * fitting into the input buffer.
+	 *
+	 * We discard the current buffer content and reset all parsers.
+	 */
+	} else if (rx_data->input_buffer.end ==
+		 rx_data->input_buffer.start + CLA_RX_BUFFER_SIZE) {
+		LOG("RX: WARNING, RX buffer is full.");
+		link->config->vtable->cla_rx_task_reset_parsers(
+			link
+		);
+		rx_data->input_buffer.end = rx_data->input_buffer.start;
 	}
 
+	return true;
+}
+
+static void cla_contact_rx_task(void *const param)
+{
+	struct cla_link *link = param;
+
+	while (link->active)
+		process_input(link);
+
+#if HAL_EXECUTOR_WORKERS
+	cla_link_side_ended(link);
+#endif /* HAL_EXECUTOR_WORKERS */
+
 	Task_t rx_task_handle = link->rx_task_handle;
 
 	// After releasing the semaphore, link may become invalid.
@@ -401,8 +527,91 @@ static void cla_contact_rx_task(void *const param)
 	hal_task_delete(rx_task_handle);
 }
 
+#if HAL_EXECUTOR_WORKERS
+
+/*
+ * Hands the held-back bundles over to the bundle processor. If its queue is
+ * still full, the work item is retried after CLA_RX_RETRY_DELAY_MS, leaving
+ * further input in the socket buffer.
+ */
+static bool deliver_pending(struct cla_link *link)
+{
+	struct rx_task_data *const rx_data = &link->rx_task_data;
+	uint8_t delivered = 0;
+
+	while (delivered < rx_data->pending_count) {
+		if (bundle_processor_try_inform(
+				link->config->bundle_agent_interface
+					->bundle_signaling_queue,
+				rx_data->pending_bundles[delivered],
+				BP_SIGNAL_BUNDLE_INCOMING,
+				BUNDLE_SR_REASON_NO_INFO) != UD3TN_OK)
+			break;
+		delivered++;
+	}
+	if (delivered != 0) {
+		memmove(rx_data->pending_bundles,
+			&rx_data->pending_bundles[delivered],
+			(rx_data->pending_count - delivered) *
+				sizeof(bundleid_t));
+		rx_data->pending_count -= delivered;
+	}
+	if (rx_data->pending_count == 0)
+		return true;
+	hal_work_submit_delayed(&link->rx_work, CLA_RX_RETRY_DELAY_MS);
+	return false;
+}
+
+/* Processes the input available for an event-driven link */
+static void cla_contact_rx_work(struct hal_work *work)
+{
+	struct cla_link *link = (struct cla_link *)(
+		(char *)work - offsetof(struct cla_link, rx_work));
+	int budget = CLA_RX_WORK_CHUNK_BUDGET;
+
+	// A submission may have raced with the end of the link
+	if (link->rx_finalized)
+		return;
+
+	while (link->active) {
+		if (!deliver_pending(link))
+			return;
+		if (!process_input(link))
+			break;
+		// Let the worker serve other links, continue in the next run
+		if (--budget == 0) {
+			if (deliver_pending(link))
+				hal_work_submit(work);
+			return;
+		}
+	}
+
+	// Bundles received last are handed over before the link ends
+	if (!deliver_pending(link) || link->active)
+		return;
+
+	link->rx_finalized = true;
+	cla_link_side_ended(link);
+
+	// After releasing the semaphore, link may become invalid as soon as
+	// the work item has been cancelled.
+	hal_semaphore_release(link->rx_task_sem);
+}
+
+#endif /* HAL_EXECUTOR_WORKERS */
+
 enum ud3tn_result cla_launch_contact_rx_task(struct cla_link *link)
 {
+#if HAL_EXECUTOR_WORKERS
+	if (link->config->event_driven_rx) {
+		// Released by the last run after the link was deactivated
+		hal_semaphore_take_blocking(link->rx_task_sem);
+		link->rx_finalized = false;
+		hal_work_init(&link->rx_work, cla_contact_rx_work);
+		return UD3TN_OK;
+	}
+#endif /* HAL_EXECUTOR_WORKERS */
+
 	static uint8_t ctr = 1;
 	static char tname_buf[6];
 
@@ -421,3 +630,13 @@ enum ud3tn_result cla_launch_contact_rx_task(struct cla_link *link)
 	);
 	return link->rx_task_handle ? UD3TN_OK : UD3TN_FAIL;
 }
+
+void cla_contact_rx_task_wait_exit(struct cla_link *link)
+{
+	hal_semaphore_take_blocking(link->rx_task_sem);
+#if HAL_EXECUTOR_WORKERS
+	// Submissions racing with the end of the link may still be pending
+	if (link->config->event_driven_rx)
+		hal_work_cancel_sync(&link->rx_work);
+#endif /* HAL_EXECUTOR_WORKERS */
+}
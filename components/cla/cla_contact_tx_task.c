@@ -1,5 +1,7 @@
 #include "cla/cla.h"
 #include "cla/cla_contact_tx_task.h"
+#include "cla/cla_tx_scheduler.h"
+#include "cla/cla_tx_window.h"
 
 #include "bundle6/parser.h"
 #include "bundle7/parser.h"
@@ -14,113 +16,272 @@
 #include "routing/router_task.h"
 #include "ud3tn/task_tags.h"
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 
-static inline void report_bundle(QueueIdentifier_t signaling_queue,
-				 struct routed_bundle *bundle,
-				 enum router_signal_type type)
+/* Bundles serialized since the link has last been flushed */
+struct tx_completions {
+	struct router_signal signals[CLA_TX_COMPLETION_BATCH];
+	size_t count;
+};
+
+static void report_completions(struct cla_link *link,
+			       struct tx_completions *completions)
 {
-	struct router_signal signal = {
-		.type = type,
-		.data = bundle
-	};
+	QueueIdentifier_t router_signaling_queue =
+		link->config->bundle_agent_interface->router_signaling_queue;
+	struct router_signal *signal;
+	struct routed_bundle *rb;
+	bool failed = false;
+	size_t i;
+
+	// The bundles are only transmitted once their data has been sent
+	if (link->config->vtable->cla_flush != NULL)
+		link->config->vtable->cla_flush(link);
+	if (completions->count == 0)
+		return;
+
+	for (i = 0; i < completions->count; i++) {
+		signal = &completions->signals[i];
+		rb = signal->data;
+		if (signal->type == ROUTER_SIGNAL_TRANSMISSION_SUCCESS &&
+		    !link->active)
+			signal->type = ROUTER_SIGNAL_TRANSMISSION_FAILURE;
+		if (signal->type == ROUTER_SIGNAL_TRANSMISSION_SUCCESS) {
+			rb->transmitted++;
+			bundle_storage_note_transmission(rb->id);
+		} else {
+			failed = true;
+		}
+	}
 
-	hal_queue_push_to_back(signaling_queue, &signal);
+	hal_queue_push_batch(router_signaling_queue, completions->signals,
+			     completions->count, -1);
+	cla_tx_window_release(&link->tx_window, completions->count, failed);
+	completions->count = 0;
 }
 
-static void cla_contact_tx_task(void *param)
+static bool link_ready(struct cla_link *link)
+{
+	return link->config->vtable->cla_tx_ready == NULL ||
+		link->config->vtable->cla_tx_ready(link);
+}
+
+static void complete_bundle(struct cla_link *link,
+			    struct tx_completions *completions,
+			    struct routed_bundle *rb, enum ud3tn_result s)
+{
+	struct router_signal *signal =
+		&completions->signals[completions->count++];
+
+	signal->type = (s == UD3TN_OK)
+		? ROUTER_SIGNAL_TRANSMISSION_SUCCESS
+		: ROUTER_SIGNAL_TRANSMISSION_FAILURE;
+	signal->data = rb;
+	if (completions->count == ARRAY_LENGTH(completions->signals))
+		report_completions(link, completions);
+}
+
+/*
+ * Serializes the bundle without waiting for the data of the previous ones to
+ * be sent, the CLA may buffer it until cla_flush().
+ */
+static void transmit_bundle(struct cla_link *link,
+			    struct routed_bundle_list *entry,
+			    struct tx_completions *completions)
 {
-	struct cla_link *link = param;
-	struct cla_contact_tx_task_command cmd;
 	struct bundle *b;
-	struct routed_bundle_list *cur;
 	enum ud3tn_result s;
 	void const *cla_send_packet_data =
 		link->config->vtable->cla_send_packet_data;
-	QueueIdentifier_t router_signaling_queue =
-		link->config->bundle_agent_interface->router_signaling_queue;
 
-	while (link->active) {
-		if (hal_queue_receive(link->tx_queue_handle,
-				      &cmd, -1) == UD3TN_FAIL)
-			continue;
-		else if (cmd.type == TX_COMMAND_FINALIZE)
-			break;
-		/* TX_COMMAND_BUNDLES received */
-		while (cmd.bundles != NULL) {
-			cur = cmd.bundles;
-			cmd.bundles = cmd.bundles->next;
-			cur->data->serialized++;
-			b = bundle_storage_get(cur->data->id);
-			if (b != NULL) {
-				LOGF(
-					"TX: Sending bundle #%d via CLA %s",
-					b->id,
-					link->config->vtable->cla_name_get()
-				);
-
-                const uint32_t serialized_size = bundle_get_serialized_size(b);
-                LOG_EV("transmit_bundle", "\"link\": \"%p\", \"local_bundle_id\": %d, \"serialized_size\": %d", link, b->id, serialized_size);
-
-				link->config->vtable->cla_begin_packet(
-					link,
-                    serialized_size
-				);
-
-				s = bundle_serialize(
-					b,
-					cla_send_packet_data,
-					(void *)link
-				);
-
-				link->config->vtable->cla_end_packet(link);
-			} else {
-				LOGF("TX: Bundle #%d not found!",
-				     cur->data->id);
-				s = UD3TN_FAIL;
-			}
-
-			if (s == UD3TN_OK) {
-				cur->data->transmitted++;
-				report_bundle(
-					router_signaling_queue,
-					cur->data,
-					ROUTER_SIGNAL_TRANSMISSION_SUCCESS
-				);
-			} else {
-				report_bundle(
-					router_signaling_queue,
-					cur->data,
-					ROUTER_SIGNAL_TRANSMISSION_FAILURE
-				);
-			}
-			/* Free only the RB list, the RB is reported */
-			free(cur);
-		}
+	entry->data->serialized++;
+	b = bundle_storage_acquire(entry->data->id);
+	if (b != NULL) {
+		LOGF(
+			"TX: Sending bundle #%d via CLA %s",
+			b->id,
+			link->config->vtable->cla_name_get()
+		);
+
+		const uint32_t serialized_size = bundle_get_serialized_size(b);
+		LOG_EV("transmit_bundle", "\"link\": \"%p\", \"local_bundle_id\": %d, \"serialized_size\": %d", link, b->id, serialized_size);
+
+		link->config->vtable->cla_begin_packet(
+			link,
+			serialized_size
+		);
+
+		s = bundle_serialize(
+			b,
+			cla_send_packet_data,
+			(void *)link
+		);
+
+		link->config->vtable->cla_end_packet(link);
+		bundle_storage_release(entry->data->id);
+	} else {
+		LOGF("TX: Bundle #%d not found!",
+		     entry->data->id);
+		s = UD3TN_FAIL;
+	}
+
+	/* Free only the RB list, the RB is reported */
+	complete_bundle(link, completions, entry->data, s);
+	routed_bundle_list_free(entry);
+}
+
+static void discard_bundles(struct cla_link *link,
+			    struct routed_bundle_list *bundles,
+			    struct tx_completions *completions)
+{
+	struct routed_bundle_list *cur;
+
+	while (bundles != NULL) {
+		cur = bundles;
+		bundles = bundles->next;
+		cur->data->serialized++;
+		/* Free only the RB list, the RB is reported */
+		complete_bundle(link, completions, cur->data, UD3TN_FAIL);
+		routed_bundle_list_free(cur);
 	}
+}
+
+/*
+ * Moves the bundles of the queued commands to the scheduler of the link, so
+ * that bundles of a higher priority overtake those which are already waiting.
+ * Returns false if TX_COMMAND_FINALIZE has been received, the bundles of
+ * subsequent commands are discarded.
+ */
+static bool fetch_commands(struct cla_link *link, int timeout,
+			   struct tx_completions *completions)
+{
+	struct cla_contact_tx_task_command cmds[CONTACT_TX_TASK_QUEUE_LENGTH];
+	bool finalize = false;
+	size_t count, i;
+
+	count = hal_queue_receive_batch(link->tx_queue_handle, cmds,
+					ARRAY_LENGTH(cmds), timeout);
+	for (i = 0; i < count; i++) {
+		if (cmds[i].type == TX_COMMAND_FINALIZE)
+			finalize = true;
+		else if (finalize)
+			discard_bundles(link, cmds[i].bundles, completions);
+		else
+			cla_tx_scheduler_enqueue(&link->tx_scheduler,
+						 cmds[i].bundles);
+	}
+	return !finalize;
+}
+
+/* Fails the scheduled bundles and everything still in the queue */
+static void discard_pending(struct cla_link *link,
+			    struct tx_completions *completions)
+{
+	struct cla_contact_tx_task_command cmds[CONTACT_TX_TASK_QUEUE_LENGTH];
+	struct routed_bundle_list *entry;
+	size_t count, i;
 
 	// Lock the queue before we start to free it
 	hal_semaphore_take_blocking(link->tx_queue_sem);
 
+	while ((entry = cla_tx_scheduler_dequeue(&link->tx_scheduler)) != NULL)
+		discard_bundles(link, entry, completions);
+
 	// Consume the rest of the queue
-	while (hal_queue_receive(link->tx_queue_handle, &cmd, 0) != UD3TN_FAIL) {
-		if (cmd.type == TX_COMMAND_BUNDLES) {
-			while (cmd.bundles != NULL) {
-				cur = cmd.bundles;
-				cmd.bundles = cmd.bundles->next;
-				cur->data->serialized++;
-				report_bundle(
-					router_signaling_queue,
-					cur->data,
-					ROUTER_SIGNAL_TRANSMISSION_FAILURE
-				);
-				/* Free only the RB list, the RB is reported */
-				free(cur);
-			}
+	while ((count = hal_queue_receive_batch(link->tx_queue_handle, cmds,
+						ARRAY_LENGTH(cmds), 0)) > 0) {
+		for (i = 0; i < count; i++) {
+			if (cmds[i].type == TX_COMMAND_BUNDLES)
+				discard_bundles(link, cmds[i].bundles,
+						completions);
+		}
+	}
+	report_completions(link, completions);
+}
+
+#if HAL_EXECUTOR_WORKERS
+
+/*
+ * Performs the queued commands, submitted on every new one and by the CLA
+ * once a link that was not ready (see cla_tx_ready()) can take more data.
+ * Thus, a slow link never blocks the worker.
+ */
+static void cla_contact_tx_work(struct hal_work *work)
+{
+	struct cla_link *link = (struct cla_link *)(
+		(char *)work - offsetof(struct cla_link, tx_work));
+	struct tx_completions completions = { .count = 0 };
+	struct routed_bundle_list *entry;
+
+	// A submission may have raced with the finalization
+	if (link->tx_finalized)
+		return;
+
+	while (link->active) {
+		// Check for new bundles before every transmission
+		if (!link->tx_finalizing)
+			link->tx_finalizing =
+				!fetch_commands(link, 0, &completions);
+		if (!link_ready(link)) {
+			report_completions(link, &completions);
+			if (!link_ready(link))
+				return;
+		}
+		entry = cla_tx_scheduler_dequeue(&link->tx_scheduler);
+		if (entry == NULL) {
+			report_completions(link, &completions);
+			// The link drains its output before the TX side ends
+			if (!link->tx_finalizing || !link_ready(link))
+				return;
+			break;
 		}
+		transmit_bundle(link, entry, &completions);
 	}
 
+	discard_pending(link, &completions);
+	link->tx_finalized = true;
+	cla_link_side_ended(link);
+
+	// After releasing the semaphore, link may become invalid as soon as
+	// the work item has been cancelled.
+	hal_semaphore_release(link->tx_task_sem);
+}
+
+#else /* HAL_EXECUTOR_WORKERS */
+
+static void cla_contact_tx_task(void *param)
+{
+	struct cla_link *link = param;
+	struct tx_completions completions = { .count = 0 };
+	struct routed_bundle_list *entry;
+	bool finalize = false;
+
+	while (link->active) {
+		// Blocking links drain on cla_flush()
+		if (!link_ready(link)) {
+			report_completions(link, &completions);
+			continue;
+		}
+		entry = cla_tx_scheduler_dequeue(&link->tx_scheduler);
+		if (entry == NULL) {
+			report_completions(link, &completions);
+			if (finalize)
+				break;
+			// Wait for new bundles only if all have been sent
+			finalize = !fetch_commands(link, -1, &completions);
+			continue;
+		}
+		transmit_bundle(link, entry, &completions);
+		if (!finalize)
+			finalize = !fetch_commands(link, 0, &completions);
+	}
+
+	discard_pending(link, &completions);
+
 	Task_t tx_task_handle = link->tx_task_handle;
 
 	// After releasing the semaphore, link may become invalid.
@@ -128,8 +289,19 @@ static void cla_contact_tx_task(void *param)
 	hal_task_delete(tx_task_handle);
 }
 
+#endif /* HAL_EXECUTOR_WORKERS */
+
 enum ud3tn_result cla_launch_contact_tx_task(struct cla_link *link)
 {
+#if HAL_EXECUTOR_WORKERS
+	// The semaphore is released by the run processing TX_COMMAND_FINALIZE
+	hal_semaphore_take_blocking(link->tx_task_sem);
+	link->tx_finalizing = false;
+	link->tx_finalized = false;
+	hal_work_init(&link->tx_work, cla_contact_tx_work);
+
+	return UD3TN_OK;
+#else /* HAL_EXECUTOR_WORKERS */
 	static uint8_t ctr = 1;
 	static char tname_buf[6];
 
@@ -148,15 +320,70 @@ enum ud3tn_result cla_launch_contact_tx_task(struct cla_link *link)
 	);
 
 	return link->tx_task_handle ? UD3TN_OK : UD3TN_FAIL;
+#endif /* HAL_EXECUTOR_WORKERS */
+}
+
+void cla_contact_tx_task_wait_exit(struct cla_link *link)
+{
+	hal_semaphore_take_blocking(link->tx_task_sem);
+#if HAL_EXECUTOR_WORKERS
+	// Submissions racing with the finalization may still be pending
+	hal_work_cancel_sync(&link->tx_work);
+#endif /* HAL_EXECUTOR_WORKERS */
 }
 
-void cla_contact_tx_task_request_exit(QueueIdentifier_t queue)
+static uint32_t count_bundles(const struct cla_contact_tx_task_command *cmd)
+{
+	const struct routed_bundle_list *cur;
+	uint32_t count = 0;
+
+	if (cmd->type != TX_COMMAND_BUNDLES)
+		return 0;
+	for (cur = cmd->bundles; cur != NULL; cur = cur->next)
+		count++;
+	return count;
+}
+
+enum ud3tn_result cla_contact_tx_task_push(
+	struct cla_tx_queue tx_queue,
+	const struct cla_contact_tx_task_command *command,
+	int timeout)
+{
+	struct cla_link *const link = tx_queue.link;
+	const uint32_t count = count_bundles(command);
+	enum ud3tn_result result = UD3TN_OK;
+
+	ASSERT(tx_queue.tx_queue_handle != NULL);
+	// Do not wait for a slow link, the caller may retry later
+	if (count != 0 && !cla_tx_window_acquire(&link->tx_window, count))
+		return UD3TN_FAIL;
+	if (timeout < 0) {
+		hal_queue_push_to_back(tx_queue.tx_queue_handle, command);
+	} else {
+		result = hal_queue_try_push_to_back(tx_queue.tx_queue_handle,
+						    command, timeout);
+		if (result != UD3TN_OK)
+			cla_tx_window_cancel(&link->tx_window, count);
+	}
+#if HAL_EXECUTOR_WORKERS
+	if (result == UD3TN_OK)
+		hal_work_submit(&tx_queue.link->tx_work);
+#endif /* HAL_EXECUTOR_WORKERS */
+
+	return result;
+}
+
+void cla_contact_tx_task_request_exit(struct cla_link *link)
 {
 	struct cla_contact_tx_task_command command = {
 		.type = TX_COMMAND_FINALIZE,
 		.bundles = NULL,
 	};
+	struct cla_tx_queue tx_queue = {
+		.tx_queue_handle = link->tx_queue_handle,
+		.tx_queue_sem = link->tx_queue_sem,
+		.link = link,
+	};
 
-	ASSERT(queue != NULL);
-	hal_queue_push_to_back(queue, &command);
+	cla_contact_tx_task_push(tx_queue, &command, -1);
 }
@@ -0,0 +1,142 @@
+#include "cla/cla_tx_scheduler.h"
+
+#include "ud3tn/config.h"
+
+#include "util/htab_hash.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static const uint32_t lane_quantum[BUNDLE_RPRIO_HIGH] = {
+	[BUNDLE_RPRIO_LOW] = CLA_TX_WEIGHT_LOW * CLA_TX_SCHEDULER_QUANTUM,
+	[BUNDLE_RPRIO_NORMAL] = CLA_TX_WEIGHT_NORMAL * CLA_TX_SCHEDULER_QUANTUM,
+};
+
+static void init_lane(struct cla_tx_lane *lane)
+{
+	lane->head = NULL;
+	lane->tail = NULL;
+	lane->deficit = 0;
+}
+
+void cla_tx_scheduler_init(struct cla_tx_scheduler *scheduler)
+{
+	int i;
+
+	init_lane(&scheduler->strict);
+	for (i = 0; i < CLA_TX_SCHEDULER_FAIR_LANES; i++)
+		init_lane(&scheduler->fair[i]);
+	scheduler->strict_burst = 0;
+	scheduler->current = CLA_TX_SCHEDULER_FAIR_LANES - 1;
+	scheduler->granted = false;
+}
+
+static struct cla_tx_lane *get_lane(struct cla_tx_scheduler *scheduler,
+				    const struct routed_bundle *rb)
+{
+	int prio = rb->prio;
+	uint32_t flow = 0;
+
+	if (prio == BUNDLE_RPRIO_HIGH)
+		return &scheduler->strict;
+	if (prio < 0 || prio >= BUNDLE_RPRIO_HIGH)
+		prio = BUNDLE_RPRIO_LOW;
+	if (CLA_TX_SCHEDULER_FLOWS > 1 && rb->destination != NULL)
+		flow = hashlittle(rb->destination, strlen(rb->destination), 0)
+			% CLA_TX_SCHEDULER_FLOWS;
+	return &scheduler->fair[prio * CLA_TX_SCHEDULER_FLOWS + flow];
+}
+
+void cla_tx_scheduler_enqueue(struct cla_tx_scheduler *scheduler,
+			      struct routed_bundle_list *bundles)
+{
+	struct routed_bundle_list *cur;
+	struct cla_tx_lane *lane;
+
+	while (bundles != NULL) {
+		cur = bundles;
+		bundles = bundles->next;
+		cur->next = NULL;
+		lane = get_lane(scheduler, cur->data);
+		if (lane->tail == NULL)
+			lane->head = cur;
+		else
+			lane->tail->next = cur;
+		lane->tail = cur;
+	}
+}
+
+static struct routed_bundle_list *pop_lane(struct cla_tx_lane *lane)
+{
+	struct routed_bundle_list *entry = lane->head;
+
+	lane->head = entry->next;
+	if (lane->head == NULL)
+		lane->tail = NULL;
+	entry->next = NULL;
+	return entry;
+}
+
+static void next_lane(struct cla_tx_scheduler *scheduler)
+{
+	scheduler->current = (scheduler->current == 0)
+		? CLA_TX_SCHEDULER_FAIR_LANES - 1
+		: scheduler->current - 1;
+	scheduler->granted = false;
+}
+
+struct routed_bundle_list *cla_tx_scheduler_dequeue(
+	struct cla_tx_scheduler *scheduler)
+{
+	struct routed_bundle_list *entry;
+	struct cla_tx_lane *lane;
+	uint32_t size;
+	int i, backlogged = 0;
+
+	for (i = 0; i < CLA_TX_SCHEDULER_FAIR_LANES; i++) {
+		if (scheduler->fair[i].head != NULL)
+			backlogged++;
+	}
+	if (scheduler->strict.head != NULL &&
+	    (backlogged == 0 ||
+	     scheduler->strict_burst < CLA_TX_HIGH_BURST)) {
+		entry = pop_lane(&scheduler->strict);
+		scheduler->strict_burst += entry->data->size;
+		return entry;
+	}
+	// Either there is nothing to send, or the fair lanes get their turn
+	scheduler->strict_burst = 0;
+	if (backlogged == 0)
+		return NULL;
+
+	for (;;) {
+		lane = &scheduler->fair[scheduler->current];
+		if (lane->head == NULL) {
+			lane->deficit = 0;
+			next_lane(scheduler);
+			continue;
+		}
+		// Without competition, there is no need to wait for credit
+		if (backlogged == 1) {
+			lane->deficit = 0;
+			return pop_lane(lane);
+		}
+		if (!scheduler->granted) {
+			lane->deficit += lane_quantum[
+				scheduler->current / CLA_TX_SCHEDULER_FLOWS];
+			scheduler->granted = true;
+		}
+		size = lane->head->data->size;
+		if (size <= lane->deficit) {
+			lane->deficit -= size;
+			entry = pop_lane(lane);
+			if (lane->head == NULL) {
+				lane->deficit = 0;
+				next_lane(scheduler);
+			}
+			return entry;
+		}
+		next_lane(scheduler);
+	}
+}
@@ -0,0 +1,54 @@
+#include "cla/cla_tx_window.h"
+
+#include "ud3tn/common.h"
+#include "ud3tn/config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void cla_tx_window_init(struct cla_tx_window *window)
+{
+	window->outstanding = 0;
+	window->size = CONTACT_TX_TASK_QUEUE_LENGTH;
+	window->limited = false;
+}
+
+bool cla_tx_window_acquire(struct cla_tx_window *window, uint32_t count)
+{
+	uint32_t outstanding = __atomic_load_n(&window->outstanding,
+					       __ATOMIC_RELAXED);
+
+	do {
+		// A single command exceeding the window is admitted alone
+		if (outstanding != 0 && outstanding + count >
+		    __atomic_load_n(&window->size, __ATOMIC_RELAXED)) {
+			__atomic_store_n(&window->limited, true,
+					 __ATOMIC_RELAXED);
+			return false;
+		}
+	} while (!__atomic_compare_exchange_n(&window->outstanding,
+					      &outstanding, outstanding + count,
+					      true, __ATOMIC_ACQUIRE,
+					      __ATOMIC_RELAXED));
+	return true;
+}
+
+void cla_tx_window_release(struct cla_tx_window *window, uint32_t count,
+			   bool failed)
+{
+	uint32_t size = __atomic_load_n(&window->size, __ATOMIC_RELAXED);
+
+	// Grow the window while the link keeps up with its producers
+	if (failed)
+		size = MAX(size / 2, CONTACT_TX_TASK_QUEUE_LENGTH);
+	else if (__atomic_exchange_n(&window->limited, false,
+				     __ATOMIC_RELAXED))
+		size = MIN(size * 2, CLA_TX_WINDOW_MAX);
+	__atomic_store_n(&window->size, size, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&window->outstanding, count, __ATOMIC_RELEASE);
+}
+
+void cla_tx_window_cancel(struct cla_tx_window *window, uint32_t count)
+{
+	__atomic_sub_fetch(&window->outstanding, count, __ATOMIC_RELAXED);
+}
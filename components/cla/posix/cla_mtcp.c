@@ -9,6 +9,7 @@
 #include "bundle7/parser.h"
 
 #include "platform/hal_config.h"
+#include "platform/hal_executor.h"
 #include "platform/hal_io.h"
 #include "platform/hal_semaphore.h"
 #include "platform/hal_task.h"
@@ -53,6 +54,11 @@ struct mtcp_contact_parameters {
 	int connect_attempt;
 
 	int socket;
+
+#if HAL_EXECUTOR_WORKERS
+	// Cleans up after an incoming connection served without a task
+	struct hal_work closed_work;
+#endif
 };
 
 
@@ -61,6 +67,10 @@ static enum ud3tn_result handle_established_connection(
 {
 	struct mtcp_config *const mtcp_config = param->config;
 
+#if HAL_EXECUTOR_WORKERS
+	// This task waits for the link to end
+	param->link.base.base.closed_work = NULL;
+#endif
 	if (cla_tcp_link_init(&param->link.base, param->socket,
 			      &mtcp_config->base)
 			!= UD3TN_OK) {
@@ -68,11 +78,18 @@ static enum ud3tn_result handle_established_connection(
 		return UD3TN_FAIL;
 	}
 
-	cla_link_wait_cleanup(&param->link.base.base);
+	cla_tcp_link_wait_cleanup(&param->link.base);
 
 	return UD3TN_OK;
 }
 
+static void free_contact_parameters(struct mtcp_contact_parameters *param)
+{
+	mtcp_parser_reset(&param->link.mtcp_parser);
+	free(param->cla_sock_addr);
+	free(param);
+}
+
 static void mtcp_link_management_task(void *p)
 {
 	struct mtcp_contact_parameters *const param = p;
@@ -114,15 +131,60 @@ static void mtcp_link_management_task(void *p)
 	hal_semaphore_take_blocking(param->config->param_htab_sem);
 	htab_remove(&param->config->param_htab, param->cla_sock_addr);
 	hal_semaphore_release(param->config->param_htab_sem);
-	mtcp_parser_reset(&param->link.mtcp_parser);
-	free(param->cla_sock_addr);
 
 	Task_t management_task = param->management_task;
 
-	free(param);
+	free_contact_parameters(param);
 	hal_task_delete(management_task);
 }
 
+static Task_t create_management_task(struct mtcp_contact_parameters *param)
+{
+	return hal_task_create(
+		mtcp_link_management_task,
+		"mtcp_mgmt_t",
+		CONTACT_MANAGEMENT_TASK_PRIORITY,
+		param,
+		CONTACT_MANAGEMENT_TASK_STACK_SIZE,
+		(void *)CLA_SPECIFIC_TASK_TAG
+	);
+}
+
+#if HAL_EXECUTOR_WORKERS
+
+static void mtcp_link_closed(struct hal_work *work)
+{
+	struct mtcp_contact_parameters *const param =
+		(struct mtcp_contact_parameters *)((char *)work - offsetof(
+			struct mtcp_contact_parameters, closed_work));
+	struct mtcp_config *const mtcp_config = param->config;
+
+	// RX and TX have already ended, thus, this does not block
+	cla_tcp_link_wait_cleanup(&param->link.base);
+
+	hal_semaphore_take_blocking(mtcp_config->param_htab_sem);
+	param->connected = false;
+	param->connect_attempt = 0;
+	param->socket = -1;
+	// If a contact has been associated meanwhile, a task reconnects
+	if (param->in_contact) {
+		param->management_task = create_management_task(param);
+		if (!param->management_task)
+			LOG("MTCP: Error creating management task!");
+	}
+	if (!param->management_task) {
+		LOGF("MTCP: Connection with \"%s\" closed",
+		     param->cla_sock_addr);
+		htab_remove(&mtcp_config->param_htab, param->cla_sock_addr);
+	}
+	hal_semaphore_release(mtcp_config->param_htab_sem);
+
+	if (!param->management_task)
+		free_contact_parameters(param);
+}
+
+#endif /* HAL_EXECUTOR_WORKERS */
+
 static void launch_connection_management_task(
 	struct mtcp_config *const mtcp_config,
 	const int sock, const char *cla_addr)
@@ -174,14 +236,26 @@ static void launch_connection_management_task(
 		goto fail;
 	}
 
-	contact_params->management_task = hal_task_create(
-		mtcp_link_management_task,
-		"mtcp_mgmt_t",
-		CONTACT_MANAGEMENT_TASK_PRIORITY,
-		contact_params,
-		CONTACT_MANAGEMENT_TASK_STACK_SIZE,
-		(void *)CLA_SPECIFIC_TASK_TAG
-	);
+#if HAL_EXECUTOR_WORKERS
+	// Incoming connections are served without a task of their own
+	if (contact_params->connected) {
+		contact_params->management_task = NULL;
+		hal_work_init(&contact_params->closed_work, mtcp_link_closed);
+		contact_params->link.base.base.closed_work =
+			&contact_params->closed_work;
+		if (cla_tcp_link_init(&contact_params->link.base, sock,
+				      &mtcp_config->base) == UD3TN_OK)
+			return;
+		LOG("MTCP: Error initializing CLA link!");
+		htab_remove(&mtcp_config->param_htab,
+			    contact_params->cla_sock_addr);
+		close(sock);
+		goto fail;
+	}
+#endif
+
+	contact_params->management_task =
+		create_management_task(contact_params);
 
 	if (!contact_params->management_task) {
 		LOG("MTCP: Error creating management task!");
@@ -362,16 +436,17 @@ static struct cla_tx_queue mtcp_get_tx_queue(
 
 		// Freed while trying to obtain it
 		if (!cla_link->tx_queue_handle)
-			return (struct cla_tx_queue){ NULL, NULL };
+			return (struct cla_tx_queue){ NULL, NULL, NULL };
 
 		return (struct cla_tx_queue){
 			.tx_queue_handle = cla_link->tx_queue_handle,
 			.tx_queue_sem = cla_link->tx_queue_sem,
+			.link = cla_link,
 		};
 	}
 
 	hal_semaphore_release(mtcp_config->param_htab_sem);
-	return (struct cla_tx_queue){ NULL, NULL };
+	return (struct cla_tx_queue){ NULL, NULL, NULL };
 }
 
 static enum ud3tn_result mtcp_start_scheduled_contact(
@@ -419,7 +494,8 @@ static enum ud3tn_result mtcp_end_scheduled_contact(
 		if (CLA_MTCP_CLOSE_AFTER_CONTACT && param->socket >= 0) {
 			LOGF("MTCP: Terminating connection with \"%s\"",
 			     cla_addr);
-			close(param->socket);
+			// The socket is closed by the disconnect handler
+			shutdown(param->socket, SHUT_RDWR);
 		}
 	}
 
@@ -441,7 +517,7 @@ void mtcp_begin_packet(struct cla_link *link, size_t length)
 
 	const size_t hdr_len = mtcp_encode_header(buffer, BUFFER_SIZE, length);
 
-	if (tcp_send_all(tcp_link->connection_socket, buffer, hdr_len) == -1) {
+	if (cla_tcp_write(tcp_link, buffer, hdr_len) != UD3TN_OK) {
 		LOG("mtcp: Error during sending. Data discarded.");
 		link->config->vtable->cla_disconnect_handler(link);
 	}
@@ -449,7 +525,7 @@ void mtcp_begin_packet(struct cla_link *link, size_t length)
 
 void mtcp_end_packet(struct cla_link *link)
 {
-	// STUB
+	// The data is sent by cla_tcp_flush_packets()
 	(void)link;
 }
 
@@ -462,7 +538,7 @@ void mtcp_send_packet_data(
 	if (!link->active)
 		return;
 
-	if (tcp_send_all(tcp_link->connection_socket, data, length) == -1) {
+	if (cla_tcp_write(tcp_link, data, length) != UD3TN_OK) {
 		LOG("mtcp: Error during sending. Data discarded.");
 		link->config->vtable->cla_disconnect_handler(link);
 	}
@@ -480,6 +556,8 @@ const struct cla_vtable mtcp_vtable = {
 	.cla_begin_packet = mtcp_begin_packet,
 	.cla_end_packet = mtcp_end_packet,
 	.cla_send_packet_data = mtcp_send_packet_data,
+	.cla_flush = cla_tcp_flush_packets,
+	.cla_tx_ready = cla_tcp_tx_ready,
 
 	.cla_rx_task_reset_parsers = mtcp_reset_parsers,
 	.cla_rx_task_forward_to_specific_parser =
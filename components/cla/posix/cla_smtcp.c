@@ -79,6 +79,8 @@ const struct cla_vtable smtcp_vtable = {
 	.cla_begin_packet = mtcp_begin_packet,
 	.cla_end_packet = mtcp_end_packet,
 	.cla_send_packet_data = mtcp_send_packet_data,
+	.cla_flush = cla_tcp_flush_packets,
+	.cla_tx_ready = cla_tcp_tx_ready,
 
 	.cla_rx_task_reset_parsers = mtcp_reset_parsers,
 	.cla_rx_task_forward_to_specific_parser =
@@ -3,8 +3,11 @@
 #include "cla/cla.h"
 #include "cla/cla_contact_tx_task.h"
 #include "cla/posix/cla_tcp_common.h"
+#include "cla/posix/cla_tcp_reactor.h"
 #include "cla/posix/cla_tcp_util.h"
 
+#include "platform/hal_config.h"
+#include "platform/hal_executor.h"
 #include "platform/hal_io.h"
 #include "platform/hal_semaphore.h"
 #include "platform/hal_task.h"
@@ -18,11 +21,14 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 enum ud3tn_result cla_tcp_config_init(
@@ -34,6 +40,10 @@ enum ud3tn_result cla_tcp_config_init(
 
 	config->listen_task = NULL;
 	config->socket = -1;
+#if HAL_EXECUTOR_WORKERS
+	// The sockets of all links are watched by the reactor
+	config->base.event_driven_rx = true;
+#endif
 
 	return UD3TN_OK;
 }
@@ -63,11 +73,44 @@ enum ud3tn_result cla_tcp_link_init(
 {
 	ASSERT(connected_socket >= 0);
 	link->connection_socket = connected_socket;
+	link->tx_head = NULL;
+	link->tx_tail = NULL;
+	link->tx_sent = 0;
+	link->tx_queued = 0;
+	link->tx_spare = NULL;
+	link->tx_waiting = false;
+#ifdef CLA_TCP_IO_URING
+	link->uring_rx.enabled = false;
+	link->uring_tx.enabled = false;
+	link->uring_tx.pending = false;
+#endif
+
+#if HAL_EXECUTOR_WORKERS
+	const int flags = fcntl(connected_socket, F_GETFL);
+
+	if (flags < 0 ||
+	    fcntl(connected_socket, F_SETFL, flags | O_NONBLOCK) < 0) {
+		LOGF("TCP: Cannot make socket non-blocking: %s",
+		     strerror(errno));
+		return UD3TN_FAIL;
+	}
+#endif
 
 	// This will fire up the RX and TX tasks
 	if (cla_link_init(&link->base, &config->base) != UD3TN_OK)
 		return UD3TN_FAIL;
 
+#if HAL_EXECUTOR_WORKERS
+	if (cla_tcp_reactor_add(link) != UD3TN_OK) {
+		// Tear the link down again, the socket is left to the caller
+		link->base.closed_work = NULL;
+		cla_generic_disconnect_handler(&link->base);
+		hal_work_submit(&link->base.rx_work);
+		cla_tcp_link_wait_cleanup(link);
+		return UD3TN_FAIL;
+	}
+#endif
+
 	return UD3TN_OK;
 }
 
@@ -77,14 +120,24 @@ enum ud3tn_result cla_tcp_read(struct cla_link *link,
 {
 	struct cla_tcp_link *tcp_link = (struct cla_tcp_link *)link;
 
-	const ssize_t ret = recv(
+	ssize_t ret;
+
+#ifdef CLA_TCP_IO_URING
+	if (tcp_link->uring_rx.enabled)
+		ret = cla_tcp_uring_recv(tcp_link, buffer, length);
+	else
+#endif
+	ret = recv(
 		tcp_link->connection_socket,
 		buffer,
 		length,
 		0
 	);
 
-	if (ret < 0) {
+	if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+		// Non-blocking socket drained, the reactor reports new data
+		ret = 0;
+	} else if (ret < 0) {
 		LOGF("TCP: Error reading from socket: %s", strerror(errno));
 		link->config->vtable->cla_disconnect_handler(link);
 		return UD3TN_FAIL;
@@ -99,6 +152,294 @@ enum ud3tn_result cla_tcp_read(struct cla_link *link,
 	return UD3TN_OK;
 }
 
+/* Maximum number of chunks passed to a single sendmsg() */
+#define TX_IOV_COUNT 16
+
+static struct cla_tcp_tx_chunk *alloc_chunk(struct cla_tcp_link *link,
+					    size_t length)
+{
+	struct cla_tcp_tx_chunk *chunk;
+
+	if (length <= CLA_TCP_TX_BUFFER_SIZE && link->tx_spare != NULL) {
+		chunk = link->tx_spare;
+		link->tx_spare = NULL;
+	} else {
+		length = MAX(length, CLA_TCP_TX_BUFFER_SIZE);
+		chunk = malloc(sizeof(struct cla_tcp_tx_chunk) + length);
+		if (chunk == NULL)
+			return NULL;
+		chunk->capacity = length;
+	}
+	chunk->next = NULL;
+	chunk->length = 0;
+
+	if (link->tx_tail != NULL)
+		link->tx_tail->next = chunk;
+	else
+		link->tx_head = chunk;
+	link->tx_tail = chunk;
+	return chunk;
+}
+
+static void free_chunk(struct cla_tcp_link *link,
+		       struct cla_tcp_tx_chunk *chunk)
+{
+	if (chunk->capacity == CLA_TCP_TX_BUFFER_SIZE &&
+	    link->tx_spare == NULL)
+		link->tx_spare = chunk;
+	else
+		free(chunk);
+}
+
+static void discard_queue(struct cla_tcp_link *link)
+{
+	struct cla_tcp_tx_chunk *chunk;
+
+	while (link->tx_head != NULL) {
+		chunk = link->tx_head;
+		link->tx_head = chunk->next;
+		free_chunk(link, chunk);
+	}
+	link->tx_tail = NULL;
+	link->tx_sent = 0;
+	link->tx_queued = 0;
+}
+
+/*
+ * Fills the I/O vector with the queued data and, if all of it fits, the
+ * given data. Adds MSG_MORE to the flags if queued data is left over.
+ *
+ * @return The number of entries used.
+ */
+static size_t fill_iov(struct cla_tcp_link *link, struct iovec *iov,
+		       size_t count, const void *data, size_t length,
+		       int *flags)
+{
+	struct cla_tcp_tx_chunk *chunk = link->tx_head;
+	size_t offset = link->tx_sent;
+	size_t used = 0;
+
+	for (; chunk != NULL && used < count; chunk = chunk->next) {
+		iov[used].iov_base = &chunk->data[offset];
+		iov[used].iov_len = chunk->length - offset;
+		used++;
+		offset = 0;
+	}
+	if (chunk == NULL && used < count && length != 0) {
+		iov[used].iov_base = (void *)data;
+		iov[used].iov_len = length;
+		used++;
+	} else {
+		// The rest of the packet follows with the next call
+		*flags |= chunk != NULL ? MSG_MORE : 0;
+	}
+	return used;
+}
+
+/*
+ * Removes the given number of sent bytes from the queue.
+ *
+ * @return The number of bytes exceeding the queued data.
+ */
+static size_t consume_sent(struct cla_tcp_link *link, size_t r)
+{
+	struct cla_tcp_tx_chunk *chunk;
+	size_t offset;
+
+	while (r > 0 && link->tx_head != NULL) {
+		chunk = link->tx_head;
+		offset = chunk->length - link->tx_sent;
+		if (r < offset) {
+			link->tx_sent += r;
+			link->tx_queued -= r;
+			return 0;
+		}
+		r -= offset;
+		link->tx_queued -= offset;
+		link->tx_sent = 0;
+		link->tx_head = chunk->next;
+		if (link->tx_head == NULL)
+			link->tx_tail = NULL;
+		free_chunk(link, chunk);
+	}
+	return r;
+}
+
+/*
+ * Offers the queued data and, if all of it fits into the I/O vector, the
+ * given data to the socket with a single sendmsg(). Removes what has been
+ * sent from the queue.
+ *
+ * @return The number of bytes sent of the given data, -1 on error.
+ */
+static ssize_t send_queued(struct cla_tcp_link *link,
+			   const void *data, size_t length, int flags)
+{
+	struct iovec iov[TX_IOV_COUNT];
+	struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 0 };
+	ssize_t r;
+
+	msg.msg_iovlen = fill_iov(link, iov, TX_IOV_COUNT, data, length,
+				  &flags);
+	do {
+		r = sendmsg(link->connection_socket, &msg, flags);
+	} while (r < 0 && errno == EINTR);
+	if (r < 0)
+		return -1;
+
+	return (ssize_t)consume_sent(link, (size_t)r);
+}
+
+// Whether the queue must not be sent from by cla_tcp_write() directly
+static bool tx_busy(struct cla_tcp_link *link)
+{
+#ifdef CLA_TCP_IO_URING
+	// A pending send request references the queue
+	if (link->uring_tx.pending)
+		return true;
+#endif
+	return __atomic_load_n(&link->tx_waiting, __ATOMIC_RELAXED);
+}
+
+enum ud3tn_result cla_tcp_write(struct cla_tcp_link *link,
+				const void *data, size_t length)
+{
+	struct cla_tcp_tx_chunk *chunk = link->tx_tail;
+	ssize_t sent = 0;
+
+	if (length == 0)
+		return UD3TN_OK;
+
+	if (chunk == NULL || chunk->capacity - chunk->length < length) {
+		// The last byte is kept back, so the flush at the end of the
+		// packet always has data to push out what is held back due
+		// to MSG_MORE.
+		if (length > CLA_TCP_TX_BUFFER_SIZE && !tx_busy(link)) {
+			sent = send_queued(link, data, length - 1, MSG_MORE);
+			if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+				return UD3TN_FAIL;
+			sent = MAX(sent, 0);
+		}
+		chunk = alloc_chunk(link, length - sent);
+		if (chunk == NULL) {
+			errno = ENOMEM;
+			return UD3TN_FAIL;
+		}
+	}
+	memcpy(&chunk->data[chunk->length], (const uint8_t *)data + sent,
+	       length - sent);
+	chunk->length += length - sent;
+	link->tx_queued += length - sent;
+
+	return UD3TN_OK;
+}
+
+#ifdef CLA_TCP_IO_URING
+
+/*
+ * Sends the queue with one io_uring request at a time, see cla_tcp_uring.h.
+ * Called again by the TX work item once the request has completed.
+ */
+static enum ud3tn_result flush_uring(struct cla_tcp_link *link)
+{
+	struct cla_tcp_uring_tx *const tx = &link->uring_tx;
+	ssize_t sent = cla_tcp_uring_send_result(link);
+	size_t count;
+	int flags = 0;
+
+	if (sent < 0) {
+		if (errno == EINPROGRESS)
+			return UD3TN_OK;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return UD3TN_FAIL;
+		// As below, the socket is tried once more after the reactor
+		// has been asked to report the next time it becomes writable.
+		if (__atomic_exchange_n(&link->tx_waiting, true,
+					__ATOMIC_SEQ_CST))
+			return UD3TN_OK;
+		sent = 0;
+	}
+	consume_sent(link, (size_t)sent);
+	if (link->tx_queued == 0)
+		return UD3TN_OK;
+
+	count = fill_iov(link, tx->iov, ARRAY_LENGTH(tx->iov), NULL, 0,
+			 &flags);
+	cla_tcp_uring_send(link, count, flags);
+	return UD3TN_OK;
+}
+
+#endif /* CLA_TCP_IO_URING */
+
+enum ud3tn_result cla_tcp_flush(struct cla_tcp_link *link)
+{
+	bool waiting = false;
+
+#ifdef CLA_TCP_IO_URING
+	if (link->uring_tx.enabled)
+		return flush_uring(link);
+#endif
+
+	while (link->tx_queued != 0) {
+		if (send_queued(link, NULL, 0, 0) >= 0)
+			continue;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return UD3TN_FAIL;
+		if (waiting)
+			break;
+		// The reactor reports the next time the socket becomes
+		// writable. As this may have happened before the flag was
+		// set, the socket is tried once more.
+		__atomic_store_n(&link->tx_waiting, true, __ATOMIC_SEQ_CST);
+		waiting = true;
+	}
+
+	return UD3TN_OK;
+}
+
+void cla_tcp_flush_packets(struct cla_link *link)
+{
+	struct cla_tcp_link *const tcp_link = (struct cla_tcp_link *)link;
+
+	// A previous operation may have canceled the sending process.
+	if (!link->active) {
+#ifdef CLA_TCP_IO_URING
+		// The kernel may still read from the queue until the link has
+		// been removed from the backend, it is discarded on cleanup.
+		if (tcp_link->uring_tx.pending)
+			return;
+#endif
+		discard_queue(tcp_link);
+		return;
+	}
+
+	if (cla_tcp_flush(tcp_link) != UD3TN_OK) {
+		LOGF("TCP: Error during sending: %s", strerror(errno));
+		link->config->vtable->cla_disconnect_handler(link);
+	}
+}
+
+bool cla_tcp_tx_ready(struct cla_link *link)
+{
+	const struct cla_tcp_link *const tcp_link =
+		(struct cla_tcp_link *)link;
+
+#if HAL_EXECUTOR_WORKERS
+	// Everything queued is sent before the TX side ends
+	if (link->tx_finalizing)
+		return tcp_link->tx_queued == 0 || !link->active;
+#endif
+	return tcp_link->tx_queued < CLA_TCP_TX_QUEUE_LIMIT;
+}
+
+void cla_tcp_link_wait_cleanup(struct cla_tcp_link *link)
+{
+	cla_link_wait_cleanup(&link->base);
+	discard_queue(link);
+	free(link->tx_spare);
+	link->tx_spare = NULL;
+}
+
 enum ud3tn_result cla_tcp_connect(struct cla_tcp_config *const config,
 				  const char *node, const char *service)
 {
@@ -217,8 +558,20 @@ void cla_tcp_disconnect_handler(struct cla_link *link)
 {
 	struct cla_tcp_link *tcp_link = (struct cla_tcp_link *)link;
 
+	// RX and TX may both run into the broken connection, but the socket
+	// must only be closed once as its number may be reused afterwards.
+	if (!__atomic_exchange_n(&link->active, false, __ATOMIC_ACQ_REL))
+		return;
+
+#if HAL_EXECUTOR_WORKERS
+	cla_tcp_reactor_remove(tcp_link);
+#endif
 	close(tcp_link->connection_socket);
 	cla_generic_disconnect_handler(link);
+#if HAL_EXECUTOR_WORKERS
+	// Without further events, the RX side has to be told about the end
+	hal_work_submit(&link->rx_work);
+#endif
 }
 
 void cla_tcp_single_disconnect_handler(struct cla_link *link)
@@ -240,6 +593,10 @@ static void handle_established_connection(
 	ASSERT(!config->link);
 	config->link = link;
 
+#if HAL_EXECUTOR_WORKERS
+	// This task waits for the link to end
+	link->base.closed_work = NULL;
+#endif
 	if (cla_tcp_link_init(link, sock, &config->base) != UD3TN_OK) {
 		LOG("TCP: Error creating a link instance!");
 	} else {
@@ -253,7 +610,7 @@ static void handle_established_connection(
 
 		hal_queue_push_to_back(bai->router_signaling_queue, &rt_signal);
 
-		cla_link_wait_cleanup(&link->base);
+		cla_tcp_link_wait_cleanup(link);
 	}
 	config->link = NULL;
 	free(link);
@@ -341,17 +698,18 @@ struct cla_tx_queue cla_tcp_single_get_tx_queue(
 
 	// No active link!
 	if (!link)
-		return (struct cla_tx_queue){ NULL, NULL };
+		return (struct cla_tx_queue){ NULL, NULL, NULL };
 
 	hal_semaphore_take_blocking(link->base.tx_queue_sem);
 
 	// Freed while trying to obtain it
 	if (!link->base.tx_queue_handle)
-		return (struct cla_tx_queue){ NULL, NULL };
+		return (struct cla_tx_queue){ NULL, NULL, NULL };
 
 	return (struct cla_tx_queue){
 		.tx_queue_handle = link->base.tx_queue_handle,
 		.tx_queue_sem = link->base.tx_queue_sem,
+		.link = &link->base,
 	};
 }
 
@@ -0,0 +1,196 @@
+#include "cla/cla.h"
+#include "cla/posix/cla_tcp_common.h"
+#include "cla/posix/cla_tcp_reactor.h"
+#include "cla/posix/cla_tcp_uring.h"
+
+#include "platform/hal_config.h"
+#include "platform/hal_executor.h"
+#include "platform/hal_io.h"
+#include "platform/hal_task.h"
+
+#include "ud3tn/common.h"
+#include "ud3tn/config.h"
+#include "ud3tn/result.h"
+#include "ud3tn/task_tags.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#if HAL_EXECUTOR_WORKERS
+
+static int epoll_fd = -1;
+// Registered without a link, wakes up the reactor for a removal
+static int wakeup_fd = -1;
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+#ifdef CLA_TCP_IO_URING
+// Whether the io_uring backend receives instead of the epoll reactor
+static bool use_io_uring;
+#endif
+
+// Counts the handled batches of events, see cla_tcp_reactor_remove()
+static uint64_t iterations;
+static pthread_mutex_t iteration_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t iteration_done = PTHREAD_COND_INITIALIZER;
+
+static void reactor_task(void *param)
+{
+	struct epoll_event events[CLA_TCP_REACTOR_EVENT_BATCH];
+	struct cla_tcp_link *link;
+	uint64_t wakeups;
+	int count, i;
+
+	(void)param;
+	for (;;) {
+		count = epoll_wait(epoll_fd, events, ARRAY_LENGTH(events), -1);
+		if (count < 0) {
+			if (errno != EINTR) {
+				LOGF("TCP: Waiting for socket events failed: %s",
+				     strerror(errno));
+				ASSERT(0);
+			}
+			count = 0;
+		}
+
+		for (i = 0; i < count; i++) {
+			link = events[i].data.ptr;
+			if (link == NULL) {
+				// Reset the counter of the non-blocking eventfd
+				while (read(wakeup_fd, &wakeups,
+					    sizeof(wakeups)) > 0)
+					;
+				continue;
+			}
+			// The TX side waits for space in the send buffer only
+			// if it has data left in the output queue.
+			if ((events[i].events &
+			     (EPOLLOUT | EPOLLERR | EPOLLHUP)) &&
+			    __atomic_exchange_n(&link->tx_waiting, false,
+						__ATOMIC_ACQ_REL))
+				hal_work_submit(&link->base.tx_work);
+			// The RX side reads until the socket is drained, as
+			// there is no further event before.
+			if (events[i].events &
+			    (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP))
+				hal_work_submit(&link->base.rx_work);
+		}
+
+		pthread_mutex_lock(&iteration_lock);
+		iterations++;
+		pthread_cond_broadcast(&iteration_done);
+		pthread_mutex_unlock(&iteration_lock);
+	}
+}
+
+static void start_reactor(void)
+{
+	struct epoll_event event = {
+		.events = EPOLLIN,
+		.data.ptr = NULL,
+	};
+
+#ifdef CLA_TCP_IO_URING
+	// Sockets are still watched by epoll for writability, in case the
+	// send buffer is full (see flush_uring())
+	if (cla_tcp_uring_start() == UD3TN_OK) {
+		LOG("TCP: Sending and receiving via io_uring");
+		use_io_uring = true;
+	} else {
+		LOG("TCP: io_uring not supported, falling back to epoll");
+	}
+#endif
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0)
+		goto fail_epoll;
+	wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (wakeup_fd < 0)
+		goto fail_eventfd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &event) < 0)
+		goto fail_task;
+
+	if (hal_task_create(
+			reactor_task,
+			"tcp_reactor_t",
+			CONTACT_LISTEN_TASK_PRIORITY,
+			NULL,
+			CONTACT_LISTEN_TASK_STACK_SIZE,
+			(void *)CLA_SPECIFIC_TASK_TAG) == NULL)
+		goto fail_task;
+
+	return;
+
+fail_task:
+	close(wakeup_fd);
+fail_eventfd:
+	close(epoll_fd);
+fail_epoll:
+	LOGF("TCP: Starting the reactor failed: %s", strerror(errno));
+	epoll_fd = -1;
+}
+
+enum ud3tn_result cla_tcp_reactor_add(struct cla_tcp_link *link)
+{
+	struct epoll_event event = {
+		.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+		.data.ptr = link,
+	};
+
+	// The reactor is started with the first link
+	pthread_once(&start_once, start_reactor);
+	if (epoll_fd < 0)
+		return UD3TN_FAIL;
+#ifdef CLA_TCP_IO_URING
+	if (use_io_uring)
+		event.events = EPOLLOUT | EPOLLET;
+#endif
+
+	link->tx_waiting = false;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, link->connection_socket,
+		      &event) < 0) {
+		LOGF("TCP: Cannot watch socket: %s", strerror(errno));
+		return UD3TN_FAIL;
+	}
+
+#ifdef CLA_TCP_IO_URING
+	if (use_io_uring && cla_tcp_uring_add(link) != UD3TN_OK) {
+		cla_tcp_reactor_remove(link);
+		return UD3TN_FAIL;
+	}
+#endif
+
+	return UD3TN_OK;
+}
+
+void cla_tcp_reactor_remove(struct cla_tcp_link *link)
+{
+	const uint64_t wakeup = 1;
+	uint64_t target;
+
+#ifdef CLA_TCP_IO_URING
+	if (link->uring_rx.enabled)
+		cla_tcp_uring_remove(link);
+#endif
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, link->connection_socket,
+		      NULL) < 0)
+		LOGF("TCP: Cannot stop watching socket: %s", strerror(errno));
+
+	// Events of the socket may have been fetched before it was removed.
+	// They are handled at the latest by the current iteration, which is
+	// forced to end if the reactor is waiting for events.
+	pthread_mutex_lock(&iteration_lock);
+	target = iterations + 1;
+	if (write(wakeup_fd, &wakeup, sizeof(wakeup)) < 0)
+		LOGF("TCP: Cannot wake up reactor: %s", strerror(errno));
+	while (iterations < target)
+		pthread_cond_wait(&iteration_done, &iteration_lock);
+	pthread_mutex_unlock(&iteration_lock);
+}
+
+#endif /* HAL_EXECUTOR_WORKERS */
@@ -0,0 +1,532 @@
+#include "cla/cla.h"
+#include "cla/posix/cla_tcp_common.h"
+#include "cla/posix/cla_tcp_uring.h"
+
+#include "platform/hal_executor.h"
+#include "platform/hal_io.h"
+#include "platform/hal_task.h"
+
+#include "ud3tn/common.h"
+#include "ud3tn/config.h"
+#include "ud3tn/result.h"
+#include "ud3tn/task_tags.h"
+
+#ifdef CLA_TCP_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Buffer group of the provided buffer ring
+#define BUFFER_GROUP 0
+// Tags the user data of send requests, which is the address of the link
+#define SEND_REQUEST 1
+
+#if (CLA_TCP_URING_BUFFER_COUNT & (CLA_TCP_URING_BUFFER_COUNT - 1)) != 0
+#error "CLA_TCP_URING_BUFFER_COUNT must be a power of two"
+#endif
+
+static struct {
+	int fd;
+
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int sq_mask;
+	unsigned int *sq_array;
+	struct io_uring_sqe *sqes;
+
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int cq_mask;
+	struct io_uring_cqe *cqes;
+
+	struct io_uring_buf_ring *buf_ring;
+	uint16_t buf_tail;
+	uint8_t *buffers;
+} ring = { .fd = -1 };
+
+// Serializes the producers of the submission queue
+static pthread_mutex_t submit_lock = PTHREAD_MUTEX_INITIALIZER;
+// Serializes the producers of the buffer ring
+static pthread_mutex_t buffer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Queues of received buffers, see struct cla_tcp_uring_rx
+static int32_t next_buffer[CLA_TCP_URING_BUFFER_COUNT];
+static uint32_t buffer_length[CLA_TCP_URING_BUFFER_COUNT];
+
+static int uring_enter(unsigned int to_submit, unsigned int min_complete,
+		       unsigned int flags)
+{
+	return (int)syscall(__NR_io_uring_enter, ring.fd, to_submit,
+			    min_complete, flags, NULL, 0);
+}
+
+static void submit(const struct io_uring_sqe *sqe)
+{
+	unsigned int tail, head;
+
+	pthread_mutex_lock(&submit_lock);
+	tail = *ring.sq_tail;
+	ring.sqes[tail & ring.sq_mask] = *sqe;
+	ring.sq_array[tail & ring.sq_mask] = tail & ring.sq_mask;
+	__atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	// The entry is visible to the kernel now, thus, it cannot be
+	// withdrawn anymore if entering fails temporarily.
+	for (;;) {
+		head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+		if (head == tail + 1)
+			break;
+		if (uring_enter(tail + 1 - head, 0, 0) >= 0)
+			continue;
+		if (errno == EAGAIN || errno == EBUSY)
+			hal_task_delay(1);
+		else if (errno != EINTR) {
+			LOGF("TCP: Submitting to io_uring failed: %s",
+			     strerror(errno));
+			ASSERT(0);
+		}
+	}
+	pthread_mutex_unlock(&submit_lock);
+}
+
+static void recycle_buffer(int32_t bid)
+{
+	struct io_uring_buf *buf;
+
+	pthread_mutex_lock(&buffer_lock);
+	buf = &ring.buf_ring->bufs[ring.buf_tail &
+				   (CLA_TCP_URING_BUFFER_COUNT - 1)];
+	buf->addr = (uintptr_t)&ring.buffers[
+		(size_t)bid * CLA_TCP_URING_BUFFER_SIZE];
+	buf->len = CLA_TCP_URING_BUFFER_SIZE;
+	buf->bid = (uint16_t)bid;
+	ring.buf_tail++;
+	__atomic_store_n(&ring.buf_ring->tail, ring.buf_tail,
+			 __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&buffer_lock);
+}
+
+// Has to be called with the lock of the link held
+static void arm_receive(struct cla_tcp_link *link)
+{
+	const struct io_uring_sqe sqe = {
+		.opcode = IORING_OP_RECV,
+		.flags = IOSQE_BUFFER_SELECT,
+		.ioprio = IORING_RECV_MULTISHOT,
+		.fd = link->connection_socket,
+		.buf_group = BUFFER_GROUP,
+		.user_data = (uintptr_t)link,
+	};
+
+	link->uring_rx.armed = true;
+	submit(&sqe);
+}
+
+static void handle_send_completion(const struct io_uring_cqe *cqe)
+{
+	struct cla_tcp_link *const link = (struct cla_tcp_link *)(uintptr_t)
+		(cqe->user_data & ~(uint64_t)SEND_REQUEST);
+	struct cla_tcp_uring_tx *const tx = &link->uring_tx;
+
+	pthread_mutex_lock(&tx->lock);
+	tx->result = cqe->res;
+	tx->in_flight = false;
+	pthread_cond_broadcast(&tx->completed);
+	// The TX side takes the result and sends what is left
+	if (!tx->removed)
+		hal_work_submit(&link->base.tx_work);
+	pthread_mutex_unlock(&tx->lock);
+}
+
+static void handle_completion(const struct io_uring_cqe *cqe)
+{
+	struct cla_tcp_link *const link =
+		(struct cla_tcp_link *)(uintptr_t)cqe->user_data;
+	struct cla_tcp_uring_rx *rx;
+	int32_t bid;
+
+	// Cancellations are acknowledged by the end of the request
+	if (link == NULL)
+		return;
+	if (cqe->user_data & SEND_REQUEST) {
+		handle_send_completion(cqe);
+		return;
+	}
+
+	rx = &link->uring_rx;
+	pthread_mutex_lock(&rx->lock);
+	if (cqe->res > 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+		bid = (int32_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+		buffer_length[bid] = (uint32_t)cqe->res;
+		next_buffer[bid] = -1;
+		if (rx->head < 0)
+			rx->head = bid;
+		else
+			next_buffer[rx->tail] = bid;
+		rx->tail = bid;
+	} else if (cqe->res == 0) {
+		rx->eof = true;
+	} else if (cqe->res != -ENOBUFS && !rx->removed) {
+		// Running out of buffers is handled in cla_tcp_uring_recv()
+		rx->error = -cqe->res;
+	}
+
+	if (!(cqe->flags & IORING_CQE_F_MORE)) {
+		rx->armed = false;
+		pthread_cond_broadcast(&rx->disarmed);
+	}
+	// Still holding the lock, as the link may be gone after a removal
+	if (!rx->removed)
+		hal_work_submit(&link->base.rx_work);
+	pthread_mutex_unlock(&rx->lock);
+}
+
+static void uring_task(void *param)
+{
+	unsigned int head, tail;
+
+	(void)param;
+	for (;;) {
+		if (uring_enter(0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+		    errno != EINTR) {
+			LOGF("TCP: Waiting for io_uring completions failed: %s",
+			     strerror(errno));
+			ASSERT(0);
+		}
+
+		head = *ring.cq_head;
+		tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++)
+			handle_completion(&ring.cqes[head & ring.cq_mask]);
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	}
+}
+
+// Multishot receives (Linux 6.0) are not announced by a feature flag
+static bool probe_multishot_recv(void)
+{
+	struct io_uring_sqe sqe = {
+		.opcode = IORING_OP_RECV,
+		.flags = IOSQE_BUFFER_SELECT,
+		.ioprio = IORING_RECV_MULTISHOT,
+		.buf_group = BUFFER_GROUP,
+	};
+	const struct io_uring_cqe *cqe;
+	bool supported = false, done = false;
+	unsigned int head;
+	int fds[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+		return false;
+	sqe.fd = fds[0];
+	submit(&sqe);
+	// The request has to persist after the data until the end of stream
+	if (write(fds[1], "", 1) != 1)
+		LOGF("TCP: Probing io_uring failed: %s", strerror(errno));
+	close(fds[1]);
+
+	while (!done) {
+		if (uring_enter(0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+		    errno != EINTR)
+			break;
+		head = *ring.cq_head;
+		for (; head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+		     head++) {
+			cqe = &ring.cqes[head & ring.cq_mask];
+			if (cqe->flags & IORING_CQE_F_BUFFER)
+				recycle_buffer((int32_t)(cqe->flags >>
+					IORING_CQE_BUFFER_SHIFT));
+			if (cqe->res > 0 && (cqe->flags & IORING_CQE_F_MORE))
+				supported = true;
+			if (!(cqe->flags & IORING_CQE_F_MORE))
+				done = true;
+		}
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	}
+	close(fds[0]);
+
+	return supported && done;
+}
+
+enum ud3tn_result cla_tcp_uring_start(void)
+{
+	struct io_uring_params params;
+	struct io_uring_buf_reg reg;
+	size_t ring_size, sqes_size, buf_ring_size;
+	uint8_t *ring_mem;
+	int32_t bid;
+
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = 2 * CLA_TCP_URING_BUFFER_COUNT;
+	ring.fd = (int)syscall(__NR_io_uring_setup, CLA_TCP_URING_ENTRIES,
+			       &params);
+	if (ring.fd < 0)
+		return UD3TN_FAIL;
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP) ||
+	    !(params.features & IORING_FEAT_NODROP))
+		goto fail_ring;
+
+	ring_size = MAX(
+		params.sq_off.array + params.sq_entries * sizeof(unsigned int),
+		params.cq_off.cqes +
+			params.cq_entries * sizeof(struct io_uring_cqe));
+	ring_mem = mmap(NULL, ring_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+	if (ring_mem == MAP_FAILED)
+		goto fail_ring;
+	sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring.sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+	if (ring.sqes == MAP_FAILED)
+		goto fail_sqes;
+
+	ring.sq_head = (unsigned int *)(ring_mem + params.sq_off.head);
+	ring.sq_tail = (unsigned int *)(ring_mem + params.sq_off.tail);
+	ring.sq_mask = *(unsigned int *)(ring_mem + params.sq_off.ring_mask);
+	ring.sq_array = (unsigned int *)(ring_mem + params.sq_off.array);
+	ring.cq_head = (unsigned int *)(ring_mem + params.cq_off.head);
+	ring.cq_tail = (unsigned int *)(ring_mem + params.cq_off.tail);
+	ring.cq_mask = *(unsigned int *)(ring_mem + params.cq_off.ring_mask);
+	ring.cqes = (struct io_uring_cqe *)(ring_mem + params.cq_off.cqes);
+
+	// The buffer ring has to be page-aligned
+	buf_ring_size = CLA_TCP_URING_BUFFER_COUNT *
+		sizeof(struct io_uring_buf);
+	ring.buf_ring = mmap(NULL, buf_ring_size, PROT_READ | PROT_WRITE,
+			     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ring.buf_ring == MAP_FAILED)
+		goto fail_buf_ring;
+	ring.buffers = malloc((size_t)CLA_TCP_URING_BUFFER_COUNT *
+			      CLA_TCP_URING_BUFFER_SIZE);
+	if (ring.buffers == NULL)
+		goto fail_buffers;
+
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uintptr_t)ring.buf_ring;
+	reg.ring_entries = CLA_TCP_URING_BUFFER_COUNT;
+	reg.bgid = BUFFER_GROUP;
+	if (syscall(__NR_io_uring_register, ring.fd,
+		    IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+		goto fail_register;
+	for (bid = 0; bid < CLA_TCP_URING_BUFFER_COUNT; bid++)
+		recycle_buffer(bid);
+
+	if (!probe_multishot_recv())
+		goto fail_register;
+
+	if (hal_task_create(
+			uring_task,
+			"tcp_uring_t",
+			CONTACT_LISTEN_TASK_PRIORITY,
+			NULL,
+			CONTACT_LISTEN_TASK_STACK_SIZE,
+			(void *)CLA_SPECIFIC_TASK_TAG) == NULL)
+		goto fail_register;
+
+	return UD3TN_OK;
+
+fail_register:
+	free(ring.buffers);
+fail_buffers:
+	munmap(ring.buf_ring, buf_ring_size);
+fail_buf_ring:
+	munmap(ring.sqes, sqes_size);
+fail_sqes:
+	munmap(ring_mem, ring_size);
+fail_ring:
+	close(ring.fd);
+	ring.fd = -1;
+	return UD3TN_FAIL;
+}
+
+enum ud3tn_result cla_tcp_uring_add(struct cla_tcp_link *link)
+{
+	struct cla_tcp_uring_rx *const rx = &link->uring_rx;
+	struct cla_tcp_uring_tx *const tx = &link->uring_tx;
+
+	pthread_mutex_init(&tx->lock, NULL);
+	pthread_cond_init(&tx->completed, NULL);
+	tx->pending = false;
+	tx->in_flight = false;
+	tx->removed = false;
+	tx->result = 0;
+	tx->enabled = true;
+
+	pthread_mutex_init(&rx->lock, NULL);
+	pthread_cond_init(&rx->disarmed, NULL);
+	rx->removed = false;
+	rx->eof = false;
+	rx->error = 0;
+	rx->head = -1;
+	rx->tail = -1;
+	rx->offset = 0;
+	rx->enabled = true;
+
+	pthread_mutex_lock(&rx->lock);
+	arm_receive(link);
+	pthread_mutex_unlock(&rx->lock);
+
+	return UD3TN_OK;
+}
+
+void cla_tcp_uring_remove(struct cla_tcp_link *link)
+{
+	struct cla_tcp_uring_rx *const rx = &link->uring_rx;
+	struct cla_tcp_uring_tx *const tx = &link->uring_tx;
+	const struct io_uring_sqe sqe = {
+		.opcode = IORING_OP_ASYNC_CANCEL,
+		.addr = (uintptr_t)link,
+		.user_data = 0,
+	};
+	const struct io_uring_sqe send_sqe = {
+		.opcode = IORING_OP_ASYNC_CANCEL,
+		.addr = (uintptr_t)link | SEND_REQUEST,
+		.user_data = 0,
+	};
+	int32_t bid;
+
+	// The output queue is discarded by the TX side afterwards
+	pthread_mutex_lock(&tx->lock);
+	tx->removed = true;
+	if (tx->in_flight)
+		submit(&send_sqe);
+	while (tx->in_flight)
+		pthread_cond_wait(&tx->completed, &tx->lock);
+	pthread_mutex_unlock(&tx->lock);
+
+	pthread_mutex_lock(&rx->lock);
+	rx->removed = true;
+	// If the cancellation fails, the request is completing anyway
+	if (rx->armed)
+		submit(&sqe);
+	while (rx->armed)
+		pthread_cond_wait(&rx->disarmed, &rx->lock);
+
+	while (rx->head >= 0) {
+		bid = rx->head;
+		rx->head = next_buffer[bid];
+		recycle_buffer(bid);
+	}
+	rx->offset = 0;
+	pthread_mutex_unlock(&rx->lock);
+}
+
+ssize_t cla_tcp_uring_recv(struct cla_tcp_link *link,
+			   uint8_t *buffer, size_t length)
+{
+	struct cla_tcp_uring_rx *const rx = &link->uring_rx;
+	size_t copied = 0, chunk;
+	ssize_t ret;
+	int error = 0;
+	int32_t bid;
+
+	pthread_mutex_lock(&rx->lock);
+	while (copied < length && rx->head >= 0) {
+		bid = rx->head;
+		chunk = MIN(length - copied, buffer_length[bid] - rx->offset);
+		memcpy(&buffer[copied],
+		       &ring.buffers[(size_t)bid * CLA_TCP_URING_BUFFER_SIZE +
+				     rx->offset],
+		       chunk);
+		copied += chunk;
+		rx->offset += chunk;
+		if (rx->offset == buffer_length[bid]) {
+			rx->head = next_buffer[bid];
+			rx->offset = 0;
+			recycle_buffer(bid);
+		}
+	}
+
+	if (copied != 0) {
+		ret = (ssize_t)copied;
+	} else if (rx->removed || rx->eof) {
+		// Behave like a socket that has been shut down
+		ret = 0;
+	} else if (rx->error != 0) {
+		error = rx->error;
+		ret = -1;
+	} else if (rx->armed) {
+		error = EAGAIN;
+		ret = -1;
+	} else {
+		// The request ended for lack of buffers, there is no further
+		// completion before it is armed again.
+		ret = recv(link->connection_socket, buffer, length, 0);
+		if (ret < 0) {
+			error = errno;
+			if (error == EAGAIN || error == EWOULDBLOCK)
+				arm_receive(link);
+		}
+	}
+	pthread_mutex_unlock(&rx->lock);
+
+	if (ret < 0)
+		errno = error;
+	return ret;
+}
+
+void cla_tcp_uring_send(struct cla_tcp_link *link, size_t iov_count,
+			int flags)
+{
+	struct cla_tcp_uring_tx *const tx = &link->uring_tx;
+	const struct io_uring_sqe sqe = {
+		.opcode = IORING_OP_SENDMSG,
+		.fd = link->connection_socket,
+		.addr = (uintptr_t)&tx->msg,
+		.msg_flags = (uint32_t)flags,
+		.user_data = (uintptr_t)link | SEND_REQUEST,
+	};
+
+	ASSERT(!tx->pending);
+	memset(&tx->msg, 0, sizeof(tx->msg));
+	tx->msg.msg_iov = tx->iov;
+	tx->msg.msg_iovlen = iov_count;
+	tx->pending = true;
+
+	pthread_mutex_lock(&tx->lock);
+	// The link may have been removed after the TX side checked it
+	if (tx->removed) {
+		tx->result = -ECANCELED;
+	} else {
+		tx->in_flight = true;
+		submit(&sqe);
+	}
+	pthread_mutex_unlock(&tx->lock);
+}
+
+ssize_t cla_tcp_uring_send_result(struct cla_tcp_link *link)
+{
+	struct cla_tcp_uring_tx *const tx = &link->uring_tx;
+	int32_t result;
+
+	if (!tx->pending)
+		return 0;
+	pthread_mutex_lock(&tx->lock);
+	if (tx->in_flight) {
+		pthread_mutex_unlock(&tx->lock);
+		errno = EINPROGRESS;
+		return -1;
+	}
+	result = tx->result;
+	pthread_mutex_unlock(&tx->lock);
+
+	tx->pending = false;
+	if (result < 0) {
+		errno = -result;
+		return -1;
+	}
+	return result;
+}
+
+#endif /* CLA_TCP_IO_URING */
@@ -226,6 +226,10 @@ static enum ud3tn_result handle_established_connection(
 	param->state = TCPCLV3_ESTABLISHED;
 	hal_semaphore_release(tcpclv3_config->param_htab_sem);
 
+#if HAL_EXECUTOR_WORKERS
+	// This task waits for the link to end
+	param->link.base.closed_work = NULL;
+#endif
 	if (cla_tcp_link_init(&param->link, param->socket,
 			      &tcpclv3_config->base)
 			!= UD3TN_OK) {
@@ -234,7 +238,7 @@ static enum ud3tn_result handle_established_connection(
 		return UD3TN_FAIL;
 	}
 
-	cla_link_wait_cleanup(&param->link.base);
+	cla_tcp_link_wait_cleanup(&param->link);
 
 	param->state = TCPCLV3_CONNECTING;
 	return UD3TN_OK;
@@ -479,16 +483,17 @@ static struct cla_tx_queue tcpclv3_get_tx_queue(
 
 		// Freed while trying to obtain it
 		if (!param->link.base.tx_queue_handle)
-			return (struct cla_tx_queue){ NULL, NULL };
+			return (struct cla_tx_queue){ NULL, NULL, NULL };
 
 		return (struct cla_tx_queue){
 			.tx_queue_handle = param->link.base.tx_queue_handle,
 			.tx_queue_sem = param->link.base.tx_queue_sem,
+			.link = &param->link.base,
 		};
 	}
 
 	hal_semaphore_release(tcpclv3_config->param_htab_sem);
-	return (struct cla_tx_queue){ NULL, NULL };
+	return (struct cla_tx_queue){ NULL, NULL, NULL };
 }
 
 static enum ud3tn_result tcpclv3_start_scheduled_contact(
@@ -644,8 +649,8 @@ static void tcpclv3_begin_packet(struct cla_link *link, size_t length)
 	// Calculate and set SDNV size of packet length.
 	int sdnv_len = sdnv_write_u32(&header_buffer[1], length);
 
-	if (tcp_send_all(param->link.connection_socket,
-			 header_buffer, sdnv_len + 1) == -1) {
+	if (cla_tcp_write(&param->link, header_buffer,
+			  sdnv_len + 1) != UD3TN_OK) {
 		LOGF("TCPCLv3: Error sending segment header: %s",
 		     strerror(errno));
 		link->config->vtable->cla_disconnect_handler(link);
@@ -658,7 +663,7 @@ static void tcpclv3_end_packet(struct cla_link *link)
 		(struct tcpclv3_contact_parameters *)link;
 
 	ASSERT(param->state == TCPCLV3_ESTABLISHED);
-	// STUB
+	// The data is sent by cla_tcp_flush_packets()
 	(void)param;
 }
 
@@ -673,7 +678,7 @@ static void tcpclv3_send_packet_data(
 	if (!link->active)
 		return;
 
-	if (tcp_send_all(param->link.connection_socket, data, length) == -1) {
+	if (cla_tcp_write(&param->link, data, length) != UD3TN_OK) {
 		LOGF("TCPCLv3: Error during sending: %s", strerror(errno));
 		link->config->vtable->cla_disconnect_handler(link);
 	}
@@ -695,6 +700,8 @@ const struct cla_vtable tcpclv3_vtable = {
 	.cla_begin_packet = tcpclv3_begin_packet,
 	.cla_end_packet = tcpclv3_end_packet,
 	.cla_send_packet_data = tcpclv3_send_packet_data,
+	.cla_flush = cla_tcp_flush_packets,
+	.cla_tx_ready = cla_tcp_tx_ready,
 
 	.cla_rx_task_reset_parsers = tcpclv3_reset_parsers,
 	.cla_rx_task_forward_to_specific_parser =
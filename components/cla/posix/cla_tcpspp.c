@@ -291,8 +291,8 @@ static void tcpspp_begin_packet(struct cla_link *link, size_t length)
 		);
 	}
 
-	if (tcp_send_all(tcp_link->connection_socket, header_buf,
-			 header_end - &header_buf[0]) == -1) {
+	if (cla_tcp_write(tcp_link, header_buf,
+			  header_end - &header_buf[0]) != UD3TN_OK) {
 		LOG("tcpspp: Error during sending. Data discarded.");
 		link->config->vtable->cla_disconnect_handler(link);
 	}
@@ -314,8 +314,7 @@ static void tcpspp_end_packet(struct cla_link *link)
 		// Big Endian (Network Byte Order) is necessary
 		const uint8_t crc16_be[2] = { crc16[1], crc16[0] };
 
-		if (tcp_send_all(tcp_link->connection_socket, crc16_be, 2)
-				== -1) {
+		if (cla_tcp_write(tcp_link, crc16_be, 2) != UD3TN_OK) {
 			LOG("tcpspp: Error during sending. Data discarded.");
 			link->config->vtable->cla_disconnect_handler(link);
 		}
@@ -333,7 +332,7 @@ static void tcpspp_send_packet_data(
 	if (!link->active)
 		return;
 
-	if (tcp_send_all(tcp_link->connection_socket, data, length) == -1) {
+	if (cla_tcp_write(tcp_link, data, length) != UD3TN_OK) {
 		LOG("tcpspp: Error during sending. Data discarded.");
 		link->config->vtable->cla_disconnect_handler(link);
 	}
@@ -356,6 +355,8 @@ const struct cla_vtable tcpspp_vtable = {
 	.cla_begin_packet = tcpspp_begin_packet,
 	.cla_end_packet = tcpspp_end_packet,
 	.cla_send_packet_data = tcpspp_send_packet_data,
+	.cla_flush = cla_tcp_flush_packets,
+	.cla_tx_ready = cla_tcp_tx_ready,
 
 	.cla_rx_task_reset_parsers = tcpspp_reset_parsers,
 	.cla_rx_task_forward_to_specific_parser =
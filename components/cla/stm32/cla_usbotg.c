@@ -199,6 +199,7 @@ static struct cla_tx_queue usbotg_get_tx_queue(
 	return (struct cla_tx_queue){
 		.tx_queue_handle = usbotg_config->link.tx_queue_handle,
 		.tx_queue_sem = usbotg_config->link.tx_queue_sem,
+		.link = &usbotg_config->link,
 	};
 }
 
@@ -1217,16 +1217,17 @@ static struct cla_tx_queue ml2cap_get_tx_queue(
 
         // Freed while trying to obtain it
         if (!cla_link->tx_queue_handle)
-            return (struct cla_tx_queue) {NULL, NULL};
+            return (struct cla_tx_queue) {NULL, NULL, NULL};
 
         return (struct cla_tx_queue) {
                 .tx_queue_handle = cla_link->tx_queue_handle,
                 .tx_queue_sem = cla_link->tx_queue_sem,
+                .link = cla_link,
         };
     }
 
     hal_semaphore_release(ml2cap_config->links_sem);
-    return (struct cla_tx_queue) {NULL, NULL};
+    return (struct cla_tx_queue) {NULL, NULL, NULL};
 }
 
 const struct cla_vtable ml2cap_vtable = {
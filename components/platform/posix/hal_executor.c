@@ -0,0 +1,240 @@
+/*
+ * hal_executor.c
+ *
+ * Description: contains the POSIX implementation of the hardware
+ * abstraction layer interface for running work items on a shared pool of
+ * tasks
+ *
+ */
+
+#include "platform/hal_config.h"
+#include "platform/hal_executor.h"
+#include "platform/hal_io.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+enum work_state {
+	WORK_IDLE,
+	WORK_QUEUED,
+	WORK_RUNNING,
+	/* Submitted again while running */
+	WORK_RERUN,
+	/* Waiting for its deadline */
+	WORK_DELAYED,
+	/* Submitted again with a delay while running */
+	WORK_RERUN_DELAYED,
+};
+
+/* The work items waiting for a worker, protected by the lock */
+static struct hal_work *head, *tail;
+/* The delayed work items, sorted by their deadlines */
+static struct hal_work *delayed;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+/* Signaled if work has been queued */
+static pthread_cond_t work_available = PTHREAD_COND_INITIALIZER;
+/* Broadcast if a run has completed, for hal_work_cancel_sync() */
+static pthread_cond_t run_completed = PTHREAD_COND_INITIALIZER;
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+
+static void enqueue(struct hal_work *work)
+{
+	work->state = WORK_QUEUED;
+	work->next = NULL;
+	if (tail)
+		tail->next = work;
+	else
+		head = work;
+	tail = work;
+	pthread_cond_signal(&work_available);
+}
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void add_delayed(struct hal_work *work)
+{
+	struct hal_work **pos = &delayed;
+
+	while (*pos != NULL && (*pos)->deadline_ms <= work->deadline_ms)
+		pos = &(*pos)->next;
+	work->next = *pos;
+	*pos = work;
+	work->state = WORK_DELAYED;
+	// A waiting worker has to consider the new deadline
+	pthread_cond_signal(&work_available);
+}
+
+static void remove_delayed(struct hal_work *work)
+{
+	struct hal_work **pos = &delayed;
+
+	while (*pos != work)
+		pos = &(*pos)->next;
+	*pos = work->next;
+}
+
+/* Queues the delayed work items that are due, returns the next deadline */
+static uint64_t queue_due_work(void)
+{
+	const uint64_t now = now_ms();
+	struct hal_work *work;
+
+	while (delayed != NULL && delayed->deadline_ms <= now) {
+		work = delayed;
+		delayed = work->next;
+		enqueue(work);
+	}
+	return delayed != NULL ? delayed->deadline_ms : 0;
+}
+
+static void *worker(void *param)
+{
+	struct hal_work *work;
+	struct timespec ts;
+	uint64_t deadline;
+
+	(void)param;
+	pthread_mutex_lock(&lock);
+	for (;;) {
+		deadline = delayed != NULL ? queue_due_work() : 0;
+		while (head == NULL) {
+			if (deadline == 0) {
+				pthread_cond_wait(&work_available, &lock);
+			} else {
+				ts.tv_sec = deadline / 1000;
+				ts.tv_nsec = (deadline % 1000) * 1000000;
+				pthread_cond_timedwait(&work_available, &lock,
+						       &ts);
+			}
+			deadline = delayed != NULL ? queue_due_work() : 0;
+		}
+		work = head;
+		head = work->next;
+		if (head == NULL)
+			tail = NULL;
+		work->state = WORK_RUNNING;
+		pthread_mutex_unlock(&lock);
+
+		work->run(work);
+
+		pthread_mutex_lock(&lock);
+		if (work->state == WORK_RERUN)
+			enqueue(work);
+		else if (work->state == WORK_RERUN_DELAYED)
+			add_delayed(work);
+		else
+			work->state = WORK_IDLE;
+		pthread_cond_broadcast(&run_completed);
+	}
+	return NULL;
+}
+
+static void start_workers(void)
+{
+	pthread_condattr_t cond_attr;
+	pthread_attr_t attr;
+	pthread_t thread;
+	int i;
+
+	// Deadlines of delayed work items refer to the monotonic clock
+	pthread_condattr_init(&cond_attr);
+	pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&work_available, &cond_attr);
+	pthread_condattr_destroy(&cond_attr);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	for (i = 0; i < HAL_EXECUTOR_WORKERS; i++) {
+		if (pthread_create(&thread, &attr, worker, NULL) != 0)
+			LOG("Executor: Creating a worker failed!");
+	}
+	pthread_attr_destroy(&attr);
+}
+
+void hal_work_init(struct hal_work *work, void (*run)(struct hal_work *work))
+{
+	work->run = run;
+	work->next = NULL;
+	work->deadline_ms = 0;
+	work->state = WORK_IDLE;
+}
+
+void hal_work_submit(struct hal_work *work)
+{
+	/* The workers are started with the first work item */
+	pthread_once(&start_once, start_workers);
+
+	pthread_mutex_lock(&lock);
+	switch (work->state) {
+	case WORK_IDLE:
+		enqueue(work);
+		break;
+	case WORK_DELAYED:
+		remove_delayed(work);
+		enqueue(work);
+		break;
+	case WORK_RUNNING:
+	case WORK_RERUN_DELAYED:
+		work->state = WORK_RERUN;
+		break;
+	default:
+		break;
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+void hal_work_submit_delayed(struct hal_work *work, int delay_ms)
+{
+	pthread_once(&start_once, start_workers);
+
+	pthread_mutex_lock(&lock);
+	switch (work->state) {
+	case WORK_IDLE:
+		work->deadline_ms = now_ms() + delay_ms;
+		add_delayed(work);
+		break;
+	case WORK_RUNNING:
+		work->deadline_ms = now_ms() + delay_ms;
+		work->state = WORK_RERUN_DELAYED;
+		break;
+	default:
+		// Already scheduled, at the latest after the delay
+		break;
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+void hal_work_cancel_sync(struct hal_work *work)
+{
+	struct hal_work *prev = NULL, *cur;
+
+	pthread_mutex_lock(&lock);
+	if (work->state == WORK_QUEUED) {
+		for (cur = head; cur != work; cur = cur->next)
+			prev = cur;
+		if (prev)
+			prev->next = work->next;
+		else
+			head = work->next;
+		if (tail == work)
+			tail = prev;
+		work->state = WORK_IDLE;
+	} else if (work->state == WORK_DELAYED) {
+		remove_delayed(work);
+		work->state = WORK_IDLE;
+	}
+	/* Do not run it again after the current run */
+	if (work->state == WORK_RERUN || work->state == WORK_RERUN_DELAYED)
+		work->state = WORK_RUNNING;
+	while (work->state == WORK_RUNNING)
+		pthread_cond_wait(&run_completed, &lock);
+	pthread_mutex_unlock(&lock);
+}
@@ -6,9 +6,11 @@
  *
  */
 
+#include "platform/hal_config.h"
 #include "platform/hal_queue.h"
 #include "platform/hal_types.h"
 
+#include "platform/posix/mpsc_queue.h"
 #include "platform/posix/simple_queue.h"
 
 #include "ud3tn/result.h"
@@ -16,6 +18,73 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#if HAL_QUEUE_LOCK_FREE
+
+QueueIdentifier_t hal_queue_create(int queue_length, int item_size)
+{
+	return mpsc_queue_create(queue_length, item_size);
+}
+
+
+void hal_queue_push_to_back(QueueIdentifier_t queue, const void *item)
+{
+	mpsc_queue_push(queue, item, -1);
+}
+
+
+enum ud3tn_result hal_queue_receive(QueueIdentifier_t queue, void *targetBuffer,
+				    int timeout)
+{
+	return mpsc_queue_pop(queue, targetBuffer, timeout);
+}
+
+
+size_t hal_queue_push_batch(QueueIdentifier_t queue, const void *items,
+			    size_t count, int timeout)
+{
+	return mpsc_queue_push_batch(queue, items, count, timeout);
+}
+
+
+size_t hal_queue_receive_batch(QueueIdentifier_t queue, void *targetBuffer,
+			       size_t max_count, int timeout)
+{
+	return mpsc_queue_pop_batch(queue, targetBuffer, max_count, timeout);
+}
+
+
+void hal_queue_reset(QueueIdentifier_t queue)
+{
+	mpsc_queue_reset(queue);
+}
+
+
+enum ud3tn_result hal_queue_try_push_to_back(QueueIdentifier_t queue,
+					     const void *item, int timeout)
+{
+	return mpsc_queue_push(queue, item, timeout);
+}
+
+
+void hal_queue_delete(QueueIdentifier_t queue)
+{
+	mpsc_queue_delete(queue);
+}
+
+
+enum ud3tn_result hal_queue_override_to_back(QueueIdentifier_t queue,
+					     const void *item)
+{
+	return mpsc_queue_override(queue, item);
+}
+
+uint8_t hal_queue_nr_of_items_waiting(QueueIdentifier_t queue)
+{
+	return mpsc_queue_items_waiting(queue);
+}
+
+#else // HAL_QUEUE_LOCK_FREE
+
 
 QueueIdentifier_t hal_queue_create(int queue_length, int item_size)
 {
@@ -37,6 +106,38 @@ enum ud3tn_result hal_queue_receive(QueueIdentifier_t queue, void *targetBuffer,
 }
 
 
+size_t hal_queue_push_batch(QueueIdentifier_t queue, const void *items,
+			    size_t count, int timeout)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (queuePush(queue, (const uint8_t *)items +
+			      i * queue->item_size, timeout, false) != 0)
+			break;
+	}
+	return i;
+}
+
+
+size_t hal_queue_receive_batch(QueueIdentifier_t queue, void *targetBuffer,
+			       size_t max_count, int timeout)
+{
+	size_t count;
+
+	if (max_count == 0 || queuePop(queue, targetBuffer, timeout) != 0)
+		return 0;
+	/* Take only what is there already */
+	for (count = 1; count < max_count; count++) {
+		if (queueItemsWaiting(queue) == 0 ||
+		    queuePop(queue, (uint8_t *)targetBuffer +
+			     count * queue->item_size, 0) != 0)
+			break;
+	}
+	return count;
+}
+
+
 void hal_queue_reset(QueueIdentifier_t queue)
 {
 	queueReset(queue);
@@ -67,3 +168,5 @@ uint8_t hal_queue_nr_of_items_waiting(QueueIdentifier_t queue)
 {
 	return queueItemsWaiting(queue);
 }
+
+#endif // HAL_QUEUE_LOCK_FREE
@@ -0,0 +1,72 @@
+/*
+ * hal_reply.c
+ *
+ * Description: contains the POSIX implementation of the hardware
+ * abstraction layer interface for one-shot replies between tasks
+ *
+ */
+
+#include "platform/hal_reply.h"
+#include "platform/hal_semaphore.h"
+#include "platform/hal_types.h"
+
+#include "ud3tn/result.h"
+
+#include <pthread.h>
+#include <stddef.h>
+
+static pthread_key_t waiter_key;
+static pthread_once_t waiter_key_once = PTHREAD_ONCE_INIT;
+
+static void delete_waiter(void *sem)
+{
+	hal_semaphore_delete(sem);
+}
+
+static void create_waiter_key(void)
+{
+	pthread_key_create(&waiter_key, delete_waiter);
+}
+
+/* Every thread creates its semaphore once, it is deleted on thread exit */
+static Semaphore_t get_waiter(void)
+{
+	Semaphore_t sem;
+
+	pthread_once(&waiter_key_once, create_waiter_key);
+	sem = pthread_getspecific(waiter_key);
+	if (sem != NULL)
+		return sem;
+	sem = hal_semaphore_init_binary();
+	if (sem == NULL)
+		return NULL;
+	if (pthread_setspecific(waiter_key, sem) != 0) {
+		hal_semaphore_delete(sem);
+		return NULL;
+	}
+	return sem;
+}
+
+enum ud3tn_result hal_reply_init(struct hal_reply *reply, uint8_t count)
+{
+	reply->waiter = get_waiter();
+	reply->result = 0;
+	reply->remaining = count;
+	return reply->waiter != NULL ? UD3TN_OK : UD3TN_FAIL;
+}
+
+void hal_reply_post(struct hal_reply *reply, int result)
+{
+	Semaphore_t waiter = reply->waiter;
+
+	if (result != 0)
+		__atomic_store_n(&reply->result, result, __ATOMIC_RELAXED);
+	if (__atomic_sub_fetch(&reply->remaining, 1, __ATOMIC_ACQ_REL) == 0)
+		hal_semaphore_release(waiter);
+}
+
+int hal_reply_wait(struct hal_reply *reply)
+{
+	hal_semaphore_take_blocking(reply->waiter);
+	return __atomic_load_n(&reply->result, __ATOMIC_ACQUIRE);
+}
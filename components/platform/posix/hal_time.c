@@ -13,72 +13,81 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <time.h>
-#include <math.h>
 #include <string.h>
 
-static uint64_t ref_timestamp;
+/*
+ * The coarse clock returns the time of the last timer tick without reading
+ * the hardware clock, thus, it lags behind by up to one tick (1-10 ms,
+ * depending on the kernel configuration). This is precise enough for
+ * timestamps in seconds and for lifetimes, expiration and bookkeeping in
+ * milliseconds, which are queried per bundle.
+ */
+#ifdef CLOCK_REALTIME_COARSE
+#define COARSE_CLOCK CLOCK_REALTIME_COARSE
+#else
+#define COARSE_CLOCK CLOCK_REALTIME
+#endif
+
+/* Seconds to subtract from the Unix time to get the (modified) DTN time */
+static time_t dtn_offset_s = DTN_TIMESTAMP_OFFSET;
 static bool mod_time;
-static struct timespec ref_timespec;
 
 static char *time_string;
 static Semaphore_t time_string_semph;
 
 void hal_time_init(const uint64_t initial_timestamp)
 {
-	/* get the current system time */
-	clock_gettime(CLOCK_REALTIME, &ref_timespec);
+	struct timespec ts;
+
+	/* get the current system time, the coarse clock never is ahead */
+	clock_gettime(COARSE_CLOCK, &ts);
 
 	/* calculate offset to required time */
-	ref_timestamp = ref_timespec.tv_sec - DTN_TIMESTAMP_OFFSET -
-			initial_timestamp;
+	dtn_offset_s = ts.tv_sec - (time_t)initial_timestamp;
 
 	mod_time = (initial_timestamp != 0);
 }
 
-uint64_t hal_time_get_timestamp_s(void)
+/* Sub-second parts are truncated, a timestamp must not lie in the future */
+static uint64_t get_s(clockid_t clock)
 {
 	struct timespec ts;
 
-	/* returns the time relative to the unix epoch */
-	clock_gettime(CLOCK_REALTIME, &ts);
-
-	/* we want to use the DTN epoch -> subtract the offset */
-	return ts.tv_sec - DTN_TIMESTAMP_OFFSET - ref_timestamp;
+	clock_gettime(clock, &ts);
+	return (uint64_t)(ts.tv_sec - dtn_offset_s);
 }
 
-uint64_t hal_time_get_timestamp_ms(void)
+static uint64_t get_ms(clockid_t clock)
 {
 	struct timespec ts;
-	long ms; /* Milliseconds */
-	time_t s;  /* Seconds */
 
-	/* Returns the time relative to the unix epoch */
-	clock_gettime(CLOCK_REALTIME, &ts);
+	clock_gettime(clock, &ts);
+	return (uint64_t)(ts.tv_sec - dtn_offset_s) * 1000 +
+		(uint64_t)ts.tv_nsec / 1000000;
+}
 
-	/* We want to use the DTN epoch -> subtract the offset */
-	s = ts.tv_sec - DTN_TIMESTAMP_OFFSET - ref_timestamp;
-	/* Convert nanoseconds to milliseconds */
-	ms = round(ts.tv_nsec / 1.0e6);
+uint64_t hal_time_get_timestamp_s(void)
+{
+	return get_s(COARSE_CLOCK);
+}
 
-	return (s*1.0e3)+ms;
+uint64_t hal_time_get_timestamp_ms(void)
+{
+	return get_ms(COARSE_CLOCK);
 }
 
+uint64_t hal_time_get_timestamp_ms_precise(void)
+{
+	return get_ms(CLOCK_REALTIME);
+}
 
 uint64_t hal_time_get_timestamp_us(void)
 {
 	struct timespec ts;
-	long us; /* Milliseconds */
-	time_t s;  /* Seconds */
 
-	/* Returns the time relative to the unix epoch */
 	clock_gettime(CLOCK_REALTIME, &ts);
-
-	/* We want to use the DTN epoch -> subtract the offset */
-	s = ts.tv_sec - DTN_TIMESTAMP_OFFSET - ref_timestamp;
-	/* Convert nanoseconds to microseconds */
-	us = round(ts.tv_nsec / 1.0e3);
-
-	return (s*1.0e6)+us;
+	return (uint64_t)(ts.tv_sec - dtn_offset_s) * 1000000 +
+		(uint64_t)ts.tv_nsec / 1000;
 }
 
 
@@ -0,0 +1,443 @@
+/*
+ * mpsc_queue.c
+ *
+ * Description: bounded lock-free message queue for many producers and a
+ * single consumer, based on a ring of sequence-numbered slots. Pushing and
+ * popping take no lock and issue no system call unless the queue is empty
+ * or full and a thread has to sleep on the respective futex.
+ *
+ */
+
+#include "platform/hal_config.h"
+
+#if HAL_QUEUE_LOCK_FREE
+
+#include "platform/posix/mpsc_queue.h"
+
+#include "ud3tn/result.h"
+
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct mpsc_queue_slot {
+	size_t sequence;
+	uint8_t data[];
+};
+
+/*
+ * Sequence number of a slot that is free for the producer of position pos
+ * and of a slot holding its item, respectively. Both are distinct from those
+ * of every other position, even if the queue consists of a single slot.
+ */
+#define SEQUENCE_FREE(pos) (2 * (pos))
+#define SEQUENCE_USED(pos) (2 * (pos) + 1)
+
+static struct mpsc_queue_slot *get_slot(struct mpsc_queue *queue, size_t pos)
+{
+	return (struct mpsc_queue_slot *)(
+		queue->slots + (pos % queue->length) * queue->slot_size);
+}
+
+static void futex_wait(uint32_t *word, uint32_t expected,
+		       const struct timespec *timeout)
+{
+	syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, timeout,
+		NULL, 0);
+}
+
+static void futex_wake_one(uint32_t *word)
+{
+	syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+/*
+ * Bumps the event and wakes a thread sleeping on it, if any. Together
+ * with the fence in wait_for(), this ensures that either the waiter sees the
+ * new state or we see the waiter.
+ */
+static void notify(uint32_t *event, uint32_t *waiters)
+{
+	__atomic_add_fetch(event, 1, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(waiters, __ATOMIC_RELAXED) != 0)
+		futex_wake_one(event);
+}
+
+/*
+ * Claims up to count consecutive free positions starting at the tail.
+ * A slot that is free for position pos can only be taken by the producer
+ * claiming pos, so the slots found free stay so if the CAS succeeds.
+ */
+static size_t claim_push(struct mpsc_queue *queue, size_t count, size_t *start)
+{
+	size_t pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+	size_t n;
+	intptr_t diff;
+
+	for (;;) {
+		for (n = 0; n < count; n++) {
+			diff = (intptr_t)(__atomic_load_n(
+				&get_slot(queue, pos + n)->sequence,
+				__ATOMIC_ACQUIRE) - SEQUENCE_FREE(pos + n));
+			if (diff != 0)
+				break;
+		}
+		if (n == 0 && diff < 0) {
+			// The slot still holds an item of the last round
+			return 0;
+		} else if (n != 0) {
+			// On failure, pos is updated to the current tail
+			if (__atomic_compare_exchange_n(
+					&queue->tail, &pos, pos + n, true,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else {
+			pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	*start = pos;
+	return n;
+}
+
+/*
+ * Claims up to count consecutive positions holding an item, starting at the
+ * head. Like for claim_push(), only the consumer claiming a position
+ * can free its slot.
+ */
+static size_t claim_pop(struct mpsc_queue *queue, size_t count, size_t *start)
+{
+	size_t pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+	size_t n;
+	intptr_t diff;
+
+	for (;;) {
+		for (n = 0; n < count; n++) {
+			diff = (intptr_t)(__atomic_load_n(
+				&get_slot(queue, pos + n)->sequence,
+				__ATOMIC_ACQUIRE) - SEQUENCE_USED(pos + n));
+			if (diff != 0)
+				break;
+		}
+		if (n == 0 && diff < 0) {
+			// Nothing has been published at this position yet
+			return 0;
+		} else if (n != 0) {
+			if (__atomic_compare_exchange_n(
+					&queue->head, &pos, pos + n, true,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else {
+			pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+		}
+	}
+
+	*start = pos;
+	return n;
+}
+
+static void publish(struct mpsc_queue *queue, size_t pos, const void *item)
+{
+	struct mpsc_queue_slot *slot = get_slot(queue, pos);
+
+	memcpy(slot->data, item, queue->item_size);
+	__atomic_store_n(&slot->sequence, SEQUENCE_USED(pos), __ATOMIC_RELEASE);
+}
+
+/*
+ * Copies the item out of a claimed slot and hands the slot over to the
+ * producer of the next round. mpsc_queue_override() may lock the slot
+ * meanwhile to replace the item, the copy is repeated in that case.
+ */
+static void take(struct mpsc_queue *queue, size_t pos, void *target)
+{
+	struct mpsc_queue_slot *slot = get_slot(queue, pos);
+	size_t expected;
+
+	for (;;) {
+		expected = SEQUENCE_USED(pos);
+		while (__atomic_load_n(&slot->sequence,
+				       __ATOMIC_ACQUIRE) != expected)
+			sched_yield();
+		if (target != NULL)
+			memcpy(target, slot->data, queue->item_size);
+		if (__atomic_compare_exchange_n(
+				&slot->sequence, &expected,
+				SEQUENCE_FREE(pos + queue->length), false,
+				__ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			return;
+	}
+}
+
+static bool try_push(struct mpsc_queue *queue, void *item)
+{
+	size_t pos;
+
+	if (claim_push(queue, 1, &pos) == 0)
+		return false;
+	publish(queue, pos, item);
+	notify(&queue->items_event, &queue->pop_waiters);
+	return true;
+}
+
+static bool try_pop(struct mpsc_queue *queue, void *target)
+{
+	size_t pos;
+
+	if (claim_pop(queue, 1, &pos) == 0)
+		return false;
+	take(queue, pos, target);
+	notify(&queue->space_event, &queue->push_waiters);
+	return true;
+}
+
+struct mpsc_queue_batch {
+	uint8_t *items;
+	size_t count;
+	size_t done;
+};
+
+// Succeeds once all items of the batch have been pushed
+static bool try_push_batch(struct mpsc_queue *queue, void *arg)
+{
+	struct mpsc_queue_batch *batch = arg;
+	size_t pos, n, i;
+
+	while (batch->done != batch->count) {
+		n = claim_push(queue, batch->count - batch->done, &pos);
+		if (n == 0)
+			return false;
+		for (i = 0; i < n; i++)
+			publish(queue, pos + i, batch->items +
+				(batch->done + i) * queue->item_size);
+		batch->done += n;
+		// A single wake-up for all items that fit in
+		notify(&queue->items_event, &queue->pop_waiters);
+	}
+	return true;
+}
+
+// Succeeds as soon as at least one item has been popped
+static bool try_pop_batch(struct mpsc_queue *queue, void *arg)
+{
+	struct mpsc_queue_batch *batch = arg;
+	size_t pos, n, i;
+
+	n = claim_pop(queue, batch->count, &pos);
+	if (n == 0)
+		return false;
+	for (i = 0; i < n; i++)
+		take(queue, pos + i, batch->items + i * queue->item_size);
+	batch->done = n;
+	notify(&queue->space_event, &queue->push_waiters);
+	return true;
+}
+
+static void get_deadline(struct timespec *deadline, int timeout_ms)
+{
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	deadline->tv_sec += timeout_ms / 1000;
+	deadline->tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+	if (deadline->tv_nsec >= 1000000000) {
+		deadline->tv_sec += 1;
+		deadline->tv_nsec -= 1000000000;
+	}
+}
+
+// Returns false if the deadline has passed
+static bool get_remaining(const struct timespec *deadline,
+			  struct timespec *remaining)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	remaining->tv_sec = deadline->tv_sec - now.tv_sec;
+	remaining->tv_nsec = deadline->tv_nsec - now.tv_nsec;
+	if (remaining->tv_nsec < 0) {
+		remaining->tv_sec -= 1;
+		remaining->tv_nsec += 1000000000;
+	}
+	return remaining->tv_sec > 0 ||
+		(remaining->tv_sec == 0 && remaining->tv_nsec > 0);
+}
+
+/*
+ * Retries the operation until it succeeds, sleeping on the event between the
+ * attempts. The event is read before registering as a waiter, thus, the
+ * futex does not sleep if it was bumped after the last failed attempt.
+ */
+static bool wait_for(struct mpsc_queue *queue,
+		     bool (*attempt)(struct mpsc_queue *, void *), void *arg,
+		     uint32_t *event, uint32_t *waiters, int timeout_ms)
+{
+	struct timespec deadline, remaining;
+	uint32_t last_event;
+	bool success;
+
+	if (attempt(queue, arg))
+		return true;
+	if (timeout_ms == 0)
+		return false;
+	if (timeout_ms > 0)
+		get_deadline(&deadline, timeout_ms);
+
+	for (;;) {
+		last_event = __atomic_load_n(event, __ATOMIC_ACQUIRE);
+		__atomic_add_fetch(waiters, 1, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		success = attempt(queue, arg);
+		if (!success) {
+			if (timeout_ms < 0)
+				futex_wait(event, last_event, NULL);
+			else if (get_remaining(&deadline, &remaining))
+				futex_wait(event, last_event, &remaining);
+			else
+				timeout_ms = 0;
+		}
+		__atomic_sub_fetch(waiters, 1, __ATOMIC_RELAXED);
+		if (success)
+			return true;
+		if (timeout_ms == 0)
+			return false;
+		if (attempt(queue, arg))
+			return true;
+	}
+}
+
+struct mpsc_queue *mpsc_queue_create(size_t length, size_t item_size)
+{
+	struct mpsc_queue *queue;
+	size_t i;
+
+	if (length == 0 || item_size == 0)
+		return NULL;
+	if (posix_memalign((void **)&queue, 64, sizeof(struct mpsc_queue)))
+		return NULL;
+
+	queue->tail = 0;
+	queue->items_event = 0;
+	queue->pop_waiters = 0;
+	queue->head = 0;
+	queue->space_event = 0;
+	queue->push_waiters = 0;
+	queue->length = length;
+	queue->item_size = item_size;
+	// Keep the sequence numbers of all slots aligned
+	queue->slot_size = (sizeof(struct mpsc_queue_slot) + item_size +
+			    sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+	queue->slots = malloc(length * queue->slot_size);
+	if (queue->slots == NULL) {
+		free(queue);
+		return NULL;
+	}
+	for (i = 0; i < length; i++)
+		get_slot(queue, i)->sequence = SEQUENCE_FREE(i);
+
+	return queue;
+}
+
+void mpsc_queue_delete(struct mpsc_queue *queue)
+{
+	free(queue->slots);
+	free(queue);
+}
+
+void mpsc_queue_reset(struct mpsc_queue *queue)
+{
+	while (try_pop(queue, NULL))
+		;
+}
+
+size_t mpsc_queue_items_waiting(struct mpsc_queue *queue)
+{
+	const size_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+	const size_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+	if (tail <= head)
+		return 0;
+	return tail - head < queue->length ? tail - head : queue->length;
+}
+
+enum ud3tn_result mpsc_queue_push(struct mpsc_queue *queue, const void *item,
+				  int timeout_ms)
+{
+	return wait_for(queue, try_push, (void *)item, &queue->space_event,
+			&queue->push_waiters, timeout_ms)
+		? UD3TN_OK : UD3TN_FAIL;
+}
+
+enum ud3tn_result mpsc_queue_override(struct mpsc_queue *queue,
+				      const void *item)
+{
+	struct mpsc_queue_slot *slot;
+	size_t pos, expected;
+
+	while (!try_push(queue, (void *)item)) {
+		// The queue is full, thus, at least one item has been pushed
+		pos = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) - 1;
+		slot = get_slot(queue, pos);
+		expected = SEQUENCE_USED(pos);
+		// Lock the newest item, unless it has been consumed meanwhile;
+		// the consumer regards the slot as empty in between.
+		if (__atomic_compare_exchange_n(&slot->sequence, &expected,
+						SEQUENCE_FREE(pos), false,
+						__ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED)) {
+			memcpy(slot->data, item, queue->item_size);
+			__atomic_store_n(&slot->sequence, SEQUENCE_USED(pos),
+					 __ATOMIC_RELEASE);
+			notify(&queue->items_event, &queue->pop_waiters);
+			break;
+		}
+	}
+
+	return UD3TN_OK;
+}
+
+enum ud3tn_result mpsc_queue_pop(struct mpsc_queue *queue, void *target,
+				 int timeout_ms)
+{
+	return wait_for(queue, try_pop, target, &queue->items_event,
+			&queue->pop_waiters, timeout_ms)
+		? UD3TN_OK : UD3TN_FAIL;
+}
+
+size_t mpsc_queue_push_batch(struct mpsc_queue *queue, const void *items,
+			     size_t count, int timeout_ms)
+{
+	struct mpsc_queue_batch batch = {
+		.items = (uint8_t *)items,
+		.count = count,
+		.done = 0,
+	};
+
+	wait_for(queue, try_push_batch, &batch, &queue->space_event,
+		 &queue->push_waiters, timeout_ms);
+	return batch.done;
+}
+
+size_t mpsc_queue_pop_batch(struct mpsc_queue *queue, void *targets,
+			    size_t max_count, int timeout_ms)
+{
+	struct mpsc_queue_batch batch = {
+		.items = targets,
+		.count = max_count,
+		.done = 0,
+	};
+
+	if (max_count == 0)
+		return 0;
+	wait_for(queue, try_pop_batch, &batch, &queue->items_event,
+		 &queue->pop_waiters, timeout_ms);
+	return batch.done;
+}
+
+#endif // HAL_QUEUE_LOCK_FREE
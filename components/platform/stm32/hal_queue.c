@@ -26,7 +26,12 @@ static inline enum ud3tn_result pdBOOL2ud3tnresult(BaseType_t pdBOOL)
 
 QueueIdentifier_t hal_queue_create(int queue_length, int item_size)
 {
-	return xQueueCreate(queue_length, item_size);
+	QueueHandle_t queue = xQueueCreate(queue_length, item_size);
+
+	/* FreeRTOS does not expose the item size needed for batches */
+	if (queue != NULL)
+		vQueueSetQueueNumber(queue, item_size);
+	return queue;
 }
 
 
@@ -54,6 +59,42 @@ enum ud3tn_result hal_queue_receive(QueueIdentifier_t queue,
 }
 
 
+size_t hal_queue_push_batch(QueueIdentifier_t queue, const void *items,
+			    size_t count, int timeout)
+{
+	const size_t item_size = uxQueueGetQueueNumber(queue);
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (hal_queue_try_push_to_back(
+				queue, (const uint8_t *)items + i * item_size,
+				timeout) != UD3TN_OK)
+			break;
+	}
+	return i;
+}
+
+
+size_t hal_queue_receive_batch(QueueIdentifier_t queue, void *targetBuffer,
+			       size_t max_count, int timeout)
+{
+	const size_t item_size = uxQueueGetQueueNumber(queue);
+	size_t count;
+
+	if (max_count == 0 ||
+	    hal_queue_receive(queue, targetBuffer, timeout) != UD3TN_OK)
+		return 0;
+	/* Take only what is there already */
+	for (count = 1; count < max_count; count++) {
+		if (xQueueReceive(queue,
+				  (uint8_t *)targetBuffer + count * item_size,
+				  0) != pdTRUE)
+			break;
+	}
+	return count;
+}
+
+
 void hal_queue_reset(QueueHandle_t queue)
 {
 	xQueueReset(queue);
@@ -0,0 +1,40 @@
+/*
+ * hal_reply.c
+ *
+ * Description: contains the stm32-implementation of the hardware
+ * abstraction layer interface for one-shot replies between tasks
+ *
+ */
+
+#include "platform/hal_reply.h"
+
+#include "ud3tn/result.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+/* The notification value of the waiting task serves as its semaphore */
+enum ud3tn_result hal_reply_init(struct hal_reply *reply, uint8_t count)
+{
+	reply->waiter = xTaskGetCurrentTaskHandle();
+	reply->result = 0;
+	reply->remaining = count;
+	return UD3TN_OK;
+}
+
+void hal_reply_post(struct hal_reply *reply, int result)
+{
+	TaskHandle_t waiter = reply->waiter;
+
+	if (result != 0)
+		__atomic_store_n(&reply->result, result, __ATOMIC_RELAXED);
+	if (__atomic_sub_fetch(&reply->remaining, 1, __ATOMIC_ACQ_REL) == 0)
+		xTaskNotifyGive(waiter);
+}
+
+int hal_reply_wait(struct hal_reply *reply)
+{
+	while (ulTaskNotifyTake(pdTRUE, portMAX_DELAY) == 0)
+		;
+	return __atomic_load_n(&reply->result, __ATOMIC_ACQUIRE);
+}
@@ -52,6 +52,13 @@ uint64_t hal_time_get_timestamp_ms(void)
 }
 
 
+/* The tick counter is cheap to read, there is no coarser clock */
+uint64_t hal_time_get_timestamp_ms_precise(void)
+{
+	return hal_time_get_timestamp_ms();
+}
+
+
 uint64_t hal_time_get_timestamp_us(void)
 {
 	return ref_timestamp * 1000000ULL + timer_get_ticks() - ref_ticks;
@@ -129,6 +129,66 @@ enum ud3tn_result hal_queue_receive(struct k_msgq *queue,
     return ret == 0 ? UD3TN_OK : UD3TN_FAIL;
 }
 
+/**
+ * @brief hal_queue_push_batch Attach a number of items to the back of the
+ *			       queue, in order.
+ * @param queue The identifier of the Queue that the elements should be
+ *              inserted
+ * @param items An array of count items
+ * @param count The number of items to be inserted
+ * @param timeout After which time (in milliseconds) the attempt to insert
+ *		  the remaining items should be aborted.
+ *		  If this value is -1, the call blocks until all items are
+ *		  inserted
+ * @return The number of items inserted, less than count only on timeout
+ */
+size_t hal_queue_push_batch(struct k_msgq *queue, const void *items,
+                            size_t count, int timeout) {
+    k_timeout_t zephyr_timeout = timeout == -1 ? K_FOREVER : K_MSEC(timeout);
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (k_msgq_put(queue, (const uint8_t *)items + i * queue->msg_size,
+                       zephyr_timeout) != 0) {
+            break;
+        }
+    }
+    return i;
+}
+
+/**
+ * @brief hal_queue_receive_batch Receive up to max_count items from the
+ *				  specific queue. Blocks only until the first
+ *				  item arrives.
+ * @param queue The identifier of the Queue that the elements should be read
+ *		from
+ * @param targetBuffer A pointer to an array of max_count items where the
+ *		       received items should be stored
+ * @param max_count The maximum number of items to be received
+ * @param timeout After which time (in milliseconds) the receiving attempt
+ *		  should be aborted.
+ *		  If this value is -1, receiving will block indefinitely
+ * @return The number of items received, 0 if the timeout expired
+ */
+size_t hal_queue_receive_batch(struct k_msgq *queue, void *targetBuffer,
+                               size_t max_count, int timeout) {
+    size_t count;
+
+    if (max_count == 0 ||
+        hal_queue_receive(queue, targetBuffer, timeout) != UD3TN_OK) {
+        return 0;
+    }
+
+    // take only what is there already
+    for (count = 1; count < max_count; count++) {
+        if (k_msgq_get(queue, (uint8_t *)targetBuffer + count * queue->msg_size,
+                       K_NO_WAIT) != 0) {
+            break;
+        }
+    }
+    return count;
+}
+
 /**
  * @brief hal_queue_reset Reset (i.e. empty) the specific queue
  * @param queue The queue that should be cleared
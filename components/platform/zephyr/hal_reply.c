@@ -0,0 +1,49 @@
+#include "platform/hal_reply.h"
+#include "ud3tn/result.h"
+
+#include <kernel.h>
+
+/**
+ * @brief hal_reply_init Prepare a reply slot for the calling task. The
+ *			 semaphore is part of the slot, initializing it
+ *			 does not allocate anything.
+ * @param reply The slot to be initialized
+ * @param count The number of replies to be posted before the waiter
+ *		wakes up, at least 1
+ * @return Whether the slot could be set up
+ */
+enum ud3tn_result hal_reply_init(struct hal_reply *reply, uint8_t count) {
+    reply->result = 0;
+    reply->remaining = count;
+    return k_sem_init(&reply->waiter, 0, 1) == 0 ? UD3TN_OK : UD3TN_FAIL;
+}
+
+/**
+ * @brief hal_reply_post Post one reply, waking up the waiting task with the
+ *			 last one. The reply slot must not be accessed
+ *			 anymore afterwards.
+ * @param reply The slot the reply belongs to
+ * @param result The result of the replying task, 0 means success
+ */
+void hal_reply_post(struct hal_reply *reply, int result) {
+    if (result != 0) {
+        __atomic_store_n(&reply->result, result, __ATOMIC_RELAXED);
+    }
+    // k_sem_give() does not touch the semaphore after waking the waiter
+    if (__atomic_sub_fetch(&reply->remaining, 1, __ATOMIC_ACQ_REL) == 0) {
+        k_sem_give(&reply->waiter);
+    }
+}
+
+/**
+ * @brief hal_reply_wait Block until all replies have been posted. Must be
+ *			 called by the task that initialized the slot.
+ * @param reply The slot to be waited for
+ * @return A non-zero result posted by any of the replying tasks, or 0 if
+ *	   all of them succeeded
+ */
+int hal_reply_wait(struct hal_reply *reply) {
+    while (k_sem_take(&reply->waiter, K_FOREVER))
+        ;
+    return __atomic_load_n(&reply->result, __ATOMIC_ACQUIRE);
+}
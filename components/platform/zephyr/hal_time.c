@@ -42,6 +42,12 @@ uint64_t hal_time_get_timestamp_ms(void)
     return ref_timestamp * 1000ULL + k_ticks_to_ms_floor64(k_uptime_ticks() - ref_ticks);
 }
 
+// the tick counter is cheap to read, there is no coarser clock
+uint64_t hal_time_get_timestamp_ms_precise(void)
+{
+    return hal_time_get_timestamp_ms();
+}
+
 uint64_t hal_time_get_timestamp_us(void)
 {
     return ref_timestamp * 1000000ULL + k_ticks_to_us_floor64(k_uptime_ticks() - ref_ticks);
@@ -37,6 +37,8 @@ struct contact_info {
 static struct contact_info current_contacts[MAX_CONCURRENT_CONTACTS];
 static int8_t current_contact_count;
 static uint64_t next_contact_time = UINT64_MAX;
+/* Set if a link refused bundles as its transmit window was full */
+static bool tx_retry_pending;
 
 static bool contact_active(const struct contact *contact)
 {
@@ -183,7 +185,11 @@ static void hand_over_contact_bundles(struct contact_info c)
 
 	command.bundles = c.contact->contact_bundles;
 	c.contact->contact_bundles = NULL;
-	hal_queue_push_to_back(tx_queue.tx_queue_handle, &command);
+	if (cla_contact_tx_task_push(tx_queue, &command, -1) != UD3TN_OK) {
+		// The link is busy, keep the bundles for the next attempt
+		c.contact->contact_bundles = command.bundles;
+		tx_retry_pending = true;
+	}
 	hal_semaphore_release(tx_queue.tx_queue_sem); // taken by get_tx_queue
 }
 
@@ -191,6 +197,7 @@ static void process_current_contacts(void)
 {
 	int8_t i;
 
+	tx_retry_pending = false;
 	for (i = 0; i < current_contact_count; i++)
 		hand_over_contact_bundles(current_contacts[i]);
 }
@@ -304,6 +311,9 @@ static void contact_manager_task(void *cm_parameters)
 			continue;
 		else
 			delay = next_time - cur_time;
+		/* Process the current bundles again when a link was busy */
+		if (tx_retry_pending && delay > CONTACT_TX_RETRY_PERIOD)
+			delay = CONTACT_TX_RETRY_PERIOD;
 		/*LOGA("ContactManager: Suspended on queue.",*/
 		/*	(uint8_t)(delay / 1000), LOG_NO_ITEM);*/
 		hal_queue_receive(parameters->control_queue, &signal,
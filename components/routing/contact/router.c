@@ -1,5 +1,6 @@
 #include "ud3tn/bundle.h"
 #include "ud3tn/common.h"
+#include "ud3tn/eid_table.h"
 #include "ud3tn/node.h"
 #include "routing/contact/router.h"
 #include "routing/contact/routing_table.h"
@@ -489,7 +490,7 @@ enum ud3tn_result router_add_bundle_to_contact(
 	ASSERT(contact != NULL);
 	ASSERT(rb != NULL);
 	ASSERT(contact->remaining_capacity_p0 > 0);
-	new_entry = malloc(sizeof(struct routed_bundle_list));
+	new_entry = routed_bundle_list_alloc();
 	if (new_entry == NULL)
 		return UD3TN_FAIL;
 	new_entry->data = rb;
@@ -524,7 +525,7 @@ struct routed_bundle *router_remove_bundle_from_contact(
 			rb = (*cur_entry)->data;
 			tmp = *cur_entry;
 			*cur_entry = (*cur_entry)->next;
-			free(tmp);
+			routed_bundle_list_free(tmp);
 			contact->bundle_count--;
 			contact->remaining_capacity_p0 += rb->size;
 			if (rb->prio > BUNDLE_RPRIO_LOW) {
@@ -547,22 +548,22 @@ uint8_t router_add_bundle_to_route(struct fragment_route *r, struct bundle *b)
 
 	ASSERT(r != NULL);
 	ASSERT(b != NULL);
-	rb = malloc(sizeof(struct routed_bundle));
+	rb = routed_bundle_alloc();
 	if (rb == NULL)
 		return 0;
 	rb->id = b->id;
     rb->prio = bundle_get_routing_priority(b);
     rb->size = bundle_get_serialized_size(b);
     rb->exp_time = bundle_get_expiration_time_s(b);
-    rb->destination = strdup(b->destination);
+    rb->destination = eid_ref(b->destination);
 	if (rb->destination == NULL) {
-		free(rb);
+		routed_bundle_free(rb);
 		return 0;
 	}
 	success = router_update_routed_bundle(r, rb);
 	if (!success) {
-		free(rb->destination);
-		free(rb);
+		eid_release(rb->destination);
+		routed_bundle_free(rb);
 		return 0;
 	}
 	return 1;
@@ -613,8 +614,8 @@ void router_remove_bundle_from_route(
 			rb = tmp;
 	}
 	if (free_rb && rb != NULL) {
-		free(rb->destination);
+		eid_release(rb->destination);
 		free(rb->contacts);
-		free(rb);
+		routed_bundle_free(rb);
 	}
 }
@@ -184,11 +184,11 @@ static inline struct routed_bundle_list *get_less_prio_bundle_list(
 
 	while (cur_list != NULL) {
 		if (cur_list->data->prio < prio) {
-			*all_list_e = malloc(sizeof(struct routed_bundle_list));
+			*all_list_e = routed_bundle_list_alloc();
 			if (*all_list_e == NULL) {
 				while (all_list != NULL) {
 					next = all_list->next;
-					free(all_list);
+					routed_bundle_list_free(all_list);
 					all_list = next;
 				}
 				ASSERT(all_list != NULL);
@@ -339,12 +339,12 @@ static uint8_t do_preemption(
 		preempted[(*preempted_count)++] = all_list->data;
 		(*preempted_contact_count)++;
 		next = all_list->next;
-		free(all_list);
+		routed_bundle_list_free(all_list);
 		all_list = next;
 	}
 	while (all_list != NULL) {
 		next = all_list->next;
-		free(all_list);
+		routed_bundle_list_free(all_list);
 		all_list = next;
 	}
 	/* 4.a If failed, continue */
@@ -4,6 +4,7 @@
 #include "ud3tn/bundle_storage_manager.h"
 #include "ud3tn/common.h"
 #include "ud3tn/config.h"
+#include "ud3tn/eid_table.h"
 #include "routing/contact/contact_manager.h"
 #include "ud3tn/node.h"
 #include "routing/contact/router.h"
@@ -51,7 +52,8 @@ void router_task(void *rt_parameters)
 	struct router_task_parameters *parameters;
 	struct contact_manager_params cm_param;
 	Semaphore_t ro_sem;
-	struct router_signal signal;
+	struct router_signal signals[ROUTER_SIGNAL_BATCH_SIZE];
+	size_t count, i;
 
 	ASSERT(rt_parameters != NULL);
 	parameters = (struct router_task_parameters *)rt_parameters;
@@ -70,11 +72,11 @@ void router_task(void *rt_parameters)
 	ASSERT(ro_sem != NULL);
 
 	for (;;) {
-		if (hal_queue_receive(
-			parameters->router_signaling_queue, &signal,
-			-1) == UD3TN_OK
-		) {
-			process_signal(signal,
+		count = hal_queue_receive_batch(
+			parameters->router_signaling_queue, signals,
+			ROUTER_SIGNAL_BATCH_SIZE, -1);
+		for (i = 0; i < count; i++) {
+			process_signal(signals[i],
 				parameters->bundle_processor_signaling_queue,
 				parameters->router_signaling_queue,
 				cm_param.semaphore, cm_param.control_queue,
@@ -146,11 +148,13 @@ static bool process_signal(
 			bp_signaling_queue
 		);
 		hal_semaphore_release(cm_semaphore);
-		if (success)
+		if (success) {
 			wake_up_contact_manager(
 				cm_queue,
 				CM_SIGNAL_UPDATE_CONTACT_LIST
 			);
+			bundle_processor_notify_routes_changed();
+		}
 		if (success) {
 			LOGF("RouterTask: Command (T = %c) processed.",
 			     command->type);
@@ -163,7 +167,7 @@ static bool process_signal(
 		break;
 	case ROUTER_SIGNAL_ROUTE_BUNDLE:
 		b_id = (bundleid_t)(uintptr_t)signal.data;
-		b = bundle_storage_get(b_id);
+		b = bundle_storage_acquire(b_id);
 		hal_semaphore_take_blocking(cm_semaphore);
 		/*
 		 * TODO: Check bundle expiration time
@@ -174,8 +178,10 @@ static bool process_signal(
 			.status_or_fragments = BUNDLE_RESULT_INVALID
 		};
 
-		if (b != NULL)
+		if (b != NULL) {
 			proc_result = process_bundle(b);
+			bundle_storage_release(b_id);
+		}
 		b = NULL; /* b may be invalid or free'd now */
 		hal_semaphore_release(cm_semaphore);
 		if (IS_DEBUG_BUILD)
@@ -235,9 +241,9 @@ static bool process_signal(
 					: BP_SIGNAL_TRANSMISSION_FAILURE,
 				BUNDLE_SR_REASON_NO_INFO
 			);
-			free(rb->destination);
+			eid_release(rb->destination);
 			free(rb->contacts);
-			free(rb);
+			routed_bundle_free(rb);
 		}
 		break;
 	case ROUTER_SIGNAL_OPTIMIZATION_DROP:
@@ -250,9 +256,9 @@ static bool process_signal(
 			BP_SIGNAL_TRANSMISSION_FAILURE,
 			BUNDLE_SR_REASON_NO_INFO
 		);
-		free(rb->destination);
+		eid_release(rb->destination);
 		free(rb->contacts);
-		free(rb);
+		routed_bundle_free(rb);
 		LOGF("RouterTask: Preemption routing failed for bundle #%d!",
 		     b_id);
 		break;
@@ -400,11 +406,11 @@ static struct bundle_processing_result apply_fragmentation(
 		}
 	}
 
-	/* Add to route */
+	/* Add to route, the fragments replace the bundle in the storage */
 	for (f = 0; f < fragments; f++) {
-		bundle_storage_add(frags[f]);
-		if (!router_add_bundle_to_route(
-			&route.fragment_results[f], frags[f])
+		if (bundle_storage_add_exempt(frags[f]) == BUNDLE_INVALID_ID ||
+			!router_add_bundle_to_route(
+				&route.fragment_results[f], frags[f])
 		) {
 			for (g = 0; g < f; g++)
 				router_remove_bundle_from_route(
@@ -420,12 +426,14 @@ static struct bundle_processing_result apply_fragmentation(
 		}
 	}
 
-	/* Success - remove bundle */
-	bundle_storage_delete(bundle->id);
-	bundle_free(bundle);
-
+	/* Persisted fragments may be unloaded, only keep their IDs */
 	for (f = 0; f < fragments; f++)
 		result.fragment_ids[f] = frags[f]->id;
+
+	/* Success - replace the persistent copy, if any, and remove bundle */
+	for (f = 0; f < fragments; f++)
+		bundle_storage_persist(result.fragment_ids[f]);
+	bundle_storage_drop(bundle->id);
 	result.status_or_fragments = fragments;
 	return result;
 }
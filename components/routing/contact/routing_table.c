@@ -503,8 +503,8 @@ void routing_table_contact_passed(
 				BP_SIGNAL_RESCHEDULE_BUNDLE,
 				BUNDLE_SR_REASON_NO_INFO);
 			tmp = contact->contact_bundles->next;
-			free(contact->contact_bundles->data);
-			free(contact->contact_bundles);
+			routed_bundle_free(contact->contact_bundles->data);
+			routed_bundle_list_free(contact->contact_bundles);
 			contact->contact_bundles = tmp;
 		}
 	}
@@ -277,13 +277,13 @@ static enum ud3tn_result try_to_send_bundle(struct routed_bundle *routed_bundle,
             .bundles = NULL,
     };
 
-    command.bundles = malloc(sizeof(struct routed_bundle_list));
+    command.bundles = routed_bundle_list_alloc();
     command.bundles->data = routed_bundle;
     command.bundles->next = NULL;
 
-    enum ud3tn_result res = hal_queue_try_push_to_back(tx_queue.tx_queue_handle, &command, timeout);
+    enum ud3tn_result res = cla_contact_tx_task_push(tx_queue, &command, timeout);
     if (res == UD3TN_FAIL) {
-        free(command.bundles);
+        routed_bundle_list_free(command.bundles);
     }
 
     hal_semaphore_release(tx_queue.tx_queue_sem); // taken by get_tx_queue
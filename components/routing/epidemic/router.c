@@ -1,5 +1,8 @@
 
 #include "routing/epidemic/router.h"
+#include "ud3tn/eid_table.h"
+#include "ud3tn/timer_service.h"
+#include <stddef.h>
 #include <stdlib.h>
 
 // Limit the amount of transmissions to nodes that are NOT the destination
@@ -28,7 +31,7 @@ bool bundle_should_be_offered(struct router_contact *rc, struct bundle_info_list
 
     if (candidate->num_pending_transmissions == 0) {
         // if there are no pending transmissions anymore, the only way to transmit this bundle is if this is the bundle's real destination!
-        if (rc->contact->node->eid != NULL && strstr(candidate->destination, rc->contact->node->eid) != NULL) {
+        if (rc->contact->node->eid != NULL && eid_has_node(candidate->destination, rc->contact->node->eid)) {
             LOG("Found direct delivery contact! \\o/");
             return true;
         } else {
@@ -103,79 +106,75 @@ void signal_bundle_expired(struct bundle_info_list_entry *bundle_info) {
     );
 }
 
-void update_bundle_info_list() {
-
-    uint64_t cur_time = hal_time_get_timestamp_s();
+// called for the popped expiry timers, router_contact_htab_sem is held by router_update()
+static void remove_expired_bundle_info(struct bundle_info_list_entry *current, uint64_t cur_time) {
 
-    if (cur_time < router_config.next_bundle_update) {
-        return; // the same second -> probably not much changed (we simply ignore the few bundles that might have been now transmitted)
+    // this bundle is invalid -> we try to delete it!
+    // but only if no contact is trying to send it right now
+    for(int i = router_config.num_router_contacts-1; i >= 0; i--) {
+        if (current == router_config.router_contacts[i]->current_bundle) {
+            // we try again in the next second
+            timer_service_add(&current->expiry_timer, cur_time);
+            return;
+        }
     }
 
-    router_config.next_bundle_update = cur_time + 1; // update every second
+    struct bundle_info_list_entry *next = current->next;
 
-    struct bundle_info_list_entry *current = router_config.bundle_info_list.head;
-    struct bundle_info_list_entry *prev = NULL;
+    if (current->prev) {
+        current->prev->next = next;
+    } else {
+        router_config.bundle_info_list.head = next;
+    }
 
-    // this loops through all available bundles and checks for possible expiration,
-    //TODO: Delete old bundles if not enough space for new ones?
-    while(current != NULL) {
-
-        bool delete = false;
-        if (current->exp_time < cur_time) {
-            delete = true;
-            // this bundle is invalid -> we try to delete it!
-            // but only if no contact is trying to send it right now
-            for(int i = router_config.num_router_contacts-1; i >= 0; i--) {
-                if (current == router_config.router_contacts[i]->current_bundle) {
-                    delete = false;
-                    break;
-                }
-            }
+    // current could also be the last one in the list -> we need to set it to the previous element! (which could also be null)
+    if (next) {
+        next->prev = current->prev;
+    } else {
+        router_config.bundle_info_list.tail = current->prev;
+    }
+
+    // we now need to update all references of the contacts (so they do not reference an old bundle!
+    for(int i = router_config.num_router_contacts-1; i >= 0; i--) {
+        if (current == router_config.router_contacts[i]->next_bundle_candidate) {
+            router_config.router_contacts[i]->next_bundle_candidate = next;
         }
+    }
 
-        if (delete) {
-            struct bundle_info_list_entry *next = current->next;
+    summary_vector_entry_print("Router: Deleting Bundle ", &current->sv_entry);
 
-            if (current == router_config.bundle_info_list.head) {
-                // prev could be null in this case and is not relevant
-                router_config.bundle_info_list.head = next;
-                //LOGF("update_bundle_info_list urrent == router_config.bundle_info_list.hea List head %p", router_config.bundle_info_list.head);
-            } else {
-                // prev is not null!
-                prev->next = next;
-            }
+    signal_bundle_expired(current);
 
-            // current could also be the last one in the list -> we need to set it to the previous element! (which could also be null)
-            if (current == router_config.bundle_info_list.tail) {
-                router_config.bundle_info_list.tail = prev;
-            }
+    eid_release(current->destination); //nothing more todo atm :)
+    free(current); //nothing more todo atm :)
+}
 
-            // we now need to update all references of the contacts (so they do not reference an old bundle!
-            for(int i = router_config.num_router_contacts-1; i >= 0; i--) {
-                if (current == router_config.router_contacts[i]->next_bundle_candidate) {
-                    router_config.router_contacts[i]->next_bundle_candidate = next;
-                }
-            }
+void update_bundle_info_list() {
 
-            summary_vector_entry_print("Router: Deleting Bundle ", &current->sv_entry);
+    uint64_t cur_time = hal_time_get_timestamp_s();
 
-            signal_bundle_expired(current);
+    if (cur_time < router_config.next_bundle_update) {
+        return; // the same second -> probably not much changed (we simply ignore the few bundles that might have been now transmitted)
+    }
 
-            free(current->destination); //nothing more todo atm :)
-            free(current); //nothing more todo atm :)
-            // prev stays the same
-            current = next;
-        } else {
-            prev = current;
-            current = current->next;
-        }
+    router_config.next_bundle_update = cur_time + 1; // update every second
+
+    // this only touches the expired bundles, see remove_expired_bundle_info()
+    //TODO: Delete old bundles if not enough space for new ones?
+    timer_service_advance(cur_time);
+
+    struct timer *timer;
+    while ((timer = timer_service_pop(&router_config.expired_bundles, cur_time)) != NULL) {
+        remove_expired_bundle_info((struct bundle_info_list_entry *)(
+            (char *)timer - offsetof(struct bundle_info_list_entry, expiry_timer)
+        ), cur_time);
     }
 }
 
 
 enum ud3tn_result try_to_send_bundle(const char* eid, struct bundle_info_list_entry *bundle_info) {
 
-    struct routed_bundle *routed_bundle = malloc(sizeof(struct routed_bundle));
+    struct routed_bundle *routed_bundle = routed_bundle_alloc();
 
     if (routed_bundle == NULL)
         return UD3TN_FAIL;
@@ -185,19 +184,19 @@ enum ud3tn_result try_to_send_bundle(const char* eid, struct bundle_info_list_en
     routed_bundle->prio = bundle_info->prio;
     routed_bundle->size = bundle_info->size;
     routed_bundle->exp_time = bundle_info->exp_time;
-    routed_bundle->destination = strdup(eid);
+    routed_bundle->destination = eid_intern(eid);
     routed_bundle->contacts = NULL;
 
     if (routed_bundle->destination == NULL) {
-        free(routed_bundle);
+        routed_bundle_free(routed_bundle);
         return UD3TN_FAIL;
     }
 
     enum ud3tn_result res = contact_manager_try_to_send_bundle(routed_bundle, 100); // TODO: which timeout to use?
 
     if (res == UD3TN_FAIL) {
-        free(routed_bundle->destination);
-        free(routed_bundle);
+        eid_release(routed_bundle->destination);
+        routed_bundle_free(routed_bundle);
     }
 
     return res;
@@ -258,6 +257,7 @@ enum ud3tn_result router_init(const struct bundle_agent_interface *bundle_agent_
     memset(&router_config, 0, sizeof(struct router_config));
     router_config.bundle_agent_interface = bundle_agent_interface;
     router_config.next_bundle_update = 0;
+    timer_queue_init(&router_config.expired_bundles);
 
     htab_init(&router_config.router_contact_htab, CONFIG_BT_MAX_CONN-1, router_config.router_contact_htab_elem);
 
@@ -299,7 +299,7 @@ bool route_epidemic_bundle(struct bundle *bundle) {
         current = current->next;
     }
 
-    info->destination = strdup(bundle->destination);
+    info->destination = eid_ref(bundle->destination);
 
     if (!info->destination) {
         LOG("Router: Could not duplicate destination to route epidemic bundle!");
@@ -313,18 +313,19 @@ bool route_epidemic_bundle(struct bundle *bundle) {
     info->size = bundle_get_serialized_size(bundle);
     info->exp_time = bundle_get_expiration_time_s(bundle);
     info->next = NULL;
+    timer_service_init_timer(&info->expiry_timer, &router_config.expired_bundles);
 
     const char *type = "unknown";
-    if (strstr(bundle->destination, EPIDEMIC_DESTINATION) != NULL) {
+    if (eid_has_node(bundle->destination, EPIDEMIC_DESTINATION)) {
         type = "epidemic";
         info->num_pending_transmissions = -1; // we will have infinite retransmissions!
-    } else if (strstr(bundle->destination, DIRECT_TRANSMISSION_DESTINATION) != NULL) {
+    } else if (eid_has_node(bundle->destination, DIRECT_TRANSMISSION_DESTINATION)) {
         // this is a direct (or spray-and-wait) bundle
         type = "direct";
         if (CONFIG_DIRECT_TRANSMISSION_REPLICAS == -1) {
             info->num_pending_transmissions = -1; // if the num_replicas is also set to -1, we also do epidemic forwarding!
         } else {
-            if (strstr(bundle->source, router_config.bundle_agent_interface->local_eid) != NULL) {
+            if (eid_has_node(bundle->source, router_config.bundle_agent_interface->local_eid)) {
                 // this bundle is from us -> we allow a specific amount of direct transmissions
                 info->num_pending_transmissions = CONFIG_DIRECT_TRANSMISSION_REPLICAS;
             } else {
@@ -343,6 +344,7 @@ bool route_epidemic_bundle(struct bundle *bundle) {
     struct bundle_info_list_entry *cur_tail = router_config.bundle_info_list.tail;
 
     router_config.bundle_info_list.tail = info;
+    info->prev = cur_tail;
 
     if (cur_tail) {
         ASSERT(cur_tail->next == NULL);
@@ -352,6 +354,8 @@ bool route_epidemic_bundle(struct bundle *bundle) {
         router_config.bundle_info_list.head = info;
     }
 
+    timer_service_add(&info->expiry_timer, info->exp_time);
+
     // we now add this bundle to every currently known contact that has no other candidates
     for(int i = router_config.num_router_contacts-1; i >= 0; i--) {
         struct router_contact *rc = router_config.router_contacts[i];
@@ -369,15 +373,16 @@ bool route_epidemic_bundle(struct bundle *bundle) {
 
 bool route_info_bundle(struct bundle *bundle) {
 
-    char * destination = strdup(bundle->destination);
-    struct routed_bundle *rb = malloc(sizeof(struct routed_bundle));
+    char * destination = eid_ref(bundle->destination);
+    struct routed_bundle *rb = routed_bundle_alloc();
 
     bool success = false;
 
     if (destination != NULL && rb != NULL) {
 
         rb->id = bundle->id;
-        rb->prio = bundle_get_routing_priority(bundle);
+        // Info bundles (e.g., summary vectors) overtake queued data bundles
+        rb->prio = BUNDLE_RPRIO_HIGH;
         rb->size = bundle_get_serialized_size(bundle);
         rb->exp_time = bundle_get_expiration_time_s(bundle);
         rb->destination = destination;
@@ -390,8 +395,8 @@ bool route_info_bundle(struct bundle *bundle) {
     }
 
     if (!success) {
-        free(destination);
-        free(rb);
+        eid_release(destination);
+        routed_bundle_free(rb);
     }
 
     return success;
@@ -487,8 +492,8 @@ void router_signal_bundle_transmission(struct routed_bundle *routed_bundle, bool
         // TODO: send signal if the transmission is done, i.e. routed_bundle->dest == bundle->dest
     }
 
-    free(routed_bundle->destination);
-    free(routed_bundle);
+    eid_release(routed_bundle->destination);
+    routed_bundle_free(routed_bundle);
 }
 
 void router_update() {
@@ -114,7 +114,8 @@ void router_task(void *rt_parameters)
         return;
     }
 
-    struct router_signal signal;
+    struct router_signal signals[ROUTER_SIGNAL_BATCH_SIZE];
+    size_t count, i;
 
     ASSERT(rt_parameters != NULL);
     parameters = (struct router_task_parameters *)rt_parameters;
@@ -122,8 +123,10 @@ void router_task(void *rt_parameters)
     for (;;) {
 
         // TODO: introduce 100 as config variable?
-        if (hal_queue_receive(parameters->router_signaling_queue, &signal, 100) == UD3TN_OK) {
-            process_signal(signal,
+        count = hal_queue_receive_batch(parameters->router_signaling_queue, signals,
+                                        ROUTER_SIGNAL_BATCH_SIZE, 100);
+        for (i = 0; i < count; i++) {
+            process_signal(signals[i],
                            parameters->bundle_processor_signaling_queue,
                            parameters->router_signaling_queue
             );
@@ -180,9 +183,10 @@ static bool process_signal(
         case ROUTER_SIGNAL_ROUTE_BUNDLE:
 
             b_id = (bundleid_t)(uintptr_t) signal.data;
-            b = bundle_storage_get(b_id);
+            b = bundle_storage_acquire(b_id);
             if (b != NULL) {
                 router_route_bundle(b);
+                bundle_storage_release(b_id);
             } // TODO: can we just ignore the other case?
             break;
         case ROUTER_SIGNAL_CONTACT_OVER:
@@ -223,6 +227,7 @@ static bool process_signal(
                     //LOGF("RouterTask: ROUTER_SIGNAL_CONN_UP %s", cla_address);
                     contact_manager_handle_conn_up(cla_address);
                     free(cla_address);
+                    bundle_processor_notify_routes_changed();
                 } else {
                     LOG("RouterTask: ROUTER_SIGNAL_CONN_UP with null cla_address");
                 }
@@ -214,6 +214,12 @@ enum ud3tn_result send_sv(const char* sink, const char *destination_eid, struct
 static void on_offer_msg(struct bundle_adu data, void *param) {
     LOGF("Routing Agent: Got offer from \"%s\"", data.source);
 
+    if (bundle_adu_flatten(&data) != UD3TN_OK) {
+        LOG("RoutingAgent: Could not flatten offer");
+        bundle_adu_free_members(data);
+        return;
+    }
+
     // extract real source id
     char *source = routing_agent_create_eid_from_info_bundle_eid(data.source);
 
@@ -266,6 +272,12 @@ static void on_offer_msg(struct bundle_adu data, void *param) {
 static void on_request_msg(struct bundle_adu data, void *param) {
     LOGF("Routing Agent: Got request from \"%s\"", data.source);
 
+    if (bundle_adu_flatten(&data) != UD3TN_OK) {
+        LOG("RoutingAgent: Could not flatten request");
+        bundle_adu_free_members(data);
+        return;
+    }
+
     // extract real source id
     char *source = routing_agent_create_eid_from_info_bundle_eid(data.source);
 
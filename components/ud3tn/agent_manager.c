@@ -11,21 +11,23 @@
 #include <stdlib.h>
 #include <string.h>
 
-static struct agent *agent_search(const char *sink_identifier);
-static int agent_list_add_entry(struct agent *obj);
-static int agent_list_remove_entry(struct agent *obj);
-static struct agent_list **agent_search_ptr(const char *sink_identifier);
-
-static struct agent_list *agent_entry_node;
-
-int agent_register(const char *sink_identifier,
+static struct agent *agent_search(struct agent_list **agents,
+				  const char *sink_identifier);
+static int agent_list_add_entry(struct agent_list **agents,
+				struct agent *obj);
+static int agent_list_remove_entry(struct agent_list **agents,
+				   struct agent *obj);
+static struct agent_list **agent_search_ptr(struct agent_list **agents,
+					    const char *sink_identifier);
+
+int agent_register(struct agent_list **agents, const char *sink_identifier,
 		   void (*const callback)(struct bundle_adu data, void *param),
 		   void *param)
 {
 	struct agent *ag_ptr;
 
 	/* check if agent with that sink_id is already existing */
-	if (agent_search(sink_identifier) != NULL) {
+	if (agent_search(agents, sink_identifier) != NULL) {
 		LOGF(
 			"AgentManager: Agent with sink_id %s is already registered! Abort!",
 			sink_identifier);
@@ -40,7 +42,7 @@ int agent_register(const char *sink_identifier,
 	ag_ptr->callback = callback;
 	ag_ptr->param = param;
 
-	if (agent_list_add_entry(ag_ptr)) {
+	if (agent_list_add_entry(agents, ag_ptr)) {
 		/* the adding process to the list failed */
 		free(ag_ptr);
 		return -1;
@@ -52,11 +54,11 @@ int agent_register(const char *sink_identifier,
 	return 0;
 }
 
-int agent_deregister(const char *sink_identifier)
+int agent_deregister(struct agent_list **agents, const char *sink_identifier)
 {
 	struct agent *ag_ptr;
 
-	ag_ptr = agent_search(sink_identifier);
+	ag_ptr = agent_search(agents, sink_identifier);
 
 	/* check if agent with that sink_id is not existing */
 	if (ag_ptr == NULL) {
@@ -66,7 +68,7 @@ int agent_deregister(const char *sink_identifier)
 		return -1;
 	}
 
-	if (agent_list_remove_entry(ag_ptr)) {
+	if (agent_list_remove_entry(agents, ag_ptr)) {
 		/* the adding process to the list failed */
 		free(ag_ptr);
 		return -1;
@@ -76,9 +78,10 @@ int agent_deregister(const char *sink_identifier)
 	return 0;
 }
 
-int agent_forward(const char *sink_identifier, struct bundle_adu data)
+int agent_forward(struct agent_list **agents, const char *sink_identifier,
+		  struct bundle_adu data)
 {
-	struct agent *ag_ptr = agent_search(sink_identifier);
+	struct agent *ag_ptr = agent_search(agents, sink_identifier);
 
 	if (ag_ptr == NULL) {
 		LOGF("AgentManager: No agent registered for identifier \"%s\"!",
@@ -99,9 +102,10 @@ int agent_forward(const char *sink_identifier, struct bundle_adu data)
 	return 0;
 }
 
-static struct agent_list **agent_search_ptr(const char *sink_identifier)
+static struct agent_list **agent_search_ptr(struct agent_list **agents,
+					    const char *sink_identifier)
 {
-	struct agent_list **al_ptr = &agent_entry_node;
+	struct agent_list **al_ptr = agents;
 
 	/* loop runs until currently examined element is NULL => not found */
 	while (*al_ptr) {
@@ -113,21 +117,23 @@ static struct agent_list **agent_search_ptr(const char *sink_identifier)
 	return NULL;
 }
 
-struct agent *agent_search(const char *sink_identifier)
+static struct agent *agent_search(struct agent_list **agents,
+				  const char *sink_identifier)
 {
-	struct agent_list **al_ptr = agent_search_ptr(sink_identifier);
+	struct agent_list **al_ptr = agent_search_ptr(agents, sink_identifier);
 
 	if (al_ptr)
 		return (*al_ptr)->agent_data;
 	return NULL;
 }
 
-static int agent_list_add_entry(struct agent *obj)
+static int agent_list_add_entry(struct agent_list **agents,
+				struct agent *obj)
 {
 	struct agent_list *ag_ptr;
 	struct agent_list *ag_iterator;
 
-	if (agent_search(obj->sink_identifier) != NULL) {
+	if (agent_search(agents, obj->sink_identifier) != NULL) {
 		/* entry already existing */
 		return -1;
 	}
@@ -138,16 +144,16 @@ static int agent_list_add_entry(struct agent *obj)
 	ag_ptr->agent_data = obj;
 
 	/* check if agent_entry is existing at all */
-	if (agent_entry_node == NULL) {
+	if (*agents == NULL) {
 		/* set list object as new agent_entry node and
 		 * return success
 		 */
-		agent_entry_node = ag_ptr;
+		*agents = ag_ptr;
 		return 0;
 	}
 
 	/* assign the root element to iterator */
-	ag_iterator = agent_entry_node;
+	ag_iterator = *agents;
 
 	/* iterate over the linked list until the identifier is found
 	 * or the end of the list is reached
@@ -170,9 +176,11 @@ static int agent_list_add_entry(struct agent *obj)
 	return -1;
 }
 
-static int agent_list_remove_entry(struct agent *obj)
+static int agent_list_remove_entry(struct agent_list **agents,
+				   struct agent *obj)
 {
-	struct agent_list **al_ptr = agent_search_ptr(obj->sink_identifier);
+	struct agent_list **al_ptr = agent_search_ptr(agents,
+						      obj->sink_identifier);
 	struct agent_list *next_element;
 
 	if (!*al_ptr)
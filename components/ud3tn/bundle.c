@@ -1,6 +1,8 @@
 #include "ud3tn/bundle.h"
 #include "ud3tn/common.h"
 #include "ud3tn/config.h"
+#include "ud3tn/eid_table.h"
+#include "ud3tn/pool.h"
 
 // RFC 5050
 #include "bundle6/bundle6.h"
@@ -9,6 +11,7 @@
 // BPv7-bis
 #include "bundle7/bundle7.h"
 #include "bundle7/eid.h"
+#include "bundle7/hopcount.h"
 #include "bundle7/serializer.h"
 
 #include "platform/hal_time.h"
@@ -18,6 +21,46 @@
 #include <string.h>
 #include <inttypes.h>
 
+static struct pool bundle_pool = POOL_INITIALIZER(
+	struct bundle, "bundle");
+static struct pool block_pool = POOL_INITIALIZER(
+	struct bundle_block, "bundle_block");
+static struct pool block_entry_pool = POOL_INITIALIZER(
+	struct bundle_block_list, "bundle_block_list");
+static struct pool list_entry_pool = POOL_INITIALIZER(
+	struct bundle_list, "bundle_list");
+
+static struct pool *const pools[] = {
+	&bundle_pool,
+	&block_pool,
+	&block_entry_pool,
+	&list_entry_pool,
+};
+
+void bundle_get_pool_stats(struct pool_stats *stats)
+{
+	struct pool_stats cur;
+	size_t i;
+
+	memset(stats, 0, sizeof(struct pool_stats));
+	for (i = 0; i < sizeof(pools) / sizeof(pools[0]); i++) {
+		pool_get_stats(pools[i], &cur);
+		stats->in_use += cur.in_use;
+		stats->peak += cur.peak;
+		stats->capacity += cur.capacity;
+		stats->allocations += cur.allocations;
+		stats->heap_allocations += cur.heap_allocations;
+	}
+}
+
+void bundle_log_pool_stats(void)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(pools) / sizeof(pools[0]); i++)
+		pool_log_stats(pools[i]);
+}
+
 
 static inline void bundle_reset_internal(struct bundle *bundle)
 {
@@ -49,20 +92,36 @@ struct bundle *bundle_init(void)
 {
 	struct bundle *bundle;
 
-	bundle = malloc(sizeof(struct bundle));
+	bundle = pool_alloc(&bundle_pool);
 	bundle_reset_internal(bundle);
+	if (bundle != NULL) {
+		bundle->layout = BUNDLE_LAYOUT_GRAPH;
+		bundle->compact_size = 0;
+		bundle->shared_allocation = NULL;
+	}
 	return bundle;
 }
 
 inline void bundle_free_dynamic_parts(struct bundle *bundle)
 {
+	struct bundle_block_list *e;
+
 	ASSERT(bundle != NULL);
 
 	// EIDs
-	free(bundle->destination);
-	free(bundle->source);
-	free(bundle->report_to);
-	free(bundle->current_custodian);
+	eid_release(bundle->destination);
+	eid_release(bundle->source);
+	eid_release(bundle->report_to);
+	eid_release(bundle->current_custodian);
+
+	// The blocks of compact bundles are released together with the bundle,
+	// only the references to shared payloads have to be dropped
+	if (bundle->layout == BUNDLE_LAYOUT_COMPACT) {
+		for (e = bundle->blocks; e != NULL; e = e->next)
+			payload_buffer_release(e->data->buffer);
+		bundle->layout = BUNDLE_LAYOUT_EXPANDED;
+		return;
+	}
 
 	while (bundle->blocks != NULL)
 		bundle->blocks = bundle_block_entry_free(bundle->blocks);
@@ -79,7 +138,13 @@ void bundle_free(struct bundle *bundle)
 	if (bundle == NULL)
 		return;
 	bundle_free_dynamic_parts(bundle);
-	free(bundle);
+	if (bundle->layout == BUNDLE_LAYOUT_GRAPH)
+		pool_free(&bundle_pool, bundle);
+	// Fragments or ADUs may still reference the payload in the allocation
+	else if (bundle->shared_allocation != NULL)
+		payload_buffer_release(bundle->shared_allocation);
+	else
+		free(bundle);
 }
 
 void bundle_drop(struct bundle *bundle)
@@ -90,17 +155,20 @@ void bundle_drop(struct bundle *bundle)
 
 void bundle_copy_headers(struct bundle *to, const struct bundle *from)
 {
+	const enum bundle_layout layout = to->layout;
+	const size_t compact_size = to->compact_size;
+	struct payload_buffer *const shared_allocation = to->shared_allocation;
+
 	memcpy(to, from, sizeof(struct bundle));
+	to->layout = layout;
+	to->compact_size = compact_size;
+	to->shared_allocation = shared_allocation;
 
 	// Increase EID reference counters
-	if (to->destination != NULL)
-		to->destination = strdup(to->destination);
-	if (to->source != NULL)
-		to->source = strdup(to->source);
-	if (to->report_to != NULL)
-		to->report_to = strdup(to->report_to);
-	if (to->current_custodian != NULL)
-		to->current_custodian = strdup(to->current_custodian);
+	eid_ref(to->destination);
+	eid_ref(to->source);
+	eid_ref(to->report_to);
+	eid_ref(to->current_custodian);
 
 	// No extension blocks are copied
 	to->blocks = NULL;
@@ -125,28 +193,278 @@ enum ud3tn_result bundle_recalculate_header_length(struct bundle *bundle)
 }
 
 
+/*
+ * COMPACT LAYOUT
+ *
+ * The allocation of a compact bundle starts with the bundle struct, followed
+ * by the block list entries, block descriptors and EID reference entries.
+ * All strings and block data follow at the end, as they need no alignment.
+ * The primary EIDs are interned and thus only referenced by the bundle, the
+ * same holds for block data residing in a shared payload buffer. The data of
+ * a Hop Count block gets room for its largest encoding, so that it can be
+ * updated in place when the bundle is forwarded.
+ */
+
+#define COMPACT_ALIGNMENT sizeof(union { void *p; uint64_t u; double d; })
+
+static size_t compact_align(size_t size)
+{
+	return (size + COMPACT_ALIGNMENT - 1) & ~(COMPACT_ALIGNMENT - 1);
+}
+
+static size_t string_size(const char *str)
+{
+	return str != NULL ? strlen(str) + 1 : 0;
+}
+
+static char *compact_string(char **bytes, const char *str)
+{
+	char *result = *bytes;
+	const size_t size = string_size(str);
+
+	if (str == NULL)
+		return NULL;
+	memcpy(result, str, size);
+	*bytes += size;
+	return result;
+}
+
+static size_t block_capacity(const struct bundle_block *block)
+{
+	if (block->type == BUNDLE_BLOCK_TYPE_HOP_COUNT &&
+	    block->length < BUNDLE7_HOP_COUNT_MAX_ENCODED_SIZE)
+		return BUNDLE7_HOP_COUNT_MAX_ENCODED_SIZE;
+	return block->length;
+}
+
+static void get_compact_size(const struct bundle *bundle,
+			     size_t *objects_size, size_t *bytes_size)
+{
+	const struct bundle_block_list *e;
+	const struct endpoint_list *ref;
+
+	*objects_size = compact_align(sizeof(struct bundle));
+	*bytes_size = 0;
+	for (e = bundle->blocks; e != NULL; e = e->next) {
+		*objects_size += compact_align(sizeof(struct bundle_block_list));
+		*objects_size += compact_align(sizeof(struct bundle_block));
+		if (e->data->buffer == NULL)
+			*bytes_size += block_capacity(e->data);
+		for (ref = e->data->eid_refs; ref != NULL; ref = ref->next) {
+			*objects_size += compact_align(
+				sizeof(struct endpoint_list));
+			*bytes_size += string_size(ref->eid);
+		}
+	}
+}
+
+struct bundle *bundle_compact_dup(const struct bundle *bundle)
+{
+	size_t objects_size, bytes_size;
+	struct bundle *result;
+	uint8_t *objects;
+	char *bytes;
+	const struct bundle_block_list *e;
+	const struct endpoint_list *ref;
+	struct bundle_block_list **entry;
+	struct endpoint_list **ref_entry;
+	struct bundle_block *block;
+
+	if (bundle == NULL || bundle->layout == BUNDLE_LAYOUT_COMPACT)
+		return NULL;
+	// The payloads of fragments are handed over on reassembly
+	if (bundle_is_fragmented(bundle))
+		return NULL;
+	// Copying large payloads costs more than their separate allocation
+	if (BUNDLE_COMPACT_MAX_PAYLOAD_SIZE == 0 ||
+	    bundle->payload_block == NULL ||
+	    bundle->payload_block->length > BUNDLE_COMPACT_MAX_PAYLOAD_SIZE)
+		return NULL;
+	get_compact_size(bundle, &objects_size, &bytes_size);
+	result = malloc(objects_size + bytes_size);
+	if (result == NULL)
+		return NULL;
+
+	memcpy(result, bundle, sizeof(struct bundle));
+	result->layout = BUNDLE_LAYOUT_COMPACT;
+	result->compact_size = objects_size + bytes_size;
+	result->shared_allocation = NULL;
+	objects = (uint8_t *)result + compact_align(sizeof(struct bundle));
+	bytes = (char *)result + objects_size;
+
+	// The original stays intact, so the copy gets references of its own
+	eid_ref(result->destination);
+	eid_ref(result->source);
+	eid_ref(result->report_to);
+	eid_ref(result->current_custodian);
+
+	result->payload_block = NULL;
+	entry = &result->blocks;
+	for (e = bundle->blocks; e != NULL; e = e->next) {
+		*entry = (struct bundle_block_list *)objects;
+		objects += compact_align(sizeof(struct bundle_block_list));
+		block = (struct bundle_block *)objects;
+		objects += compact_align(sizeof(struct bundle_block));
+
+		memcpy(block, e->data, sizeof(struct bundle_block));
+		if (e->data->buffer != NULL) {
+			payload_buffer_ref(e->data->buffer);
+		} else if (e->data->data != NULL) {
+			block->data = (uint8_t *)bytes;
+			memcpy(bytes, e->data->data, e->data->length);
+			bytes += block_capacity(e->data);
+		}
+		ref_entry = &block->eid_refs;
+		for (ref = e->data->eid_refs; ref != NULL; ref = ref->next) {
+			*ref_entry = (struct endpoint_list *)objects;
+			objects += compact_align(sizeof(struct endpoint_list));
+			(*ref_entry)->eid = compact_string(&bytes, ref->eid);
+			ref_entry = &(*ref_entry)->next;
+		}
+		*ref_entry = NULL;
+
+		if (e->data == bundle->payload_block)
+			result->payload_block = block;
+		(*entry)->data = block;
+		entry = &(*entry)->next;
+	}
+	*entry = NULL;
+
+	return result;
+}
+
+struct bundle *bundle_compact(struct bundle *bundle)
+{
+	struct bundle *result = bundle_compact_dup(bundle);
+
+	if (result == NULL)
+		return bundle;
+	bundle_free(bundle);
+	return result;
+}
+
+enum ud3tn_result bundle_expand(struct bundle *bundle)
+{
+	struct bundle expanded;
+	struct bundle_block_list *e, *cur;
+
+	ASSERT(bundle != NULL);
+	if (bundle->layout != BUNDLE_LAYOUT_COMPACT)
+		return UD3TN_OK;
+
+	memcpy(&expanded, bundle, sizeof(struct bundle));
+	expanded.layout = BUNDLE_LAYOUT_GRAPH;
+	expanded.payload_block = NULL;
+	expanded.blocks = bundle_block_list_dup(bundle->blocks);
+	if (bundle->blocks != NULL && expanded.blocks == NULL)
+		return UD3TN_FAIL;
+
+	for (e = bundle->blocks, cur = expanded.blocks; e != NULL;
+			e = e->next, cur = cur->next) {
+		if (e->data == bundle->payload_block)
+			expanded.payload_block = cur->data;
+		// The duplicates hold their own references
+		payload_buffer_release(e->data->buffer);
+	}
+
+	/* The struct stays in the compact allocation */
+	memcpy(bundle, &expanded, sizeof(struct bundle));
+	bundle->layout = BUNDLE_LAYOUT_EXPANDED;
+	return UD3TN_OK;
+}
+
+#define RELOCATE(ptr, delta) do { \
+	if ((ptr) != NULL) \
+		(ptr) = (void *)((uintptr_t)(ptr) + (delta)); \
+} while (0)
+
+static struct bundle *compact_dup(const struct bundle *bundle)
+{
+	struct bundle *dup = malloc(bundle->compact_size);
+	const uintptr_t delta = (uintptr_t)dup - (uintptr_t)bundle;
+	struct bundle_block_list *e;
+	struct endpoint_list *ref;
+
+	if (dup == NULL)
+		return NULL;
+	memcpy(dup, bundle, bundle->compact_size);
+	dup->shared_allocation = NULL;
+
+	eid_ref(dup->destination);
+	eid_ref(dup->source);
+	eid_ref(dup->report_to);
+	eid_ref(dup->current_custodian);
+
+	// All other pointers refer to the same allocation and are just moved
+	RELOCATE(dup->payload_block, delta);
+	RELOCATE(dup->blocks, delta);
+	for (e = dup->blocks; e != NULL; e = e->next) {
+		RELOCATE(e->next, delta);
+		RELOCATE(e->data, delta);
+		if (e->data->buffer != NULL)
+			payload_buffer_ref(e->data->buffer);
+		else
+			RELOCATE(e->data->data, delta);
+		RELOCATE(e->data->eid_refs, delta);
+		for (ref = e->data->eid_refs; ref != NULL; ref = ref->next) {
+			RELOCATE(ref->next, delta);
+			RELOCATE(ref->eid, delta);
+		}
+	}
+	return dup;
+}
+
+static enum ud3tn_result share_separate_payload(struct bundle_block *payload)
+{
+	if (payload->buffer != NULL)
+		return UD3TN_OK;
+	payload->buffer = payload_buffer_adopt(payload->data, payload->length);
+	return payload->buffer != NULL ? UD3TN_OK : UD3TN_FAIL;
+}
+
+static enum ud3tn_result share_compact_payload(struct bundle *bundle)
+{
+	struct bundle_block *const payload = bundle->payload_block;
+	struct payload_buffer *buffer;
+
+	if (payload->buffer != NULL)
+		return UD3TN_OK;
+	// One reference keeps the allocation for the bundle, see bundle_free()
+	buffer = payload_buffer_wrap(bundle, payload->data, payload->length);
+	if (buffer == NULL)
+		return UD3TN_FAIL;
+	payload->buffer = payload_buffer_ref(buffer);
+	bundle->shared_allocation = buffer;
+	return UD3TN_OK;
+}
+
 struct bundle *bundle_dup(const struct bundle *bundle)
 {
 	struct bundle *dup;
 	struct bundle_block_list *cur_block;
 
 	ASSERT(bundle != NULL);
-	dup = malloc(sizeof(struct bundle));
+	if (bundle->layout == BUNDLE_LAYOUT_COMPACT)
+		return compact_dup(bundle);
+	dup = pool_alloc(&bundle_pool);
 	if (dup == NULL)
 		return NULL;
 	memcpy(dup, bundle, sizeof(struct bundle));
+	dup->layout = BUNDLE_LAYOUT_GRAPH;
+	dup->compact_size = 0;
+	dup->shared_allocation = NULL;
 
 	// Allocate new EID references
-	if (dup->source)
-		dup->source = strdup(dup->source);
-	if (dup->destination)
-		dup->destination = strdup(dup->destination);
-	if (dup->report_to)
-		dup->report_to = strdup(dup->report_to);
-	if (dup->current_custodian)
-		dup->current_custodian = strdup(dup->current_custodian);
-
-	// Duplicate extension blocks
+	eid_ref(dup->source);
+	eid_ref(dup->destination);
+	eid_ref(dup->report_to);
+	eid_ref(dup->current_custodian);
+
+	// Duplicate extension blocks, the payload is shared if possible and
+	// copied otherwise
+	if (bundle->payload_block != NULL)
+		share_separate_payload(bundle->payload_block);
+	dup->payload_block = NULL;
 	dup->blocks = bundle_block_list_dup(bundle->blocks);
 	if (bundle->blocks != NULL && dup->blocks == NULL) {
 		bundle_free(dup);
@@ -161,20 +479,32 @@ struct bundle *bundle_dup(const struct bundle *bundle)
 			dup->payload_block = cur_block->data;
 			break;
 		}
+		cur_block = cur_block->next;
 	}
 
 	return dup;
 }
 
+enum ud3tn_result bundle_share_payload(struct bundle *bundle)
+{
+	if (bundle->payload_block == NULL)
+		return UD3TN_OK;
+	if (bundle->layout == BUNDLE_LAYOUT_COMPACT)
+		return share_compact_payload(bundle);
+	return share_separate_payload(bundle->payload_block);
+}
+
 enum bundle_routing_priority bundle_get_routing_priority(
 	struct bundle *bundle)
 {
-	// If there are any retention constaints for the bundle or the bundle
-	// has expedited priority (RFC 5050-only)
+	// If there are any retention constaints for the bundle, it is an
+	// administrative record, or it has expedited priority (RFC 5050-only)
 	if (HAS_FLAG(bundle->ret_constraints,
 			BUNDLE_RET_CONSTRAINT_FLAG_OWN)
 		|| HAS_FLAG(bundle->ret_constraints,
 			BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED)
+		|| HAS_FLAG(bundle->proc_flags,
+			BUNDLE_FLAG_ADMINISTRATIVE_RECORD)
 		|| (bundle->protocol_version == 6
 			&& HAS_FLAG(bundle->proc_flags,
 				BUNDLE_V6_FLAG_EXPEDITED_PRIORITY)))
@@ -207,7 +537,7 @@ struct bundle_list *bundle_list_entry_create(struct bundle *bundle)
 	if (bundle == NULL)
 		return NULL;
 
-	struct bundle_list *entry = malloc(sizeof(struct bundle_list));
+	struct bundle_list *entry = pool_alloc(&list_entry_pool);
 
 	if (entry == NULL)
 		return NULL;
@@ -225,13 +555,13 @@ struct bundle_list *bundle_list_entry_free(struct bundle_list *entry)
 	ASSERT(entry != NULL);
 	next = entry->next;
 	bundle_free(entry->data);
-	free(entry);
+	pool_free(&list_entry_pool, entry);
 	return next;
 }
 
 struct bundle_block *bundle_block_create(enum bundle_block_type t)
 {
-	struct bundle_block *block = malloc(sizeof(struct bundle_block));
+	struct bundle_block *block = pool_alloc(&block_pool);
 
 	if (block == NULL)
 		return NULL;
@@ -242,6 +572,7 @@ struct bundle_block *bundle_block_create(enum bundle_block_type t)
 	block->crc_type = BUNDLE_CRC_TYPE_NONE;
 	block->length = 0;
 	block->data = NULL;
+	block->buffer = NULL;
 	return block;
 }
 
@@ -251,7 +582,7 @@ struct bundle_block_list *bundle_block_entry_create(struct bundle_block *b)
 
 	if (b == NULL)
 		return NULL;
-	entry = malloc(sizeof(struct bundle_block_list));
+	entry = pool_alloc(&block_entry_pool);
 	if (entry == NULL)
 		return NULL;
 	entry->data = b;
@@ -264,9 +595,11 @@ void bundle_block_free(struct bundle_block *b)
 	if (b != NULL) {
 		if (b->eid_refs != NULL)
 			free(b->eid_refs);
-		if (b->data != NULL)
+		if (b->buffer != NULL)
+			payload_buffer_release(b->buffer);
+		else if (b->data != NULL)
 			free(b->data);
-		free(b);
+		pool_free(&block_pool, b);
 	}
 }
 
@@ -277,16 +610,29 @@ struct bundle_block_list *bundle_block_entry_free(struct bundle_block_list *e)
 	ASSERT(e != NULL);
 	next = e->next;
 	bundle_block_free(e->data);
-	free(e);
+	pool_free(&block_entry_pool, e);
 	return next;
 }
 
+struct bundle_block_list *bundle_block_entry_remove(
+	struct bundle *bundle, struct bundle_block_list *e)
+{
+	ASSERT(e != NULL);
+	// Entries of compact bundles are released together with the bundle
+	if (bundle->layout == BUNDLE_LAYOUT_COMPACT) {
+		payload_buffer_release(e->data->buffer);
+		e->data->buffer = NULL;
+		return e->next;
+	}
+	return bundle_block_entry_free(e);
+}
+
 struct bundle_block *bundle_block_dup(struct bundle_block *b)
 {
 	struct bundle_block *dup;
 
 	ASSERT(b != NULL);
-	dup = malloc(sizeof(struct bundle_block));
+	dup = pool_alloc(&block_pool);
 	if (dup == NULL)
 		return NULL;
 	memcpy(dup, b, sizeof(struct bundle_block));
@@ -304,6 +650,12 @@ struct bundle_block *bundle_block_dup(struct bundle_block *b)
 		cur_ref = cur_ref->next;
 	}
 
+	// Slices of shared payloads are referenced, not copied
+	if (b->buffer != NULL) {
+		payload_buffer_ref(b->buffer);
+		return dup;
+	}
+
 	dup->data = malloc(b->length);
 	if (dup->data == NULL)
 		goto err;
@@ -432,7 +784,7 @@ struct bundle_unique_identifier bundle_get_unique_identifier(
 {
 	return (struct bundle_unique_identifier){
 		.protocol_version = bundle->protocol_version,
-		.source = strdup(bundle->source),
+		.source = eid_ref(bundle->source),
 		.creation_timestamp_ms = bundle->creation_timestamp_ms,
 		.sequence_number = bundle->sequence_number,
 		.fragment_offset = bundle->fragment_offset,
@@ -442,7 +794,7 @@ struct bundle_unique_identifier bundle_get_unique_identifier(
 
 void bundle_free_unique_identifier(struct bundle_unique_identifier *id)
 {
-	free(id->source);
+	eid_release(id->source);
 }
 
 bool bundle_is_equal(
@@ -460,7 +812,7 @@ bool bundle_is_equal_parent(
 {
 	return (
 		bundle->protocol_version == id->protocol_version &&
-		strcmp(bundle->source, id->source) == 0 && // XXX '==' may be ok
+		bundle->source == id->source &&
 		bundle->creation_timestamp_ms == id->creation_timestamp_ms &&
 		bundle->sequence_number == id->sequence_number
 	);
@@ -471,27 +823,126 @@ struct bundle_adu bundle_adu_init(const struct bundle *bundle)
 	return (struct bundle_adu){
 		.protocol_version = bundle->protocol_version,
 		.proc_flags = bundle->proc_flags & ~BUNDLE_FLAG_IS_FRAGMENT,
-		.source = strdup(bundle->source),
-		.destination = strdup(bundle->destination),
+		.source = eid_ref(bundle->source),
+		.destination = eid_ref(bundle->destination),
 		.payload = NULL,
-		.length = 0
+		.length = 0,
+		.segments = NULL,
+		.segment_count = 0
 	};
 }
 
+static void take_shared_payload(struct bundle_adu *adu,
+				struct bundle_block *payload)
+{
+	uint8_t *data = NULL;
+
+	// A buffer which is no longer shared is handed over as it is
+	if (payload->data == payload->buffer->data &&
+	    payload->length == payload->buffer->length)
+		data = payload_buffer_steal(payload->buffer);
+	if (data != NULL) {
+		adu->payload = data;
+	} else {
+		adu->segments = malloc(sizeof(struct bundle_adu_segment));
+		if (adu->segments == NULL) {
+			adu->length = 0;
+			return;
+		}
+		adu->segments[0] = (struct bundle_adu_segment){
+			.buffer = payload->data,
+			.offset = 0,
+			.length = payload->length,
+			.shared = payload->buffer,
+		};
+		adu->segment_count = 1;
+	}
+	// The reference is owned by the ADU now
+	payload->buffer = NULL;
+	payload->data = NULL;
+	payload->length = 0;
+}
+
 struct bundle_adu bundle_to_adu(struct bundle *bundle)
 {
 	struct bundle_adu adu = bundle_adu_init(bundle);
 
-	adu.payload = bundle->payload_block->data;
 	adu.length = bundle->payload_block->length;
+	// The payload of compact bundles is referenced in their allocation
+	if (bundle->layout == BUNDLE_LAYOUT_COMPACT)
+		share_compact_payload(bundle);
+	if (bundle->payload_block->buffer != NULL) {
+		take_shared_payload(&adu, bundle->payload_block);
+		return adu;
+	}
+	// The payload of compact bundles cannot be handed over if the
+	// allocation could not be shared
+	if (bundle->layout == BUNDLE_LAYOUT_COMPACT) {
+		adu.payload = malloc(adu.length);
+		if (adu.payload != NULL)
+			memcpy(adu.payload, bundle->payload_block->data,
+			       adu.length);
+		else
+			adu.length = 0;
+		return adu;
+	}
+	adu.payload = bundle->payload_block->data;
 	bundle->payload_block->data = NULL;
 	bundle->payload_block->length = 0;
 	return adu;
 }
 
+static void segment_free(const struct bundle_adu_segment *segment)
+{
+	if (segment->shared != NULL)
+		payload_buffer_release(segment->shared);
+	else
+		free(segment->buffer);
+}
+
 void bundle_adu_free_members(struct bundle_adu adu)
 {
-	free(adu.source);
-	free(adu.destination);
+	size_t i;
+
+	eid_release(adu.source);
+	eid_release(adu.destination);
 	free(adu.payload);
+	for (i = 0; i < adu.segment_count; i++)
+		segment_free(&adu.segments[i]);
+	free(adu.segments);
+}
+
+enum ud3tn_result bundle_adu_flatten(struct bundle_adu *adu)
+{
+	const struct bundle_adu_segment *const first = adu->segments;
+	uint8_t *payload = NULL;
+	size_t i, position = 0;
+
+	if (adu->segments == NULL)
+		return UD3TN_OK;
+	// A single segment covering its whole buffer is used as it is
+	if (adu->segment_count == 1 && first->offset == 0) {
+		if (first->shared == NULL)
+			payload = first->buffer;
+		else if (first->buffer == first->shared->data &&
+			 first->length == first->shared->length)
+			payload = payload_buffer_steal(first->shared);
+	}
+	if (payload == NULL) {
+		payload = malloc(adu->length);
+		if (payload == NULL)
+			return UD3TN_FAIL;
+		for (i = 0; i < adu->segment_count; i++) {
+			memcpy(&payload[position],
+			       &adu->segments[i].buffer[adu->segments[i].offset],
+			       adu->segments[i].length);
+			position += adu->segments[i].length;
+			segment_free(&adu->segments[i]);
+		}
+	}
+	free(adu->segments);
+	adu->segments = NULL;
+	adu->segment_count = 0;
+	adu->payload = payload;
+	return UD3TN_OK;
 }
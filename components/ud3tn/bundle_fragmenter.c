@@ -16,7 +16,7 @@ struct bundle *bundlefragmenter_create_new_fragment(
 	struct bundle *fragment;
 	struct bundle_block *fragment_pl;
 
-	fragment = malloc(sizeof(struct bundle));
+	fragment = bundle_init();
 	if (fragment == NULL)
 		return NULL;
 	bundle_copy_headers(fragment, prototype);
@@ -33,7 +33,7 @@ struct bundle *bundlefragmenter_create_new_fragment(
 		/* Create new PL block */
 		fragment_pl = bundle_block_create(BUNDLE_BLOCK_TYPE_PAYLOAD);
 		if (fragment_pl == NULL) {
-			free(fragment);
+			bundle_free(fragment);
 			return NULL;
 		}
 		fragment_pl->flags = prototype->payload_block->flags;
@@ -41,7 +41,7 @@ struct bundle *bundlefragmenter_create_new_fragment(
 		fragment->blocks = bundle_block_entry_create(fragment_pl);
 		if (fragment->blocks == NULL) {
 			bundle_block_free(fragment_pl);
-			free(fragment);
+			bundle_free(fragment);
 			return NULL;
 		}
 		/* Set the bundle's payload reference */
@@ -64,7 +64,9 @@ struct bundle *bundlefragmenter_initialize_first_fragment(struct bundle *input)
 	if (result == NULL)
 		return NULL;
 
-	// Copy all extension blocks (includung payload block) to fragment
+	// Copy all extension blocks to fragment, the payload block references
+	// the input's payload (or a copy, if it cannot be shared)
+	bundle_share_payload(input);
 	cur_block = bundle_block_list_dup(input->blocks);
 	result->blocks = cur_block;
 
@@ -93,6 +95,9 @@ struct bundle *bundlefragmenter_initialize_first_fragment(struct bundle *input)
 struct bundle *bundlefragmenter_fragment_bundle(struct bundle *working_bundle,
 	uint64_t first_max)
 {
+	/* The payload of the working bundle is shortened */
+	if (bundle_expand(working_bundle) != UD3TN_OK)
+		return NULL;
 	switch (working_bundle->protocol_version) {
 	// RFC 5050
 	case 6:
@@ -1,9 +1,12 @@
 #include "ud3tn/agent_manager.h"
+#include "ud3tn/bundle_reassembly.h"
 #include "ud3tn/common.h"
 #include "ud3tn/config.h"
 #include "ud3tn/custody_manager.h"
+#include "ud3tn/eid_table.h"
 #include "ud3tn/bundle_processor.h"
 #include "ud3tn/bundle_storage_manager.h"
+#include "ud3tn/persistent_storage.h"
 #include "ud3tn/report_manager.h"
 #include "ud3tn/result.h"
 #include "routing/router_task.h"
@@ -12,12 +15,17 @@
 #include "bundle6/bundle6.h"
 #include "bundle7/hopcount.h"
 
+#include "util/htab_hash.h"
+
+#include "platform/hal_config.h"
 #include "platform/hal_io.h"
 #include "platform/hal_queue.h"
+#include "platform/hal_reply.h"
 #include "platform/hal_task.h"
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -32,72 +40,151 @@ enum bundle_handling_result {
 	BUNDLE_HRESULT_BLOCK_DISCARDED,
 };
 
-// TODO: Move static state into context struct passed into functions
+/* Status reports generated while handling a batch of signals */
+struct pending_report {
+	struct bundle *report;
+	bundleid_t subject;
+};
 
-static QueueIdentifier_t out_queue;
-static const char *local_eid;
-static bool status_reporting;
+/*
+ * A bundle restored from the persistent storage. It is kept while waiting
+ * for a route or an agent, as neither may be known directly after a restart.
+ */
+struct restored_bundle {
+	bundleid_t id;
+	bool waiting;
+};
 
-static struct reassembly_list {
-	struct reassembly_bundle_list {
-		struct bundle *bundle;
-		struct reassembly_bundle_list *next;
-	} *bundle_list;
-	struct reassembly_list *next;
-} *reassembly_list;
+/*
+ * The state of one bundle processor shard. Every shard runs in a task of its
+ * own and handles the signals of the bundles assigned to it, so that all
+ * signals for a bundle are processed by the same task in the order they were
+ * sent. The configuration and the list of known bundles are shared.
+ */
+struct bp_context {
+	uint8_t shard;
+	QueueIdentifier_t signaling_queue;
+
+	/* Shared, not modified after initialization */
+	QueueIdentifier_t out_queue;
+	char *local_eid;
+	char *none_eid;
+	bool status_reporting;
+	struct known_bundle_list *known_bundle_list;
+
+	/* Owned by the shard */
+	struct agent_list *agents;
+	struct reassembly_table reassembly_table;
+	struct pending_report pending_reports[
+		BUNDLE_PROCESSOR_SIGNAL_BATCH_SIZE];
+	size_t pending_report_count;
+	/* Index of the next report to be sent */
+	size_t pending_report_head;
+	bool defer_reports;
+	/* Bundles loaded from the persistent storage, sorted by ID */
+	struct restored_bundle *restored;
+	size_t restored_count;
+	size_t restored_capacity;
+	size_t restored_waiting;
+	bool redispatching;
+	/* Set if an agent has been registered since the last retry */
+	bool agents_changed;
+	/* Set by bundle_processor_notify_routes_changed() */
+	bool routes_changed;
+};
 
-static struct known_bundle_list *known_bundle_list;
+static struct bp_context shards[BUNDLE_PROCESSOR_SHARDS];
 
 // for performing (de)register operations
 struct agent_manager_parameters {
-	QueueIdentifier_t feedback_queue;
 	struct agent agent;
+	/* Set if the requesting task waits, it owns the parameters then */
+	struct hal_reply *reply;
+	/* Number of shards which have not performed the action yet */
+	uint8_t remaining;
+	/* Whether the action succeeded, written by each shard before replying */
+	bool succeeded[BUNDLE_PROCESSOR_SHARDS];
 };
 
 /* DECLARATIONS */
 
-static inline void handle_signal(const struct bundle_processor_signal signal);
-
-static void bundle_dispatch(struct bundle *bundle);
-static bool bundle_endpoint_is_local(struct bundle *bundle);
-static enum ud3tn_result bundle_forward(struct bundle *bundle, uint16_t timeout);
-static void bundle_forwarding_scheduled(struct bundle *bundle);
-static void bundle_forwarding_success(struct bundle *bundle);
+static void handle_signals(struct bp_context *const ctx,
+	const struct bundle_processor_signal *signals, size_t count);
+static inline void handle_signal(struct bp_context *const ctx,
+	const struct bundle_processor_signal signal, struct bundle *b);
+static void send_pending_reports(struct bp_context *const ctx);
+
+static void bundle_dispatch(struct bp_context *const ctx,
+	struct bundle *bundle);
+static bool bundle_endpoint_is_local(struct bp_context *const ctx,
+	struct bundle *bundle);
+static enum ud3tn_result bundle_forward(struct bp_context *const ctx,
+	struct bundle *bundle, uint16_t timeout);
+static void bundle_forwarding_scheduled(struct bp_context *const ctx,
+	struct bundle *bundle);
+static void bundle_forwarding_success(struct bp_context *const ctx,
+	struct bundle *bundle);
 static void bundle_forwarding_contraindicated(
+	struct bp_context *const ctx,
 	struct bundle *bundle, enum bundle_status_report_reason reason);
 static void bundle_forwarding_failed(
+	struct bp_context *const ctx,
 	struct bundle *bundle, enum bundle_status_report_reason reason);
-static void bundle_expired(struct bundle *bundle);
-static void bundle_receive(struct bundle *bundle);
+static void bundle_expired(struct bp_context *const ctx, struct bundle *bundle);
+static void bundle_evicted(struct bp_context *const ctx, struct bundle *bundle);
+static void bundle_receive(struct bp_context *const ctx, struct bundle *bundle);
 static enum bundle_handling_result handle_unknown_block_flags(
+	struct bp_context *const ctx,
 	struct bundle *bundle, enum bundle_block_flags flags);
-static void bundle_deliver_local(struct bundle *bundle);
-static void bundle_attempt_reassembly(struct bundle *bundle);
-static void bundle_deliver_adu(struct bundle_adu data);
-static void bundle_custody_accept(struct bundle *bundle);
+static void bundle_deliver_local(struct bp_context *const ctx,
+	struct bundle *bundle);
+static void bundle_attempt_reassembly(struct bp_context *const ctx,
+	struct bundle *bundle);
+static void bundle_deliver_adu(struct bp_context *const ctx,
+	struct bundle_adu data);
+static void bundle_custody_accept(struct bp_context *const ctx,
+	struct bundle *bundle);
 static void bundle_custody_success(struct bundle *bundle);
 static void bundle_custody_failure(
 	struct bundle *bundle, enum bundle_custody_signal_reason reason);
 static void bundle_delete(
+	struct bp_context *const ctx,
 	struct bundle *bundle, enum bundle_status_report_reason reason);
 static void bundle_discard(struct bundle *bundle);
 static void bundle_handle_custody_signal(
+	struct bp_context *const ctx,
 	struct bundle_administrative_record *signal);
-static void bundle_dangling(struct bundle *bundle);
-static bool hop_count_validation(struct bundle *bundle);
-static const char *get_agent_id(const char *dest_eid);
-static bool bundle_record_add_and_check_known(const struct bundle *bundle);
-static bool bundle_reassembled_is_known(const struct bundle *bundle);
-static void bundle_add_reassembled_as_known(const struct bundle *bundle);
+static void bundle_dangling(struct bp_context *const ctx,
+	struct bundle *bundle);
+static void bundle_restored(struct bundle *bundle, persistentid_t pid,
+	void *param);
+static int compare_restored(const void *a, const void *b);
+static void dispatch_restored(struct bp_context *const ctx);
+static bool keep_restored(struct bp_context *const ctx,
+	struct bundle *bundle);
+static void forget_restored(struct bp_context *const ctx, bundleid_t id);
+static bool hop_count_validation(struct bp_context *const ctx,
+	struct bundle *bundle);
+static const char *get_agent_id(struct bp_context *const ctx,
+	const char *dest_eid);
+static bool bundle_record_add_and_check_known(struct bp_context *const ctx,
+	const struct bundle *bundle);
+static bool bundle_reassembled_is_known(struct bp_context *const ctx,
+	const struct bundle *bundle);
+static void bundle_add_reassembled_as_known(struct bp_context *const ctx,
+	const struct bundle *bundle);
 
 static void send_status_report(
+	struct bp_context *const ctx,
 	struct bundle *bundle,
 	const enum bundle_status_report_status_flags status,
 	const enum bundle_status_report_reason reason);
-static void send_custody_signal(struct bundle *bundle,
+static void send_custody_signal(struct bp_context *const ctx,
+	struct bundle *bundle,
 	const enum bundle_custody_signal_type,
 	const enum bundle_custody_signal_reason reason);
-static enum ud3tn_result send_bundle(bundleid_t bundle, uint16_t timeout);
+static enum ud3tn_result send_bundle(struct bp_context *const ctx,
+	bundleid_t bundle, uint16_t timeout);
 static struct bundle_block *find_block_by_type(struct bundle_block_list *blocks,
 	enum bundle_block_type type);
 
@@ -115,6 +202,61 @@ static inline void bundle_rem_rc(struct bundle *bundle,
 		bundle_discard(bundle);
 }
 
+/* SHARDING */
+
+/*
+ * Bundles are assigned to shards by the same key the reassembly and the
+ * known bundle list use, thus, all fragments of an ADU and all copies of a
+ * bundle end up in the same shard. Sources are interned, so their address
+ * identifies them.
+ */
+static struct bp_context *get_shard_of(const struct bundle *bundle)
+{
+	const uint64_t key[3] = {
+		(uintptr_t)bundle->source,
+		bundle->creation_timestamp_ms,
+		bundle->sequence_number,
+	};
+
+	if (BUNDLE_PROCESSOR_SHARDS == 1)
+		return &shards[0];
+	return &shards[hashlittle(key, sizeof(key), 0) %
+		       BUNDLE_PROCESSOR_SHARDS];
+}
+
+static QueueIdentifier_t get_queue_of(bundleid_t id)
+{
+	struct bp_context *shard = &shards[0];
+	struct bundle *bundle;
+
+	if (BUNDLE_PROCESSOR_SHARDS == 1)
+		return shard->signaling_queue;
+	/* Signals for bundles which are gone are dropped by the first shard */
+	bundle = bundle_storage_acquire(id);
+	if (bundle != NULL) {
+		shard = get_shard_of(bundle);
+		bundle_storage_release(id);
+	}
+	return shard->signaling_queue;
+}
+
+/* Called by the bundle storage, possibly in the context of a shard */
+static void evict_bundle(bundleid_t id, void *param)
+{
+	struct bundle_processor_signal signal = {
+		.type = BP_SIGNAL_BUNDLE_EVICTED,
+		.reason = BUNDLE_SR_REASON_DEPLETED_STORAGE,
+		.bundle = id,
+		.extra = NULL
+	};
+
+	(void)param;
+	/* A shard adding a bundle must not block on a full queue */
+	if (hal_queue_try_push_to_back(get_queue_of(id), &signal, 0)
+			!= UD3TN_OK)
+		bundle_storage_cancel_eviction(id);
+}
+
 /* COMMUNICATION */
 void bundle_processor_inform(
 	QueueIdentifier_t bundle_processor_signaling_queue, bundleid_t bundle,
@@ -130,9 +272,88 @@ void bundle_processor_inform(
 
 	ASSERT(type != BP_SIGNAL_AGENT_REGISTER && type != BP_SIGNAL_AGENT_DEREGISTER);
 
+	/* The other subsystems know the queue of the first shard only */
+	if (bundle_processor_signaling_queue == shards[0].signaling_queue)
+		bundle_processor_signaling_queue = get_queue_of(bundle);
 	hal_queue_push_to_back(bundle_processor_signaling_queue, &signal);
 }
 
+enum ud3tn_result bundle_processor_try_inform(
+	QueueIdentifier_t bundle_processor_signaling_queue, bundleid_t bundle,
+	enum bundle_processor_signal_type type,
+	enum bundle_status_report_reason reason)
+{
+	struct bundle_processor_signal signal = {
+		.type = type,
+		.reason = reason,
+		.bundle = bundle,
+		.extra = NULL
+	};
+
+	ASSERT(type != BP_SIGNAL_AGENT_REGISTER && type != BP_SIGNAL_AGENT_DEREGISTER);
+
+	if (bundle_processor_signaling_queue == shards[0].signaling_queue)
+		bundle_processor_signaling_queue = get_queue_of(bundle);
+	return hal_queue_try_push_to_back(bundle_processor_signaling_queue,
+					  &signal, 0);
+}
+
+void bundle_processor_notify_routes_changed(void)
+{
+	struct bundle_processor_signal signal = {
+		.type = BP_SIGNAL_ROUTES_CHANGED,
+		.reason = BUNDLE_SR_REASON_NO_INFO,
+		.bundle = BUNDLE_INVALID_ID,
+		.extra = NULL
+	};
+	int i;
+
+	for (i = 0; i < BUNDLE_PROCESSOR_SHARDS; i++) {
+		/* One wake-up in flight suffices, the flag is checked anyway */
+		if (__atomic_exchange_n(&shards[i].routes_changed, true,
+					__ATOMIC_ACQ_REL))
+			continue;
+		/* The shard may wait for the router, which calls this */
+		hal_queue_try_push_to_back(shards[i].signaling_queue,
+					   &signal, 0);
+	}
+}
+
+/* Deregisters the agent from the shards in which its registration succeeded */
+static void rollback_registration(
+	const struct agent_manager_parameters *const registration)
+{
+	struct agent_manager_parameters aaps = {
+		.agent = registration->agent,
+	};
+	struct bundle_processor_signal signal = {
+		.type = BP_SIGNAL_AGENT_DEREGISTER,
+		.reason = BUNDLE_SR_REASON_NO_INFO,
+		.bundle = BUNDLE_INVALID_ID,
+		.extra = &aaps
+	};
+	struct hal_reply reply;
+	uint8_t i;
+
+	for (i = 0; i < BUNDLE_PROCESSOR_SHARDS; i++) {
+		if (registration->succeeded[i])
+			aaps.remaining++;
+	}
+	if (aaps.remaining == 0)
+		return;
+	LOGF("BundleProcessor: Rolling back the registration of \"%s\" in %d shard(s)",
+	     aaps.agent.sink_identifier, aaps.remaining);
+	if (hal_reply_init(&reply, aaps.remaining) != UD3TN_OK)
+		return;
+	aaps.reply = &reply;
+	for (i = 0; i < BUNDLE_PROCESSOR_SHARDS; i++) {
+		if (registration->succeeded[i])
+			hal_queue_push_to_back(shards[i].signaling_queue,
+					       &signal);
+	}
+	hal_reply_wait(&reply);
+}
+
 int bundle_processor_perform_agent_action(
 	QueueIdentifier_t signaling_queue,
 	enum bundle_processor_signal_type type,
@@ -148,90 +369,288 @@ int bundle_processor_perform_agent_action(
 		.extra = NULL
 	};
 
-	struct agent_manager_parameters *aaps;
-	QueueIdentifier_t feedback_queue;
+	struct agent_manager_parameters waiting_aaps, *aaps = &waiting_aaps;
+	struct hal_reply reply;
+	uint8_t count = 1, i;
 	int result;
 
 	ASSERT((type == BP_SIGNAL_AGENT_REGISTER && callback)
 		|| type == BP_SIGNAL_AGENT_DEREGISTER);
 	ASSERT(sink_identifier);
 
-	aaps = malloc(sizeof(struct agent_manager_parameters));
-	if (!aaps)
-		return -1;
+	/* Every shard delivers bundles, so all of them know the agents */
+	if (signaling_queue == shards[0].signaling_queue)
+		count = BUNDLE_PROCESSOR_SHARDS;
+	/* A registration failing in some shards is rolled back in the others */
+	if (type == BP_SIGNAL_AGENT_REGISTER && count > 1)
+		wait_for_feedback = true;
+
+	/* The parameters outlive the call only if it does not wait */
+	if (wait_for_feedback) {
+		if (hal_reply_init(&reply, count) != UD3TN_OK)
+			return -1;
+		aaps->reply = &reply;
+	} else {
+		aaps = malloc(sizeof(struct agent_manager_parameters));
+		if (!aaps)
+			return -1;
+		aaps->reply = NULL;
+	}
 
 	aaps->agent.sink_identifier = sink_identifier;
 	aaps->agent.callback = callback;
 	aaps->agent.param = param;
-	aaps->feedback_queue = NULL;
+	aaps->remaining = count;
+	for (i = 0; i < BUNDLE_PROCESSOR_SHARDS; i++)
+		aaps->succeeded[i] = false;
 	signal.extra = aaps;
 
-	if (!wait_for_feedback) {
+	if (count == 1) {
 		hal_queue_push_to_back(signaling_queue, &signal);
+	} else {
+		for (i = 0; i < count; i++)
+			hal_queue_push_to_back(shards[i].signaling_queue,
+					       &signal);
+	}
+
+	if (!wait_for_feedback)
 		return 0;
+
+	/* The action failed if it failed for any shard */
+	result = hal_reply_wait(&reply);
+	if (result != 0 && type == BP_SIGNAL_AGENT_REGISTER && count > 1)
+		rollback_registration(aaps);
+	return result;
+}
+
+size_t bundle_processor_receive_signals(
+	QueueIdentifier_t signaling_queue,
+	struct bundle_processor_signal *signals, size_t max)
+{
+	ASSERT(max != 0);
+	return hal_queue_receive_batch(signaling_queue, signals, max, -1);
+}
+
+static bool signal_is_idempotent(enum bundle_processor_signal_type type)
+{
+	switch (type) {
+	case BP_SIGNAL_BUNDLE_EXPIRED:
+	case BP_SIGNAL_TRANSMISSION_SUCCESS:
+		return true;
+	default:
+		return false;
 	}
+}
 
-	feedback_queue = hal_queue_create(1, sizeof(int));
-	if (!feedback_queue) {
-		free(aaps);
-		return -1;
+size_t bundle_processor_coalesce_signals(
+	struct bundle_processor_signal *signals, size_t count)
+{
+	size_t kept = 0, i, j;
+
+	for (i = 0; i < count; i++) {
+		if (signal_is_idempotent(signals[i].type)) {
+			/* Find the preceding signal for the same bundle */
+			for (j = kept; j > 0; j--) {
+				if (signals[j - 1].bundle == signals[i].bundle)
+					break;
+			}
+			if (j > 0 && signals[j - 1].type == signals[i].type &&
+					signals[j - 1].reason == signals[i].reason)
+				continue;
+		}
+		signals[kept++] = signals[i];
 	}
+	return kept;
+}
 
-	aaps->feedback_queue = feedback_queue;
-	hal_queue_push_to_back(signaling_queue, &signal);
+static void bundle_processor_task(void *const param)
+{
+	struct bp_context *const ctx = param;
+	struct bundle_processor_signal signals[
+		BUNDLE_PROCESSOR_SIGNAL_BATCH_SIZE];
+	size_t count;
 
-	if (hal_queue_receive(feedback_queue, &result, -1) == UD3TN_OK) {
-		hal_queue_delete(feedback_queue);
-		return result;
-	}
+	dispatch_restored(ctx);
 
-	hal_queue_delete(feedback_queue);
-	return -1;
+	for (;;) {
+		count = bundle_processor_receive_signals(
+			ctx->signaling_queue,
+			signals,
+			BUNDLE_PROCESSOR_SIGNAL_BATCH_SIZE
+		);
+		count = bundle_processor_coalesce_signals(signals, count);
+		if (count != 0)
+			handle_signals(ctx, signals, count);
+		if (__atomic_exchange_n(&ctx->routes_changed, false,
+					__ATOMIC_ACQ_REL) ||
+		    ctx->agents_changed) {
+			ctx->agents_changed = false;
+			dispatch_restored(ctx);
+		}
+	}
 }
 
-void bundle_processor_task(void * const param)
+static enum ud3tn_result init_shard(
+	struct bp_context *const ctx,
+	const struct bundle_processor_task_parameters *const p,
+	struct known_bundle_list *const known_bundle_list)
 {
-	struct bundle_processor_task_parameters *p =
-		(struct bundle_processor_task_parameters *)param;
-	struct bundle_processor_signal signal;
+	ctx->shard = (uint8_t)(ctx - shards);
+	if (ctx == &shards[0])
+		ctx->signaling_queue = p->signaling_queue;
+	else
+		ctx->signaling_queue = hal_queue_create(
+			BUNDLE_QUEUE_LENGTH,
+			sizeof(struct bundle_processor_signal)
+		);
+	if (ctx->signaling_queue == NULL)
+		return UD3TN_FAIL;
 
-	out_queue = p->router_signaling_queue;
-	local_eid = p->local_eid;
-	status_reporting = p->status_reporting;
+	ctx->out_queue = p->router_signaling_queue;
+	ctx->local_eid = eid_intern(p->local_eid);
+	ctx->none_eid = eid_intern("dtn:none");
+	ctx->status_reporting = p->status_reporting;
+	ctx->known_bundle_list = known_bundle_list;
+
+	ctx->agents = NULL;
+	ctx->pending_report_count = 0;
+	ctx->pending_report_head = 0;
+	ctx->defer_reports = false;
+	ctx->restored = NULL;
+	ctx->restored_count = 0;
+	ctx->restored_capacity = 0;
+	ctx->restored_waiting = 0;
+	ctx->redispatching = false;
+	ctx->agents_changed = false;
+	ctx->routes_changed = false;
+	return bundle_reassembly_init(&ctx->reassembly_table);
+}
+
+enum ud3tn_result bundle_processor_start(
+	const struct bundle_processor_task_parameters *const p)
+{
+	struct known_bundle_list *known_bundle_list;
+	uint32_t restored;
+	uint8_t i;
 
 	custody_manager_init(p->local_eid);
 
-	// Initialize known_bundle_list
+	// Initialize known_bundle_list, which is shared by all shards
 
     known_bundle_list = known_bundle_list_create();
     if (known_bundle_list == NULL) {
         LOG("BundleProcessor: Could not initialize known_bundle_list!");
-        return;
+        return UD3TN_FAIL;
     }
 
-	LOGF("BundleProcessor: BPA initialized for \"%s\", status reports %s",
-	     p->local_eid, p->status_reporting ? "enabled" : "disabled");
+	for (i = 0; i < BUNDLE_PROCESSOR_SHARDS; i++) {
+		if (init_shard(&shards[i], p, known_bundle_list) != UD3TN_OK) {
+			LOGF("BundleProcessor: Could not initialize shard %d!",
+			     i);
+			return UD3TN_FAIL;
+		}
+	}
+
+	bundle_storage_set_eviction_handler(evict_bundle, NULL);
+
+	/* Before any shard runs, so it owns its restored bundles from start */
+	if (persistent_storage_is_enabled()) {
+		restored = persistent_storage_restore(bundle_restored, NULL);
+		LOGF("BundleProcessor: Restored %lu bundle(s) from storage",
+		     (unsigned long)restored);
+		for (i = 0; i < BUNDLE_PROCESSOR_SHARDS; i++)
+			qsort(shards[i].restored, shards[i].restored_count,
+			      sizeof(struct restored_bundle),
+			      compare_restored);
+	}
 
-	for (;;) {
-		if (hal_queue_receive(p->signaling_queue, &signal,
-			-1) == UD3TN_OK
-		) {
-			handle_signal(signal);
+	LOGF("BundleProcessor: BPA initialized for \"%s\", status reports %s, %d shard(s)",
+	     p->local_eid, p->status_reporting ? "enabled" : "disabled",
+	     BUNDLE_PROCESSOR_SHARDS);
+
+	for (i = 0; i < BUNDLE_PROCESSOR_SHARDS; i++)
+		hal_task_create(bundle_processor_task,
+				"bundl_proc_t",
+				BUNDLE_PROCESSOR_TASK_PRIORITY,
+				&shards[i],
+				DEFAULT_TASK_STACK_SIZE,
+				(void *)BUNDLE_PROCESSOR_TASK_TAG);
+	return UD3TN_OK;
+}
+
+static bool signal_requires_bundle(enum bundle_processor_signal_type type)
+{
+	return type != BP_SIGNAL_AGENT_REGISTER &&
+		type != BP_SIGNAL_AGENT_DEREGISTER &&
+		type != BP_SIGNAL_ROUTES_CHANGED;
+}
+
+/*
+ * Every bundle is acquired once per batch and kept until the batch has been
+ * processed. A bundle dropped while handling one of its signals is freed
+ * only after that, thus, later signals for it have to check whether it is
+ * still stored.
+ */
+static void handle_signals(struct bp_context *const ctx,
+	const struct bundle_processor_signal *signals, size_t count)
+{
+	struct bundle *bundles[BUNDLE_PROCESSOR_SIGNAL_BATCH_SIZE];
+	bool acquired[BUNDLE_PROCESSOR_SIGNAL_BATCH_SIZE];
+	size_t i, j;
+
+	ASSERT(count <= BUNDLE_PROCESSOR_SIGNAL_BATCH_SIZE);
+	ctx->defer_reports = true;
+	for (i = 0; i < count; i++) {
+		bundles[i] = NULL;
+		acquired[i] = false;
+		j = i;
+		if (signal_requires_bundle(signals[i].type)) {
+			for (j = 0; j < i; j++) {
+				if (acquired[j] &&
+				    signals[j].bundle == signals[i].bundle)
+					break;
+			}
+		}
+		if (j < i) {
+			/* May have been compacted by an earlier signal */
+			bundles[i] = bundle_storage_get(signals[i].bundle);
+		} else if (signal_requires_bundle(signals[i].type)) {
+			bundles[i] = bundle_storage_acquire(signals[i].bundle);
+			acquired[i] = bundles[i] != NULL;
 		}
+		handle_signal(ctx, signals[i], bundles[i]);
 	}
+	ctx->defer_reports = false;
+	send_pending_reports(ctx);
+	/* The bundles are freed here if they have been dropped meanwhile */
+	for (i = 0; i < count; i++) {
+		if (acquired[i])
+			bundle_storage_release(signals[i].bundle);
+	}
+}
 
-    known_bundle_list_destroy(known_bundle_list);
+/* The parameters are shared by all shards the action has been sent to */
+static void complete_agent_action(struct bp_context *const ctx,
+				  struct agent_manager_parameters *aaps,
+				  int feedback)
+{
+	aaps->succeeded[ctx->shard] = feedback == 0;
+	/* The parameters may be gone as soon as the reply is posted */
+	if (aaps->reply) {
+		hal_reply_post(aaps->reply, feedback);
+		return;
+	}
+	if (__atomic_sub_fetch(&aaps->remaining, 1, __ATOMIC_ACQ_REL) == 0)
+		free(aaps);
 }
 
-static inline void handle_signal(const struct bundle_processor_signal signal)
+static inline void handle_signal(struct bp_context *const ctx,
+	const struct bundle_processor_signal signal, struct bundle *b)
 {
-	bool bundle_required = signal.type != BP_SIGNAL_AGENT_REGISTER &&
-		signal.type != BP_SIGNAL_AGENT_DEREGISTER;
-	struct bundle *b = bundle_storage_get(signal.bundle);
 	struct agent_manager_parameters *aaps;
 	int feedback;
 
-	if (bundle_required && b == NULL) {
+	if (signal_requires_bundle(signal.type) && b == NULL) {
 		LOGI("BundleProcessor: Could not process signal", signal.type);
 		LOGI("BundleProcessor: Bundle not found", signal.bundle);
 		return;
@@ -239,44 +658,57 @@ static inline void handle_signal(const struct bundle_processor_signal signal)
 
 	switch (signal.type) {
 	case BP_SIGNAL_BUNDLE_INCOMING:
-		bundle_receive(b);
+		bundle_receive(ctx, b);
 		break;
 	case BP_SIGNAL_BUNDLE_ROUTED:
-		bundle_forwarding_scheduled(b);
+		bundle_forwarding_scheduled(ctx, b);
 		break;
 	case BP_SIGNAL_FORWARDING_CONTRAINDICATED:
-		bundle_forwarding_contraindicated(b, signal.reason);
+		bundle_forwarding_contraindicated(ctx, b, signal.reason);
 		break;
 	case BP_SIGNAL_BUNDLE_EXPIRED:
-		bundle_expired(b);
+		bundle_expired(ctx, b);
+		break;
+	case BP_SIGNAL_BUNDLE_EVICTED:
+		bundle_evicted(ctx, b);
 		break;
 	case BP_SIGNAL_RESCHEDULE_BUNDLE:
-		bundle_dangling(b);
+		bundle_dangling(ctx, b);
 		break;
 	case BP_SIGNAL_TRANSMISSION_SUCCESS:
-		bundle_forwarding_success(b);
+		bundle_forwarding_success(ctx, b);
 		break;
 	case BP_SIGNAL_TRANSMISSION_FAILURE:
-		bundle_forwarding_failed(b,
+		bundle_forwarding_failed(ctx, b,
 			BUNDLE_SR_REASON_TRANSMISSION_CANCELED);
 		break;
 	case BP_SIGNAL_BUNDLE_LOCAL_DISPATCH:
-		bundle_dispatch(b);
+		bundle_dispatch(ctx, b);
+		break;
+	case BP_SIGNAL_CUSTODY_SUCCESS:
+		bundle_custody_success(b);
+		break;
+	case BP_SIGNAL_CUSTODY_FAILURE:
+		bundle_custody_failure(b,
+			(enum bundle_custody_signal_reason)signal.reason);
 		break;
 	case BP_SIGNAL_AGENT_REGISTER:
 		aaps = ((struct agent_manager_parameters *) signal.extra);
-		feedback = agent_register(aaps->agent.sink_identifier,
+		feedback = agent_register(&ctx->agents,
+			aaps->agent.sink_identifier,
 			aaps->agent.callback, aaps->agent.param);
-		if (aaps->feedback_queue)
-			hal_queue_push_to_back(aaps->feedback_queue, &feedback);
-		free(aaps);
+		if (feedback == 0 && ctx->restored_waiting != 0)
+			ctx->agents_changed = true;
+		complete_agent_action(ctx, aaps, feedback);
 		break;
 	case BP_SIGNAL_AGENT_DEREGISTER:
 		aaps = ((struct agent_manager_parameters *) signal.extra);
-		feedback = agent_deregister(aaps->agent.sink_identifier);
-		if (aaps->feedback_queue)
-			hal_queue_push_to_back(aaps->feedback_queue, &feedback);
-		free(aaps);
+		feedback = agent_deregister(&ctx->agents,
+			aaps->agent.sink_identifier);
+		complete_agent_action(ctx, aaps, feedback);
+		break;
+	case BP_SIGNAL_ROUTES_CHANGED:
+		/* Handled after the batch, see bundle_processor_task() */
 		break;
 	default:
 		LOGF("BundleProcessor: Invalid signal (%d) detected",
@@ -289,7 +721,7 @@ static inline void handle_signal(const struct bundle_processor_signal signal)
 /* BUNDLE HANDLING */
 
 /* 5.3 */
-static void bundle_dispatch(struct bundle *bundle)
+static void bundle_dispatch(struct bp_context *const ctx, struct bundle *bundle)
 {
     LOG_EV("bundle_dispatch", "\"local_id\": %d, \"source\": \"%s\", \"destination\": \"%s\", \"creation_timestamp_ms\": %d, \"sequence_number\": %d",
            bundle->id,
@@ -299,39 +731,49 @@ static void bundle_dispatch(struct bundle *bundle)
            (uint32_t)(bundle->sequence_number&0xFFFFFFFF)
     );
 
+	/* Keep the bundle over a restart until it has been processed */
+	bundle_storage_persist(bundle->id);
+
 	/* 5.3-1 */
-	if (bundle_endpoint_is_local(bundle)) {
-		bundle_deliver_local(bundle);
+	if (bundle_endpoint_is_local(ctx, bundle)) {
+		bundle_deliver_local(ctx, bundle);
 		return;
 	}
 	/* 5.3-2 */
-	bundle_forward(bundle, 0);
+	/* Bundles possibly waiting for a contact are kept in one allocation; */
+	/* this is the last point before the ID is passed to other tasks */
+	bundle = bundle_storage_compact(bundle->id);
+	bundle_forward(ctx, bundle, 0);
 }
 
 /* 5.3-1 */
-static bool bundle_endpoint_is_local(struct bundle *bundle)
+static bool bundle_endpoint_is_local(struct bp_context *const ctx,
+	struct bundle *bundle)
 {
-	const size_t local_len = strlen(local_eid);
-	const size_t dest_len = strlen(bundle->destination);
+	const size_t local_len = eid_length(ctx->local_eid);
+	const size_t dest_len = eid_length(bundle->destination);
 
+	if (bundle->destination == ctx->local_eid)
+		return true;
 	/* Compare bundle destination EID _prefix_ with configured uD3TN EID */
 	return (
 		// For the memcmp to be safe, the destination EID has to be at
 		// least as long as the local EID.
 		dest_len >= local_len &&
 		// The prefix (the local EID) has to match the bundle dest-EID.
-		memcmp(local_eid, bundle->destination, local_len) == 0
+		memcmp(ctx->local_eid, bundle->destination, local_len) == 0
 	);
 }
 
 /* 5.4 */
-static enum ud3tn_result bundle_forward(struct bundle *bundle, uint16_t timeout)
+static enum ud3tn_result bundle_forward(struct bp_context *const ctx,
+	struct bundle *bundle, uint16_t timeout)
 {
 	/* 4.3.4. Hop Count (BPv7-bis) */
 	/* TODO: Is this the correct point to perform the hop-count check? */
-	if (!hop_count_validation(bundle)) {
+	if (!hop_count_validation(ctx, bundle)) {
 	    LOGF("BundleProcessor: Bundle #%d: Hop limit exceeded!", bundle->id);
-		bundle_delete(bundle, BUNDLE_SR_REASON_HOP_LIMIT_EXCEEDED);
+		bundle_delete(ctx, bundle, BUNDLE_SR_REASON_HOP_LIMIT_EXCEEDED);
 		return UD3TN_FAIL;
 	}
 
@@ -340,10 +782,13 @@ static enum ud3tn_result bundle_forward(struct bundle *bundle, uint16_t timeout)
 	bundle_rem_rc(bundle, BUNDLE_RET_CONSTRAINT_DISPATCH_PENDING, 0);
 
 	/* 5.4-2 */
-	if (send_bundle(bundle->id, timeout) != UD3TN_OK) {
+	if (send_bundle(ctx, bundle->id, timeout) != UD3TN_OK) {
+		/* Restored bundles are retried with the next notification */
+		if (keep_restored(ctx, bundle))
+			return UD3TN_FAIL;
 		/* Could not store bundle in queue -> delete it. */
         LOGF("BundleProcessor: Bundle #%d: Could not store bundle in queue!", bundle->id);
-		bundle_delete(bundle, BUNDLE_SR_REASON_DEPLETED_STORAGE);
+		bundle_delete(ctx, bundle, BUNDLE_SR_REASON_DEPLETED_STORAGE);
 		return UD3TN_FAIL;
 	}
 	/* For steps after 5.4-2, see below */
@@ -351,8 +796,10 @@ static enum ud3tn_result bundle_forward(struct bundle *bundle, uint16_t timeout)
 }
 
 /* 5.4-4 */
-static void bundle_forwarding_scheduled(struct bundle *bundle)
+static void bundle_forwarding_scheduled(struct bp_context *const ctx,
+	struct bundle *bundle)
 {
+	forget_restored(ctx, bundle->id);
 	/* 5.4-4 */
 	/* Custody may have already been accepted if we are re-scheduling */
 	if (
@@ -363,17 +810,18 @@ static void bundle_forwarding_scheduled(struct bundle *bundle)
 		&& bundle->protocol_version == 6
 	) {
 		/* bundle_receive already checked if bundle is acceptable */
-		bundle_custody_accept(bundle);
+		bundle_custody_accept(ctx, bundle);
 	}
 	/* 5.4-5 is done by contact manager / ground station task */
 }
 
 /* 5.4-6 */
-static void bundle_forwarding_success(struct bundle *bundle)
+static void bundle_forwarding_success(struct bp_context *const ctx,
+	struct bundle *bundle)
 {
 	if (HAS_FLAG(bundle->proc_flags, BUNDLE_FLAG_REPORT_FORWARDING)) {
 		/* See 5.4-6: reason code vs. unidirectional links */
-		send_status_report(bundle,
+		send_status_report(ctx, bundle,
 			BUNDLE_SR_FLAG_BUNDLE_FORWARDED,
 			BUNDLE_SR_REASON_NO_INFO);
 	}
@@ -383,16 +831,21 @@ static void bundle_forwarding_success(struct bundle *bundle)
 
 /* 5.4.1 */
 static void bundle_forwarding_contraindicated(
+	struct bp_context *const ctx,
 	struct bundle *bundle, enum bundle_status_report_reason reason)
 {
+	/* There may be no contacts yet after a restart */
+	if (keep_restored(ctx, bundle))
+		return;
 	/* 5.4.1-1: For now, we declare forwarding failure everytime */
-	bundle_forwarding_failed(bundle, reason);
+	bundle_forwarding_failed(ctx, bundle, reason);
 	/* 5.4.1-2 (a): At the moment, custody transfer is declared as failed */
 	/* 5.4.1-2 (b): Will not be handled */
 }
 
 /* 5.4.2 */
 static void bundle_forwarding_failed(
+	struct bp_context *const ctx,
 	struct bundle *bundle, enum bundle_status_report_reason reason)
 {
 	enum bundle_custody_signal_reason cs_reason;
@@ -413,15 +866,15 @@ static void bundle_forwarding_failed(
 					? BUNDLE_CS_REASON_NO_INFO
 					: (enum bundle_custody_signal_reason)
 						reason);
-			send_custody_signal(bundle, BUNDLE_CS_TYPE_REFUSAL,
+			send_custody_signal(ctx, bundle, BUNDLE_CS_TYPE_REFUSAL,
 				cs_reason);
 		}
 	}
-	bundle_delete(bundle, reason);
+	bundle_delete(ctx, bundle, reason);
 }
 
 /* 5.5 */
-static void bundle_expired(struct bundle *bundle)
+static void bundle_expired(struct bp_context *const ctx, struct bundle *bundle)
 {
     LOG_EV("bundle_expired", "\"local_id\": %d, \"source\": \"%s\", \"destination\": \"%s\", \"creation_timestamp_ms\": %d, \"sequence_number\": %d",
            bundle->id,
@@ -430,11 +883,26 @@ static void bundle_expired(struct bundle *bundle)
            (uint32_t)(bundle->creation_timestamp_ms&0xFFFFFFFF),
            (uint32_t)(bundle->sequence_number&0xFFFFFFFF)
     );
-	bundle_delete(bundle, BUNDLE_SR_REASON_LIFETIME_EXPIRED);
+	bundle_delete(ctx, bundle, BUNDLE_SR_REASON_LIFETIME_EXPIRED);
+}
+
+static void bundle_evicted(struct bp_context *const ctx, struct bundle *bundle)
+{
+	/* The bundle may have been accepted for custody after its selection */
+	if (HAS_FLAG(bundle->ret_constraints,
+		     BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED) ||
+	    HAS_FLAG(bundle->ret_constraints,
+		     BUNDLE_RET_CONSTRAINT_REASSEMBLY_PENDING)) {
+		bundle_storage_cancel_eviction(bundle->id);
+		return;
+	}
+	LOGF("BundleProcessor: Evicting bundle #%d to free storage",
+	     bundle->id);
+	bundle_delete(ctx, bundle, BUNDLE_SR_REASON_DEPLETED_STORAGE);
 }
 
 /* 5.6 */
-static void bundle_receive(struct bundle *bundle)
+static void bundle_receive(struct bp_context *const ctx, struct bundle *bundle)
 {
 	struct bundle_block_list **e;
 	enum bundle_handling_result res;
@@ -443,7 +911,7 @@ static void bundle_receive(struct bundle *bundle)
 	bundle_add_rc(bundle, BUNDLE_RET_CONSTRAINT_DISPATCH_PENDING);
 	/* 5.6-2 Request reception */
 	if (HAS_FLAG(bundle->proc_flags, BUNDLE_FLAG_REPORT_RECEPTION))
-		send_status_report(bundle,
+		send_status_report(ctx, bundle,
 			BUNDLE_SR_FLAG_BUNDLE_RECEIVED,
 			BUNDLE_SR_REASON_NO_INFO);
 	/* Check lifetime - TODO: support Bundle Age block */
@@ -451,14 +919,14 @@ static void bundle_receive(struct bundle *bundle)
 			bundle_get_expiration_time_s(bundle) <
 			hal_time_get_timestamp_s()) {
 	    LOGF("BundleProcessor: Bundle #%d was expired on arrival", bundle->id);
-		bundle_delete(bundle, BUNDLE_SR_REASON_LIFETIME_EXPIRED);
+		bundle_delete(ctx, bundle, BUNDLE_SR_REASON_LIFETIME_EXPIRED);
 		return;
 	}
 	/* 5.6-3 Handle blocks */
 	e = &bundle->blocks;
 	while (*e != NULL) {
 		if ((*e)->data->type != BUNDLE_BLOCK_TYPE_PAYLOAD) {
-			res = handle_unknown_block_flags(
+			res = handle_unknown_block_flags(ctx, 
 				bundle, (*e)->data->flags);
 			switch (res) {
 			case BUNDLE_HRESULT_OK:
@@ -466,11 +934,11 @@ static void bundle_receive(struct bundle *bundle)
 					BUNDLE_V6_BLOCK_FLAG_FWD_UNPROC;
 				break;
 			case BUNDLE_HRESULT_DELETED:
-				bundle_delete(bundle,
+				bundle_delete(ctx, bundle,
 					BUNDLE_SR_REASON_BLOCK_UNINTELLIGIBLE);
 				return;
 			case BUNDLE_HRESULT_BLOCK_DISCARDED:
-				*e = bundle_block_entry_free(*e);
+				*e = bundle_block_entry_remove(bundle, *e);
 				break;
 			}
 
@@ -485,7 +953,7 @@ static void bundle_receive(struct bundle *bundle)
 	) {
 		if (custody_manager_has_redundant_bundle(bundle)) {
 			/* 5.6-4 */
-			send_custody_signal(bundle, BUNDLE_CS_TYPE_REFUSAL,
+			send_custody_signal(ctx, bundle, BUNDLE_CS_TYPE_REFUSAL,
 				BUNDLE_CS_REASON_REDUNDANT_RECEPTION);
 			bundle_rem_rc(bundle,
 				BUNDLE_RET_CONSTRAINT_DISPATCH_PENDING, 1);
@@ -494,23 +962,24 @@ static void bundle_receive(struct bundle *bundle)
 			/* to check if we want to reject custody before */
 			/* dispatching the bundle. */
 			/* In that case, the bundle would be deleted. */
-			send_custody_signal(bundle, BUNDLE_CS_TYPE_REFUSAL,
+			send_custody_signal(ctx, bundle, BUNDLE_CS_TYPE_REFUSAL,
 				BUNDLE_CS_REASON_DEPLETED_STORAGE);
-			bundle_delete(bundle,
+			bundle_delete(ctx, bundle,
 				BUNDLE_SR_REASON_DEPLETED_STORAGE);
 		}
 	} else {
 		/* 5.6-5 */
-		bundle_dispatch(bundle);
+		bundle_dispatch(ctx, bundle);
 	}
 }
 
 /* 5.6-3 */
 static enum bundle_handling_result handle_unknown_block_flags(
+	struct bp_context *const ctx,
 	struct bundle *bundle, enum bundle_block_flags flags)
 {
 	if (HAS_FLAG(flags, BUNDLE_BLOCK_FLAG_REPORT_IF_UNPROC)) {
-		send_status_report(bundle,
+		send_status_report(ctx, bundle,
 			BUNDLE_SR_FLAG_BUNDLE_RECEIVED,
 			BUNDLE_SR_REASON_BLOCK_UNINTELLIGIBLE);
 	}
@@ -522,12 +991,19 @@ static enum bundle_handling_result handle_unknown_block_flags(
 }
 
 /* 5.7 */
-static void bundle_deliver_local(struct bundle *bundle)
+static void bundle_deliver_local(struct bp_context *const ctx,
+	struct bundle *bundle)
 {
+	/* The agent may not have been registered again after a restart */
+	if (!HAS_FLAG(bundle->proc_flags, BUNDLE_FLAG_ADMINISTRATIVE_RECORD) &&
+	    get_agent_id(ctx, bundle->destination) == NULL &&
+	    keep_restored(ctx, bundle))
+		return;
+	forget_restored(ctx, bundle->id);
 	bundle_rem_rc(bundle, BUNDLE_RET_CONSTRAINT_DISPATCH_PENDING, 0);
 
 	/* Check and record knowledge of bundle */
-	if (bundle_record_add_and_check_known(bundle)) {
+	if (bundle_record_add_and_check_known(ctx, bundle)) {
 		LOGF("BundleProcessor: Bundle #%d was already delivered, dropping it",
 		     bundle->id);
 		// NOTE: We cannot have custody as the CM checks for duplicates
@@ -537,152 +1013,62 @@ static void bundle_deliver_local(struct bundle *bundle)
 
 	/* Report successful delivery, if applicable */
 	if (HAS_FLAG(bundle->proc_flags, BUNDLE_FLAG_REPORT_DELIVERY)) {
-		send_status_report(bundle,
+		send_status_report(ctx, bundle,
 			BUNDLE_SR_FLAG_BUNDLE_DELIVERED,
 			BUNDLE_SR_REASON_NO_INFO);
 	}
 
 	if (!HAS_FLAG(bundle->proc_flags, BUNDLE_FLAG_ADMINISTRATIVE_RECORD) &&
-			get_agent_id(bundle->destination) == NULL) {
+			get_agent_id(ctx, bundle->destination) == NULL) {
 		// If it is no admin. record and we have no agent to deliver#
 		// it to, drop it.
 		LOGF("BundleProcessor: Received bundle not destined for any registered EID (from = %s, to = %s), dropping...",
 		     bundle->source, bundle->destination);
-		bundle_delete(bundle, BUNDLE_SR_REASON_DEST_EID_UNINTELLIGIBLE);
+		bundle_delete(ctx, bundle,
+			      BUNDLE_SR_REASON_DEST_EID_UNINTELLIGIBLE);
 		return;
 	}
 
 	if (HAS_FLAG(bundle->proc_flags, BUNDLE_FLAG_IS_FRAGMENT)) {
 		bundle_add_rc(bundle, BUNDLE_RET_CONSTRAINT_REASSEMBLY_PENDING);
-		bundle_attempt_reassembly(bundle);
+		bundle_attempt_reassembly(ctx, bundle);
 	} else {
 		struct bundle_adu adu = bundle_to_adu(bundle);
 
 		bundle_discard(bundle);
-		bundle_deliver_adu(adu);
+		bundle_deliver_adu(ctx, adu);
 	}
 }
 
-static bool may_reassemble(const struct bundle *b1, const struct bundle *b2)
-{
-	return (
-		b1->creation_timestamp_ms == b2->creation_timestamp_ms &&
-		b1->sequence_number == b2->sequence_number &&
-		strcmp(b1->source, b2->source) == 0 // XXX: '==' may be ok
-	);
-}
+struct reassembly_release {
+	struct bp_context *ctx;
+	bool added_as_known;
+};
 
-static void add_to_reassembly_bundle_list(struct reassembly_list *item,
-					  struct bundle *bundle)
+static void release_reassembled_fragment(struct bundle *fragment,
+					 void *param)
 {
-	struct reassembly_bundle_list **cur_entry = &item->bundle_list;
-
-	while (*cur_entry != NULL) {
-		struct reassembly_bundle_list *e = *cur_entry;
+	struct reassembly_release *const release = param;
 
-		// Order by frag. offset
-		if (e->bundle->fragment_offset > bundle->fragment_offset)
-			break;
-		cur_entry = &(*cur_entry)->next;
+	if (!release->added_as_known) {
+		bundle_add_reassembled_as_known(release->ctx, fragment);
+		release->added_as_known = true;
 	}
-
-	struct reassembly_bundle_list *new_entry = malloc(
-		sizeof(struct reassembly_bundle_list)
-	);
-	if (!new_entry) {
-		bundle_delete(bundle, BUNDLE_SR_REASON_DEPLETED_STORAGE);
-		return;
-	}
-	new_entry->bundle = bundle;
-	new_entry->next = *cur_entry;
-	*cur_entry = new_entry;
+	bundle_rem_rc(fragment, BUNDLE_RET_CONSTRAINT_REASSEMBLY_PENDING, 0);
+	bundle_discard(fragment);
 }
 
-static void try_reassemble(struct reassembly_list **slot)
+static void bundle_attempt_reassembly(struct bp_context *const ctx,
+	struct bundle *bundle)
 {
-	struct reassembly_list *const e = *slot;
-	struct reassembly_bundle_list *eb;
-	struct bundle *b;
-
-	size_t pos_in_bundle = 0;
-
-	LOG("Attempting bundle reassembly!");
-
-	// Check if we can reassemble
-	for (eb = e->bundle_list; eb; eb = eb->next) {
-		b = eb->bundle;
-		if (b->fragment_offset > pos_in_bundle)
-			return; // cannot reassemble, has gaps
-		pos_in_bundle = b->fragment_offset + b->payload_block->length;
-		if (pos_in_bundle >= b->total_adu_length)
-			break; // can reassemble
-	}
-	if (!eb)
-		return;
-	LOG("Reassembling bundle!");
-
-	// Reassemble by memcpy
-	b = e->bundle_list->bundle;
-	const size_t adu_length = b->total_adu_length;
-	uint8_t *const payload = malloc(adu_length);
-	bool added_as_known = false;
-
-	if (!payload)
-		return; // currently not enough memory to reassemble
-
-	struct bundle_adu adu = bundle_adu_init(b);
-
-	adu.payload = payload;
-	adu.length = adu_length;
-
-	pos_in_bundle = 0;
-	for (eb = e->bundle_list; eb; eb = eb->next) {
-		b = eb->bundle;
-
-		if (!added_as_known) {
-			bundle_add_reassembled_as_known(b);
-			added_as_known = true;
-		}
-
-		const size_t offset_in_bundle = (
-			pos_in_bundle - b->fragment_offset
-		);
-		const size_t bytes_copied = Z_MIN(
-			b->payload_block->length - offset_in_bundle,
-			adu_length - pos_in_bundle
-		);
-
-		if (offset_in_bundle < b->payload_block->length) {
-			memcpy(
-				&payload[pos_in_bundle],
-				&b->payload_block->data[offset_in_bundle],
-				bytes_copied
-			);
-			pos_in_bundle += bytes_copied;
-		}
-
-		bundle_rem_rc(b, BUNDLE_RET_CONSTRAINT_REASSEMBLY_PENDING, 0);
-		bundle_discard(b);
-	}
-
-	// Delete slot
-	*slot = (*slot)->next;
-	while (e->bundle_list) {
-		eb = e->bundle_list;
-		e->bundle_list = e->bundle_list->next;
-		free(eb);
-	}
-	free(e);
-
-	// Deliver ADU
-	bundle_deliver_adu(adu);
-}
-
-static void bundle_attempt_reassembly(struct bundle *bundle)
-{
-	struct reassembly_list **r_list_e = &reassembly_list;
+	struct reassembly_entry *entry;
+	struct bundle_adu adu;
+	struct reassembly_release release = {
+		.ctx = ctx,
+		.added_as_known = false,
+	};
 
-	if (bundle_reassembled_is_known(bundle)) {
+	if (bundle_reassembled_is_known(ctx, bundle)) {
 		LOGF("Original bundle for #%d was already delivered, dropping",
 		     bundle->id);
 		// Already delivered the original bundle
@@ -692,67 +1078,68 @@ static void bundle_attempt_reassembly(struct bundle *bundle)
 			0
 		);
 		bundle_discard(bundle);
+		return;
 	}
 
-	// Find bundle
-	for (; *r_list_e; r_list_e = &(*r_list_e)->next) {
-		struct reassembly_list *const e = *r_list_e;
-
-		if (may_reassemble(e->bundle_list->bundle, bundle)) {
-			add_to_reassembly_bundle_list(e, bundle);
-			try_reassemble(r_list_e);
-			return;
-		}
+	entry = bundle_reassembly_add(&ctx->reassembly_table, bundle);
+	if (!entry) {
+		bundle_delete(ctx, bundle, BUNDLE_SR_REASON_DEPLETED_STORAGE);
+		return;
 	}
+	if (!bundle_reassembly_is_complete(entry))
+		return;
+	LOG("Reassembling bundle!");
 
-	// Not found, append
-	struct reassembly_list *new_list = malloc(
-		sizeof(struct reassembly_list)
-	);
+	// The ADU takes over the payloads of the fragments
+	if (bundle_reassembly_take_adu(&ctx->reassembly_table, entry, &adu,
+				       release_reassembled_fragment,
+				       &release) != UD3TN_OK)
+		return; // currently not enough memory to reassemble
 
-	if (!new_list) {
-		bundle_delete(bundle, BUNDLE_SR_REASON_DEPLETED_STORAGE);
-		return;
-	}
-	new_list->bundle_list = NULL;
-	new_list->next = NULL;
-	add_to_reassembly_bundle_list(new_list, bundle);
-	*r_list_e = new_list;
-	try_reassemble(r_list_e);
+	// Deliver ADU
+	bundle_deliver_adu(ctx, adu);
 }
 
-static void bundle_deliver_adu(struct bundle_adu adu)
+static void bundle_deliver_adu(struct bp_context *const ctx,
+	struct bundle_adu adu)
 {
 	struct bundle_administrative_record *record;
 
 	if (HAS_FLAG(adu.proc_flags, BUNDLE_FLAG_ADMINISTRATIVE_RECORD)) {
+		if (bundle_adu_flatten(&adu) != UD3TN_OK) {
+			bundle_adu_free_members(adu);
+			return;
+		}
 		record = parse_administrative_record(
 			adu.protocol_version,
 			adu.payload,
 			adu.length
 		);
 		if (record != NULL && record->type == BUNDLE_AR_CUSTODY_SIGNAL)
-			bundle_handle_custody_signal(record);
+			bundle_handle_custody_signal(ctx, record);
 		free_administrative_record(record);
 		bundle_adu_free_members(adu);
 		return;
 	}
 
-	const char *agent_id = get_agent_id(adu.destination);
+	const char *agent_id = get_agent_id(ctx, adu.destination);
 
 	ASSERT(agent_id != NULL);
 	LOGF("BundleProcessor: Received local bundle -> \"%s\"; len(PL) = %d B",
 	     agent_id, adu.length);
-	agent_forward(agent_id, adu);
+	agent_forward(&ctx->agents, agent_id, adu);
 }
 
 /* 5.10 */
-static void bundle_custody_accept(struct bundle *bundle)
+static void bundle_custody_accept(struct bp_context *const ctx,
+	struct bundle *bundle)
 {
 	if (custody_manager_accept(bundle) != UD3TN_OK) {
 		/* TODO */
 		return;
 	}
+	/* Record the acceptance of custody in the persistent copy */
+	bundle_storage_persist(bundle->id);
 
 	if (HAS_FLAG(bundle->proc_flags,
 		BUNDLE_V6_FLAG_REPORT_CUSTODY_ACCEPTANCE)
@@ -763,10 +1150,10 @@ static void bundle_custody_accept(struct bundle *bundle)
 		/* then this report should be generated by simply turning on */
 		/* the "Reporting node accepted custody of bundle" flag */
 		/* in that earlier report's status flags byte. */
-		send_status_report(bundle, BUNDLE_SR_FLAG_CUSTODY_TRANSFER,
+		send_status_report(ctx, bundle, BUNDLE_SR_FLAG_CUSTODY_TRANSFER,
 			BUNDLE_SR_REASON_NO_INFO);
 	}
-	send_custody_signal(bundle, BUNDLE_CS_TYPE_ACCEPTANCE,
+	send_custody_signal(ctx, bundle, BUNDLE_CS_TYPE_ACCEPTANCE,
 		BUNDLE_CS_REASON_NO_INFO);
 }
 
@@ -796,10 +1183,12 @@ static void bundle_custody_failure(
 /* 5.13 (RFC 5050) */
 /* 5.14 (BPv7-bis) */
 static void bundle_delete(
+	struct bp_context *const ctx,
 	struct bundle *bundle, enum bundle_status_report_reason reason)
 {
 	bool generate_report = false;
 
+	forget_restored(ctx, bundle->id);
 	if (HAS_FLAG(bundle->ret_constraints,
 		BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED)
 	) {
@@ -811,7 +1200,7 @@ static void bundle_delete(
 	}
 
 	if (generate_report)
-		send_status_report(bundle,
+		send_status_report(ctx, bundle,
 			BUNDLE_SR_FLAG_BUNDLE_DELETED, reason);
 
 	bundle->ret_constraints &= BUNDLE_RET_CONSTRAINT_NONE;
@@ -829,26 +1218,59 @@ static void bundle_discard(struct bundle *bundle)
            (uint32_t)(bundle->creation_timestamp_ms&0xFFFFFFFF),
            (uint32_t)(bundle->sequence_number&0xFFFFFFFF)
     );
-	bundle_storage_delete(bundle->id);
-	bundle_drop(bundle);
+	ASSERT(bundle->ret_constraints == BUNDLE_RET_CONSTRAINT_NONE);
+	/* Bundles acquired by other tasks are freed when released */
+	if (!bundle_storage_drop(bundle->id))
+		bundle_drop(bundle);
 }
 
 /* 6.3 */
 static void bundle_handle_custody_signal(
+	struct bp_context *const ctx,
 	struct bundle_administrative_record *signal)
 {
-	struct bundle *bundle = custody_manager_get_by_record(signal);
+	const bundleid_t id = custody_manager_get_by_record(signal);
+	struct bundle_processor_signal redirected = {
+		.type = BP_SIGNAL_CUSTODY_SUCCESS,
+		.reason = BUNDLE_SR_REASON_NO_INFO,
+		.bundle = id,
+		.extra = NULL
+	};
+	struct bundle *bundle;
+	struct bp_context *owner;
 
+	if (id == BUNDLE_INVALID_ID)
+		return;
+	bundle = bundle_storage_acquire(id);
 	if (bundle == NULL)
 		return;
-	if (signal->custody_signal->type == BUNDLE_CS_TYPE_ACCEPTANCE)
-		bundle_custody_success(bundle);
-	else
-		bundle_custody_failure(bundle, signal->custody_signal->reason);
+	owner = get_shard_of(bundle);
+	if (owner == ctx) {
+		if (signal->custody_signal->type == BUNDLE_CS_TYPE_ACCEPTANCE)
+			bundle_custody_success(bundle);
+		else
+			bundle_custody_failure(bundle,
+				signal->custody_signal->reason);
+	} else {
+		/* The bundle is processed by another shard */
+		if (signal->custody_signal->type != BUNDLE_CS_TYPE_ACCEPTANCE) {
+			redirected.type = BP_SIGNAL_CUSTODY_FAILURE;
+			redirected.reason = (enum bundle_status_report_reason)
+				signal->custody_signal->reason;
+		}
+		/* Do not wait for a shard which may wait for this one */
+		if (hal_queue_try_push_to_back(owner->signaling_queue,
+					       &redirected,
+					       CUSTODY_SIGNAL_TIMEOUT)
+		    != UD3TN_OK)
+			LOGF("BundleProcessor: Failed passing custody signal for bundle #%d to its shard.",
+			     id);
+	}
+	bundle_storage_release(id);
 }
 
 /* RE-SCHEDULING */
-static void bundle_dangling(struct bundle *bundle)
+static void bundle_dangling(struct bp_context *const ctx, struct bundle *bundle)
 {
 	uint8_t resched = 0;
 
@@ -864,47 +1286,216 @@ static void bundle_dangling(struct bundle *bundle)
 		break;
 	}
 	if (!resched) {
-		bundle_delete(bundle, BUNDLE_SR_REASON_TRANSMISSION_CANCELED);
+		bundle_delete(ctx, bundle,
+			      BUNDLE_SR_REASON_TRANSMISSION_CANCELED);
 	/* Send it to the router task again after evaluating policy. */
-	} else if (send_bundle(bundle->id, FAILED_FORWARD_TIMEOUT) != UD3TN_OK) {
+	} else if (send_bundle(ctx, bundle->id,
+			       FAILED_FORWARD_TIMEOUT) != UD3TN_OK) {
 		LOGF("BundleProcessor: Failed forwarding bundle #%d to router task, dropping.",
 		     bundle->id);
-		bundle_delete(bundle, BUNDLE_SR_REASON_DEPLETED_STORAGE);
+		bundle_delete(ctx, bundle, BUNDLE_SR_REASON_DEPLETED_STORAGE);
 	}
 }
 
+/*
+ * Adds a bundle loaded from the persistent storage. Called before the shards
+ * start, the bundle is handed to its shard by appending it to the list of
+ * restored bundles the shard dispatches first.
+ */
+static void bundle_restored(struct bundle *bundle, persistentid_t pid,
+	void *param)
+{
+	struct bp_context *const owner = get_shard_of(bundle);
+	struct restored_bundle *list;
+
+	(void)param;
+	if (owner->restored_count == owner->restored_capacity) {
+		list = realloc(owner->restored,
+			       MAX(2 * owner->restored_capacity, 16) *
+				sizeof(struct restored_bundle));
+		if (list == NULL) {
+			LOG("BundleProcessor: Not enough memory for restoring bundles");
+			bundle_free(bundle);
+			return;
+		}
+		owner->restored = list;
+		owner->restored_capacity = MAX(2 * owner->restored_capacity,
+					       16);
+	}
+	if (bundle_storage_add_persisted(bundle, pid) == BUNDLE_INVALID_ID) {
+		bundle_free(bundle);
+		return;
+	}
+	if (HAS_FLAG(bundle->ret_constraints,
+		BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED)
+	)
+		custody_manager_restore(bundle);
+	/* Continue as if the bundle was just received or created (5.3) */
+	bundle_add_rc(bundle, BUNDLE_RET_CONSTRAINT_DISPATCH_PENDING);
+	owner->restored[owner->restored_count].id = bundle->id;
+	owner->restored[owner->restored_count].waiting = true;
+	owner->restored_count++;
+	owner->restored_waiting++;
+}
+
+static int compare_restored(const void *a, const void *b)
+{
+	const bundleid_t id_a = ((const struct restored_bundle *)a)->id;
+	const bundleid_t id_b = ((const struct restored_bundle *)b)->id;
+
+	return (id_a > id_b) - (id_a < id_b);
+}
+
+static void free_restored(struct bp_context *const ctx)
+{
+	free(ctx->restored);
+	ctx->restored = NULL;
+	ctx->restored_count = 0;
+	ctx->restored_capacity = 0;
+	ctx->restored_waiting = 0;
+}
+
+static struct restored_bundle *find_restored(struct bp_context *const ctx,
+	bundleid_t id)
+{
+	const struct restored_bundle key = { .id = id };
+	struct restored_bundle *entry;
+
+	if (ctx->restored_waiting == 0)
+		return NULL;
+	entry = bsearch(&key, ctx->restored, ctx->restored_count,
+			sizeof(struct restored_bundle), compare_restored);
+	if (entry == NULL || !entry->waiting)
+		return NULL;
+	return entry;
+}
+
+/*
+ * Returns true if the bundle is a restored one which has neither been routed
+ * nor delivered yet. It is then kept for the next dispatch_restored().
+ */
+static bool keep_restored(struct bp_context *const ctx, struct bundle *bundle)
+{
+	if (find_restored(ctx, bundle->id) == NULL)
+		return false;
+	bundle_rem_rc(bundle, BUNDLE_RET_CONSTRAINT_FORWARD_PENDING, 0);
+	bundle_add_rc(bundle, BUNDLE_RET_CONSTRAINT_DISPATCH_PENDING);
+	return true;
+}
+
+/* The bundle has been routed, delivered or deleted */
+static void forget_restored(struct bp_context *const ctx, bundleid_t id)
+{
+	struct restored_bundle *entry = find_restored(ctx, id);
+
+	if (entry == NULL)
+		return;
+	entry->waiting = false;
+	ctx->restored_waiting--;
+	if (ctx->restored_waiting == 0 && !ctx->redispatching)
+		free_restored(ctx);
+}
+
+/*
+ * (Re-)dispatches all restored bundles which are still waiting. Entries are
+ * only marked while iterating and removed afterwards.
+ */
+static void dispatch_restored(struct bp_context *const ctx)
+{
+	struct bundle *bundle;
+	size_t i, kept = 0;
+
+	if (ctx->restored_waiting == 0) {
+		free_restored(ctx);
+		return;
+	}
+	ctx->redispatching = true;
+	for (i = 0; i < ctx->restored_count; i++) {
+		if (!ctx->restored[i].waiting)
+			continue;
+		bundle = bundle_storage_acquire(ctx->restored[i].id);
+		if (bundle == NULL) {
+			ctx->restored[i].waiting = false;
+			ctx->restored_waiting--;
+			continue;
+		}
+		bundle_dispatch(ctx, bundle);
+		bundle_storage_release(ctx->restored[i].id);
+	}
+	ctx->redispatching = false;
+	for (i = 0; i < ctx->restored_count; i++) {
+		if (ctx->restored[i].waiting)
+			ctx->restored[kept++] = ctx->restored[i];
+	}
+	ctx->restored_count = kept;
+	if (kept == 0)
+		free_restored(ctx);
+}
+
 /* HELPERS */
 
 static void send_status_report(
+	struct bp_context *const ctx,
 	struct bundle *bundle,
 	const enum bundle_status_report_status_flags status,
 	const enum bundle_status_report_reason reason)
 {
-	if (!status_reporting)
+	if (!ctx->status_reporting)
 		return;
 
 	/* If the report-to EID is the null endpoint or uD3TN itself we do */
 	/* not need to create a status report */
-	if (strcmp(bundle->destination, "dtn:none") == 0
-		|| strcmp(bundle->destination, local_eid) == 0)
+	if (bundle->destination == ctx->none_eid
+		|| bundle->destination == ctx->local_eid)
 		return;
 
 	struct bundle_status_report report = {
 		.status = status,
 		.reason = reason
 	};
-	struct bundle *b = generate_status_report(bundle, &report, local_eid);
+	struct bundle *b = generate_status_report(bundle, &report,
+						  ctx->local_eid);
+
+	if (b == NULL)
+		return;
+	if (ctx->pending_report_count == BUNDLE_PROCESSOR_SIGNAL_BATCH_SIZE)
+		send_pending_reports(ctx);
+	ctx->pending_reports[ctx->pending_report_count].report = b;
+	ctx->pending_reports[ctx->pending_report_count].subject = bundle->id;
+	ctx->pending_report_count++;
+	if (!ctx->defer_reports)
+		send_pending_reports(ctx);
+}
 
-	if (b != NULL) {
-		bundle_add_rc(b, BUNDLE_RET_CONSTRAINT_DISPATCH_PENDING);
-		bundle_storage_add(b);
-		if (bundle_forward(b, STATUS_REPORT_TIMEOUT) != UD3TN_OK)
+/*
+ * Reports are sent in the order they have been generated. They are taken one
+ * by one, as forwarding may add further ones and send them in a nested call.
+ */
+static void send_pending_reports(struct bp_context *const ctx)
+{
+	struct pending_report pending;
+
+	while (ctx->pending_report_head != ctx->pending_report_count) {
+		pending = ctx->pending_reports[ctx->pending_report_head++];
+		bundle_add_rc(pending.report,
+			      BUNDLE_RET_CONSTRAINT_DISPATCH_PENDING);
+		if (bundle_storage_add(pending.report) == BUNDLE_INVALID_ID) {
+			LOGF("BundleProcessor: No storage for status report for bundle #%d.",
+			     pending.subject);
+			bundle_free(pending.report);
+			continue;
+		}
+		if (bundle_forward(ctx, pending.report,
+				   STATUS_REPORT_TIMEOUT) != UD3TN_OK)
 			LOGF("BundleProcessor: Failed sending status report for bundle #%d.",
-			     bundle->id);
+			     pending.subject);
 	}
+	ctx->pending_report_head = 0;
+	ctx->pending_report_count = 0;
 }
 
-static void send_custody_signal(struct bundle *bundle,
+static void send_custody_signal(struct bp_context *const ctx,
+	struct bundle *bundle,
 	const enum bundle_custody_signal_type type,
 	const enum bundle_custody_signal_reason reason)
 {
@@ -916,18 +1507,23 @@ static void send_custody_signal(struct bundle *bundle,
 	struct bundle_list *signals = generate_custody_signal(
 		bundle,
 		&signal,
-		local_eid
+		ctx->local_eid
 	);
 
 	/* Walk through all signals and forward them to their destination */
 	while (signals != NULL) {
 		bundle_add_rc(signals->data,
 			BUNDLE_RET_CONSTRAINT_DISPATCH_PENDING);
-		bundle_storage_add(signals->data);
-		if (bundle_forward(signals->data, CUSTODY_SIGNAL_TIMEOUT)
-		    != UD3TN_OK)
+		if (bundle_storage_add(signals->data) == BUNDLE_INVALID_ID) {
+			LOGF("BundleProcessor: No storage for custody signal for bundle #%d.",
+			     bundle->id);
+			bundle_free(signals->data);
+		} else if (bundle_forward(ctx, signals->data,
+					  CUSTODY_SIGNAL_TIMEOUT)
+			   != UD3TN_OK) {
 			LOGF("BundleProcessor: Failed sending custody signal for bundle #%d.",
 			     bundle->id);
+		}
 
 		/* Free current list entry (but not the bundle itself) */
 		next = signals->next;
@@ -936,7 +1532,8 @@ static void send_custody_signal(struct bundle *bundle,
 	}
 }
 
-static enum ud3tn_result send_bundle(bundleid_t bundle, uint16_t timeout)
+static enum ud3tn_result send_bundle(struct bp_context *const ctx,
+	bundleid_t bundle, uint16_t timeout)
 {
 	struct router_signal signal = {
 		.type = ROUTER_SIGNAL_ROUTE_BUNDLE,
@@ -945,10 +1542,10 @@ static enum ud3tn_result send_bundle(bundleid_t bundle, uint16_t timeout)
 	};
 
 	if (timeout == 0) {
-		hal_queue_push_to_back(out_queue, &signal);
+		hal_queue_push_to_back(ctx->out_queue, &signal);
 		return UD3TN_OK;
 	}
-	return hal_queue_try_push_to_back(out_queue,
+	return hal_queue_try_push_to_back(ctx->out_queue,
 					  &signal,
 					  timeout);
 }
@@ -978,7 +1575,8 @@ static struct bundle_block *find_block_by_type(struct bundle_block_list *blocks,
  *
  * @return false if the hop count exeeds the hop limit, true otherwise
  */
-static bool hop_count_validation(struct bundle *bundle)
+static bool hop_count_validation(struct bp_context *const ctx,
+	struct bundle *bundle)
 {
 	struct bundle_block *block = find_block_by_type(bundle->blocks,
 		BUNDLE_BLOCK_TYPE_HOP_COUNT);
@@ -1000,15 +1598,28 @@ static bool hop_count_validation(struct bundle *bundle)
 
 	/* Hop count exeeded, delete bundle */
 	if (hop_count.count >= hop_count.limit) {
-		bundle_delete(bundle, BUNDLE_SR_REASON_HOP_LIMIT_EXCEEDED);
+		bundle_delete(ctx, bundle, BUNDLE_SR_REASON_HOP_LIMIT_EXCEEDED);
 		return false;
 	}
 
 	/* Increment Hop Count */
 	hop_count.count++;
+	/* The persistent copy keeps the former count */
+	bundle_storage_note_modification(bundle->id);
 
 	/* CBOR-encoding */
-	uint8_t *buffer = malloc(BUNDLE7_HOP_COUNT_MAX_ENCODED_SIZE);
+	uint8_t encoded[BUNDLE7_HOP_COUNT_MAX_ENCODED_SIZE];
+	const size_t length = bundle7_hop_count_serialize(&hop_count,
+		encoded, BUNDLE7_HOP_COUNT_MAX_ENCODED_SIZE);
+
+	/* Compact bundles have room for the largest encoding */
+	if (bundle->layout == BUNDLE_LAYOUT_COMPACT || length <= block->length) {
+		memcpy(block->data, encoded, length);
+		block->length = length;
+		return true;
+	}
+
+	uint8_t *buffer = malloc(length);
 
 	/* Out of memory - validation passes none the less */
 	if (buffer == NULL) {
@@ -1019,9 +1630,9 @@ static bool hop_count_validation(struct bundle *bundle)
 
 	free(block->data);
 
+	memcpy(buffer, encoded, length);
 	block->data = buffer;
-	block->length = bundle7_hop_count_serialize(&hop_count,
-		buffer, BUNDLE7_HOP_COUNT_MAX_ENCODED_SIZE);
+	block->length = length;
 
 	return true;
 }
@@ -1030,13 +1641,14 @@ static bool hop_count_validation(struct bundle *bundle)
  * Get the agent identifier for local bundle delivery.
  * The agent identifier should follow the local EID behind a slash ('/').
  */
-static const char *get_agent_id(const char *dest_eid)
+static const char *get_agent_id(struct bp_context *const ctx,
+	const char *dest_eid)
 {
-	const size_t local_len = strlen(local_eid);
-	const size_t dest_len = strlen(dest_eid);
+	const size_t local_len = eid_length(ctx->local_eid);
+	const size_t dest_len = eid_length(dest_eid);
 
 	// Local EID ends with '/' -> agent starts at dest_eid[local_len]
-	if (local_eid[local_len - 1] == '/') {
+	if (ctx->local_eid[local_len - 1] == '/') {
 		if (dest_len <= local_len || dest_eid[local_len - 1] != '/')
 			return NULL;
 		return &dest_eid[local_len];
@@ -1049,12 +1661,13 @@ static const char *get_agent_id(const char *dest_eid)
 }
 
 // Checks whether we know the bundle. If not, adds it to the list.
-static bool bundle_record_add_and_check_known(const struct bundle *bundle)
+static bool bundle_record_add_and_check_known(struct bp_context *const ctx,
+	const struct bundle *bundle)
 {
     uint64_t cur_time = hal_time_get_timestamp_s();
 
-    // we first remove all expired bundles (easy as they are at the front of the list)
-    known_bundle_list_remove_before(known_bundle_list, cur_time);
+    // we first remove all expired bundles (cheap, only the due slots of the shared timing wheel are touched)
+    known_bundle_list_remove_before(ctx->known_bundle_list, cur_time);
 
     const uint64_t bundle_deadline = bundle_get_expiration_time_s(bundle);
 
@@ -1062,26 +1675,29 @@ static bool bundle_record_add_and_check_known(const struct bundle *bundle)
     if (bundle_deadline < cur_time)
         return true;
 
-    return known_bundle_list_add(known_bundle_list, bundle);
+    return known_bundle_list_add(ctx->known_bundle_list, bundle);
 }
 
-static bool bundle_reassembled_is_known(const struct bundle *bundle)
+static bool bundle_reassembled_is_known(struct bp_context *const ctx,
+	const struct bundle *bundle)
 {
     // TODO: This is not yet tested...
-    return known_bundle_list_contains_reassembled_parent(known_bundle_list, bundle);
+    return known_bundle_list_contains_reassembled_parent(
+        ctx->known_bundle_list, bundle);
 }
 
-static void bundle_add_reassembled_as_known(const struct bundle *bundle)
+static void bundle_add_reassembled_as_known(struct bp_context *const ctx,
+	const struct bundle *bundle)
 {
     // TODO: This is not yet tested...
-    known_bundle_list_add_reassembled_parent(known_bundle_list, bundle);
+    known_bundle_list_add_reassembled_parent(ctx->known_bundle_list, bundle);
 }
 
 enum ud3tn_result bundle_processor_get_known_bundle_list(struct known_bundle_list **dest) {
-    if(known_bundle_list) {
+    if(shards[0].known_bundle_list) {
         // TODO: Do we want to copy this list?
         // For now, the list's semaphore prevent race conditions...
-        *dest = known_bundle_list;
+        *dest = shards[0].known_bundle_list;
         return UD3TN_OK;
     } else {
         return UD3TN_FAIL;
@@ -0,0 +1,364 @@
+#include "ud3tn/bundle.h"
+#include "ud3tn/bundle_reassembly.h"
+#include "ud3tn/common.h"
+#include "ud3tn/config.h"
+
+#include "util/htab_hash.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_FRAGMENT_CAPACITY 8
+#define INITIAL_INTERVAL_CAPACITY 4
+
+/* Sources are interned, so their address identifies them */
+static uint32_t get_digest(const struct bundle *bundle)
+{
+	const uint64_t key[3] = {
+		(uintptr_t)bundle->source,
+		bundle->creation_timestamp_ms,
+		bundle->sequence_number,
+	};
+
+	return hashlittle(key, sizeof(key), 0);
+}
+
+static bool may_reassemble(const struct bundle *b1, const struct bundle *b2)
+{
+	return (
+		b1->creation_timestamp_ms == b2->creation_timestamp_ms &&
+		b1->sequence_number == b2->sequence_number &&
+		b1->source == b2->source
+	);
+}
+
+enum ud3tn_result bundle_reassembly_init(struct reassembly_table *table)
+{
+	table->buckets = calloc(BUNDLE_REASSEMBLY_INITIAL_BUCKETS,
+				sizeof(struct reassembly_entry *));
+	if (table->buckets == NULL)
+		return UD3TN_FAIL;
+	table->bucket_count = BUNDLE_REASSEMBLY_INITIAL_BUCKETS;
+	table->count = 0;
+	return UD3TN_OK;
+}
+
+static void free_entry(struct reassembly_entry *entry)
+{
+	free(entry->fragments);
+	free(entry->intervals);
+	free(entry);
+}
+
+void bundle_reassembly_destroy(
+	struct reassembly_table *table,
+	void (*release_fragment)(struct bundle *fragment, void *param),
+	void *param)
+{
+	struct reassembly_entry *entry, *next;
+	uint32_t i, f;
+
+	for (i = 0; i < table->bucket_count; i++) {
+		for (entry = table->buckets[i]; entry != NULL; entry = next) {
+			next = entry->next;
+			for (f = 0; f < entry->fragment_count; f++)
+				release_fragment(entry->fragments[f], param);
+			free_entry(entry);
+		}
+	}
+	free(table->buckets);
+	table->buckets = NULL;
+	table->bucket_count = 0;
+	table->count = 0;
+}
+
+static void grow_table(struct reassembly_table *table)
+{
+	const uint32_t new_count = table->bucket_count * 2;
+	struct reassembly_entry **buckets = calloc(
+		new_count, sizeof(struct reassembly_entry *));
+	struct reassembly_entry *entry, *next;
+	uint32_t i;
+
+	/* Without a larger table, the chains just become longer */
+	if (buckets == NULL)
+		return;
+	for (i = 0; i < table->bucket_count; i++) {
+		for (entry = table->buckets[i]; entry != NULL; entry = next) {
+			next = entry->next;
+			entry->next = buckets[entry->digest & (new_count - 1)];
+			buckets[entry->digest & (new_count - 1)] = entry;
+		}
+	}
+	free(table->buckets);
+	table->buckets = buckets;
+	table->bucket_count = new_count;
+}
+
+static struct reassembly_entry *create_entry(
+	struct reassembly_table *table, const struct bundle *fragment,
+	const uint32_t digest)
+{
+	struct reassembly_entry *entry = malloc(
+		sizeof(struct reassembly_entry));
+
+	if (entry == NULL)
+		return NULL;
+	entry->fragments = malloc(
+		INITIAL_FRAGMENT_CAPACITY * sizeof(struct bundle *));
+	entry->intervals = malloc(
+		INITIAL_INTERVAL_CAPACITY * sizeof(struct reassembly_interval));
+	if (entry->fragments == NULL || entry->intervals == NULL) {
+		free_entry(entry);
+		return NULL;
+	}
+	entry->digest = digest;
+	entry->total_adu_length = fragment->total_adu_length;
+	entry->covered = 0;
+	entry->fragment_count = 0;
+	entry->fragment_capacity = INITIAL_FRAGMENT_CAPACITY;
+	entry->interval_count = 0;
+	entry->interval_capacity = INITIAL_INTERVAL_CAPACITY;
+
+	if (table->count >= table->bucket_count)
+		grow_table(table);
+	entry->next = table->buckets[digest & (table->bucket_count - 1)];
+	table->buckets[digest & (table->bucket_count - 1)] = entry;
+	table->count++;
+	return entry;
+}
+
+static void remove_entry(struct reassembly_table *table,
+			 struct reassembly_entry *entry)
+{
+	struct reassembly_entry **cur =
+		&table->buckets[entry->digest & (table->bucket_count - 1)];
+
+	while (*cur != entry)
+		cur = &(*cur)->next;
+	*cur = entry->next;
+	table->count--;
+}
+
+/* Makes room for one more fragment and one more interval */
+static bool reserve_slots(struct reassembly_entry *entry)
+{
+	struct bundle **fragments;
+	struct reassembly_interval *intervals;
+
+	if (entry->fragment_count == entry->fragment_capacity) {
+		fragments = realloc(entry->fragments,
+				    entry->fragment_capacity * 2 *
+				    sizeof(struct bundle *));
+		if (fragments == NULL)
+			return false;
+		entry->fragments = fragments;
+		entry->fragment_capacity *= 2;
+	}
+	if (entry->interval_count == entry->interval_capacity) {
+		intervals = realloc(entry->intervals,
+				    entry->interval_capacity * 2 *
+				    sizeof(struct reassembly_interval));
+		if (intervals == NULL)
+			return false;
+		entry->intervals = intervals;
+		entry->interval_capacity *= 2;
+	}
+	return true;
+}
+
+/* Merges [start, end) into the intervals, which are kept disjoint */
+static void add_interval(struct reassembly_entry *entry,
+			 const size_t start, const size_t end)
+{
+	struct reassembly_interval *const iv = entry->intervals;
+	uint32_t first = 0, last, count = entry->interval_count;
+	uint32_t low = 0, high = count, mid;
+	size_t merged_start = start, merged_end = end, replaced = 0;
+
+	/* The first interval which ends at or after start */
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (iv[mid].end < start)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	first = low;
+	/* Intervals overlapping or touching [start, end) are replaced */
+	for (last = first; last < count && iv[last].start <= end; last++) {
+		merged_start = Z_MIN(merged_start, iv[last].start);
+		merged_end = Z_MAX(merged_end, iv[last].end);
+		replaced += iv[last].end - iv[last].start;
+	}
+
+	if (last == first) {
+		memmove(&iv[first + 1], &iv[first],
+			(count - first) * sizeof(struct reassembly_interval));
+		entry->interval_count++;
+	} else if (last > first + 1) {
+		memmove(&iv[first + 1], &iv[last],
+			(count - last) * sizeof(struct reassembly_interval));
+		entry->interval_count -= last - first - 1;
+	}
+	iv[first].start = merged_start;
+	iv[first].end = merged_end;
+	entry->covered += (merged_end - merged_start) - replaced;
+}
+
+struct reassembly_entry *bundle_reassembly_add(
+	struct reassembly_table *table, struct bundle *fragment)
+{
+	const uint32_t digest = get_digest(fragment);
+	struct reassembly_entry *entry;
+	size_t start, end;
+
+	entry = table->buckets[digest & (table->bucket_count - 1)];
+	while (entry != NULL && (entry->digest != digest ||
+			!may_reassemble(entry->fragments[0], fragment)))
+		entry = entry->next;
+	if (entry == NULL) {
+		entry = create_entry(table, fragment, digest);
+		if (entry == NULL)
+			return NULL;
+	}
+
+	if (!reserve_slots(entry)) {
+		/* Do not keep an entry without fragments */
+		if (entry->fragment_count == 0) {
+			remove_entry(table, entry);
+			free_entry(entry);
+		}
+		return NULL;
+	}
+	entry->fragments[entry->fragment_count++] = fragment;
+
+	start = Z_MIN(fragment->fragment_offset, entry->total_adu_length);
+	end = Z_MIN(fragment->fragment_offset + fragment->payload_block->length,
+		    entry->total_adu_length);
+	if (start < end)
+		add_interval(entry, start, end);
+	return entry;
+}
+
+static int compare_offsets(const void *a, const void *b)
+{
+	const struct bundle *fa = *(const struct bundle *const *)a;
+	const struct bundle *fb = *(const struct bundle *const *)b;
+
+	if (fa->fragment_offset != fb->fragment_offset)
+		return fa->fragment_offset < fb->fragment_offset ? -1 : 1;
+	/* Longer fragments first, the shorter ones are not needed then */
+	if (fa->payload_block->length != fb->payload_block->length)
+		return fa->payload_block->length > fb->payload_block->length
+			? -1 : 1;
+	return 0;
+}
+
+/* Only payloads allocated separately or shared can be taken over */
+static bool payload_is_movable(const struct bundle *fragment)
+{
+	return fragment->layout != BUNDLE_LAYOUT_COMPACT ||
+		fragment->payload_block->buffer != NULL;
+}
+
+/* Builds the segments, copying only the payloads of compact fragments */
+static struct bundle **build_segments(struct reassembly_entry *entry,
+				      struct bundle_adu_segment *segments,
+				      size_t *segment_count)
+{
+	struct bundle **owners = malloc(
+		entry->fragment_count * sizeof(struct bundle *));
+	size_t position = 0, count = 0, start, end, i;
+	struct bundle *fragment;
+
+	if (owners == NULL)
+		return NULL;
+	for (i = 0; i < entry->fragment_count; i++) {
+		fragment = entry->fragments[i];
+		start = fragment->fragment_offset;
+		end = Z_MIN(start + fragment->payload_block->length,
+			    entry->total_adu_length);
+		if (end <= position)
+			continue;
+		ASSERT(start <= position);
+		segments[count].buffer = fragment->payload_block->data;
+		segments[count].offset = position - start;
+		segments[count].length = end - position;
+		segments[count].shared = fragment->payload_block->buffer;
+		if (!payload_is_movable(fragment)) {
+			segments[count].buffer = malloc(end - position);
+			if (segments[count].buffer == NULL)
+				goto fail;
+			memcpy(segments[count].buffer,
+			       &fragment->payload_block->data[position - start],
+			       end - position);
+			segments[count].offset = 0;
+		}
+		owners[count++] = fragment;
+		position = end;
+	}
+	*segment_count = count;
+	return owners;
+
+fail:
+	while (count--) {
+		if (!payload_is_movable(owners[count]))
+			free(segments[count].buffer);
+	}
+	free(owners);
+	return NULL;
+}
+
+enum ud3tn_result bundle_reassembly_take_adu(
+	struct reassembly_table *table, struct reassembly_entry *entry,
+	struct bundle_adu *adu,
+	void (*release_fragment)(struct bundle *fragment, void *param),
+	void *param)
+{
+	struct bundle_adu_segment *segments = NULL;
+	struct bundle **owners = NULL;
+	size_t segment_count = 0, i;
+
+	ASSERT(entry->fragment_count != 0);
+	ASSERT(bundle_reassembly_is_complete(entry));
+
+	qsort(entry->fragments, entry->fragment_count,
+	      sizeof(struct bundle *), compare_offsets);
+	segments = malloc(
+		entry->fragment_count * sizeof(struct bundle_adu_segment));
+	if (segments == NULL)
+		return UD3TN_FAIL;
+	owners = build_segments(entry, segments, &segment_count);
+	if (owners == NULL) {
+		free(segments);
+		return UD3TN_FAIL;
+	}
+
+	*adu = bundle_adu_init(entry->fragments[0]);
+	adu->length = entry->total_adu_length;
+	if (segment_count != 0) {
+		adu->segments = segments;
+		adu->segment_count = segment_count;
+	} else {
+		free(segments);
+	}
+	/* The payloads are owned by the segments now */
+	for (i = 0; i < segment_count; i++) {
+		if (!payload_is_movable(owners[i]))
+			continue;
+		owners[i]->payload_block->buffer = NULL;
+		owners[i]->payload_block->data = NULL;
+		owners[i]->payload_block->length = 0;
+	}
+	free(owners);
+
+	remove_entry(table, entry);
+	for (i = 0; i < entry->fragment_count; i++)
+		release_fragment(entry->fragments[i], param);
+	free_entry(entry);
+	return UD3TN_OK;
+}
@@ -1,35 +1,131 @@
 #include "platform/hal_semaphore.h"
+#include "platform/hal_io.h"
 
 #include "ud3tn/bundle.h"
 #include "ud3tn/bundle_storage_manager.h"
 #include "ud3tn/common.h"
+#include "ud3tn/config.h"
+#include "ud3tn/persistent_storage.h"
 
+#include <stdbool.h>
 #include <stdlib.h>
 
-static struct node {
-	bundleid_t id;
-	struct node *successor[2];
-	struct node *parent;
-	struct bundle *bundle;
-	int8_t height;
-} *storage_tree;
-
-static Semaphore_t tree_semaphore;
+/*
+ * Bundles are kept in a generation-tagged slot table. A bundle ID encodes
+ * the index of its slot in the lower BUNDLE_STORAGE_INDEX_BITS and the
+ * generation of that slot in the upper bits. Every time a slot is released,
+ * its generation is incremented, so that stale IDs (e.g. still residing in
+ * some signal queue) do not resolve to a bundle that re-used the slot.
+ * Lookups are thus O(1) and free slots are handed out from a FIFO free list
+ * instead of probing for unused IDs.
+ *
+ * Modifications are serialized by a semaphore, lookups do not take it.
+ * The table consists of chunks which are never moved after allocation and
+ * the generation of a slot acts as sequence counter: a lookup reads the
+ * generation, the bundle pointer and the generation again and only succeeds
+ * if both generations match the ID. Deletions increment the generation
+ * before clearing the bundle pointer.
+ *
+ * Tasks which may access a bundle concurrently to its deletion acquire it
+ * via bundle_storage_acquire(), which pins the slot. A slot which is deleted
+ * while pinned is recycled only after the last pin has been released, and
+ * bundles removed via bundle_storage_drop() are freed at the same time.
+ *
+ * The bundle of a slot is only replaced by bundle_storage_compact(). Tasks
+ * which acquired the ID before may still access the former bundle, which
+ * stays intact and is freed when the last pin has been released. Unpinned
+ * lookups via bundle_storage_get() are thus reserved to the task owning the
+ * bundle while it is acquired, which is also the only one compacting it.
+ *
+ * If the persistent storage is enabled, a slot additionally references the
+ * persistent copy of its bundle, which is removed together with the bundle.
+ * While the bundles in memory exceed the resident quota, persisted bundles
+ * which are not acquired are unloaded, i.e. freed, so that only their slots
+ * remain. The slots are visited like by the hand of a clock, bundles that
+ * have been acquired since the last visit get a second chance. Acquiring an
+ * unloaded bundle loads it again from its persistent copy. Custody-accepted
+ * bundles and fragments pending reassembly, to which other components keep
+ * pointers, as well as bundles changed after being persisted stay in memory.
+ *
+ * The stored bytes (primary block and block data) are limited to
+ * BUNDLE_QUOTA. If a new bundle exceeds the quota, bundles are selected
+ * according to the eviction policy and handed to the eviction handler, which
+ * deletes them asynchronously. Their bytes are already considered free, so
+ * the quota may be exceeded until the handler has removed them. The victims
+ * are found by a linear scan of the slots, which only runs if the storage is
+ * full.
+ */
 
 #define INV_ID BUNDLE_INVALID_ID
-static bundleid_t next_id = INV_ID + 1;
 
-static const int8_t comp_to_successor[] = {0, 0, 1};
+#define INDEX_MASK ((UINT32_C(1) << BUNDLE_STORAGE_INDEX_BITS) - 1)
+#define GENERATION_MASK (UINT32_MAX >> BUNDLE_STORAGE_INDEX_BITS)
+#define MAX_SLOTS (INDEX_MASK + 1)
+#define NO_SLOT UINT32_MAX
+
+/* The first chunk has BUNDLE_STORAGE_INITIAL_SLOTS slots, every further */
+/* chunk doubles the slot count of the table. */
+#define MAX_CHUNKS 32
+
+#define make_id(index, gen) \
+	((bundleid_t)(((gen) << BUNDLE_STORAGE_INDEX_BITS) | (index)))
+#define id_to_index(id) ((uint32_t)(id) & INDEX_MASK)
+#define id_to_generation(id) ((uint32_t)(id) >> BUNDLE_STORAGE_INDEX_BITS)
+
+#define atomic_load(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
+#define atomic_store(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_SEQ_CST)
+
+struct slot {
+	/* NULL if the slot is unused (accessed atomically) */
+	struct bundle *bundle;
+	/* Accessed atomically */
+	uint32_t generation;
+	/* Number of tasks which acquired the bundle (accessed atomically) */
+	uint32_t pins;
+	/* Set when the bundle is acquired, cleared when the hand of the */
+	/* unloading passes (accessed atomically, kept apart from the plain */
+	/* flags below so that no wider load covers it) */
+	uint32_t referenced;
+	/* Set if the bundle has been unloaded (accessed atomically) */
+	uint32_t unloaded;
+	/* Set if the slot has to be recycled when the last pin is released */
+	/* (accessed atomically) */
+	uint8_t release_pending;
+	/* Retention constraints contained in the persistent copy */
+	uint8_t persisted_constraints;
+	/* Index of the next free slot (only valid if the slot is unused) */
+	uint32_t next_free;
+	/* PERSISTENT_INVALID_ID if the bundle has not been persisted */
+	persistentid_t pid;
+	/* Bundle to be freed when the slot is recycled */
+	struct bundle *dropped;
+	/* Bundle replaced by bundle_storage_compact() which has to be freed */
+	/* when the last pin is released (accessed atomically) */
+	struct bundle *replaced;
+	/* Bytes accounted for the bundle when it was added */
+	uint32_t size;
+	/* Order in which the bundles have been added */
+	uint32_t sequence;
+	/* Number of successful transmissions */
+	uint8_t transmissions;
+	/* Set if the bundle has been handed to the eviction handler */
+	uint8_t evicting;
+	/* Set if the bundle has been changed after it was persisted */
+	uint8_t modified;
+	/* State of the unloaded bundle needed without loading it */
+	uint8_t unloaded_constraints;
+	uint8_t unloaded_priority;
+	uint64_t unloaded_expiration_s;
+};
+
+static struct slot *chunks[MAX_CHUNKS];
+
+/* Accessed atomically */
+static uint32_t slot_count;
+static uint32_t free_head = NO_SLOT;
+static uint32_t free_tail = NO_SLOT;
 
-#define max(x, y) ((x > y) ? x : y)
-#define height(node) (((node) == NULL) ? 0 : (node)->height)
-#define get_balance(node) (((node) == NULL) ? 0 : \
-	height((node)->successor[0]) - height((node)->successor[1]))
-#define recalc_height(node) ( \
-	(node)->height = (1 + max( \
-		height((node)->successor[0]), \
-		height((node)->successor[1]))) \
-)
+static Semaphore_t tree_semaphore;
 
 static void lock_tree(void)
 {
@@ -44,351 +140,839 @@ static void unlock_tree(void)
 	hal_semaphore_release(tree_semaphore);
 }
 
-static struct node *create_node(
-	bundleid_t id, struct bundle *bundle, struct node *parent)
+static uint32_t get_chunk(uint32_t index)
 {
-	struct node *node = malloc(sizeof(struct node));
+	const uint32_t base = index / BUNDLE_STORAGE_INITIAL_SLOTS;
 
-	if (node == NULL)
-		return NULL;
-	node->id = id;
-	node->successor[0] = NULL;
-	node->successor[1] = NULL;
-	node->parent = parent;
-	node->height = 1;
-	node->bundle = bundle;
-	return node;
+	if (base == 0)
+		return 0;
+	return 32 - __builtin_clz(base);
 }
 
-static struct node *rotate_right(struct node *old_top)
+static uint32_t get_chunk_start(uint32_t chunk)
 {
-	ASSERT(old_top != NULL);
-	ASSERT(old_top->successor[0] != NULL);
+	if (chunk == 0)
+		return 0;
+	return (uint32_t)BUNDLE_STORAGE_INITIAL_SLOTS << (chunk - 1);
+}
 
-	struct node *new_top = old_top->successor[0];
-	struct node *T2 = new_top->successor[1];
+/* Returns the slot with the given index, callable without holding the lock */
+static struct slot *get_slot(uint32_t index)
+{
+	const uint32_t chunk = get_chunk(index);
 
-	new_top->successor[1] = old_top;
-	new_top->parent = old_top->parent;
-	old_top->parent = new_top;
-	old_top->successor[0] = T2;
-	if (T2 != NULL)
-		T2->parent = old_top;
+	if (index >= atomic_load(&slot_count))
+		return NULL;
+	return &atomic_load(&chunks[chunk])[index - get_chunk_start(chunk)];
+}
 
-	recalc_height(old_top);
-	recalc_height(new_top);
+static void push_free_slot(uint32_t index)
+{
+	struct slot *slot = get_slot(index);
 
-	return new_top;
+	slot->pid = PERSISTENT_INVALID_ID;
+	slot->dropped = NULL;
+	slot->next_free = NO_SLOT;
+	if (free_tail == NO_SLOT)
+		free_head = index;
+	else
+		get_slot(free_tail)->next_free = index;
+	free_tail = index;
 }
 
-static struct node *rotate_left(struct node *old_top)
+static uint32_t pop_free_slot(void)
 {
-	ASSERT(old_top != NULL);
-	ASSERT(old_top->successor[1] != NULL);
+	const uint32_t index = free_head;
+
+	if (index == NO_SLOT)
+		return NO_SLOT;
+	free_head = get_slot(index)->next_free;
+	if (free_head == NO_SLOT)
+		free_tail = NO_SLOT;
+	return index;
+}
 
-	struct node *new_top = old_top->successor[1];
-	struct node *T2 = new_top->successor[0];
+/* Doubles the slot table and appends the new slots to the free list. */
+static uint8_t grow_slots(void)
+{
+	const uint32_t old_count = atomic_load(&slot_count);
+	const uint32_t chunk = old_count ? get_chunk(old_count) : 0;
+	const uint32_t chunk_size = chunk
+		? get_chunk_start(chunk) : BUNDLE_STORAGE_INITIAL_SLOTS;
+	struct slot *new_chunk;
+	uint32_t i;
+
+	if (old_count + chunk_size > MAX_SLOTS || chunk >= MAX_CHUNKS)
+		return 0;
+	new_chunk = calloc(chunk_size, sizeof(struct slot));
+	if (new_chunk == NULL)
+		return 0;
+	for (i = 0; i < chunk_size; i++) {
+		/* Generation 0 is never used to prevent creating INV_ID */
+		new_chunk[i].generation = 1;
+	}
+	/* Publish the chunk before the slots become addressable */
+	atomic_store(&chunks[chunk], new_chunk);
+	atomic_store(&slot_count, old_count + chunk_size);
+	for (i = old_count; i < old_count + chunk_size; i++)
+		push_free_slot(i);
+	return 1;
+}
 
-	new_top->successor[0] = old_top;
-	new_top->parent = old_top->parent;
-	old_top->parent = new_top;
-	old_top->successor[1] = T2;
-	if (T2 != NULL)
-		T2->parent = old_top;
+/* Returns the bundle for the given id, callable without holding the lock */
+static struct bundle *lookup(struct slot *slot, bundleid_t id)
+{
+	const uint32_t generation = atomic_load(&slot->generation);
+	struct bundle *bundle;
 
-	recalc_height(old_top);
-	recalc_height(new_top);
+	if (generation != id_to_generation(id))
+		return NULL;
+	bundle = atomic_load(&slot->bundle);
+	/* The slot has been released and possibly re-used in between */
+	if (atomic_load(&slot->generation) != generation)
+		return NULL;
+	return bundle;
+}
 
-	return new_top;
+/* Whether the bundle with the given ID is stored, but has been unloaded */
+static bool is_unloaded(struct slot *slot, bundleid_t id)
+{
+	return atomic_load(&slot->unloaded) &&
+		atomic_load(&slot->generation) == id_to_generation(id);
 }
 
-/* Find a node by id, or the parent for a new node with the given id. */
-static struct node **find_nodeptr(bundleid_t id, int8_t insert)
+/* Returns the slot for the given id or NULL if it is not in use. */
+static struct slot *find_slot(bundleid_t id)
 {
-	struct node **prev = NULL;
-	struct node **node = &storage_tree;
-	int8_t comp;
+	struct slot *slot;
 
-	if (*node == NULL)
+	if (id == INV_ID)
 		return NULL;
-	do {
-		prev = node;
-		comp = (id < (*node)->id) ? -1 : (id > (*node)->id);
-		/*
-		 * On insert existence
-		 * must be checked beforehand
-		 */
-		if (comp == 0)
-			return node;
-		node = &(*node)->successor[comp_to_successor[comp + 1]];
-	} while (*node != NULL);
-	if (insert)
-		return prev;
-	else
+	slot = get_slot(id_to_index(id));
+	if (slot == NULL ||
+	    (lookup(slot, id) == NULL && !is_unloaded(slot, id)))
 		return NULL;
+	return slot;
+}
+
+static uint32_t slot_to_index(struct slot *slot)
+{
+	uint32_t chunk;
+
+	for (chunk = 0; chunk < MAX_CHUNKS; chunk++) {
+		const uint32_t start = get_chunk_start(chunk);
+		const uint32_t size = chunk
+			? start : BUNDLE_STORAGE_INITIAL_SLOTS;
+
+		if (slot >= chunks[chunk] && slot < chunks[chunk] + size)
+			return start + (uint32_t)(slot - chunks[chunk]);
+	}
+	ASSERT(0);
+	return NO_SLOT;
 }
 
-/* Gets a pointer to the nodes parent in forward traversing direction. */
-/* This pointer type is needed for rebalance_from_nodeptr. */
-static inline struct node **get_parent_fwd_ptr(struct node *node)
+static bundleid_t get_id(struct slot *slot)
 {
-	if (node == NULL || node->parent == NULL)
+	return make_id(slot_to_index(slot), slot->generation);
+}
+
+/*
+ * Returns the slot to the free list. Has to be called while holding the
+ * lock and returns the bundle which has to be freed by the caller, if any.
+ */
+static struct bundle *recycle_slot(struct slot *slot)
+{
+	struct bundle *dropped = slot->dropped;
+
+	atomic_store(&slot->release_pending, 0);
+	push_free_slot(slot_to_index(slot));
+	return dropped;
+}
+
+/*
+ * Removes the bundle from the slot. Has to be called while holding the lock
+ * and returns the bundle which has to be freed by the caller, if any.
+ */
+static struct bundle *release_slot(struct slot *slot, bool drop)
+{
+	uint32_t generation = (slot->generation + 1) & GENERATION_MASK;
+
+	if (generation == 0)
+		generation = 1;
+	/* Invalidate the ID first, so concurrent lookups fail */
+	atomic_store(&slot->generation, generation);
+	atomic_store(&slot->unloaded, 0);
+	if (drop)
+		slot->dropped = slot->bundle;
+	atomic_store(&slot->bundle, NULL);
+	atomic_store(&slot->release_pending, 1);
+	if (atomic_load(&slot->pins) != 0)
 		return NULL;
-	else if (node->parent->parent == NULL)
-		return &storage_tree;
-	else if (node->parent == node->parent->parent->successor[0])
-		return &node->parent->parent->successor[0];
-	ASSERT(node->parent == node->parent->parent->successor[1]);
-	return &node->parent->parent->successor[1];
-}
-
-/* XXX Important: "node" must point to a successor[] (forward) slot, */
-/* not to a parent or some local pointer! */
-static void rebalance_from_nodeptr(struct node **node)
-{
-	int8_t balance = 0;
-
-	while (node != NULL && *node != NULL) {
-		recalc_height(*node);
-		balance = get_balance(*node);
-		ASSERT(balance >= -2 && balance <= 2);
-		if (balance == -2) { /* right is higher */
-			if (get_balance((*node)->successor[1]) > 0)
-				(*node)->successor[1]
-					= rotate_right((*node)->successor[1]);
-			*node = rotate_left(*node);
-		} else if (balance == 2) { /* left is higher */
-			if (get_balance((*node)->successor[0]) < 0)
-				(*node)->successor[0]
-					= rotate_left((*node)->successor[0]);
-			*node = rotate_right(*node);
-		}
-		/* TODO: Might be optimizable by certain criteria ("break") */
-		ASSERT(get_balance(*node) >= -1 && get_balance(*node) <= 1);
-		/* node has to point to a "successor" slot */
-		node = get_parent_fwd_ptr(*node);
+	return recycle_slot(slot);
+}
+
+static void unpin_slot(struct slot *slot)
+{
+	struct bundle *dropped = NULL, *replaced = NULL;
+
+	if (__atomic_sub_fetch(&slot->pins, 1, __ATOMIC_SEQ_CST) != 0)
+		return;
+	if (!atomic_load(&slot->release_pending) &&
+			atomic_load(&slot->replaced) == NULL)
+		return;
+	lock_tree();
+	if (atomic_load(&slot->pins) == 0) {
+		replaced = atomic_load(&slot->replaced);
+		atomic_store(&slot->replaced, NULL);
+		if (atomic_load(&slot->release_pending))
+			dropped = recycle_slot(slot);
 	}
+	unlock_tree();
+	bundle_free(replaced);
+	bundle_free(dropped);
 }
 
-static void delete_node_at_ptr(struct node **delptr)
-{
-	struct node *del = *delptr;
-	struct node *replacement;
-	struct node **rebalance_from = delptr;
-
-	/* Determine and configure replacement */
-	if (del->successor[0] == NULL && del->successor[1] == NULL) {
-		replacement = NULL;
-	} else if (del->successor[0] != NULL && del->successor[1] == NULL) {
-		replacement = del->successor[0];
-	} else if (del->successor[0] == NULL && del->successor[1] != NULL) {
-		replacement = del->successor[1];
-	} else {
-		/* Tree-node case */
-		/* Prefer the higher sub-tree */
-		if (height(del->successor[0]) >= height(del->successor[1])) {
-			/* Determine rightmost successor of left sibling */
-			replacement = del->successor[0];
-			while (replacement->successor[1] != NULL)
-				replacement = replacement->successor[1];
-			/* Swap position in sub-tree if not direct successor */
-			if (replacement != del->successor[0]) {
-				replacement->parent->successor[1]
-					= replacement->successor[0];
-				if (replacement->successor[0] != NULL)
-					replacement->successor[0]->parent
-						= replacement->parent;
-				recalc_height(replacement->parent);
-				replacement->successor[0] = del->successor[0];
-				if (del->successor[0] != NULL)
-					del->successor[0]->parent = replacement;
-			}
-			/* "Re-hang" right successor */
-			replacement->successor[1] = del->successor[1];
-			if (del->successor[1] != NULL)
-				del->successor[1]->parent = replacement;
-			/* Rebalance from first changed node's parent */
-			rebalance_from = get_parent_fwd_ptr(replacement);
-			if (rebalance_from == NULL)
-				rebalance_from = delptr;
-		} else {
-			/* Determine leftmost successor of right sibling */
-			replacement = del->successor[1];
-			while (replacement->successor[0] != NULL)
-				replacement = replacement->successor[0];
-			/* Swap position in sub-tree if not direct successor */
-			if (replacement != del->successor[1]) {
-				replacement->parent->successor[0]
-					= replacement->successor[1];
-				if (replacement->successor[1] != NULL)
-					replacement->successor[1]->parent
-						= replacement->parent;
-				recalc_height(replacement->parent);
-				replacement->successor[1] = del->successor[1];
-				if (del->successor[1] != NULL)
-					del->successor[1]->parent = replacement;
-			}
-			/* "Re-hang" left successor */
-			replacement->successor[0] = del->successor[0];
-			if (del->successor[0] != NULL)
-				del->successor[0]->parent = replacement;
-			/* Rebalance from first changed node's parent */
-			rebalance_from = get_parent_fwd_ptr(replacement);
-			if (rebalance_from == NULL)
-				rebalance_from = delptr;
+/* Written while holding the lock, read atomically without it */
+static uint32_t bundle_bytes;
+/* Bytes of the bundles handed to the eviction handler but not yet removed */
+static uint32_t evicting_bytes;
+/* Bytes of the unloaded bundles (like bundle_bytes) */
+static uint32_t unloaded_bytes;
+static uint32_t resident_quota = BUNDLE_STORAGE_RESIDENT_QUOTA;
+static uint32_t next_sequence;
+
+static enum bundle_storage_eviction_policy eviction_policy =
+	BUNDLE_STORAGE_EVICTION_POLICY;
+static bundle_storage_evict_t evict_handler;
+static void *evict_param;
+
+/* Bundles which have to be kept regardless of the eviction policy */
+#define UNEVICTABLE_CONSTRAINTS (BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED | \
+	BUNDLE_RET_CONSTRAINT_REASSEMBLY_PENDING)
+
+void bundle_storage_set_eviction_policy(
+	enum bundle_storage_eviction_policy policy)
+{
+	lock_tree();
+	eviction_policy = policy;
+	unlock_tree();
+}
+
+enum bundle_storage_eviction_policy bundle_storage_get_eviction_policy(void)
+{
+	return atomic_load(&eviction_policy);
+}
+
+void bundle_storage_set_resident_quota(uint32_t bytes)
+{
+	atomic_store(&resident_quota, bytes);
+}
+
+void bundle_storage_set_eviction_handler(bundle_storage_evict_t handler,
+					 void *param)
+{
+	lock_tree();
+	evict_handler = handler;
+	evict_param = param;
+	unlock_tree();
+}
+
+/* The primary block and all block data, i.e. the serialized headers */
+static uint32_t get_stored_size(const struct bundle *bundle)
+{
+	const struct bundle_block_list *e;
+	uint32_t size = bundle->primary_block_length;
+
+	for (e = bundle->blocks; e != NULL; e = e->next)
+		size += e->data->length;
+	return size;
+}
+
+static uint8_t get_constraints(const struct slot *slot)
+{
+	if (slot->bundle == NULL)
+		return slot->unloaded_constraints;
+	return slot->bundle->ret_constraints;
+}
+
+static enum bundle_routing_priority get_priority(const struct slot *slot)
+{
+	if (slot->bundle == NULL)
+		return slot->unloaded_priority;
+	return bundle_get_routing_priority(slot->bundle);
+}
+
+static uint64_t get_expiration_time_s(const struct slot *slot)
+{
+	if (slot->bundle == NULL)
+		return slot->unloaded_expiration_s;
+	return bundle_get_expiration_time_s(slot->bundle);
+}
+
+static bool is_evictable(const struct slot *slot)
+{
+	return (slot->bundle != NULL || atomic_load(&slot->unloaded)) &&
+		!slot->evicting &&
+		(get_constraints(slot) & UNEVICTABLE_CONSTRAINTS) == 0;
+}
+
+/* Returns whether a should be evicted before b */
+static bool is_better_victim(const struct slot *a, const struct slot *b)
+{
+	uint64_t exp_a, exp_b;
+	enum bundle_routing_priority prio_a, prio_b;
+
+	switch (eviction_policy) {
+	case BUNDLE_STORAGE_EVICT_SOONEST_EXPIRING:
+		exp_a = get_expiration_time_s(a);
+		exp_b = get_expiration_time_s(b);
+		if (exp_a != exp_b)
+			return exp_a < exp_b;
+		break;
+	case BUNDLE_STORAGE_EVICT_LOWEST_PRIORITY:
+		prio_a = get_priority(a);
+		prio_b = get_priority(b);
+		if (prio_a != prio_b)
+			return prio_a < prio_b;
+		break;
+	case BUNDLE_STORAGE_EVICT_MOST_FORWARDED:
+		if (a->transmissions != b->transmissions)
+			return a->transmissions > b->transmissions;
+		break;
+	default:
+		break;
+	}
+	/* Ties (and BUNDLE_STORAGE_EVICT_OLDEST) evict the first stored one */
+	return (int32_t)(a->sequence - b->sequence) < 0;
+}
+
+/*
+ * The candidates are kept in a binary heap whose root is the least suitable
+ * one, so that a better victim can replace it in O(log k).
+ */
+static void sift_down(struct slot **heap, uint32_t count, uint32_t pos)
+{
+	struct slot *const entry = heap[pos];
+	uint32_t child;
+
+	while ((child = 2 * pos + 1) < count) {
+		if (child + 1 < count &&
+		    is_better_victim(heap[child], heap[child + 1]))
+			child++;
+		if (!is_better_victim(entry, heap[child]))
+			break;
+		heap[pos] = heap[child];
+		pos = child;
+	}
+	heap[pos] = entry;
+}
+
+static void sift_up(struct slot **heap, uint32_t pos)
+{
+	struct slot *const entry = heap[pos];
+	uint32_t parent;
+
+	while (pos != 0) {
+		parent = (pos - 1) / 2;
+		if (!is_better_victim(heap[parent], entry))
+			break;
+		heap[pos] = heap[parent];
+		pos = parent;
+	}
+	heap[pos] = entry;
+}
+
+/*
+ * Marks bundles for eviction until at least the given number of bytes can be
+ * reclaimed. Has to be called while holding the lock. Returns the number of
+ * victims written to the array or zero, marking nothing, if not enough bytes
+ * can be reclaimed.
+ *
+ * The slots are scanned once, keeping the BUNDLE_STORAGE_MAX_EVICTIONS best
+ * victims. The best ones of them are taken until enough bytes are reclaimed.
+ */
+static uint32_t select_victims(uint32_t needed, bundleid_t *victims)
+{
+	struct slot *heap[BUNDLE_STORAGE_MAX_EVICTIONS];
+	const uint32_t count_slots = atomic_load(&slot_count);
+	uint32_t count = 0, reclaimed = 0, i;
+	struct slot *slot;
+
+	for (i = 0; i < count_slots; i++) {
+		slot = get_slot(i);
+		if (!is_evictable(slot))
+			continue;
+		if (count < BUNDLE_STORAGE_MAX_EVICTIONS) {
+			heap[count] = slot;
+			sift_up(heap, count++);
+		} else if (is_better_victim(slot, heap[0])) {
+			heap[0] = slot;
+			sift_down(heap, count, 0);
 		}
 	}
-	/* Replace, rebalance from there or from parent if NULL and exists */
-	*delptr = replacement;
-	if (replacement != NULL) {
-		replacement->parent = del->parent;
-		rebalance_from_nodeptr(rebalance_from);
-	} else if (del->parent != NULL) {
-		rebalance_from_nodeptr(get_parent_fwd_ptr(del));
+	/* Sort the candidates by moving the least suitable one to the end */
+	for (i = count; i > 1; i--) {
+		slot = heap[0];
+		heap[0] = heap[i - 1];
+		heap[i - 1] = slot;
+		sift_down(heap, i - 1, 0);
+	}
+	for (i = 0; i < count && reclaimed < needed; i++)
+		reclaimed += heap[i]->size;
+	if (reclaimed < needed)
+		return 0;
+	count = i;
+	for (i = 0; i < count; i++) {
+		heap[i]->evicting = 1;
+		victims[i] = get_id(heap[i]);
 	}
-	free(del);
+	evicting_bytes += reclaimed;
+	return count;
 }
 
-static uint8_t add_node(bundleid_t id, struct bundle *bundle)
+/* Returns false if the bundle cannot be admitted */
+static bool make_room(uint32_t size, bundleid_t *victims,
+		      uint32_t *victim_count)
 {
-	struct node *prev = NULL;
-	struct node *new = NULL;
-	int8_t suc = 0;
+	const uint64_t usage = bundle_bytes - evicting_bytes;
+
+	*victim_count = 0;
+	if (usage + size <= BUNDLE_QUOTA)
+		return true;
+	if (eviction_policy == BUNDLE_STORAGE_EVICT_NONE ||
+	    evict_handler == NULL || size > BUNDLE_QUOTA)
+		return false;
+	*victim_count = select_victims(usage + size - BUNDLE_QUOTA, victims);
+	return *victim_count != 0;
+}
+
+/* Bundles unloaded and slots visited at most per call of trim_resident() */
+#define TRIM_MAX_UNLOADS 16
+#define TRIM_MAX_VISITS 64
+
+/* Index of the slot visited next by trim_resident() */
+static uint32_t trim_hand;
+
+/* Whether the bundle can be freed and loaded again from its persistent copy */
+static bool is_unloadable(const struct slot *slot)
+{
+	const struct bundle *bundle = slot->bundle;
+
+	return bundle != NULL && slot->pid != PERSISTENT_INVALID_ID &&
+		!slot->modified && !slot->evicting &&
+		atomic_load(&slot->pins) == 0 &&
+		atomic_load(&slot->replaced) == NULL &&
+		(bundle->ret_constraints & UNEVICTABLE_CONSTRAINTS) == 0;
+}
 
-	if (storage_tree == NULL) {
-		storage_tree = create_node(id, bundle, NULL);
-		return (storage_tree != NULL);
+/*
+ * Removes the bundle from the slot, keeping the slot in use. Has to be called
+ * while holding the lock and returns the bundle which has to be freed by the
+ * caller or NULL if it has been acquired in the meantime.
+ */
+static struct bundle *unload_slot(struct slot *slot)
+{
+	struct bundle *bundle = slot->bundle;
+
+	slot->unloaded_constraints = bundle->ret_constraints;
+	slot->unloaded_priority = bundle_get_routing_priority(bundle);
+	slot->unloaded_expiration_s = bundle_get_expiration_time_s(bundle);
+	/* Announce the unloading before the bundle becomes unreachable, so */
+	/* that either acquiring tasks wait for the lock or we see their pin */
+	atomic_store(&slot->unloaded, 1);
+	atomic_store(&slot->bundle, NULL);
+	if (atomic_load(&slot->pins) != 0) {
+		atomic_store(&slot->bundle, bundle);
+		atomic_store(&slot->unloaded, 0);
+		return NULL;
 	}
-	ASSERT((prev = *find_nodeptr(id, 1)) != NULL);
+	atomic_store(&unloaded_bytes, unloaded_bytes + slot->size);
+	return bundle;
+}
+
+/*
+ * Unloads bundles while the resident ones exceed the quota. Has to be called
+ * while holding the lock and returns the number of unloaded bundles written
+ * to the array, which have to be freed by the caller. The work per call is
+ * bounded, the hand continues where it stopped with the next call.
+ */
+static uint32_t trim_resident(struct bundle **unloaded)
+{
+	const uint32_t count_slots = atomic_load(&slot_count);
+	uint32_t count = 0, visits;
+	struct bundle *bundle;
+	struct slot *slot;
 
-	new = create_node(id, bundle, prev);
-	if (new == NULL)
+	if (!persistent_storage_is_enabled())
 		return 0;
-	suc = comp_to_successor[1 +
-		((id < prev->id) ? -1 : (id > prev->id))];
-	ASSERT(prev->successor[suc] == NULL);
-	prev->successor[suc] = new;
+	for (visits = 0; visits < TRIM_MAX_VISITS &&
+	     count < TRIM_MAX_UNLOADS &&
+	     bundle_bytes - unloaded_bytes > resident_quota; visits++) {
+		if (trim_hand >= count_slots)
+			trim_hand = 0;
+		slot = get_slot(trim_hand++);
+		if (!is_unloadable(slot))
+			continue;
+		if (atomic_load(&slot->referenced)) {
+			atomic_store(&slot->referenced, 0);
+			continue;
+		}
+		bundle = unload_slot(slot);
+		if (bundle != NULL)
+			unloaded[count++] = bundle;
+	}
+	return count;
+}
 
-	rebalance_from_nodeptr(get_parent_fwd_ptr(new));
+static void trim_if_needed(void)
+{
+	struct bundle *unloaded[TRIM_MAX_UNLOADS];
+	uint32_t count, i;
 
-	return 1;
+	if (atomic_load(&bundle_bytes) - atomic_load(&unloaded_bytes) <=
+	    atomic_load(&resident_quota))
+		return;
+	lock_tree();
+	count = trim_resident(unloaded);
+	unlock_tree();
+	for (i = 0; i < count; i++)
+		bundle_free(unloaded[i]);
 }
 
-static uint32_t bundle_bytes;
-
-bundleid_t bundle_storage_add(struct bundle *bundle)
+static bundleid_t add_bundle(struct bundle *bundle, persistentid_t pid,
+			     bool enforce_quota)
 {
-	bundleid_t id = next_id++;
+	const uint32_t size = get_stored_size(bundle);
+	bundleid_t victims[BUNDLE_STORAGE_MAX_EVICTIONS];
+	struct bundle *unloaded[TRIM_MAX_UNLOADS];
+	uint32_t victim_count = 0, unloaded_count = 0, index, i;
+	bundle_storage_evict_t handler;
+	void *param;
+	bundleid_t id = INV_ID;
+	struct slot *slot;
 
 	ASSERT(bundle->id == INV_ID);
 	lock_tree();
-	/* TODO: This is not very efficient; */
-	/* A precalculated list of free ids should be used */
-	while (id == INV_ID || find_nodeptr(id, 0) != NULL)
-		id = next_id++;
-	if (add_node(id, bundle)) {
+	index = pop_free_slot();
+	if (index == NO_SLOT && grow_slots())
+		index = pop_free_slot();
+	if (index != NO_SLOT && enforce_quota &&
+	    !make_room(size, victims, &victim_count)) {
+		push_free_slot(index);
+		index = NO_SLOT;
+	}
+	if (index != NO_SLOT) {
+		/* Before adding the bundle, as the caller still accesses it */
+		unloaded_count = trim_resident(unloaded);
+		slot = get_slot(index);
+		slot->pid = pid;
+		slot->persisted_constraints = bundle->ret_constraints &
+			PERSISTENT_STORAGE_RETAINED_CONSTRAINTS;
+		slot->size = size;
+		slot->sequence = next_sequence++;
+		slot->transmissions = 0;
+		slot->evicting = 0;
+		slot->modified = 0;
+		atomic_store(&slot->referenced, 0);
+		id = make_id(index, slot->generation);
 		bundle->id = id;
-		if (bundle->payload_block)
-			bundle_bytes += bundle->payload_block->length;
+		atomic_store(&slot->bundle, bundle);
+		atomic_store(&bundle_bytes, bundle_bytes + size);
 		/* LOGI("Stored bundle", id); */
-	} else {
-		id = BUNDLE_INVALID_ID;
 	}
+	handler = evict_handler;
+	param = evict_param;
 	unlock_tree();
+	for (i = 0; i < unloaded_count; i++)
+		bundle_free(unloaded[i]);
+	/* The handler may call back into the storage */
+	for (i = 0; i < victim_count; i++)
+		handler(victims[i], param);
 	return id;
 }
 
-int8_t bundle_storage_contains(bundleid_t id)
+bundleid_t bundle_storage_add(struct bundle *bundle)
 {
-	struct node **node;
+	return add_bundle(bundle, PERSISTENT_INVALID_ID, true);
+}
 
-	if (id == INV_ID)
-		return 0;
-	lock_tree();
-	node = find_nodeptr(id, 0);
-	unlock_tree();
-	if (node != NULL)
+bundleid_t bundle_storage_add_exempt(struct bundle *bundle)
+{
+	return add_bundle(bundle, PERSISTENT_INVALID_ID, false);
+}
+
+bundleid_t bundle_storage_add_persisted(struct bundle *bundle,
+					persistentid_t pid)
+{
+	/* Bundles restored from the persistent storage are always kept */
+	return add_bundle(bundle, pid, false);
+}
+
+int8_t bundle_storage_contains(bundleid_t id)
+{
+	if (find_slot(id) != NULL)
 		return 1;
 	return 0;
 }
 
 struct bundle *bundle_storage_get(bundleid_t id)
 {
-	struct node **node;
-	struct bundle *result = NULL;
-	/*uint32_t ptr;*/
+	struct slot *slot;
 
 	if (id == INV_ID)
 		return NULL;
+	slot = get_slot(id_to_index(id));
+	if (slot == NULL)
+		return NULL;
+	return lookup(slot, id);
+}
+
+static int8_t remove_bundle(bundleid_t id, bool drop);
+
+/*
+ * Loads an unloaded bundle from its persistent copy. The slot has to be
+ * pinned, so that it cannot be recycled in the meantime.
+ */
+static struct bundle *reload_bundle(struct slot *slot, bundleid_t id)
+{
+	struct bundle *bundle, *loaded;
+	persistentid_t pid = PERSISTENT_INVALID_ID;
+
 	lock_tree();
-	node = find_nodeptr(id, 0);
-	if (node != NULL) {
-		/* TODO: Persistent storage disabled */
-		/*ptr = (uint32_t)(*node)->bundle;*/
-		/*if ((ptr & 0x80000000) == 0x80000000)*/
-		/*	result = persistent_storage_get(ptr & 0x7FFFFFFF);*/
-		/*else*/
-		result = (*node)->bundle;
+	/* The lookup may also have failed while an unloading was reverted */
+	bundle = lookup(slot, id);
+	if (bundle == NULL && is_unloaded(slot, id))
+		pid = slot->pid;
+	unlock_tree();
+	if (pid == PERSISTENT_INVALID_ID)
+		return bundle;
+
+	/* Do not block other tasks while reading the bundle from disk */
+	loaded = persistent_storage_load(pid);
+	if (loaded == NULL) {
+		LOGI("BundleStorage: Could not load unloaded bundle", id);
+		remove_bundle(id, false);
+		return NULL;
 	}
+
+	lock_tree();
+	/* Another task may have loaded the bundle in the meantime */
+	if (is_unloaded(slot, id)) {
+		loaded->id = id;
+		loaded->ret_constraints = slot->unloaded_constraints;
+		atomic_store(&slot->bundle, loaded);
+		atomic_store(&slot->unloaded, 0);
+		atomic_store(&unloaded_bytes, unloaded_bytes - slot->size);
+		loaded = NULL;
+	}
+	bundle = lookup(slot, id);
 	unlock_tree();
-	return result;
+	bundle_free(loaded);
+	return bundle;
 }
 
-int8_t bundle_storage_delete(bundleid_t id)
+struct bundle *bundle_storage_acquire(bundleid_t id)
 {
-	struct node **delptr;
+	struct slot *slot;
+	struct bundle *bundle;
+
+	if (id == INV_ID)
+		return NULL;
+	slot = get_slot(id_to_index(id));
+	if (slot == NULL)
+		return NULL;
+	/* Pin first, a deletion after the lookup will then be deferred */
+	__atomic_add_fetch(&slot->pins, 1, __ATOMIC_SEQ_CST);
+	bundle = lookup(slot, id);
+	/* Only unloaded bundles are missing while the ID is still valid */
+	if (bundle == NULL &&
+	    atomic_load(&slot->generation) == id_to_generation(id))
+		bundle = reload_bundle(slot, id);
+	if (bundle == NULL) {
+		unpin_slot(slot);
+		return NULL;
+	}
+	__atomic_store_n(&slot->referenced, 1, __ATOMIC_RELAXED);
+	return bundle;
+}
+
+void bundle_storage_release(bundleid_t id)
+{
+	struct slot *slot = get_slot(id_to_index(id));
+
+	ASSERT(slot != NULL && atomic_load(&slot->pins) != 0);
+	unpin_slot(slot);
+	trim_if_needed();
+}
+
+static int8_t remove_bundle(bundleid_t id, bool drop)
+{
+	struct slot *slot;
+	struct bundle *dropped = NULL;
+	persistentid_t pid = PERSISTENT_INVALID_ID;
 	int8_t result = 0;
-	/*uint32_t ptr;*/
 
 	if (id == INV_ID)
 		return 0;
 	lock_tree();
-	delptr = find_nodeptr(id, 0);
-	if (delptr != NULL) {
-		/* TODO: Persistent storage disabled */
-		/*ptr = (uint32_t)(*delptr)->bundle;*/
-		/*if ((ptr & 0x80000000) == 0x80000000)*/
-		/*	persistent_storage_delete(ptr & 0x7FFFFFFF);*/
-		const size_t size = (*delptr)->bundle->payload_block
-			? (*delptr)->bundle->payload_block->length : 0;
-		ASSERT(bundle_bytes >= size);
-		bundle_bytes -= size;
-		delete_node_at_ptr(delptr);
+	slot = find_slot(id);
+	if (slot != NULL) {
+		ASSERT(bundle_bytes >= slot->size);
+		atomic_store(&bundle_bytes, bundle_bytes - slot->size);
+		if (slot->evicting) {
+			evicting_bytes -= slot->size;
+			slot->evicting = 0;
+		}
+		if (atomic_load(&slot->unloaded))
+			atomic_store(&unloaded_bytes,
+				     unloaded_bytes - slot->size);
+		pid = slot->pid;
+		slot->pid = PERSISTENT_INVALID_ID;
+		dropped = release_slot(slot, drop);
 		result = 1;
 	}
 	unlock_tree();
+	if (dropped != NULL)
+		bundle_free(dropped);
+	persistent_storage_delete(pid);
 	return result;
 }
 
+int8_t bundle_storage_delete(bundleid_t id)
+{
+	return remove_bundle(id, false);
+}
+
+int8_t bundle_storage_drop(bundleid_t id)
+{
+	return remove_bundle(id, true);
+}
+
 int8_t bundle_storage_persist(bundleid_t id)
 {
-	struct node **node;
-	uint32_t ptr;
+	struct slot *slot;
+	struct bundle *bundle;
+	persistentid_t pid;
+	uint8_t constraints;
 	int8_t result = 0;
-	/*uint32_t pid;*/
 
-	if (id == INV_ID)
+	if (id == INV_ID || !persistent_storage_is_enabled())
+		return 0;
+	/* Keep the bundle from being freed while it is written unlocked */
+	bundle = bundle_storage_acquire(id);
+	if (bundle == NULL)
 		return 0;
 	lock_tree();
-	node = find_nodeptr(id, 0);
-	if (node != NULL) {
-		ptr = (uintptr_t)(*node)->bundle;
-		/* TODO: Persistent storage disabled */
-		(void)ptr;
-		/*if ((ptr & 0x80000000) == 0) {*/
-			/*pid = persistent_storage_add((*node)->bundle);*/
-			/*if (pid == PERSISTENT_INVALID_ID) {*/
-			/*	result = 0;*/
-			/*} else {*/
-			/*	(*node)->bundle = (void *)(pid | 0x80000000);*/
-			/*	result = 1;*/
-			/*}*/
-		/*}*/
+	slot = find_slot(id);
+	if (slot == NULL) {
+		unlock_tree();
+		goto done;
+	}
+	pid = slot->pid;
+	constraints = bundle->ret_constraints &
+		PERSISTENT_STORAGE_RETAINED_CONSTRAINTS;
+	/* Only re-write the bundle if its retained state has changed */
+	if (pid != PERSISTENT_INVALID_ID &&
+			constraints == slot->persisted_constraints) {
+		unlock_tree();
+		result = 1;
+		goto done;
 	}
 	unlock_tree();
+
+	/* Do not block other tasks while writing the bundle to disk */
+	pid = persistent_storage_add(bundle, pid);
+	if (pid == PERSISTENT_INVALID_ID)
+		goto done;
+
+	lock_tree();
+	slot = find_slot(id);
+	if (slot != NULL) {
+		slot->pid = pid;
+		slot->persisted_constraints = constraints;
+		slot->modified = 0;
+	}
+	unlock_tree();
+	/* The bundle has been deleted in the meantime */
+	if (slot == NULL)
+		persistent_storage_delete(pid);
+	else
+		result = 1;
+done:
+	bundle_storage_release(id);
 	return result;
 }
 
+struct bundle *bundle_storage_compact(bundleid_t id)
+{
+	struct slot *slot;
+	struct bundle *bundle = NULL, *replaced = NULL;
+
+	lock_tree();
+	slot = find_slot(id);
+	if (slot == NULL)
+		goto done;
+	bundle = slot->bundle;
+	/* The former bundle of a previous call is still pinned */
+	if (atomic_load(&slot->replaced) != NULL)
+		goto done;
+	/* The eviction reads the bundles while holding the lock */
+	replaced = bundle;
+	bundle = bundle_compact_dup(replaced);
+	if (bundle == NULL) {
+		bundle = replaced;
+		replaced = NULL;
+		goto done;
+	}
+	/* Announce the former bundle before it becomes unreachable, so that */
+	/* either the last unpin_slot() sees it or we see no pins below. */
+	atomic_store(&slot->replaced, replaced);
+	atomic_store(&slot->bundle, bundle);
+	if (atomic_load(&slot->pins) == 0)
+		atomic_store(&slot->replaced, NULL);
+	else
+		replaced = NULL;
+done:
+	unlock_tree();
+	bundle_free(replaced);
+	return bundle;
+}
+
+void bundle_storage_cancel_eviction(bundleid_t id)
+{
+	struct slot *slot;
+
+	lock_tree();
+	slot = find_slot(id);
+	if (slot != NULL && slot->evicting) {
+		evicting_bytes -= slot->size;
+		slot->evicting = 0;
+	}
+	unlock_tree();
+}
+
+void bundle_storage_note_modification(bundleid_t id)
+{
+	struct slot *slot;
+
+	lock_tree();
+	slot = find_slot(id);
+	if (slot != NULL)
+		slot->modified = 1;
+	unlock_tree();
+}
+
+void bundle_storage_note_transmission(bundleid_t id)
+{
+	struct slot *slot;
+
+	lock_tree();
+	slot = find_slot(id);
+	if (slot != NULL && slot->transmissions != UINT8_MAX)
+		slot->transmissions++;
+	unlock_tree();
+}
+
 // NOTE: The assumption is that bundles are stored in serialized form.
 uint32_t bundle_storage_get_usage(void)
 {
@@ -396,7 +980,7 @@ uint32_t bundle_storage_get_usage(void)
 	return bundle_bytes;
 }
 
-bundleid_t bundle_storage_get_next_id(void)
+uint32_t bundle_storage_get_resident_usage(void)
 {
-	return next_id;
+	return atomic_load(&bundle_bytes) - atomic_load(&unloaded_bytes);
 }
@@ -57,6 +57,7 @@ const struct ud3tn_cmdline_options *parse_cmdline(int argc, char *argv[])
 	result->aap_socket = NULL;
 	result->aap_node = NULL;
 	result->aap_service = NULL;
+	result->storage_dir = NULL;
 	result->bundle_version = DEFAULT_BUNDLE_VERSION;
 	result->status_reporting = false;
 	result->exit_immediately = false;
@@ -74,7 +75,7 @@ const struct ud3tn_cmdline_options *parse_cmdline(int argc, char *argv[])
 		goto finish;
 
 	shorten_long_cli_options(argc, argv);
-	while ((opt = getopt(argc, argv, ":a:b:c:e:l:m:p:s:rhu")) != -1) {
+	while ((opt = getopt(argc, argv, ":a:b:c:e:l:m:p:s:S:rhu")) != -1) {
 		switch (opt) {
 		case 'a':
 			if (!optarg || strlen(optarg) < 1) {
@@ -141,6 +142,13 @@ const struct ud3tn_cmdline_options *parse_cmdline(int argc, char *argv[])
 			}
 			result->aap_socket = strdup(optarg);
 			break;
+		case 'S':
+			if (!optarg || strlen(optarg) < 1) {
+				LOG("Invalid storage directory provided!");
+				return NULL;
+			}
+			result->storage_dir = strdup(optarg);
+			break;
 		case 'u':
 			print_usage_text();
 			result->exit_immediately = true;
@@ -237,6 +245,7 @@ static void shorten_long_cli_options(const int argc, char *argv[])
 		{"--lifetime", "-l"},
 		{"--max-bundle-size", "-m"},
 		{"--status-reports", "-r"},
+		{"--storage", "-S"},
 		{"--usage", "-u"},
 	};
 
@@ -259,7 +268,8 @@ static void print_usage_text(void)
 		"    [-b 6|7, --bp-version 6|7] [-c CLA_OPTIONS, --cla CLA_OPTIONS]\n"
 		"    [-e EID, --eid EID] [-h, --help] [-l SECONDS, --lifetime SECONDS]\n"
 		"    [-m BYTES, --max-bundle-size BYTES] [-r, --status-reports]\n"
-		"    [-s PATH --aap-socket PATH] [-u, --usage]\n";
+		"    [-s PATH --aap-socket PATH] [-S DIR, --storage DIR]\n"
+		"    [-u, --usage]\n";
 
 	hal_io_message_printf(usage_text);
 }
@@ -280,6 +290,7 @@ static void print_help_text(void)
 		"  -p, --aap-port PORT         port number of the application agent service\n"
 		"  -r, --status-reports        enable status reporting\n"
 		"  -s, --aap-socket PATH       path to the UNIX domain socket of the application agent service\n"
+		"  -S, --storage DIR           keep bundles in DIR to restore them after a restart\n"
 		"  -u, --usage                 print usage summary and exit\n"
 		"\n"
 		"Default invocation: ud3tn \\\n"
@@ -3,18 +3,26 @@
 #include "ud3tn/common.h"
 #include "ud3tn/config.h"
 #include "ud3tn/custody_manager.h"
+#include "ud3tn/eid_table.h"
 
 #include "bundle6/bundle6.h"
 #include "bundle7/bundle7.h"
 
+#include "platform/hal_semaphore.h"
+
 #include <stdlib.h>
 #include <string.h>
 
+/*
+ * The accepted bundles are shared by all bundle processor shards, thus, every
+ * public function holds the semaphore while accessing them.
+ */
 
 static struct bundle *accepted_bundles[CUSTODY_MAX_BUNDLE_COUNT];
 static int accepted_bundle_count;
+static Semaphore_t custody_semaphore;
 
-static const char *own_eid;
+static char *own_eid;
 
 static int get_index(struct bundle *bundle)
 {
@@ -38,7 +46,7 @@ static int find(uint64_t creation_timestamp_ms, uint16_t sequence_number,
 		if (
 			b->creation_timestamp_ms == creation_timestamp_ms
 			&& b->sequence_number == sequence_number
-			&& strcmp(b->source, source_eid) == 0
+			&& b->source == source_eid
 			&& (!bundle_is_fragmented(b)
 				|| (b->fragment_offset == fragment_offset
 				&& b->payload_block->length == fragment_length))
@@ -49,14 +57,14 @@ static int find(uint64_t creation_timestamp_ms, uint16_t sequence_number,
 	return -1;
 }
 
-bool custody_manager_has_redundant_bundle(struct bundle *bundle)
+static bool has_redundant_bundle(struct bundle *bundle)
 {
 	return find(bundle->creation_timestamp_ms, bundle->sequence_number,
 		bundle->source, bundle->fragment_offset,
 		bundle->payload_block->length) != -1;
 }
 
-bool custody_manager_storage_is_acceptable(struct bundle *bundle)
+static bool storage_is_acceptable(struct bundle *bundle)
 {
 	/*
 	 * RFC 5050 states: "The conditions under which a node may accept
@@ -79,16 +87,43 @@ bool custody_manager_storage_is_acceptable(struct bundle *bundle)
 		);
 }
 
+bool custody_manager_has_redundant_bundle(struct bundle *bundle)
+{
+	bool result;
+
+	hal_semaphore_take_blocking(custody_semaphore);
+	result = has_redundant_bundle(bundle);
+	hal_semaphore_release(custody_semaphore);
+	return result;
+}
+
+bool custody_manager_storage_is_acceptable(struct bundle *bundle)
+{
+	bool result;
+
+	hal_semaphore_take_blocking(custody_semaphore);
+	result = storage_is_acceptable(bundle);
+	hal_semaphore_release(custody_semaphore);
+	return result;
+}
+
 bool custody_manager_has_accepted(struct bundle *bundle)
 {
-	return get_index(bundle) != -1;
+	bool result;
+
+	hal_semaphore_take_blocking(custody_semaphore);
+	result = get_index(bundle) != -1;
+	hal_semaphore_release(custody_semaphore);
+	return result;
 }
 
-struct bundle *custody_manager_get_by_record(
+bundleid_t custody_manager_get_by_record(
 	struct bundle_administrative_record *record)
 {
+	bundleid_t id = BUNDLE_INVALID_ID;
 	int index;
 
+	hal_semaphore_take_blocking(custody_semaphore);
 	index = find(
 		record->bundle_creation_timestamp_ms,
 		record->bundle_sequence_number,
@@ -96,59 +131,95 @@ struct bundle *custody_manager_get_by_record(
 		record->fragment_offset,
 		record->fragment_length
 	);
-	if (index == -1)
-		return NULL;
-	else
-		return accepted_bundles[index];
+	/* The bundle may be freed by its shard as soon as the lock is gone */
+	if (index != -1)
+		id = accepted_bundles[index]->id;
+	hal_semaphore_release(custody_semaphore);
+	return id;
 }
 
 /* 5.10.1 */
 enum ud3tn_result custody_manager_accept(struct bundle *bundle)
 {
-	/* Should be checked by bundle processor */
-	ASSERT(!custody_manager_has_redundant_bundle(bundle));
-	ASSERT(custody_manager_storage_is_acceptable(bundle));
+	hal_semaphore_take_blocking(custody_semaphore);
+	/* Checked by the bundle processor, but other shards may have */
+	/* accepted bundles in the meantime */
+	if (has_redundant_bundle(bundle) || !storage_is_acceptable(bundle)) {
+		hal_semaphore_release(custody_semaphore);
+		return UD3TN_FAIL;
+	}
 	/* Add to list */
 	accepted_bundles[accepted_bundle_count++] = bundle;
+	hal_semaphore_release(custody_semaphore);
 	/* Add ret. constraint */
 	bundle->ret_constraints |= BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED;
 	/* Add own EID as custodian and to dict */
 
 	switch (bundle->protocol_version) {
 	case 6:
-		free(bundle->current_custodian);
-		bundle->current_custodian = strdup(own_eid);
+		eid_release(bundle->current_custodian);
+		bundle->current_custodian = eid_ref(own_eid);
 		return UD3TN_OK;
 	default:
 		return UD3TN_FAIL;
 	}
 }
 
+/* Re-establishes custody of a bundle restored from the persistent storage */
+enum ud3tn_result custody_manager_restore(struct bundle *bundle)
+{
+	hal_semaphore_take_blocking(custody_semaphore);
+	if (accepted_bundle_count >= CUSTODY_MAX_BUNDLE_COUNT
+		|| get_index(bundle) != -1
+		|| has_redundant_bundle(bundle)
+	) {
+		hal_semaphore_release(custody_semaphore);
+		bundle->ret_constraints &=
+			~BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED;
+		return UD3TN_FAIL;
+	}
+	accepted_bundles[accepted_bundle_count++] = bundle;
+	hal_semaphore_release(custody_semaphore);
+	bundle->ret_constraints |= BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED;
+	return UD3TN_OK;
+}
+
 /* 5.10.2 */
 void custody_manager_release(struct bundle *bundle)
 {
 	size_t num;
-	int index = get_index(bundle);
+	int index;
 
-	if (index == -1)
+	hal_semaphore_take_blocking(custody_semaphore);
+	index = get_index(bundle);
+	if (index == -1) {
+		hal_semaphore_release(custody_semaphore);
 		return;
+	}
 	if (index != (accepted_bundle_count - 1)) {
 		num = accepted_bundle_count - index - 1;
 		memmove(
 			accepted_bundles + index,
 			accepted_bundles + index + 1,
-			num
+			num * sizeof(struct bundle *)
 		);
 	}
 	accepted_bundle_count--;
+	hal_semaphore_release(custody_semaphore);
 	bundle->ret_constraints &= ~BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED;
 	if (bundle->ret_constraints == BUNDLE_RET_CONSTRAINT_NONE) {
-		bundle_storage_delete(bundle->id);
-		bundle_drop(bundle);
+		if (!bundle_storage_drop(bundle->id))
+			bundle_drop(bundle);
 	}
 }
 
 void custody_manager_init(const char *local_eid)
 {
-	own_eid = local_eid;
+	if (custody_semaphore == NULL) {
+		custody_semaphore = hal_semaphore_init_binary();
+		ASSERT(custody_semaphore != NULL);
+		hal_semaphore_release(custody_semaphore);
+	}
+	eid_release(own_eid);
+	own_eid = eid_intern(local_eid);
 }
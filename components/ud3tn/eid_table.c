@@ -0,0 +1,241 @@
+#include "ud3tn/common.h"
+#include "ud3tn/config.h"
+#include "ud3tn/eid_table.h"
+
+#include "platform/hal_io.h"
+#include "platform/hal_semaphore.h"
+
+#include "util/htab_hash.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct eid_entry {
+	struct eid_entry *next;
+	uint32_t hash;
+	uint32_t refcount;
+	size_t length;
+	size_t node_length;
+	char eid[];
+};
+
+static Semaphore_t table_semaphore;
+static struct eid_entry **buckets;
+static uint32_t bucket_count;
+static struct eid_table_stats table_stats;
+
+static inline struct eid_entry *get_entry(const char *eid)
+{
+	return (struct eid_entry *)(eid - offsetof(struct eid_entry, eid));
+}
+
+static void lock_table(void)
+{
+	Semaphore_t sem = __atomic_load_n(&table_semaphore, __ATOMIC_ACQUIRE);
+	Semaphore_t expected = NULL;
+
+	if (sem != NULL) {
+		hal_semaphore_take_blocking(sem);
+		return;
+	}
+	/* The semaphore is created in the taken state */
+	sem = hal_semaphore_init_binary();
+	ASSERT(sem != NULL);
+	if (__atomic_compare_exchange_n(&table_semaphore, &expected, sem,
+					false, __ATOMIC_ACQ_REL,
+					__ATOMIC_ACQUIRE))
+		return;
+	/* Another task has been faster */
+	hal_semaphore_delete(sem);
+	hal_semaphore_take_blocking(expected);
+}
+
+static void unlock_table(void)
+{
+	hal_semaphore_release(table_semaphore);
+}
+
+/* "dtn://node/service" -> "dtn://node", "ipn:1.2" -> "ipn:1" */
+static size_t get_node_length(const char *eid, const size_t length)
+{
+	const char *end = NULL;
+
+	if (length > 6 && memcmp(eid, "dtn://", 6) == 0)
+		end = memchr(eid + 6, '/', length - 6);
+	else if (length > 4 && memcmp(eid, "ipn:", 4) == 0)
+		end = memchr(eid + 4, '.', length - 4);
+	return end != NULL ? (size_t)(end - eid) : length;
+}
+
+static bool grow_table(void)
+{
+	const uint32_t new_count = bucket_count != 0
+		? bucket_count * 2 : EID_TABLE_INITIAL_BUCKETS;
+	struct eid_entry **new_buckets = calloc(
+		new_count, sizeof(struct eid_entry *));
+	struct eid_entry *entry, *next;
+	uint32_t i, slot;
+
+	if (new_buckets == NULL)
+		return false;
+	for (i = 0; i < bucket_count; i++) {
+		for (entry = buckets[i]; entry != NULL; entry = next) {
+			next = entry->next;
+			slot = entry->hash & (new_count - 1);
+			entry->next = new_buckets[slot];
+			new_buckets[slot] = entry;
+		}
+	}
+	free(buckets);
+	table_stats.bytes -= bucket_count * sizeof(struct eid_entry *);
+	table_stats.bytes += new_count * sizeof(struct eid_entry *);
+	buckets = new_buckets;
+	bucket_count = new_count;
+	return true;
+}
+
+char *eid_intern(const char *eid)
+{
+	struct eid_entry *entry = NULL;
+	size_t length;
+	uint32_t hash;
+
+	if (eid == NULL)
+		return NULL;
+	length = strlen(eid);
+	hash = hashlittle(eid, length, 0);
+
+	lock_table();
+	if (bucket_count != 0) {
+		entry = buckets[hash & (bucket_count - 1)];
+		while (entry != NULL && (entry->hash != hash ||
+				entry->length != length ||
+				memcmp(entry->eid, eid, length) != 0))
+			entry = entry->next;
+	}
+	if (entry != NULL) {
+		__atomic_add_fetch(&entry->refcount, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&table_stats.references, 1,
+				   __ATOMIC_RELAXED);
+		table_stats.hits++;
+		goto unlock;
+	}
+	/* Growing may fail, in that case the chains just become longer */
+	if (table_stats.entries >= bucket_count && !grow_table() &&
+			bucket_count == 0)
+		goto unlock;
+	entry = malloc(sizeof(struct eid_entry) + length + 1);
+	if (entry == NULL)
+		goto unlock;
+	entry->hash = hash;
+	entry->refcount = 1;
+	entry->length = length;
+	entry->node_length = get_node_length(eid, length);
+	memcpy(entry->eid, eid, length + 1);
+	entry->next = buckets[hash & (bucket_count - 1)];
+	buckets[hash & (bucket_count - 1)] = entry;
+	__atomic_add_fetch(&table_stats.references, 1, __ATOMIC_RELAXED);
+	table_stats.entries++;
+	table_stats.bytes += sizeof(struct eid_entry) + length + 1;
+unlock:
+	unlock_table();
+	return entry != NULL ? entry->eid : NULL;
+}
+
+char *eid_ref(char *eid)
+{
+	if (eid == NULL)
+		return NULL;
+	/* The caller holds a reference, so the entry cannot vanish */
+	__atomic_add_fetch(&get_entry(eid)->refcount, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&table_stats.references, 1, __ATOMIC_RELAXED);
+	return eid;
+}
+
+void eid_release(char *eid)
+{
+	struct eid_entry *entry, **cur;
+	uint32_t refcount;
+
+	if (eid == NULL)
+		return;
+	entry = get_entry(eid);
+	__atomic_sub_fetch(&table_stats.references, 1, __ATOMIC_RELAXED);
+
+	/* Only the last reference has to be dropped with the table locked */
+	refcount = __atomic_load_n(&entry->refcount, __ATOMIC_RELAXED);
+	while (refcount > 1) {
+		if (__atomic_compare_exchange_n(&entry->refcount, &refcount,
+						refcount - 1, false,
+						__ATOMIC_RELEASE,
+						__ATOMIC_RELAXED))
+			return;
+	}
+
+	lock_table();
+	if (__atomic_sub_fetch(&entry->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+		cur = &buckets[entry->hash & (bucket_count - 1)];
+		while (*cur != entry)
+			cur = &(*cur)->next;
+		*cur = entry->next;
+		table_stats.entries--;
+		table_stats.bytes -= sizeof(struct eid_entry) +
+			entry->length + 1;
+		free(entry);
+	}
+	unlock_table();
+}
+
+size_t eid_length(const char *eid)
+{
+	return get_entry(eid)->length;
+}
+
+size_t eid_node_length(const char *eid)
+{
+	return get_entry(eid)->node_length;
+}
+
+const char *eid_service(const char *eid)
+{
+	const struct eid_entry *entry = get_entry(eid);
+
+	if (entry->node_length == entry->length)
+		return &eid[entry->length];
+	return &eid[entry->node_length + 1];
+}
+
+bool eid_has_node(const char *eid, const char *node_eid)
+{
+	const size_t node_length = get_node_length(
+		node_eid, strlen(node_eid));
+
+	return (
+		eid_node_length(eid) == node_length &&
+		memcmp(eid, node_eid, node_length) == 0
+	);
+}
+
+void eid_table_get_stats(struct eid_table_stats *stats)
+{
+	lock_table();
+	stats->entries = table_stats.entries;
+	stats->references = __atomic_load_n(
+		&table_stats.references, __ATOMIC_RELAXED);
+	stats->bytes = table_stats.bytes;
+	stats->hits = table_stats.hits;
+	unlock_table();
+}
+
+void eid_table_log_stats(void)
+{
+	struct eid_table_stats stats;
+
+	eid_table_get_stats(&stats);
+	LOGF("EID table: %lu EIDs with %lu references, %lu bytes, %lu hits",
+	     (unsigned long)stats.entries, (unsigned long)stats.references,
+	     (unsigned long)stats.bytes, (unsigned long)stats.hits);
+}
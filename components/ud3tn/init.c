@@ -3,6 +3,7 @@
 #include "ud3tn/cmdline.h"
 #include "ud3tn/common.h"
 #include "ud3tn/init.h"
+#include "ud3tn/persistent_storage.h"
 #include "routing/contact/router.h"
 #include "routing/router_task.h"
 #include "ud3tn/task_tags.h"
@@ -56,6 +57,20 @@ void start_tasks(const struct ud3tn_cmdline_options *const opt)
 
 	bundle_agent_interface.local_eid = opt->eid;
 
+	/* Stored bundles are restored when the bundle processor starts */
+	if (opt->storage_dir) {
+		if (persistent_storage_init(opt->storage_dir) != UD3TN_OK) {
+			LOG("INIT: Persistent storage could not be initialized!");
+			exit(EXIT_FAILURE);
+		}
+		hal_task_create(persistent_storage_compaction_task,
+				"storage_t",
+				PERSISTENT_STORAGE_TASK_PRIORITY,
+				NULL,
+				DEFAULT_TASK_STACK_SIZE,
+				(void *)FS_TASK_TAG);
+	}
+
 	/* Initialize queues to communicate with the subsystems */
 	bundle_agent_interface.router_signaling_queue
 			= hal_queue_create(ROUTER_QUEUE_LENGTH,
@@ -75,18 +90,15 @@ void start_tasks(const struct ud3tn_cmdline_options *const opt)
 			bundle_agent_interface.bundle_signaling_queue;
 	router_task_params->bundle_agent_interface = &bundle_agent_interface; // we need this reference for the routing agent!
 
-	struct bundle_processor_task_parameters *bundle_processor_task_params
-		= malloc(sizeof(struct bundle_processor_task_parameters));
-
-	ASSERT(bundle_processor_task_params != NULL);
-	bundle_processor_task_params->router_signaling_queue =
-			bundle_agent_interface.router_signaling_queue;
-	bundle_processor_task_params->signaling_queue =
-			bundle_agent_interface.bundle_signaling_queue;
-	bundle_processor_task_params->local_eid =
-			bundle_agent_interface.local_eid;
-	bundle_processor_task_params->status_reporting =
-			opt->status_reporting;
+	const struct bundle_processor_task_parameters
+		bundle_processor_task_params = {
+		.router_signaling_queue =
+			bundle_agent_interface.router_signaling_queue,
+		.signaling_queue =
+			bundle_agent_interface.bundle_signaling_queue,
+		.local_eid = bundle_agent_interface.local_eid,
+		.status_reporting = opt->status_reporting,
+	};
 
 	hal_task_create(router_task,
 			"router_t",
@@ -95,12 +107,11 @@ void start_tasks(const struct ud3tn_cmdline_options *const opt)
             CONTACT_ROUTER_TASK_STACK_SIZE,
 			(void *)ROUTER_TASK_TAG);
 
-	hal_task_create(bundle_processor_task,
-			"bundl_proc_t",
-			BUNDLE_PROCESSOR_TASK_PRIORITY,
-			bundle_processor_task_params,
-			DEFAULT_TASK_STACK_SIZE,
-			(void *)BUNDLE_PROCESSOR_TASK_TAG);
+	if (bundle_processor_start(&bundle_processor_task_params)
+			!= UD3TN_OK) {
+		LOG("INIT: Bundle processor could not be initialized!");
+		exit(EXIT_FAILURE);
+	}
 
 	config_agent_setup(bundle_agent_interface.bundle_signaling_queue,
 		bundle_agent_interface.router_signaling_queue,
@@ -1,11 +1,33 @@
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 
+#include "ud3tn/config.h"
 #include "ud3tn/known_bundle_list.h"
+#include "ud3tn/pool.h"
+#include "ud3tn/timer_service.h"
 
+#include "util/htab_hash.h"
 
-static struct known_bundle_list_entry *create_entry(const struct bundle *bundle) {
-    struct known_bundle_list_entry *entry = malloc(sizeof(struct known_bundle_list_entry));
+static struct pool entry_pool = POOL_INITIALIZER(
+    struct known_bundle_list_entry, "known_bundle_list_entry");
+
+// Fragments and their reassembled parent share a digest, as only the
+// fields identifying the parent bundle are hashed. Sources are interned,
+// so their address identifies them.
+static uint32_t get_digest(const struct bundle *bundle) {
+    const uint64_t key[3] = {
+        (uintptr_t)bundle->source,
+        bundle->creation_timestamp_ms,
+        bundle->sequence_number,
+    };
+
+    return hashlittle(key, sizeof(key), bundle->protocol_version);
+}
+
+static struct known_bundle_list_entry *create_entry(struct known_bundle_list *list, const struct bundle *bundle) {
+    struct known_bundle_list_entry *entry = pool_alloc(&entry_pool);
 
     if (!entry) {
         return NULL;
@@ -14,14 +36,18 @@ static struct known_bundle_list_entry *create_entry(const struct bundle *bundle)
     entry->id = bundle->id;
     entry->unique_identifier = bundle_get_unique_identifier(bundle);
     entry->deadline = bundle_get_expiration_time_s(bundle);
+    entry->digest = get_digest(bundle);
     entry->next = NULL;
+    entry->prev = NULL;
+    entry->bucket_next = NULL;
+    timer_service_init_timer(&entry->expiry_timer, &list->expired);
 
     return entry;
 }
 
 void known_bundle_list_free_entry(struct known_bundle_list_entry *entry) {
     bundle_free_unique_identifier(&entry->unique_identifier);
-    free(entry);
+    pool_free(&entry_pool, entry);
 }
 
 void known_bundle_list_lock(struct known_bundle_list *list) {
@@ -48,8 +74,19 @@ struct known_bundle_list *known_bundle_list_create() {
         return NULL;
     }
 
+    list->buckets = calloc(KNOWN_BUNDLE_LIST_INITIAL_BUCKETS, sizeof(struct known_bundle_list_entry *));
+
+    if (!list->buckets) {
+        free(list);
+        hal_semaphore_delete(sem);
+        return NULL;
+    }
+
     list->sem = sem;
     list->head = NULL; // empty list at the beginning!
+    list->bucket_count = KNOWN_BUNDLE_LIST_INITIAL_BUCKETS;
+    timer_queue_init(&list->expired);
+    list->count = 0;
 
     return list;
 }
@@ -60,6 +97,12 @@ void known_bundle_list_destroy(struct known_bundle_list *list) {
     struct known_bundle_list_entry *cur = list->head;
     list->head = NULL;
 
+    // expired entries stay in the list until they are popped
+    for (struct known_bundle_list_entry *e = cur; e != NULL; e = e->next) {
+        timer_service_cancel(&e->expiry_timer);
+    }
+    timer_service_clear(&list->expired);
+
     // Loop through all entries and free them
     while (cur != NULL) {
         struct known_bundle_list_entry *next = cur->next;
@@ -69,22 +112,78 @@ void known_bundle_list_destroy(struct known_bundle_list *list) {
 
     hal_semaphore_delete(list->sem);
     list->sem = NULL;
+    free(list->buckets);
     free(list); // release memory of main list
 }
 
+uint32_t known_bundle_list_count(struct known_bundle_list *list) {
+    known_bundle_list_lock(list);
+    const uint32_t count = list->count;
+    known_bundle_list_unlock(list);
+    return count;
+}
+
+
+static void grow_unsafe(struct known_bundle_list *list) {
+    if (list->count < list->bucket_count) {
+        return;
+    }
+
+    const uint32_t new_count = list->bucket_count * 2;
+    struct known_bundle_list_entry **buckets = calloc(new_count, sizeof(struct known_bundle_list_entry *));
+
+    // without a larger hash set, the buckets just get longer
+    if (buckets) {
+        for (struct known_bundle_list_entry *e = list->head; e != NULL; e = e->next) {
+            e->bucket_next = buckets[e->digest & (new_count - 1)];
+            buckets[e->digest & (new_count - 1)] = e;
+        }
+        free(list->buckets);
+        list->buckets = buckets;
+        list->bucket_count = new_count;
+    }
+}
+
+
+static void unlink_unsafe(struct known_bundle_list *list, struct known_bundle_list_entry *entry) {
+    // remove from the hash set
+    struct known_bundle_list_entry **ref = &list->buckets[entry->digest & (list->bucket_count - 1)];
+    while (*ref != entry) {
+        ref = &(*ref)->bucket_next;
+    }
+    *ref = entry->bucket_next;
 
+    // and from the list of all entries
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        list->head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    }
+    entry->next = NULL;
+    entry->prev = NULL;
+    entry->bucket_next = NULL;
+    list->count--;
+}
+
+
+// expired entries are queued by the timer service and removed when popped
 static struct known_bundle_list_entry *pop_before_unsafe(struct known_bundle_list *list, uint64_t remove_before_ts) {
-    struct known_bundle_list_entry *ret = NULL;
+    timer_service_advance(remove_before_ts);
 
-    struct known_bundle_list_entry *cur = list->head;
-    if (cur != NULL && cur->deadline < remove_before_ts) {
+    struct timer *timer = timer_service_pop(&list->expired, remove_before_ts);
 
-        // move list to next element
-        list->head = cur->next;
-        // reset next element
-        cur->next = NULL;
-        ret = cur;
+    if (timer == NULL) {
+        return NULL;
     }
+
+    struct known_bundle_list_entry *ret = (struct known_bundle_list_entry *)(
+        (char *)timer - offsetof(struct known_bundle_list_entry, expiry_timer)
+    );
+
+    unlink_unsafe(list, ret);
     return ret;
 }
 
@@ -110,50 +209,64 @@ void known_bundle_list_remove_before(struct known_bundle_list *list, uint64_t re
 }
 
 
-bool add_if_not_exists(struct known_bundle_list *list, const struct bundle *bundle, bool as_parent) {
-    const uint64_t bundle_deadline = bundle_get_expiration_time_s(bundle);
-
-    known_bundle_list_lock(list);
-
-    // the reference that needs to be updated to the new element
-    struct known_bundle_list_entry **ref = &list->head;
+static bool is_parent_entry(const struct bundle *bundle, const struct known_bundle_list_entry *entry) {
+    return (
+        bundle_is_equal_parent(bundle, &entry->unique_identifier) &&
+        entry->unique_identifier.fragment_offset == 0 &&
+        entry->unique_identifier.payload_length == bundle->total_adu_length
+    );
+}
 
-    // search for the position in the list
-    struct known_bundle_list_entry *cur = list->head;
+static struct known_bundle_list_entry *find_unsafe(struct known_bundle_list *list, const struct bundle *bundle, uint32_t digest, bool as_parent) {
+    struct known_bundle_list_entry *cur = list->buckets[digest & (list->bucket_count - 1)];
 
     while (cur != NULL) {
-        // we do not check if for equality
-        if (as_parent && bundle_is_equal_parent(bundle, &cur->unique_identifier) &&
-            cur->unique_identifier.fragment_offset == 0 &&
-            cur->unique_identifier.payload_length == bundle->total_adu_length
-        ) {
-            known_bundle_list_unlock(list);
-            return true; // parent bundle already exists -> abort
-        } else if (!as_parent && bundle_is_equal(bundle, &cur->unique_identifier)) {
-            known_bundle_list_unlock(list);
-            return true; // bundle already exists -> abort
-        } else if (bundle_deadline < cur->deadline) {
-            // the bundle needs to be inserted at the place of cur
-            // the bundle is not part of this list
-            // TODO: This assumption is only true for bundles with a creation timestamp
-            break;
+        if (cur->digest == digest) {
+            if (as_parent && is_parent_entry(bundle, cur)) {
+                return cur;
+            } else if (!as_parent && bundle_is_equal(bundle, &cur->unique_identifier)) {
+                return cur;
+            }
         }
+        cur = cur->bucket_next;
+    }
+    return NULL;
+}
+
+bool add_if_not_exists(struct known_bundle_list *list, const struct bundle *bundle, bool as_parent) {
+    const uint32_t digest = get_digest(bundle);
 
-        ref = &cur->next;
-        cur = cur->next;
+    known_bundle_list_lock(list);
+
+    if (find_unsafe(list, bundle, digest, as_parent) != NULL) {
+        known_bundle_list_unlock(list);
+        return true; // (parent) bundle already exists -> abort
     }
 
-    // element has not been found but the position was -> insert
-    struct known_bundle_list_entry *entry = create_entry(bundle);
+    // element has not been found -> insert
+    struct known_bundle_list_entry *entry;
 
-    if (entry != NULL) {
-        entry->next = *ref; // use the old reference
-        *ref = entry; // and update the reference to the new entry
+    grow_unsafe(list);
+    entry = create_entry(list, bundle);
 
+    if (entry != NULL) {
+        entry->is_fragment = !as_parent && bundle_is_fragmented(bundle);
         if (as_parent) {
             entry->unique_identifier.fragment_offset = 0;
             entry->unique_identifier.payload_length = bundle->total_adu_length;
         }
+
+        entry->next = list->head;
+        if (list->head) {
+            list->head->prev = entry;
+        }
+        list->head = entry;
+
+        entry->bucket_next = list->buckets[digest & (list->bucket_count - 1)];
+        list->buckets[digest & (list->bucket_count - 1)] = entry;
+
+        timer_service_add(&entry->expiry_timer, entry->deadline);
+        list->count++;
     } else {
         //TODO: handle error!
     }
@@ -172,110 +285,30 @@ bool known_bundle_list_add_reassembled_parent(struct known_bundle_list *list, co
 }
 
 bool known_bundle_list_contains_reassembled_parent(struct known_bundle_list *list, const struct bundle *bundle) {
-    known_bundle_list_lock(list);
-    KNOWN_BUNDLE_LIST_FOREACH(list, entry) {
-        if (
-                bundle_is_equal_parent(bundle, &entry->unique_identifier) &&
-                entry->unique_identifier.fragment_offset == 0 &&
-                entry->unique_identifier.payload_length == bundle->total_adu_length
-                ){
-            known_bundle_list_unlock(list);
-            return true;
-        }
-    }
-    known_bundle_list_unlock(list);
-    return false;
-}
+    const uint32_t digest = get_digest(bundle);
 
-/*
-bool known_bundle_list_contains(struct known_bundle_list *list, const struct bundle *bundle) {
     known_bundle_list_lock(list);
-    KNOWN_BUNDLE_LIST_FOREACH(list, entry) {
-        if (bundle_is_equal(bundle, &entry->unique_identifier)) {
-            known_bundle_list_unlock(list);
-            return true;
-        }
-    }
+    const bool ret = find_unsafe(list, bundle, digest, true) != NULL;
     known_bundle_list_unlock(list);
-    return false;
+    return ret;
 }
 
+bool known_bundle_list_contains_primary(struct known_bundle_list *list, const struct bundle *bundle) {
+    const uint32_t digest = get_digest(bundle);
+    bool ret = false;
 
-
-bool known_bundle_list_contains_id(struct known_bundle_list *list, bundleid_t id) {
     known_bundle_list_lock(list);
-    KNOWN_BUNDLE_LIST_FOREACH(list, entry) {
-        if (entry->id == id) {
-            known_bundle_list_unlock(list);
-            return true;
-        }
+    struct known_bundle_list_entry *cur = list->buckets[digest & (list->bucket_count - 1)];
+
+    // the payload length is not known yet, so only entries for whole bundles can match
+    while (cur != NULL && !ret) {
+        ret = (
+            cur->digest == digest &&
+            !cur->is_fragment &&
+            bundle_is_equal_parent(bundle, &cur->unique_identifier)
+        );
+        cur = cur->bucket_next;
     }
     known_bundle_list_unlock(list);
-    return false;
-}
-
-bool known_bundle_list_remove(struct known_bundle_list *list, const struct bundle *bundle) {
-    const uint64_t bundle_deadline = bundle_get_expiration_time_s(bundle);
-
-    known_bundle_list_lock(list);
-
-    // the reference that needs to be updated to the new element
-    struct known_bundle_list_entry **ref = &list->head;
-
-    // search for the position in the list
-    struct known_bundle_list_entry *cur = list->head;
-
-    while (cur != NULL) {
-        if (bundle_is_equal(bundle, &cur->unique_identifier)) {
-
-            // current needs to be deleted -> set reference to the following element
-            *ref = cur->next;
-
-            // free cur
-            known_bundle_list_free_entry(cur);
-            // and we are done
-            known_bundle_list_unlock(list);
-            return true; // bundle already exists -> abort
-        } else if (bundle_deadline < cur->deadline) {
-            // the bundle is not part of this list
-            // TODO: This assumption is only true for bundles with a creation timestamp
-            break;
-        }
-
-        ref = &cur->next;
-        cur = cur->next;
-    }
-
-    known_bundle_list_unlock(list);
-    return false;
+    return ret;
 }
-
-bool known_bundle_list_remove_bundleid(struct known_bundle_list *list, bundleid_t id) {
-    known_bundle_list_lock(list);
-
-    // the reference that needs to be updated to the new element
-    struct known_bundle_list_entry **ref = &list->head;
-
-    // search for the position in the list
-    struct known_bundle_list_entry *cur = list->head;
-
-    while (cur != NULL) {
-        if (cur->id == id) {
-            // current needs to be deleted -> set reference to the following element
-            *ref = cur->next;
-
-            // free cur
-            known_bundle_list_free_entry(cur);
-
-            // and we are done
-            known_bundle_list_unlock(list);
-            return true;
-        }
-
-        ref = &cur->next;
-        cur = cur->next;
-    }
-
-    known_bundle_list_unlock(list);
-    return false;
-}*/
\ No newline at end of file
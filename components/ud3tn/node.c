@@ -1,5 +1,6 @@
 #include "ud3tn/common.h"
 #include "ud3tn/node.h"
+#include "ud3tn/pool.h"
 #include "ud3tn/result.h"
 
 #include "platform/hal_time.h"
@@ -10,6 +11,37 @@
 #include <string.h>
 #include <stdbool.h>
 
+static struct pool routed_bundle_pool = POOL_INITIALIZER(
+	struct routed_bundle, "routed_bundle");
+static struct pool routed_bundle_list_pool = POOL_INITIALIZER(
+	struct routed_bundle_list, "routed_bundle_list");
+
+struct routed_bundle *routed_bundle_alloc(void)
+{
+	return pool_alloc(&routed_bundle_pool);
+}
+
+void routed_bundle_free(struct routed_bundle *rb)
+{
+	pool_free(&routed_bundle_pool, rb);
+}
+
+struct routed_bundle_list *routed_bundle_list_alloc(void)
+{
+	return pool_alloc(&routed_bundle_list_pool);
+}
+
+void routed_bundle_list_free(struct routed_bundle_list *entry)
+{
+	pool_free(&routed_bundle_list_pool, entry);
+}
+
+void routed_bundle_log_pool_stats(void)
+{
+	pool_log_stats(&routed_bundle_pool);
+	pool_log_stats(&routed_bundle_list_pool);
+}
+
 struct node *node_create(char *eid)
 {
 	struct node *ret = malloc(sizeof(struct node));
@@ -69,7 +101,7 @@ static void free_contact_internal(
 	cur_bundle = contact->contact_bundles;
 	while (cur_bundle != NULL) {
 		next = cur_bundle->next;
-		free(cur_bundle);
+		routed_bundle_list_free(cur_bundle);
 		cur_bundle = next;
 	}
 	free(contact);
@@ -0,0 +1,59 @@
+#include "ud3tn/common.h"
+#include "ud3tn/payload_buffer.h"
+#include "ud3tn/pool.h"
+
+#include <stdlib.h>
+
+static struct pool buffer_pool = POOL_INITIALIZER(
+	struct payload_buffer, "payload_buffer");
+
+struct payload_buffer *payload_buffer_adopt(uint8_t *data, size_t length)
+{
+	return payload_buffer_wrap(data, data, length);
+}
+
+struct payload_buffer *payload_buffer_wrap(void *allocation, uint8_t *data,
+					   size_t length)
+{
+	struct payload_buffer *buffer = pool_alloc(&buffer_pool);
+
+	if (buffer == NULL)
+		return NULL;
+	buffer->data = data;
+	buffer->length = length;
+	buffer->refcount = 1;
+	buffer->allocation = allocation;
+	return buffer;
+}
+
+struct payload_buffer *payload_buffer_ref(struct payload_buffer *buffer)
+{
+	ASSERT(buffer != NULL);
+	__atomic_add_fetch(&buffer->refcount, 1, __ATOMIC_RELAXED);
+	return buffer;
+}
+
+void payload_buffer_release(struct payload_buffer *buffer)
+{
+	if (buffer == NULL)
+		return;
+	if (__atomic_sub_fetch(&buffer->refcount, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+	free(buffer->allocation);
+	pool_free(&buffer_pool, buffer);
+}
+
+uint8_t *payload_buffer_steal(struct payload_buffer *buffer)
+{
+	uint8_t *data;
+
+	ASSERT(buffer != NULL);
+	if (buffer->allocation != buffer->data)
+		return NULL;
+	/* Nobody else can take a new reference without holding one */
+	if (__atomic_load_n(&buffer->refcount, __ATOMIC_ACQUIRE) != 1)
+		return NULL;
+	data = buffer->data;
+	pool_free(&buffer_pool, buffer);
+	return data;
+}
@@ -0,0 +1,1193 @@
+#include "ud3tn/bundle.h"
+#include "ud3tn/common.h"
+#include "ud3tn/config.h"
+#include "ud3tn/persistent_storage.h"
+#include "ud3tn/result.h"
+
+#include "platform/hal_io.h"
+#include "platform/hal_task.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef PLATFORM_POSIX
+
+#include "ud3tn/crc.h"
+
+#include "bundle6/parser.h"
+#include "bundle7/parser.h"
+
+#include "platform/hal_semaphore.h"
+#include "platform/hal_time.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * On-disk format
+ *
+ * The store consists of segment files named "<number>.seg" with ascending
+ * numbers. Only the segment with the highest number is appended to, all
+ * others are immutable until they are removed by the compaction.
+ * A segment is a sequence of records, each consisting of a header followed
+ * by the serialized bundle (PUT records) or nothing (DEL records). The header
+ * is stored in host byte order, the store is not meant to be moved between
+ * machines. A record is always written using a single system call, thus, if
+ * the process is killed, the record is either fully contained in the file or
+ * not at all. A power loss may still leave a partially written record at the
+ * end of the last segment, which is detected via the CRC and truncated.
+ *
+ * A later record for a persistent ID overrides all earlier ones. As the
+ * compaction may drop PUT records of older segments only if no newer record
+ * references the ID, a DEL record has to be kept as long as older segments
+ * exist which may contain a PUT record for the same ID.
+ */
+
+#define RECORD_MAGIC UINT32_C(0x53503355) /* "U3PS" */
+#define SEGMENT_SUFFIX ".seg"
+#define SEGMENT_NAME_LENGTH 8
+
+enum record_type {
+	RECORD_PUT = 1,
+	RECORD_DEL = 2,
+};
+
+struct record_header {
+	uint32_t magic;
+	/* CRC-32 over all following header fields and the body */
+	uint32_t crc;
+	uint32_t pid;
+	/* Length of the body following the header */
+	uint32_t length;
+	uint64_t expiration_s;
+	uint8_t type;
+	uint8_t ret_constraints;
+	uint8_t reserved[6];
+};
+
+#define RECORD_CRC_OFFSET (offsetof(struct record_header, pid))
+
+struct segment {
+	uint32_t number;
+	/* Bytes in the segment file */
+	uint32_t size;
+	/* Bytes of PUT records which are the latest ones for their ID */
+	uint32_t live;
+	/* Bytes of DEL records */
+	uint32_t tombstones;
+};
+
+struct index_entry {
+	/* PERSISTENT_INVALID_ID if the entry is unused */
+	persistentid_t pid;
+	uint32_t segment;
+	uint32_t offset;
+	/* Size of the record, including the header */
+	uint32_t size;
+	uint64_t expiration_s;
+};
+
+static char *storage_directory;
+static Semaphore_t storage_semaphore;
+
+/* Sorted by number, the last one is the active segment */
+static struct segment *segments;
+static uint32_t segment_count;
+static int active_fd = -1;
+/* Set while a compaction moves records to the active segment, which */
+/* releases the lock between its batches */
+static bool compacting;
+
+/* Open addressing hash table with linear probing */
+static struct index_entry *index_slots;
+static uint32_t index_capacity;
+static uint32_t index_count;
+
+static persistentid_t next_pid = 1;
+
+/* INDEX */
+
+static uint32_t index_hash(persistentid_t pid)
+{
+	/* Fibonacci hashing, the capacity is always a power of two */
+	return (uint32_t)(pid * UINT32_C(2654435761)) & (index_capacity - 1);
+}
+
+static struct index_entry *index_find(persistentid_t pid)
+{
+	uint32_t i;
+
+	if (index_capacity == 0)
+		return NULL;
+	for (i = index_hash(pid);
+	     index_slots[i].pid != PERSISTENT_INVALID_ID;
+	     i = (i + 1) & (index_capacity - 1)) {
+		if (index_slots[i].pid == pid)
+			return &index_slots[i];
+	}
+	return NULL;
+}
+
+static struct index_entry *index_insert_slot(persistentid_t pid)
+{
+	uint32_t i = index_hash(pid);
+
+	while (index_slots[i].pid != PERSISTENT_INVALID_ID &&
+	       index_slots[i].pid != pid)
+		i = (i + 1) & (index_capacity - 1);
+	return &index_slots[i];
+}
+
+static bool index_grow(void)
+{
+	struct index_entry *old_slots = index_slots;
+	const uint32_t old_capacity = index_capacity;
+	const uint32_t new_capacity = index_capacity
+		? index_capacity * 2 : PERSISTENT_STORAGE_INITIAL_INDEX_SLOTS;
+	uint32_t i;
+
+	if (new_capacity < old_capacity)
+		return false;
+	index_slots = calloc(new_capacity, sizeof(struct index_entry));
+	if (index_slots == NULL) {
+		index_slots = old_slots;
+		return false;
+	}
+	index_capacity = new_capacity;
+	for (i = 0; i < old_capacity; i++) {
+		if (old_slots[i].pid != PERSISTENT_INVALID_ID)
+			*index_insert_slot(old_slots[i].pid) = old_slots[i];
+	}
+	free(old_slots);
+	return true;
+}
+
+/* Removes the entry, keeping all probe sequences intact. */
+static void index_remove(struct index_entry *entry)
+{
+	uint32_t hole = (uint32_t)(entry - index_slots);
+	uint32_t i = hole, home;
+
+	for (;;) {
+		i = (i + 1) & (index_capacity - 1);
+		if (index_slots[i].pid == PERSISTENT_INVALID_ID)
+			break;
+		home = index_hash(index_slots[i].pid);
+		/* Move the entry into the hole if it is not reachable else */
+		if (((i - home) & (index_capacity - 1)) >=
+				((i - hole) & (index_capacity - 1))) {
+			index_slots[hole] = index_slots[i];
+			hole = i;
+		}
+	}
+	index_slots[hole].pid = PERSISTENT_INVALID_ID;
+	index_count--;
+}
+
+/* SEGMENTS */
+
+static struct segment *find_segment(uint32_t number)
+{
+	uint32_t low = 0, high = segment_count;
+
+	while (low < high) {
+		const uint32_t mid = low + (high - low) / 2;
+
+		if (segments[mid].number == number)
+			return &segments[mid];
+		if (segments[mid].number < number)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return NULL;
+}
+
+static struct segment *active_segment(void)
+{
+	return &segments[segment_count - 1];
+}
+
+static void get_segment_path(char *buf, size_t len, uint32_t number)
+{
+	snprintf(buf, len, "%s/%0*" PRIu32 SEGMENT_SUFFIX,
+		 storage_directory, SEGMENT_NAME_LENGTH, number);
+}
+
+static int open_segment(uint32_t number, int flags)
+{
+	char path[PATH_MAX];
+
+	get_segment_path(path, sizeof(path), number);
+	return open(path, flags | O_CLOEXEC, 0600);
+}
+
+static void remove_segment(struct segment *segment)
+{
+	char path[PATH_MAX];
+	const uint32_t pos = (uint32_t)(segment - segments);
+
+	get_segment_path(path, sizeof(path), segment->number);
+	if (unlink(path) != 0)
+		LOGF("PersistentStorage: Could not remove \"%s\": %s",
+		     path, strerror(errno));
+	memmove(&segments[pos], &segments[pos + 1],
+		(segment_count - pos - 1) * sizeof(struct segment));
+	segment_count--;
+}
+
+static bool add_segment(uint32_t number, uint32_t size)
+{
+	struct segment *new_segments = realloc(
+		segments,
+		(segment_count + 1) * sizeof(struct segment)
+	);
+
+	if (new_segments == NULL)
+		return false;
+	segments = new_segments;
+	segments[segment_count++] = (struct segment){
+		.number = number,
+		.size = size,
+	};
+	return true;
+}
+
+static bool start_segment(void)
+{
+	const uint32_t number = segment_count
+		? active_segment()->number + 1 : 1;
+	int fd;
+
+	fd = open_segment(number, O_RDWR | O_CREAT | O_TRUNC);
+	if (fd < 0) {
+		LOGF("PersistentStorage: Could not create segment %" PRIu32
+		     ": %s", number, strerror(errno));
+		return false;
+	}
+	if (!add_segment(number, 0)) {
+		close(fd);
+		return false;
+	}
+	if (active_fd >= 0) {
+		/* Moved records must not be lost with their old segment */
+		if (compacting && !PERSISTENT_STORAGE_SYNC &&
+		    fdatasync(active_fd) != 0)
+			LOGF("PersistentStorage: Sync failed: %s",
+			     strerror(errno));
+		close(active_fd);
+	}
+	active_fd = fd;
+	return true;
+}
+
+static bool sync_directory(void)
+{
+	const int fd = open(storage_directory,
+			    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	bool result;
+
+	if (fd < 0)
+		return false;
+	result = fsync(fd) == 0;
+	close(fd);
+	return result;
+}
+
+static bool read_fully(int fd, void *buf, size_t len, off_t offset)
+{
+	uint8_t *pos = buf;
+	ssize_t r;
+
+	while (len) {
+		r = pread(fd, pos, len, offset);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return false;
+		pos += r;
+		len -= r;
+		offset += r;
+	}
+	return true;
+}
+
+static bool write_fully(int fd, const void *buf, size_t len, off_t offset)
+{
+	const uint8_t *pos = buf;
+	ssize_t r;
+
+	while (len) {
+		r = pwrite(fd, pos, len, offset);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r < 0)
+			return false;
+		pos += r;
+		len -= r;
+		offset += r;
+	}
+	return true;
+}
+
+/* RECORDS */
+
+static uint32_t record_crc(const uint8_t *record, size_t size)
+{
+	return crc32(record + RECORD_CRC_OFFSET, size - RECORD_CRC_OFFSET);
+}
+
+static bool record_is_valid(const uint8_t *record, size_t size)
+{
+	const struct record_header *header =
+		(const struct record_header *)record;
+
+	return (
+		size >= sizeof(struct record_header) &&
+		header->magic == RECORD_MAGIC &&
+		size - sizeof(struct record_header) == header->length &&
+		(header->type == RECORD_PUT || header->type == RECORD_DEL) &&
+		header->pid != PERSISTENT_INVALID_ID &&
+		header->crc == record_crc(record, size)
+	);
+}
+
+/*
+ * Appends the record to the active segment. The record must start with a
+ * filled-in header, the CRC is calculated here.
+ */
+static bool append_record(uint8_t *record, uint32_t size,
+			  uint32_t *segment_number, uint32_t *offset)
+{
+	struct record_header *header = (struct record_header *)record;
+	struct segment *active = active_segment();
+
+	if (active->size != 0 &&
+	    (uint64_t)active->size + size > PERSISTENT_STORAGE_SEGMENT_SIZE) {
+		if (!start_segment())
+			return false;
+		active = active_segment();
+	}
+
+	header->magic = RECORD_MAGIC;
+	header->crc = record_crc(record, size);
+	if (!write_fully(active_fd, record, size, active->size)) {
+		LOGF("PersistentStorage: Write failed: %s", strerror(errno));
+		/* Do not leave a partial record in front of the next one */
+		if (ftruncate(active_fd, active->size) != 0)
+			LOG("PersistentStorage: Could not truncate segment");
+		return false;
+	}
+	if (PERSISTENT_STORAGE_SYNC && fdatasync(active_fd) != 0)
+		LOGF("PersistentStorage: Sync failed: %s", strerror(errno));
+
+	*segment_number = active->number;
+	*offset = active->size;
+	active->size += size;
+	return true;
+}
+
+/* Marks the record referenced by the entry as no longer live. */
+static void release_record(const struct index_entry *entry)
+{
+	struct segment *segment = find_segment(entry->segment);
+
+	if (segment != NULL) {
+		ASSERT(segment->live >= entry->size);
+		segment->live -= entry->size;
+	}
+}
+
+static bool index_put(persistentid_t pid, uint32_t segment_number,
+		      uint32_t offset, uint32_t size, uint64_t expiration_s)
+{
+	struct index_entry *entry = index_find(pid);
+
+	if (entry != NULL) {
+		release_record(entry);
+	} else {
+		/* Keep the load factor below 3/4 */
+		if ((index_count + 1) * 4 > index_capacity * 3 &&
+		    !index_grow())
+			return false;
+		entry = index_insert_slot(pid);
+		index_count++;
+	}
+	*entry = (struct index_entry){
+		.pid = pid,
+		.segment = segment_number,
+		.offset = offset,
+		.size = size,
+		.expiration_s = expiration_s,
+	};
+	find_segment(segment_number)->live += size;
+	return true;
+}
+
+static void delete_entry(struct index_entry *entry)
+{
+	struct record_header header = {
+		.pid = entry->pid,
+		.type = RECORD_DEL,
+	};
+	uint32_t segment_number, offset;
+
+	if (append_record((uint8_t *)&header, sizeof(header),
+			  &segment_number, &offset))
+		find_segment(segment_number)->tombstones += sizeof(header);
+	release_record(entry);
+	index_remove(entry);
+}
+
+/* Returns a new descriptor of the segment, valid even if it is removed */
+static int get_segment_fd(uint32_t number)
+{
+	if (number == active_segment()->number)
+		return fcntl(active_fd, F_DUPFD_CLOEXEC, 0);
+	return open_segment(number, O_RDONLY);
+}
+
+/* Reads the record referenced by the entry into a newly allocated buffer. */
+static uint8_t *read_record_from(int fd, const struct index_entry *entry)
+{
+	uint8_t *record = malloc(entry->size);
+
+	if (record == NULL)
+		return NULL;
+	if (!read_fully(fd, record, entry->size, entry->offset) ||
+	    !record_is_valid(record, entry->size) ||
+	    ((struct record_header *)record)->pid != entry->pid) {
+		LOGF("PersistentStorage: Record %" PRIu32 " is corrupted",
+		     entry->pid);
+		free(record);
+		return NULL;
+	}
+	return record;
+}
+
+static uint8_t *read_record(const struct index_entry *entry)
+{
+	const int fd = get_segment_fd(entry->segment);
+	uint8_t *record;
+
+	if (fd < 0)
+		return NULL;
+	record = read_record_from(fd, entry);
+	close(fd);
+	return record;
+}
+
+/* STARTUP */
+
+/*
+ * Reads all records of the segment and applies them to the index.
+ * If the segment is the last one, a damaged tail is cut off.
+ */
+static void scan_segment(struct segment *segment, bool is_last)
+{
+	struct record_header header;
+	uint8_t *record;
+	struct stat st;
+	off_t offset = 0;
+	int fd;
+
+	fd = open_segment(segment->number, O_RDWR);
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		LOGF("PersistentStorage: Could not open segment %" PRIu32,
+		     segment->number);
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+
+	while (offset + (off_t)sizeof(header) <= st.st_size) {
+		if (!read_fully(fd, &header, sizeof(header), offset) ||
+		    header.magic != RECORD_MAGIC ||
+		    header.length >
+			(uint64_t)(st.st_size - offset) - sizeof(header))
+			break;
+
+		const uint32_t size = sizeof(header) + header.length;
+
+		record = malloc(size);
+		if (record == NULL ||
+		    !read_fully(fd, record, size, offset) ||
+		    !record_is_valid(record, size)) {
+			free(record);
+			break;
+		}
+		free(record);
+
+		if (header.type == RECORD_PUT) {
+			index_put(header.pid, segment->number, offset, size,
+				  header.expiration_s);
+		} else {
+			struct index_entry *entry = index_find(header.pid);
+
+			if (entry != NULL) {
+				release_record(entry);
+				index_remove(entry);
+			}
+			segment->tombstones += size;
+		}
+		if (header.pid >= next_pid)
+			next_pid = header.pid + 1;
+		offset += size;
+	}
+
+	segment->size = offset;
+	if (offset != st.st_size) {
+		LOGF("PersistentStorage: Segment %" PRIu32 " damaged at offset %lld",
+		     segment->number, (long long)offset);
+		if (is_last && ftruncate(fd, offset) != 0)
+			LOG("PersistentStorage: Could not truncate segment");
+	}
+	close(fd);
+}
+
+static int compare_segments(const void *a, const void *b)
+{
+	const uint32_t na = ((const struct segment *)a)->number;
+	const uint32_t nb = ((const struct segment *)b)->number;
+
+	return (na > nb) - (na < nb);
+}
+
+static bool list_segments(void)
+{
+	const size_t suffix_len = strlen(SEGMENT_SUFFIX);
+	DIR *dir = opendir(storage_directory);
+	struct dirent *e;
+	char *end;
+	unsigned long number;
+
+	if (dir == NULL)
+		return false;
+	while ((e = readdir(dir)) != NULL) {
+		if (strlen(e->d_name) != SEGMENT_NAME_LENGTH + suffix_len ||
+		    strcmp(e->d_name + SEGMENT_NAME_LENGTH,
+			   SEGMENT_SUFFIX) != 0)
+			continue;
+		number = strtoul(e->d_name, &end, 10);
+		if (end != e->d_name + SEGMENT_NAME_LENGTH || number == 0 ||
+		    number > UINT32_MAX)
+			continue;
+		if (!add_segment((uint32_t)number, 0)) {
+			closedir(dir);
+			return false;
+		}
+	}
+	closedir(dir);
+	if (segment_count)
+		qsort(segments, segment_count, sizeof(struct segment),
+		      compare_segments);
+	return true;
+}
+
+/* API */
+
+enum ud3tn_result persistent_storage_init(const char *directory)
+{
+	uint32_t i;
+
+	ASSERT(storage_directory == NULL);
+	if (mkdir(directory, 0700) != 0 && errno != EEXIST) {
+		LOGF("PersistentStorage: Could not create \"%s\": %s",
+		     directory, strerror(errno));
+		return UD3TN_FAIL;
+	}
+	storage_directory = strdup(directory);
+	if (storage_directory == NULL)
+		return UD3TN_FAIL;
+	storage_semaphore = hal_semaphore_init_binary();
+	if (!list_segments() || !index_grow())
+		goto fail;
+
+	for (i = 0; i < segment_count; i++)
+		scan_segment(&segments[i], i == segment_count - 1);
+
+	LOGF("PersistentStorage: Found %" PRIu32 " bundle(s) in %" PRIu32
+	     " segment(s) in \"%s\"", index_count, segment_count,
+	     directory);
+
+	/* Continue appending to the last segment */
+	if (segment_count)
+		active_fd = open_segment(active_segment()->number, O_RDWR);
+	if (active_fd < 0 && !start_segment())
+		goto fail;
+	hal_semaphore_release(storage_semaphore);
+	return UD3TN_OK;
+
+fail:
+	LOGF("PersistentStorage: Could not open \"%s\"", directory);
+	hal_semaphore_release(storage_semaphore);
+	persistent_storage_deinit();
+	return UD3TN_FAIL;
+}
+
+void persistent_storage_deinit(void)
+{
+	if (storage_directory == NULL)
+		return;
+	hal_semaphore_take_blocking(storage_semaphore);
+	if (active_fd >= 0)
+		close(active_fd);
+	active_fd = -1;
+	free(segments);
+	segments = NULL;
+	segment_count = 0;
+	free(index_slots);
+	index_slots = NULL;
+	index_capacity = 0;
+	index_count = 0;
+	next_pid = 1;
+	free(storage_directory);
+	storage_directory = NULL;
+	hal_semaphore_delete(storage_semaphore);
+	storage_semaphore = NULL;
+}
+
+bool persistent_storage_is_enabled(void)
+{
+	return storage_directory != NULL;
+}
+
+struct serialize_buffer {
+	uint8_t *data;
+	size_t length;
+	size_t capacity;
+	bool failed;
+};
+
+static void write_to_buffer(void *param, const void *data, const size_t len)
+{
+	struct serialize_buffer *buf = param;
+	uint8_t *new_data;
+
+	if (buf->failed)
+		return;
+	if (buf->length + len > buf->capacity) {
+		new_data = realloc(buf->data, buf->length + len);
+		if (new_data == NULL) {
+			buf->failed = true;
+			return;
+		}
+		buf->data = new_data;
+		buf->capacity = buf->length + len;
+	}
+	memcpy(buf->data + buf->length, data, len);
+	buf->length += len;
+}
+
+static persistentid_t allocate_pid(void)
+{
+	persistentid_t pid;
+
+	do {
+		pid = next_pid++;
+		if (next_pid == PERSISTENT_INVALID_ID)
+			next_pid = 1;
+	} while (pid == PERSISTENT_INVALID_ID || index_find(pid) != NULL);
+	return pid;
+}
+
+persistentid_t persistent_storage_add(struct bundle *bundle,
+				      persistentid_t pid)
+{
+	struct serialize_buffer buf = {
+		.length = sizeof(struct record_header),
+		.capacity = sizeof(struct record_header) +
+			bundle_get_serialized_size(bundle),
+	};
+	struct record_header *header;
+	uint32_t segment_number, offset;
+
+	if (!persistent_storage_is_enabled())
+		return PERSISTENT_INVALID_ID;
+
+	/* Serialize without holding the lock */
+	buf.data = malloc(buf.capacity);
+	if (buf.data == NULL)
+		return PERSISTENT_INVALID_ID;
+	if (bundle_serialize(bundle, write_to_buffer, &buf) != UD3TN_OK ||
+	    buf.failed || buf.length > UINT32_MAX) {
+		free(buf.data);
+		return PERSISTENT_INVALID_ID;
+	}
+
+	header = (struct record_header *)buf.data;
+	memset(header, 0, sizeof(*header));
+	header->length = buf.length - sizeof(struct record_header);
+	header->expiration_s = bundle_get_expiration_time_s(bundle);
+	header->type = RECORD_PUT;
+	header->ret_constraints = bundle->ret_constraints &
+		PERSISTENT_STORAGE_RETAINED_CONSTRAINTS;
+
+	hal_semaphore_take_blocking(storage_semaphore);
+	if (pid == PERSISTENT_INVALID_ID)
+		pid = allocate_pid();
+	header->pid = pid;
+	if (!append_record(buf.data, buf.length, &segment_number, &offset) ||
+	    !index_put(pid, segment_number, offset, buf.length,
+		       header->expiration_s))
+		pid = PERSISTENT_INVALID_ID;
+	hal_semaphore_release(storage_semaphore);
+
+	free(buf.data);
+	return pid;
+}
+
+void persistent_storage_delete(persistentid_t pid)
+{
+	struct index_entry *entry;
+
+	if (!persistent_storage_is_enabled() || pid == PERSISTENT_INVALID_ID)
+		return;
+	hal_semaphore_take_blocking(storage_semaphore);
+	entry = index_find(pid);
+	if (entry != NULL)
+		delete_entry(entry);
+	hal_semaphore_release(storage_semaphore);
+}
+
+static void parsed_bundle(struct bundle *bundle, void *param)
+{
+	*(struct bundle **)param = bundle;
+}
+
+static struct bundle *parse_bundle(const uint8_t *data, size_t length)
+{
+	struct bundle *result = NULL;
+	struct bundle6_parser p6;
+	struct bundle7_parser p7;
+	struct parser *basedata;
+	size_t parsed = 0, n;
+
+	/* BPv6 starts with the version byte, BPv7 with an indef. array */
+	if (length == 0)
+		return NULL;
+	if (data[0] == 6)
+		basedata = bundle6_parser_init(&p6, parsed_bundle, &result);
+	else
+		basedata = bundle7_parser_init(&p7, parsed_bundle, &result);
+	if (basedata == NULL)
+		return NULL;
+	if (data[0] != 6)
+		p7.bundle_quota = BUNDLE_QUOTA;
+
+	while (parsed < length && basedata->status == PARSER_STATUS_GOOD) {
+		if (data[0] == 6)
+			n = bundle6_parser_read(&p6, data + parsed,
+						length - parsed);
+		else
+			n = bundle7_parser_read(&p7, data + parsed,
+						length - parsed);
+		if (n == 0)
+			break;
+		parsed += n;
+	}
+
+	if (data[0] == 6)
+		bundle6_parser_deinit(&p6);
+	else
+		bundle7_parser_deinit(&p7);
+	return result;
+}
+
+static struct bundle *parse_record(const uint8_t *record)
+{
+	const struct record_header *header =
+		(const struct record_header *)record;
+	struct bundle *bundle = parse_bundle(
+		record + sizeof(struct record_header),
+		header->length
+	);
+
+	if (bundle != NULL)
+		bundle->ret_constraints = header->ret_constraints;
+	return bundle;
+}
+
+struct bundle *persistent_storage_load(persistentid_t pid)
+{
+	struct index_entry entry;
+	struct index_entry *found;
+	struct bundle *bundle;
+	uint8_t *record;
+	int fd = -1;
+
+	if (!persistent_storage_is_enabled() || pid == PERSISTENT_INVALID_ID)
+		return NULL;
+
+	/* Only open the segment while holding the lock, the descriptor */
+	/* stays valid if the compaction removes it in the meantime */
+	hal_semaphore_take_blocking(storage_semaphore);
+	found = index_find(pid);
+	if (found != NULL) {
+		entry = *found;
+		fd = get_segment_fd(entry.segment);
+	}
+	hal_semaphore_release(storage_semaphore);
+	if (fd < 0)
+		return NULL;
+
+	record = read_record_from(fd, &entry);
+	close(fd);
+	if (record == NULL)
+		return NULL;
+	bundle = parse_record(record);
+	free(record);
+	if (bundle == NULL)
+		LOGI("PersistentStorage: Could not parse bundle", pid);
+	return bundle;
+}
+
+uint32_t persistent_storage_restore(
+	void (*callback)(struct bundle *bundle, persistentid_t pid,
+			 void *param),
+	void *param)
+{
+	persistentid_t *pids;
+	struct index_entry *entry;
+	struct bundle *bundle;
+	uint8_t *record;
+	uint32_t pid_count = 0, restored = 0, i;
+	const uint64_t now = hal_time_get_timestamp_s();
+
+	if (!persistent_storage_is_enabled())
+		return 0;
+
+	/* The callback may add bundles, so do not iterate the index */
+	hal_semaphore_take_blocking(storage_semaphore);
+	pids = malloc((index_count + 1) * sizeof(persistentid_t));
+	if (pids != NULL) {
+		for (i = 0; i < index_capacity; i++) {
+			if (index_slots[i].pid != PERSISTENT_INVALID_ID)
+				pids[pid_count++] = index_slots[i].pid;
+		}
+	}
+	hal_semaphore_release(storage_semaphore);
+	if (pids == NULL)
+		return 0;
+
+	for (i = 0; i < pid_count; i++) {
+		hal_semaphore_take_blocking(storage_semaphore);
+		entry = index_find(pids[i]);
+		record = NULL;
+		if (entry != NULL && entry->expiration_s < now) {
+			LOGI("PersistentStorage: Dropping expired bundle",
+			     pids[i]);
+			delete_entry(entry);
+		} else if (entry != NULL) {
+			record = read_record(entry);
+			if (record == NULL)
+				delete_entry(entry);
+		}
+		hal_semaphore_release(storage_semaphore);
+		if (record == NULL)
+			continue;
+
+		bundle = parse_record(record);
+		free(record);
+		if (bundle == NULL) {
+			LOGI("PersistentStorage: Could not parse bundle",
+			     pids[i]);
+			persistent_storage_delete(pids[i]);
+			continue;
+		}
+		callback(bundle, pids[i], param);
+		restored++;
+	}
+	free(pids);
+	return restored;
+}
+
+/* Copies the record to the active segment. */
+static bool move_record(const uint8_t *data, uint32_t size)
+{
+	/* The record may be unaligned within the batch */
+	uint8_t *record = malloc(size);
+	const struct record_header *header =
+		(const struct record_header *)record;
+	uint32_t segment_number, new_offset;
+	bool success = false;
+
+	if (record == NULL)
+		return false;
+	memcpy(record, data, size);
+	if (record_is_valid(record, size) &&
+	    append_record(record, size, &segment_number, &new_offset)) {
+		if (header->type == RECORD_PUT) {
+			success = index_put(header->pid, segment_number,
+					    new_offset, size,
+					    header->expiration_s);
+		} else {
+			find_segment(segment_number)->tombstones += size;
+			success = true;
+		}
+	}
+	free(record);
+	return success;
+}
+
+/*
+ * Reads the records of the segment starting at the given offset, up to
+ * PERSISTENT_STORAGE_COMPACTION_BATCH_SIZE bytes but at least one record.
+ */
+static uint8_t *read_batch(int fd, uint32_t offset, uint32_t segment_size,
+			   uint32_t *length)
+{
+	struct record_header header;
+	uint32_t size = segment_size - offset;
+	uint8_t *batch;
+
+	if (size > PERSISTENT_STORAGE_COMPACTION_BATCH_SIZE) {
+		if (!read_fully(fd, &header, sizeof(header), offset) ||
+		    header.length > size - sizeof(header))
+			return NULL;
+		size = MAX(sizeof(header) + header.length,
+			   PERSISTENT_STORAGE_COMPACTION_BATCH_SIZE);
+	}
+	batch = malloc(size);
+	if (batch == NULL || !read_fully(fd, batch, size, offset)) {
+		free(batch);
+		return NULL;
+	}
+	*length = size;
+	return batch;
+}
+
+/*
+ * Moves the live records of the batch read from the given offset of the
+ * segment to the active segment. Has to be called while holding the lock,
+ * so that the index cannot change between checking and moving a record.
+ * Returns the number of bytes of the complete records in the batch.
+ */
+static uint32_t compact_batch(const uint8_t *batch, uint32_t length,
+			      uint32_t number, uint32_t offset,
+			      bool is_oldest, uint64_t now)
+{
+	struct record_header header;
+	struct index_entry *entry;
+	uint32_t pos = 0, size;
+
+	while (length - pos >= sizeof(header)) {
+		memcpy(&header, batch + pos, sizeof(header));
+		if (header.length > length - pos - sizeof(header))
+			break;
+		size = sizeof(header) + header.length;
+
+		if (header.type == RECORD_PUT) {
+			entry = index_find(header.pid);
+			/* Only the latest record of a bundle is live */
+			if (entry != NULL && entry->segment == number &&
+			    entry->offset == offset + pos) {
+				if (entry->expiration_s < now) {
+					if (is_oldest) {
+						release_record(entry);
+						index_remove(entry);
+					} else {
+						delete_entry(entry);
+					}
+				} else if (!move_record(batch + pos, size)) {
+					return 0;
+				}
+			}
+		} else if (!is_oldest && !move_record(batch + pos, size)) {
+			return 0;
+		}
+		pos += size;
+	}
+	return pos;
+}
+
+/*
+ * Moves the live records of the segment to the active segment and removes
+ * it. Called without holding the lock: the immutable segment is read in
+ * batches, only checking and moving the records of a batch is done while
+ * holding it, so that bundles can be persisted in between.
+ */
+static bool compact_segment(uint32_t number, uint32_t segment_size,
+			    bool is_oldest, uint64_t now)
+{
+	struct segment *segment;
+	uint8_t *batch;
+	uint32_t first_active, offset = 0, length, moved;
+	bool rotated;
+	int fd = open_segment(number, O_RDONLY);
+	int sync_fd;
+
+	if (fd < 0)
+		goto fail;
+
+	hal_semaphore_take_blocking(storage_semaphore);
+	first_active = active_segment()->number;
+	hal_semaphore_release(storage_semaphore);
+
+	while (offset < segment_size) {
+		batch = read_batch(fd, offset, segment_size, &length);
+		if (batch == NULL)
+			goto fail;
+		hal_semaphore_take_blocking(storage_semaphore);
+		moved = compact_batch(batch, length, number, offset,
+				      is_oldest, now);
+		hal_semaphore_release(storage_semaphore);
+		free(batch);
+		if (moved == 0)
+			goto fail;
+		offset += moved;
+	}
+	close(fd);
+	fd = -1;
+
+	/*
+	 * The moved records have to be on disk before the segment holding
+	 * their only other copy is removed. Segments started meanwhile also
+	 * need their directory entries to be durable.
+	 */
+	hal_semaphore_take_blocking(storage_semaphore);
+	sync_fd = get_segment_fd(active_segment()->number);
+	rotated = active_segment()->number != first_active;
+	hal_semaphore_release(storage_semaphore);
+	if (sync_fd < 0 ||
+	    (!PERSISTENT_STORAGE_SYNC && fdatasync(sync_fd) != 0)) {
+		LOGF("PersistentStorage: Sync failed: %s", strerror(errno));
+		if (sync_fd >= 0)
+			close(sync_fd);
+		goto fail;
+	}
+	close(sync_fd);
+	if (rotated && !sync_directory()) {
+		LOG("PersistentStorage: Could not sync the storage directory");
+		goto fail;
+	}
+
+	hal_semaphore_take_blocking(storage_semaphore);
+	segment = find_segment(number);
+	ASSERT(segment != NULL && segment->live == 0);
+	remove_segment(segment);
+	compacting = false;
+	hal_semaphore_release(storage_semaphore);
+	return true;
+
+fail:
+	LOGF("PersistentStorage: Compaction of segment %" PRIu32 " failed",
+	     number);
+	if (fd >= 0)
+		close(fd);
+	hal_semaphore_take_blocking(storage_semaphore);
+	compacting = false;
+	hal_semaphore_release(storage_semaphore);
+	return false;
+}
+
+bool persistent_storage_compact(void)
+{
+	const uint64_t now = hal_time_get_timestamp_s();
+	struct segment *segment;
+	uint64_t retained;
+	uint32_t i, number = 0, size = 0;
+	bool is_oldest = false, found = false;
+
+	if (!persistent_storage_is_enabled())
+		return false;
+
+	hal_semaphore_take_blocking(storage_semaphore);
+	/* The active segment is never compacted */
+	for (i = 0; !compacting && i + 1 < segment_count; i++) {
+		segment = &segments[i];
+		retained = segment->live;
+		/* Tombstones can only be dropped from the oldest segment */
+		if (i != 0)
+			retained += segment->tombstones;
+		if (segment->size == 0 || retained * 100 <
+		    (uint64_t)segment->size *
+		    PERSISTENT_STORAGE_COMPACTION_THRESHOLD) {
+			number = segment->number;
+			size = segment->size;
+			is_oldest = i == 0;
+			/* Only one compaction at a time, see compact_segment() */
+			compacting = true;
+			found = true;
+			break;
+		}
+	}
+	hal_semaphore_release(storage_semaphore);
+	if (!found)
+		return false;
+	return compact_segment(number, size, is_oldest, now);
+}
+
+#else /* PLATFORM_POSIX */
+
+enum ud3tn_result persistent_storage_init(const char *directory)
+{
+	(void)directory;
+	LOG("PersistentStorage: Not supported on this platform");
+	return UD3TN_FAIL;
+}
+
+void persistent_storage_deinit(void)
+{
+}
+
+bool persistent_storage_is_enabled(void)
+{
+	return false;
+}
+
+persistentid_t persistent_storage_add(struct bundle *bundle,
+				      persistentid_t pid)
+{
+	(void)bundle;
+	(void)pid;
+	return PERSISTENT_INVALID_ID;
+}
+
+void persistent_storage_delete(persistentid_t pid)
+{
+	(void)pid;
+}
+
+struct bundle *persistent_storage_load(persistentid_t pid)
+{
+	(void)pid;
+	return NULL;
+}
+
+uint32_t persistent_storage_restore(
+	void (*callback)(struct bundle *bundle, persistentid_t pid,
+			 void *param),
+	void *param)
+{
+	(void)callback;
+	(void)param;
+	return 0;
+}
+
+bool persistent_storage_compact(void)
+{
+	return false;
+}
+
+#endif /* PLATFORM_POSIX */
+
+void persistent_storage_compaction_task(void *param)
+{
+	(void)param;
+
+	for (;;) {
+		hal_task_delay(PERSISTENT_STORAGE_COMPACTION_INTERVAL);
+		while (persistent_storage_compact())
+			;
+	}
+}
@@ -0,0 +1,135 @@
+#include "ud3tn/common.h"
+#include "ud3tn/config.h"
+#include "ud3tn/pool.h"
+
+#include "platform/hal_io.h"
+#include "platform/hal_semaphore.h"
+
+#ifdef PLATFORM_ZEPHYR
+#include "platform/hal_heap.h"
+#endif // PLATFORM_ZEPHYR
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define POOL_ALIGNMENT sizeof(union { void *p; uint64_t u; double d; })
+
+struct free_object {
+	struct free_object *next;
+};
+
+static size_t get_slot_size(const struct pool *pool)
+{
+	size_t size = pool->object_size;
+
+	if (size < sizeof(struct free_object))
+		size = sizeof(struct free_object);
+	return (size + POOL_ALIGNMENT - 1) & ~(POOL_ALIGNMENT - 1);
+}
+
+static void lock_pool(struct pool *pool)
+{
+	Semaphore_t sem = __atomic_load_n(&pool->semaphore, __ATOMIC_ACQUIRE);
+	Semaphore_t expected = NULL;
+
+	if (sem != NULL) {
+		hal_semaphore_take_blocking(sem);
+		return;
+	}
+	/* The semaphore is created in the taken state */
+	sem = hal_semaphore_init_binary();
+	ASSERT(sem != NULL);
+	if (__atomic_compare_exchange_n(&pool->semaphore, &expected, sem,
+					false, __ATOMIC_ACQ_REL,
+					__ATOMIC_ACQUIRE))
+		return;
+	/* Another task has been faster */
+	hal_semaphore_delete(sem);
+	hal_semaphore_take_blocking(expected);
+}
+
+static void unlock_pool(struct pool *pool)
+{
+	hal_semaphore_release(pool->semaphore);
+}
+
+static int8_t grow_pool(struct pool *pool)
+{
+	const size_t slot_size = get_slot_size(pool);
+	uint8_t *chunk = malloc(slot_size * OBJECT_POOL_CHUNK_SIZE);
+	struct free_object *object;
+	uint32_t i;
+
+	if (chunk == NULL)
+		return 0;
+	for (i = 0; i < OBJECT_POOL_CHUNK_SIZE; i++) {
+		object = (struct free_object *)(chunk + i * slot_size);
+		object->next = pool->free_list;
+		pool->free_list = object;
+	}
+	pool->stats.capacity += OBJECT_POOL_CHUNK_SIZE;
+	pool->stats.heap_allocations++;
+	return 1;
+}
+
+void *pool_alloc(struct pool *pool)
+{
+	struct free_object *object = NULL;
+
+	lock_pool(pool);
+	if (OBJECT_POOL_CHUNK_SIZE == 0) {
+		object = malloc(pool->object_size);
+		if (object != NULL) {
+			pool->stats.capacity++;
+			pool->stats.heap_allocations++;
+		}
+	} else if (pool->free_list != NULL || grow_pool(pool)) {
+		object = pool->free_list;
+		pool->free_list = object->next;
+	}
+	if (object != NULL) {
+		pool->stats.allocations++;
+		if (++pool->stats.in_use > pool->stats.peak)
+			pool->stats.peak = pool->stats.in_use;
+	}
+	unlock_pool(pool);
+	return object;
+}
+
+void pool_free(struct pool *pool, void *object)
+{
+	struct free_object *entry = object;
+
+	if (object == NULL)
+		return;
+	lock_pool(pool);
+	ASSERT(pool->stats.in_use != 0);
+	pool->stats.in_use--;
+	if (OBJECT_POOL_CHUNK_SIZE == 0) {
+		pool->stats.capacity--;
+		free(object);
+	} else {
+		entry->next = pool->free_list;
+		pool->free_list = entry;
+	}
+	unlock_pool(pool);
+}
+
+void pool_get_stats(struct pool *pool, struct pool_stats *stats)
+{
+	lock_pool(pool);
+	*stats = pool->stats;
+	unlock_pool(pool);
+}
+
+void pool_log_stats(struct pool *pool)
+{
+	struct pool_stats stats;
+
+	pool_get_stats(pool, &stats);
+	LOGF("Pool %s: %lu in use (peak %lu), capacity %lu, %lu allocations, %lu from heap",
+	     pool->name,
+	     (unsigned long)stats.in_use, (unsigned long)stats.peak,
+	     (unsigned long)stats.capacity, (unsigned long)stats.allocations,
+	     (unsigned long)stats.heap_allocations);
+}
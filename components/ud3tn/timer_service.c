@@ -0,0 +1,145 @@
+#include "ud3tn/common.h"
+#include "ud3tn/timer_service.h"
+#include "ud3tn/timing_wheel.h"
+
+#include "platform/hal_semaphore.h"
+#include "platform/hal_time.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static Semaphore_t service_semaphore;
+static struct timing_wheel wheel;
+/* The time the wheel has been advanced to, read without the lock */
+static uint64_t service_time;
+
+static void lock_service(void)
+{
+	Semaphore_t sem = __atomic_load_n(&service_semaphore, __ATOMIC_ACQUIRE);
+	Semaphore_t expected = NULL;
+
+	if (sem != NULL) {
+		hal_semaphore_take_blocking(sem);
+		return;
+	}
+	/* The semaphore is created in the taken state */
+	sem = hal_semaphore_init_binary();
+	ASSERT(sem != NULL);
+	if (__atomic_compare_exchange_n(&service_semaphore, &expected, sem,
+					false, __ATOMIC_ACQ_REL,
+					__ATOMIC_ACQUIRE)) {
+		/* The wheel starts at the time of its first use */
+		timing_wheel_init(&wheel, hal_time_get_timestamp_s());
+		__atomic_store_n(&service_time, wheel.time, __ATOMIC_RELEASE);
+		return;
+	}
+	/* Another task has been faster */
+	hal_semaphore_delete(sem);
+	hal_semaphore_take_blocking(expected);
+}
+
+static void unlock_service(void)
+{
+	hal_semaphore_release(service_semaphore);
+}
+
+void timer_queue_init(struct timer_queue *queue)
+{
+	__atomic_store_n(&queue->head, NULL, __ATOMIC_RELEASE);
+	queue->tail = NULL;
+}
+
+/* Invoked by the wheel with the lock held, the link of the timer is free */
+static void move_to_queue(struct timer *timer, void *context)
+{
+	struct timer_queue *queue = context;
+
+	timer->next = NULL;
+	if (queue->tail != NULL)
+		queue->tail->next = timer;
+	else
+		__atomic_store_n(&queue->head, timer, __ATOMIC_RELEASE);
+	queue->tail = timer;
+}
+
+void timer_service_init_timer(struct timer *timer, struct timer_queue *queue)
+{
+	timer_init(timer, move_to_queue, queue);
+}
+
+void timer_service_add(struct timer *timer, uint64_t deadline)
+{
+	lock_service();
+	timing_wheel_add(&wheel, timer, deadline);
+	unlock_service();
+}
+
+void timer_service_cancel(struct timer *timer)
+{
+	lock_service();
+	timing_wheel_cancel(&wheel, timer);
+	unlock_service();
+}
+
+uint32_t timer_service_advance(uint64_t now)
+{
+	uint32_t expired;
+
+	/* Only the first caller in a second has to process the wheel */
+	if (__atomic_load_n(&service_time, __ATOMIC_ACQUIRE) >= now)
+		return 0;
+	lock_service();
+	expired = timing_wheel_advance(&wheel, now);
+	__atomic_store_n(&service_time, wheel.time, __ATOMIC_RELEASE);
+	unlock_service();
+	return expired;
+}
+
+struct timer *timer_service_pop(struct timer_queue *queue, uint64_t now)
+{
+	struct timer *timer;
+
+	/* Reading the head without the lock only may miss a new timer */
+	if (__atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == NULL)
+		return NULL;
+	lock_service();
+	timer = queue->head;
+	if (timer != NULL && timer->deadline >= now) {
+		timer = NULL;
+	} else if (timer != NULL) {
+		__atomic_store_n(&queue->head, timer->next, __ATOMIC_RELEASE);
+		if (timer->next == NULL)
+			queue->tail = NULL;
+		timer->next = NULL;
+	}
+	unlock_service();
+	return timer;
+}
+
+void timer_service_clear(struct timer_queue *queue)
+{
+	lock_service();
+	timer_queue_init(queue);
+	unlock_service();
+}
+
+uint32_t timer_service_count(void)
+{
+	uint32_t count;
+
+	lock_service();
+	count = timing_wheel_count(&wheel);
+	unlock_service();
+	return count;
+}
+
+uint64_t timer_service_time(void)
+{
+	uint64_t time;
+
+	lock_service();
+	time = wheel.time;
+	unlock_service();
+	return time;
+}
@@ -0,0 +1,194 @@
+#include "ud3tn/common.h"
+#include "ud3tn/timing_wheel.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SLOT_MASK (TIMING_WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level) ((level) * TIMING_WHEEL_SLOT_BITS)
+/* Largest distance to the current time which can be sorted into a slot */
+#define MAX_DISTANCE \
+	((UINT64_C(1) << LEVEL_SHIFT(TIMING_WHEEL_LEVELS)) - 1)
+
+void timer_init(struct timer *timer, timer_callback_t callback,
+		void *context)
+{
+	timer->next = NULL;
+	timer->pprev = NULL;
+	timer->deadline = 0;
+	timer->callback = callback;
+	timer->context = context;
+}
+
+void timing_wheel_init(struct timing_wheel *wheel, uint64_t now)
+{
+	int level, slot;
+
+	for (level = 0; level < TIMING_WHEEL_LEVELS; level++) {
+		for (slot = 0; slot < TIMING_WHEEL_SLOTS; slot++)
+			wheel->slots[level][slot] = NULL;
+		wheel->occupied[level] = 0;
+	}
+	wheel->time = now;
+	wheel->count = 0;
+}
+
+static void link_timer(struct timing_wheel *wheel, struct timer *timer,
+		       int level, int slot)
+{
+	struct timer **head = &wheel->slots[level][slot];
+
+	timer->next = *head;
+	if (timer->next != NULL)
+		timer->next->pprev = &timer->next;
+	timer->pprev = head;
+	*head = timer;
+	wheel->occupied[level] |= UINT64_C(1) << slot;
+}
+
+static void unlink_timer(struct timing_wheel *wheel, struct timer *timer)
+{
+	*timer->pprev = timer->next;
+	if (timer->next != NULL)
+		timer->next->pprev = timer->pprev;
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+/* Timers due before wheel->time are sorted into the slot processed next */
+static void sort_in(struct timing_wheel *wheel, struct timer *timer)
+{
+	uint64_t expires = timer->deadline;
+	uint64_t distance;
+	int level;
+
+	if (expires < wheel->time)
+		expires = wheel->time;
+	distance = expires - wheel->time;
+	if (distance > MAX_DISTANCE) {
+		/* Sorted in again when its slot of the last level is due */
+		distance = MAX_DISTANCE;
+		expires = wheel->time + MAX_DISTANCE;
+	}
+	for (level = 0; level < TIMING_WHEEL_LEVELS - 1; level++) {
+		if (distance < (UINT64_C(1) << LEVEL_SHIFT(level + 1)))
+			break;
+	}
+	link_timer(wheel, timer, level,
+		   (expires >> LEVEL_SHIFT(level)) & SLOT_MASK);
+}
+
+/* Detaches the list of the slot, the timers keep pointing into it */
+static struct timer *take_slot(struct timing_wheel *wheel, int level,
+			       int slot, struct timer **list)
+{
+	*list = wheel->slots[level][slot];
+	wheel->slots[level][slot] = NULL;
+	wheel->occupied[level] &= ~(UINT64_C(1) << slot);
+	if (*list != NULL)
+		(*list)->pprev = list;
+	return *list;
+}
+
+void timing_wheel_add(struct timing_wheel *wheel, struct timer *timer,
+		      uint64_t deadline)
+{
+	if (timer_is_pending(timer))
+		unlink_timer(wheel, timer);
+	else
+		wheel->count++;
+	timer->deadline = deadline;
+	sort_in(wheel, timer);
+}
+
+void timing_wheel_cancel(struct timing_wheel *wheel, struct timer *timer)
+{
+	if (!timer_is_pending(timer))
+		return;
+	unlink_timer(wheel, timer);
+	ASSERT(wheel->count != 0);
+	wheel->count--;
+}
+
+/* Moves the timers of the higher-level slots due at wheel->time down */
+static void cascade(struct timing_wheel *wheel)
+{
+	struct timer *list, *timer;
+	int level, slot;
+
+	for (level = 1; level < TIMING_WHEEL_LEVELS; level++) {
+		slot = (wheel->time >> LEVEL_SHIFT(level)) & SLOT_MASK;
+		take_slot(wheel, level, slot, &list);
+		while ((timer = list) != NULL) {
+			unlink_timer(wheel, timer);
+			sort_in(wheel, timer);
+		}
+		/* The next level only turns if this one has wrapped around */
+		if (slot != 0)
+			break;
+	}
+}
+
+/*
+ * Determines the first second from wheel->time on at which a slot is due,
+ * i.e. has to be expired (level 0) or cascaded (higher levels). The slots
+ * of the current rotation of a level which have already been passed hold
+ * timers of its next rotation.
+ */
+static uint64_t next_due(const struct timing_wheel *wheel)
+{
+	uint64_t due = UINT64_MAX;
+	uint64_t rotation, offset, pending, candidate;
+	int level;
+
+	for (level = 0; level < TIMING_WHEEL_LEVELS; level++) {
+		if (wheel->occupied[level] == 0)
+			continue;
+		rotation = wheel->time &
+			~((UINT64_C(1) << LEVEL_SHIFT(level + 1)) - 1);
+		/* The first slot of the level which has not been passed */
+		offset = (wheel->time - rotation +
+			  (UINT64_C(1) << LEVEL_SHIFT(level)) - 1) >>
+			LEVEL_SHIFT(level);
+		pending = offset < TIMING_WHEEL_SLOTS
+			? wheel->occupied[level] >> offset << offset : 0;
+		if (pending != 0)
+			candidate = rotation + ((uint64_t)__builtin_ctzll(
+				pending) << LEVEL_SHIFT(level));
+		else
+			candidate = rotation +
+				(UINT64_C(1) << LEVEL_SHIFT(level + 1));
+		if (candidate < due)
+			due = candidate;
+	}
+	return due;
+}
+
+uint32_t timing_wheel_advance(struct timing_wheel *wheel, uint64_t now)
+{
+	struct timer *list, *timer;
+	uint32_t expired = 0;
+	uint64_t due;
+
+	while (wheel->time < now) {
+		/* Seconds in which no slot is due are skipped */
+		due = wheel->count != 0 ? next_due(wheel) : UINT64_MAX;
+		if (due >= now) {
+			wheel->time = now;
+			break;
+		}
+		wheel->time = due;
+		if ((wheel->time & SLOT_MASK) == 0)
+			cascade(wheel);
+		take_slot(wheel, 0, wheel->time & SLOT_MASK, &list);
+		/* Re-armed timers are not due before the next second */
+		wheel->time++;
+		while ((timer = list) != NULL) {
+			unlink_timer(wheel, timer);
+			wheel->count--;
+			expired++;
+			timer->callback(timer, timer->context);
+		}
+	}
+	return expired;
+}
@@ -8,6 +8,7 @@
 #include "ud3tn/parser.h"
 #include "ud3tn/result.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /**
@@ -72,6 +73,15 @@ struct bundle6_parser {
 	void (*send_callback)(struct bundle *, void *);
 	void *send_param;
 
+	/**
+	 * Optional callback invoked with send_param as soon as the primary
+	 * block is parsed. If it returns false, the remaining bytes of the
+	 * bundle are consumed without storing any block data and the bundle
+	 * is dropped. Can be updated at any time.
+	 */
+	bool (*admit_callback)(const struct bundle *, void *);
+	bool discard;
+
 	enum bundle6_parser_error error;
 
 	enum bundle6_parser_stage current_stage;
@@ -11,6 +11,7 @@
 #include "cbor.h"
 
 #include <limits.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 
@@ -68,6 +69,15 @@ struct bundle7_parser {
 	void (*send_callback)(struct bundle *, void *);
 	void *send_param;
 
+	/**
+	 * Optional callback invoked with send_param as soon as the primary
+	 * block is parsed. If it returns false, the remaining bytes of the
+	 * bundle are consumed without storing any block data and the bundle
+	 * is dropped. Can be updated at any time.
+	 */
+	bool (*admit_callback)(const struct bundle *, void *);
+	bool discard;
+
 	struct bundle_block_list **current_block_entry;
 };
 
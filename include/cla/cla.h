@@ -2,6 +2,8 @@
 #define CLA_H_INCLUDED
 
 #include "cla/cla_contact_rx_task.h"
+#include "cla/cla_tx_scheduler.h"
+#include "cla/cla_tx_window.h"
 
 #include "ud3tn/bundle_agent_interface.h"
 #include "ud3tn/crc.h"
@@ -10,8 +12,10 @@
 
 #include "spp/spp_timecodes.h"
 
+#include "platform/hal_executor.h"
 #include "platform/hal_types.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -21,6 +25,12 @@ struct cla_config {
 	const struct cla_vtable *vtable;
 
 	const struct bundle_agent_interface *bundle_agent_interface;
+
+#if HAL_EXECUTOR_WORKERS
+	// Whether the links receive in a work item submitted by the CLA when
+	// data is available instead of an RX task blocking in cla_read()
+	bool event_driven_rx;
+#endif
 };
 
 struct cla_link {
@@ -43,6 +53,28 @@ struct cla_link {
 	QueueIdentifier_t tx_queue_handle;
 	// Semaphore blocking the TX queue while bundles are being added
 	Semaphore_t tx_queue_sem;
+	// Limits the bundles queued for or in transmission
+	struct cla_tx_window tx_window;
+	// Bundles taken from the TX queue, owned by the TX task
+	struct cla_tx_scheduler tx_scheduler;
+#if HAL_EXECUTOR_WORKERS
+	// Work item performing the TX commands instead of a TX task
+	struct hal_work tx_work;
+	// Set if TX_COMMAND_FINALIZE has been taken from the TX queue
+	bool tx_finalizing;
+	// Set after the last run that may access the TX queue
+	bool tx_finalized;
+	// Work item processing received data if config->event_driven_rx
+	struct hal_work rx_work;
+	// Set after the last run that may access the RX data
+	bool rx_finalized;
+	// Submitted once RX and TX have ended, so the link can be cleaned up
+	// without a task waiting in cla_link_wait_cleanup(). Has to be set
+	// before cla_link_init() is called, may be NULL.
+	struct hal_work *closed_work;
+	// Number of RX and TX sides not yet ended
+	uint8_t open_sides;
+#endif
 
     char *cla_link_address;
 };
@@ -50,6 +82,8 @@ struct cla_link {
 struct cla_tx_queue {
 	QueueIdentifier_t tx_queue_handle;
 	Semaphore_t tx_queue_sem;
+	// The link the queue belongs to
+	struct cla_link *link;
 };
 
 /*
@@ -75,6 +109,14 @@ enum ud3tn_result cla_link_init(struct cla_link *link,
 
 void cla_link_wait_cleanup(struct cla_link *link);
 
+#if HAL_EXECUTOR_WORKERS
+/*
+ * Called by the RX and TX sides right before signaling their end. Submits
+ * the closed_work of the link after both of them have ended.
+ */
+void cla_link_side_ended(struct cla_link *link);
+#endif
+
 /**
  * Remove the protocol name from the cla address: "tcp://127.0.0.1:80" -> "127.0.0.1:80"
  */
@@ -131,6 +173,15 @@ struct cla_vtable {
 	void (*cla_send_packet_data)(struct cla_link *,
 				     const void *,
 				     const size_t);
+	/* Optional: Sends what has been buffered for the preceding packets.
+	 * Called before their transmission is reported to the router. */
+	void (*cla_flush)(struct cla_link *);
+	/* Optional: Whether the link can take another packet without
+	 * blocking. If not, the TX work item ends after cla_flush() and has
+	 * to be submitted again by the CLA once the link has drained. Also
+	 * consulted before the TX work item ends after TX_COMMAND_FINALIZE,
+	 * so the CLA can get its output sent first. */
+	bool (*cla_tx_ready)(struct cla_link *);
 
 	// RX Task API
 
@@ -139,7 +190,8 @@ struct cla_vtable {
 							 const uint8_t *,
 							 size_t);
 
-	/* Reads a chunk of data */
+	/* Reads a chunk of data. For event-driven links, UD3TN_OK with zero
+	 * bytes read denotes that no data is available at the moment. */
 	enum ud3tn_result (*cla_read)(struct cla_link *, uint8_t *buffer,
 				      size_t length, size_t *bytes_read);
 
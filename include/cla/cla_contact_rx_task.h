@@ -4,6 +4,9 @@
 #include "bundle6/parser.h"
 #include "bundle7/parser.h"
 
+#include "ud3tn/bundle.h"
+#include "ud3tn/config.h"
+
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -16,6 +19,10 @@ enum cla_payload_type {
 
 #define CLA_RX_BUFFER_SIZE 64
 
+// Forward declarations to prevent (circular) inclusion of cla.h here.
+struct cla_config;
+struct cla_link;
+
 struct rx_task_data {
 	enum cla_payload_type payload_type;
 
@@ -31,6 +38,23 @@ struct rx_task_data {
 		uint8_t *end;
 	} input_buffer;
 
+	/**
+	 * Bytes of the current bulk read already received, to resume it when
+	 * more data becomes available.
+	 */
+	size_t bulk_read_offset;
+
+	/**
+	 * Received bundles an event-driven link could not yet hand over to
+	 * the bundle processor without blocking.
+	 */
+	bundleid_t pending_bundles[CLA_RX_PENDING_BUNDLES];
+	uint8_t pending_count;
+
+	struct cla_config *cla_config;
+	/* Sources starting with the local EID are rejected as spoofed */
+	size_t local_eid_length;
+
 	bool timeout_occured;
 };
 
@@ -41,11 +65,9 @@ size_t select_bundle_parser_version(struct rx_task_data *rx_data,
 				    size_t length);
 
 enum ud3tn_result rx_task_data_init(struct rx_task_data *rx_data,
-				    void *cla_config);
+				    struct cla_config *cla_config);
 void rx_task_data_deinit(struct rx_task_data *rx_data);
 
-// Forward declaration to prevent (circular) inclusion of cla.h here.
-struct cla_link;
 
 /**
  * @brief cla_launch_contact_rx_task Creates a new RX handler task.
@@ -54,4 +76,12 @@ struct cla_link;
  */
 enum ud3tn_result cla_launch_contact_rx_task(struct cla_link *link);
 
+/**
+ * @brief cla_contact_rx_task_wait_exit Waits until the RX handler has ended
+ *        after the link was deactivated. Afterwards, it does not access the
+ *        link anymore.
+ * @param link The link associated to the task
+ */
+void cla_contact_rx_task_wait_exit(struct cla_link *link);
+
 #endif /* CLA_CONTACT_RX_TASK_H_INCLUDED */
@@ -21,6 +21,30 @@ struct cla_contact_tx_task_command {
 
 enum ud3tn_result cla_launch_contact_tx_task(struct cla_link *link);
 
-void cla_contact_tx_task_request_exit(QueueIdentifier_t queue);
+/*
+ * Waits until the TX side of the link has ended after a call to
+ * cla_contact_tx_task_request_exit(). Afterwards, it does not access the
+ * link anymore.
+ */
+void cla_contact_tx_task_wait_exit(struct cla_link *link);
+
+/*
+ * Appends a command to the TX queue, waiting up to timeout milliseconds
+ * (forever if negative) for a free slot, and schedules its execution.
+ * The caller has to hold the tx_queue_sem of the queue.
+ *
+ * A command with bundles is refused immediately if they do not fit into the
+ * transmit window of the link, regardless of the timeout. The window starts
+ * at CONTACT_TX_TASK_QUEUE_LENGTH bundles and grows up to CLA_TX_WINDOW_MAX
+ * while the link keeps up, so a slow link does not stall the caller. The
+ * bundles of a refused command stay with the caller, which has to offer
+ * them again later.
+ */
+enum ud3tn_result cla_contact_tx_task_push(
+	struct cla_tx_queue tx_queue,
+	const struct cla_contact_tx_task_command *command,
+	int timeout);
+
+void cla_contact_tx_task_request_exit(struct cla_link *link);
 
 #endif /* CLA_CONTACT_TX_TASK_H_INCLUDED */
@@ -0,0 +1,78 @@
+#ifndef CLA_TX_SCHEDULER_H_INCLUDED
+#define CLA_TX_SCHEDULER_H_INCLUDED
+
+#include "ud3tn/bundle.h"
+#include "ud3tn/config.h"
+#include "ud3tn/node.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Lanes of the priorities below BUNDLE_RPRIO_HIGH, one per flow */
+#define CLA_TX_SCHEDULER_FAIR_LANES \
+	(BUNDLE_RPRIO_HIGH * CLA_TX_SCHEDULER_FLOWS)
+
+struct cla_tx_lane {
+	struct routed_bundle_list *head;
+	struct routed_bundle_list *tail;
+	/* Bytes the lane may still send in the current round */
+	uint32_t deficit;
+};
+
+/*
+ * Order in which the bundles queued for a link are transmitted. Bundles of
+ * BUNDLE_RPRIO_HIGH (see bundle_get_routing_priority()), which includes
+ * administrative records, are served with strict priority, but at most
+ * CLA_TX_HIGH_BURST bytes in a row while other bundles are waiting, so that
+ * bundles in custody do not starve the link.
+ *
+ * All other bundles are split into flows per priority by their destination
+ * EID, as BPv7 bundles are all of normal priority. The flows share the link by
+ * deficit round robin, i.e., each of them may send CLA_TX_SCHEDULER_QUANTUM
+ * bytes times the weight of its priority per round. Within a lane, bundles
+ * are transmitted in the order they have been enqueued.
+ */
+struct cla_tx_scheduler {
+	struct cla_tx_lane strict;
+	struct cla_tx_lane fair[CLA_TX_SCHEDULER_FAIR_LANES];
+	/* Bytes sent from the strict lane since a fair lane has been served */
+	uint32_t strict_burst;
+	/* Fair lane whose turn it is, and whether it got its quantum already */
+	uint8_t current;
+	bool granted;
+};
+
+void cla_tx_scheduler_init(struct cla_tx_scheduler *scheduler);
+
+/**
+ * @brief Append the bundles to the lanes of their priorities and flows.
+ *
+ * Takes over the list entries. Bundles of the same priority and destination
+ * are transmitted in the order they have been enqueued.
+ */
+void cla_tx_scheduler_enqueue(struct cla_tx_scheduler *scheduler,
+			      struct routed_bundle_list *bundles);
+
+/**
+ * @brief Remove the list entry of the bundle to be transmitted next.
+ *
+ * @return NULL if no bundle is queued.
+ */
+struct routed_bundle_list *cla_tx_scheduler_dequeue(
+	struct cla_tx_scheduler *scheduler);
+
+static inline bool cla_tx_scheduler_is_empty(
+	const struct cla_tx_scheduler *scheduler)
+{
+	int i;
+
+	if (scheduler->strict.head != NULL)
+		return false;
+	for (i = 0; i < CLA_TX_SCHEDULER_FAIR_LANES; i++) {
+		if (scheduler->fair[i].head != NULL)
+			return false;
+	}
+	return true;
+}
+
+#endif /* CLA_TX_SCHEDULER_H_INCLUDED */
@@ -0,0 +1,49 @@
+#ifndef CLA_TX_WINDOW_H_INCLUDED
+#define CLA_TX_WINDOW_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Limits the number of bundles queued for or in transmission via a link.
+ * Producers acquire space for their bundles and are refused instead of
+ * waiting if the window is full. The window starts at
+ * CONTACT_TX_TASK_QUEUE_LENGTH bundles, doubles up to CLA_TX_WINDOW_MAX
+ * after a refusal if the link keeps up, and is halved when a transmission
+ * fails. Producers and the TX side may access it concurrently.
+ */
+struct cla_tx_window {
+	// Bundles queued for or in transmission, limited by size
+	uint32_t outstanding;
+	// Current size of the window, adapted by the TX side
+	uint32_t size;
+	// Set if bundles have been refused because the window was full
+	bool limited;
+};
+
+void cla_tx_window_init(struct cla_tx_window *window);
+
+/**
+ * @brief Reserve space for the given number of bundles.
+ *
+ * A single request exceeding the window is admitted if nothing else is
+ * outstanding, so that it cannot be refused forever.
+ *
+ * @return false if the bundles do not fit into the window.
+ */
+bool cla_tx_window_acquire(struct cla_tx_window *window, uint32_t count);
+
+/**
+ * @brief Return the space of bundles which have been processed by the link.
+ *
+ * @param failed Whether one of them could not be transmitted.
+ */
+void cla_tx_window_release(struct cla_tx_window *window, uint32_t count,
+			   bool failed);
+
+/**
+ * @brief Return the space of bundles which have not been queued after all.
+ */
+void cla_tx_window_cancel(struct cla_tx_window *window, uint32_t count);
+
+#endif /* CLA_TX_WINDOW_H_INCLUDED */
@@ -2,12 +2,17 @@
 #define CLA_TCP_COMMON_H_INCLUDED
 
 #include "cla/cla.h"
+#ifdef CLA_TCP_IO_URING
+#include "cla/posix/cla_tcp_uring.h"
+#endif
 
 #include "ud3tn/bundle_agent_interface.h"
+#include "ud3tn/config.h"
 #include "ud3tn/result.h"
 
 #include "platform/hal_types.h"
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -17,11 +22,37 @@
 #define CLA_OPTION_TCP_ACTIVE "true"
 #define CLA_OPTION_TCP_PASSIVE "false"
 
+/* Part of the output queue of a link */
+struct cla_tcp_tx_chunk {
+	struct cla_tcp_tx_chunk *next;
+	size_t length;
+	size_t capacity;
+	uint8_t data[];
+};
+
 struct cla_tcp_link {
 	struct cla_link base;
 
 	/* The handle for the connected socket */
 	int connection_socket;
+
+	/* Data not yet taken by the socket, see cla_tcp_write() */
+	struct cla_tcp_tx_chunk *tx_head, *tx_tail;
+	/* Bytes of the head chunk that have been sent already */
+	size_t tx_sent;
+	/* Bytes in the output queue */
+	size_t tx_queued;
+	/* An empty chunk of CLA_TCP_TX_BUFFER_SIZE bytes kept for reuse */
+	struct cla_tcp_tx_chunk *tx_spare;
+	/* Whether the TX work item waits for the socket to become writable */
+	bool tx_waiting;
+
+#ifdef CLA_TCP_IO_URING
+	/* Received data if the link is served by the io_uring backend */
+	struct cla_tcp_uring_rx uring_rx;
+	/* Pending send request if the link is served by the io_uring backend */
+	struct cla_tcp_uring_tx uring_tx;
+#endif
 };
 
 struct cla_tcp_config {
@@ -70,6 +101,10 @@ enum ud3tn_result cla_tcp_link_init(
 	struct cla_tcp_link *link, int connected_socket,
 	struct cla_tcp_config *config);
 
+/* Waits for the end of RX and TX via cla_link_wait_cleanup(), then releases
+ * the output queue */
+void cla_tcp_link_wait_cleanup(struct cla_tcp_link *link);
+
 enum ud3tn_result cla_tcp_listen(struct cla_tcp_config *config,
 				 const char *node, const char *service,
 				 int backlog);
@@ -101,10 +136,40 @@ enum ud3tn_result cla_tcp_single_start_scheduled_contact(
 enum ud3tn_result cla_tcp_single_end_scheduled_contact(
 	struct cla_config *config, const char *eid, const char *cla_addr);
 
+/* Sends the buffered packets via cla_tcp_flush() */
+void cla_tcp_flush_packets(struct cla_link *link);
+
+/* Whether the output queue is below CLA_TCP_TX_QUEUE_LIMIT */
+bool cla_tcp_tx_ready(struct cla_link *link);
+
 void cla_tcp_disconnect_handler(struct cla_link *link);
 
 void cla_tcp_single_disconnect_handler(struct cla_link *link);
 
+/**
+ * @brief Send data as part of the current packet.
+ *
+ * Small writes are appended to the output queue of the link. Larger writes
+ * are first offered to the socket together with the queued data, announcing
+ * that the packet continues (MSG_MORE), so they are copied only if the
+ * socket cannot take them right away.
+ *
+ * @return UD3TN_FAIL if sending failed, errno is set accordingly.
+ */
+enum ud3tn_result cla_tcp_write(struct cla_tcp_link *link,
+				const void *data, size_t length);
+
+/**
+ * @brief Send the queued data, e.g., after a batch of packets.
+ *
+ * Never blocks on a non-blocking socket: what the socket cannot take stays
+ * queued, and the reactor submits the TX work item of the link once the
+ * socket is writable again.
+ *
+ * @return UD3TN_FAIL if sending failed, errno is set accordingly.
+ */
+enum ud3tn_result cla_tcp_flush(struct cla_tcp_link *link);
+
 /**
  * @brief Read at most "length" bytes from the interface into a buffer.
  *
@@ -0,0 +1,35 @@
+#ifndef CLA_TCP_REACTOR_H_INCLUDED
+#define CLA_TCP_REACTOR_H_INCLUDED
+
+#include "cla/posix/cla_tcp_common.h"
+
+#include "ud3tn/result.h"
+
+/*
+ * Event loop for the connected sockets of the TCP-based CLAs. Instead of an
+ * RX task blocking in recv() per link, a single task waits for all sockets
+ * with edge-triggered epoll and submits the RX work item of a link when data
+ * arrives or the connection breaks. The TX work item of a link is submitted
+ * when the socket becomes writable while the link has output queued (see
+ * cla_tcp_flush()). With the io_uring backend, epoll is used for the latter
+ * only.
+ *
+ * Only available if HAL_EXECUTOR_WORKERS is non-zero.
+ */
+
+/**
+ * @brief Start watching the non-blocking socket of an initialized link.
+ *
+ * Data that arrived before is reported immediately.
+ */
+enum ud3tn_result cla_tcp_reactor_add(struct cla_tcp_link *link);
+
+/**
+ * @brief Stop watching the socket of the link.
+ *
+ * Must be called before the socket is closed. On return, the reactor does not
+ * access the link anymore.
+ */
+void cla_tcp_reactor_remove(struct cla_tcp_link *link);
+
+#endif // CLA_TCP_REACTOR_H_INCLUDED
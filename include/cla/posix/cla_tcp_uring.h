@@ -0,0 +1,133 @@
+#ifndef CLA_TCP_URING_H_INCLUDED
+#define CLA_TCP_URING_H_INCLUDED
+
+#include "platform/hal_config.h"
+
+#include "ud3tn/result.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#if defined(CLA_TCP_IO_URING) && !HAL_EXECUTOR_WORKERS
+#error "The io_uring backend requires HAL_EXECUTOR_WORKERS to be non-zero"
+#endif
+
+/*
+ * io_uring backend of the TCP reactor (see cla_tcp_reactor.h), enabled by
+ * building with CLA_TCP_IO_URING. Every link has a multishot receive request
+ * that lets the kernel copy arriving data into buffers of a shared, provided
+ * buffer ring. The completions are queued per link and consumed by the RX
+ * work item through cla_tcp_uring_recv(), thus, no system call is necessary
+ * for reading data that has already arrived.
+ *
+ * The output queue of a link is sent by one request at a time, covering all
+ * chunks queued until it is submitted. The completion only records the result
+ * and submits the TX work item, which removes the sent data from the queue
+ * (see cla_tcp_uring_send_result()), so the queue is only accessed by the TX
+ * side. While a request is pending, further packets are queued, thus, a
+ * single system call sends the data of several bundles under load.
+ */
+
+/* Maximum number of queue chunks covered by a send request */
+#define CLA_TCP_URING_TX_IOV_COUNT 16
+
+struct cla_tcp_link;
+
+struct cla_tcp_uring_rx {
+	/* Whether the link is served by the io_uring backend */
+	bool enabled;
+
+	/* Protects the following members against the reactor */
+	pthread_mutex_t lock;
+	/* Signalled when the receive request has ended */
+	pthread_cond_t disarmed;
+
+	/* Whether a receive request is pending in the kernel */
+	bool armed;
+	bool removed;
+	bool eof;
+	/* errno value of a failed receive request, or 0 */
+	int error;
+
+	/* Received buffers not yet consumed, linked by their IDs, or -1 */
+	int32_t head;
+	int32_t tail;
+	/* Number of bytes already consumed from the head buffer */
+	size_t offset;
+};
+
+struct cla_tcp_uring_tx {
+	/* Whether the link is served by the io_uring backend */
+	bool enabled;
+	/* Whether the result of a submitted request has not been taken yet, */
+	/* only accessed by the TX side */
+	bool pending;
+
+	/* Protects the following members against the reactor */
+	pthread_mutex_t lock;
+	/* Signalled when the send request has completed */
+	pthread_cond_t completed;
+
+	/* Whether a send request is pending in the kernel */
+	bool in_flight;
+	bool removed;
+	/* Bytes sent by the last request or the negated errno value */
+	int32_t result;
+
+	/* Arguments of the pending request, referencing the output queue */
+	struct msghdr msg;
+	struct iovec iov[CLA_TCP_URING_TX_IOV_COUNT];
+};
+
+/**
+ * @brief Set up the ring and start the task handling its completions.
+ *
+ * @return UD3TN_FAIL if the kernel does not support the required features.
+ */
+enum ud3tn_result cla_tcp_uring_start(void);
+
+/**
+ * @brief Start receiving from the socket of an initialized link.
+ */
+enum ud3tn_result cla_tcp_uring_add(struct cla_tcp_link *link);
+
+/**
+ * @brief Cancel the requests of the link and release its receive buffers.
+ *
+ * On return, the backend does not access the link anymore.
+ */
+void cla_tcp_uring_remove(struct cla_tcp_link *link);
+
+/**
+ * @brief Read received data of the link, with the semantics of recv().
+ *
+ * Fails with EAGAIN if no data is available. If receiving has been stopped
+ * for lack of buffers, the socket is read directly until it is drained.
+ */
+ssize_t cla_tcp_uring_recv(struct cla_tcp_link *link,
+			   uint8_t *buffer, size_t length);
+
+/**
+ * @brief Send the data referenced by the first iov_count entries of the I/O
+ * vector of the link, which have to stay valid until the result is taken.
+ *
+ * Must only be called by the TX side if no request is pending.
+ */
+void cla_tcp_uring_send(struct cla_tcp_link *link, size_t iov_count,
+			int flags);
+
+/**
+ * @brief Take the result of the pending send request, if any.
+ *
+ * @return The number of bytes sent (0 if no request is pending) or -1 with
+ *         errno set, EINPROGRESS if the request has not yet completed.
+ */
+ssize_t cla_tcp_uring_send_result(struct cla_tcp_link *link);
+
+#endif // CLA_TCP_URING_H_INCLUDED
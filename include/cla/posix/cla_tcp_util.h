@@ -43,7 +43,8 @@ int cla_tcp_connect_to_cla_addr(const char *const cla_addr,
 				const char *const default_service);
 
 /**
- * Send all data to the given socket, ignoring interruptions by signals.
+ * Send all data to the given blocking socket, ignoring interruptions by
+ * signals.
  *
  * @param socket The socket to be written to.
  * @param buffer The buffer from which data should be read.
@@ -0,0 +1,73 @@
+/*
+ * hal_executor.h
+ *
+ * Description: contains the definitions of the hardware abstraction
+ * layer interface for running work items on a shared pool of tasks
+ *
+ */
+
+#ifndef HAL_EXECUTOR_H_INCLUDED
+#define HAL_EXECUTOR_H_INCLUDED
+
+#include "platform/hal_config.h"
+
+#include <stdint.h>
+
+/*
+ * Instead of spawning a task that blocks until it has something to do,
+ * components may submit a work item whenever there is something to do. The
+ * work item runs to completion on one of HAL_EXECUTOR_WORKERS shared tasks
+ * and should not block for long, as it keeps the worker from running other
+ * work items meanwhile.
+ *
+ * The executor is only available if HAL_EXECUTOR_WORKERS is non-zero;
+ * otherwise, components have to keep using their own tasks.
+ */
+struct hal_work {
+	void (*run)(struct hal_work *work);
+	/* Private to the executor */
+	struct hal_work *next;
+	uint64_t deadline_ms;
+	uint8_t state;
+};
+
+/**
+ * @brief hal_work_init Prepare a work item
+ * @param work The work item to be initialized
+ * @param run The function to be executed, it receives the work item which
+ *	      may be embedded into a larger structure
+ */
+void hal_work_init(struct hal_work *work, void (*run)(struct hal_work *work));
+
+/**
+ * @brief hal_work_submit Schedule a work item for execution. A work item
+ *			  never runs concurrently with itself. If it is
+ *			  already waiting, nothing happens; if it is
+ *			  running, it runs once more afterwards. Thus,
+ *			  everything that happened before the submission is
+ *			  seen by a subsequent run.
+ * @param work The work item to be scheduled
+ */
+void hal_work_submit(struct hal_work *work);
+
+/**
+ * @brief hal_work_submit_delayed Schedule a work item for execution after
+ *				  a delay, e.g., to retry an operation that
+ *				  would have blocked. If it is submitted
+ *				  without delay meanwhile, it runs right away.
+ * @param work The work item to be scheduled
+ * @param delay_ms The delay in milliseconds
+ */
+void hal_work_submit_delayed(struct hal_work *work, int delay_ms);
+
+/**
+ * @brief hal_work_cancel_sync Remove a work item from the executor, waiting
+ *			       for a current run to complete. Afterwards,
+ *			       the executor does not access the work item
+ *			       anymore, so it may be freed unless it is
+ *			       submitted again.
+ * @param work The work item to be cancelled
+ */
+void hal_work_cancel_sync(struct hal_work *work);
+
+#endif /* HAL_EXECUTOR_H_INCLUDED */
@@ -90,6 +90,43 @@ enum ud3tn_result hal_queue_receive(QueueIdentifier_t queue,
 				    void *targetBuffer,
 				    int timeout);
 
+/**
+ * @brief hal_queue_push_batch Attach a number of items to the back of the
+ *			       queue, in order. Where the platform allows,
+ *			       the receiver is woken up only once for all
+ *			       of them.
+ * @param queue The identifier of the Queue that the elements should be
+ *              inserted
+ * @param items An array of count items
+ * @param count The number of items to be inserted
+ * @param timeout After which time (in milliseconds) the attempt to insert
+ *		  the remaining items should be aborted.
+ *		  If this value is -1, the call blocks until all items are
+ *		  inserted
+ * @return The number of items inserted, less than count only on timeout
+ */
+size_t hal_queue_push_batch(QueueIdentifier_t queue, const void *items,
+			    size_t count, int timeout);
+
+/**
+ * @brief hal_queue_receive_batch Receive up to max_count items from the
+ *				  specific queue with a single wakeup.
+ *				  Blocks only until the first item arrives,
+ *				  further items are taken if they are
+ *				  already available.
+ * @param queue The identifier of the Queue that the elements should be read
+ *		from
+ * @param targetBuffer A pointer to an array of max_count items where the
+ *		       received items should be stored
+ * @param max_count The maximum number of items to be received
+ * @param timeout After which time (in milliseconds) the receiving attempt
+ *		  should be aborted.
+ *		  If this value is -1, receiving will block indefinitely
+ * @return The number of items received, 0 if the timeout expired
+ */
+size_t hal_queue_receive_batch(QueueIdentifier_t queue, void *targetBuffer,
+			       size_t max_count, int timeout);
+
 /**
  * @brief hal_queue_reset Reset (i.e. empty) the specific queue
  * @param queue The queue that should be cleared
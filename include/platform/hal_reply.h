@@ -0,0 +1,57 @@
+/*
+ * hal_reply.h
+ *
+ * Description: contains the definitions of the hardware abstraction
+ * layer interface for one-shot replies between tasks
+ *
+ */
+
+#ifndef HAL_REPLY_H_INCLUDED
+#define HAL_REPLY_H_INCLUDED
+
+#include "platform/hal_types.h"
+
+#include "ud3tn/result.h"
+
+#include <stdint.h>
+
+/*
+ * A reply slot lets a task wait for the results of one or several other
+ * tasks, e.g. for a synchronous request sent via a queue. It is meant to
+ * live on the stack of the waiting task; the platform wakes it up by means
+ * of a per-task primitive that is set up once instead of for every request.
+ */
+struct hal_reply {
+	ReplyWaiter_t waiter;
+	int result;
+	uint8_t remaining;
+};
+
+/**
+ * @brief hal_reply_init Prepare a reply slot for the calling task
+ * @param reply The slot to be initialized
+ * @param count The number of replies to be posted before the waiter
+ *		wakes up, at least 1
+ * @return Whether the slot could be set up
+ */
+enum ud3tn_result hal_reply_init(struct hal_reply *reply, uint8_t count);
+
+/**
+ * @brief hal_reply_post Post one reply, waking up the waiting task with the
+ *			 last one. The reply slot must not be accessed
+ *			 anymore afterwards.
+ * @param reply The slot the reply belongs to
+ * @param result The result of the replying task, 0 means success
+ */
+void hal_reply_post(struct hal_reply *reply, int result);
+
+/**
+ * @brief hal_reply_wait Block until all replies have been posted. Must be
+ *			 called by the task that initialized the slot.
+ * @param reply The slot to be waited for
+ * @return A non-zero result posted by any of the replying tasks, or 0 if
+ *	   all of them succeeded
+ */
+int hal_reply_wait(struct hal_reply *reply);
+
+#endif /* HAL_REPLY_H_INCLUDED */
@@ -28,12 +28,24 @@ uint64_t hal_time_get_timestamp_s(void);
 
 /**
  * @brief hal_time_get_timestamp_ms Provides information about the current time
+ *				    from a clock that is cheap to read, but
+ *				    may lag behind by one system tick (up to
+ *				    10 ms on POSIX)
  * @return The current time in milliseconds
  */
 uint64_t hal_time_get_timestamp_ms(void);
 
+/**
+ * @brief hal_time_get_timestamp_ms_precise Like hal_time_get_timestamp_ms,
+ *					    but reads the hardware clock,
+ *					    e.g. for measuring durations
+ * @return The current time in milliseconds
+ */
+uint64_t hal_time_get_timestamp_ms_precise(void);
+
 /**
  * @brief hal_time_get_timestamp_us Provides information about the current time
+ *				    from the precise clock
  * @return The current time in microseconds
  */
 uint64_t hal_time_get_timestamp_us(void);
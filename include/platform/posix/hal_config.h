@@ -19,6 +19,7 @@
 #define CONTACT_MANAGER_TASK_PRIORITY 1
 #define CONTACT_TX_TASK_PRIORITY 3
 #define ROUTER_OPTIMIZER_TASK_PRIORITY 0
+#define PERSISTENT_STORAGE_TASK_PRIORITY 0
 #define CONTACT_LISTEN_TASK_PRIORITY 2
 #define CONTACT_MANAGEMENT_TASK_PRIORITY 2
 
@@ -41,4 +42,26 @@
 
 #define LINUX_SPECIFIC_API 0
 
+/*
+ * Back hal_queue by the lock-free ring of mpsc_queue.c instead of the
+ * semaphore-based simple_queue.c. Waiting threads sleep on futexes, which
+ * are only available on Linux.
+ */
+#ifndef HAL_QUEUE_LOCK_FREE
+#ifdef __linux__
+#define HAL_QUEUE_LOCK_FREE 1
+#else
+#define HAL_QUEUE_LOCK_FREE 0
+#endif
+#endif
+
+/*
+ * Number of threads executing the work items of hal_executor.h. Links and
+ * agents that opt into the executor share these instead of blocking in
+ * threads of their own. 0 disables the executor.
+ */
+#ifndef HAL_EXECUTOR_WORKERS
+#define HAL_EXECUTOR_WORKERS 8
+#endif
+
 #endif /* HAL_CONFIG_H_INCLUDED */
@@ -1,6 +1,8 @@
 #ifndef HAL_TYPES_H_INCLUDED
 #define HAL_TYPES_H_INCLUDED
 
+#include "platform/posix/hal_config.h"
+#include "platform/posix/mpsc_queue.h"
 #include "platform/posix/simple_queue.h"
 
 #include <sys/types.h>
@@ -8,8 +10,13 @@
 #include <fcntl.h>
 #include <pthread.h>
 
+#if HAL_QUEUE_LOCK_FREE
+#define QueueIdentifier_t struct mpsc_queue *
+#else
 #define QueueIdentifier_t Queue_t*
+#endif
 #define Semaphore_t sem_t*
 #define Task_t pthread_t*
+#define ReplyWaiter_t sem_t*
 
 #endif // HAL_TYPES_H_INCLUDED
@@ -0,0 +1,104 @@
+/*
+ * mpsc_queue.h
+ *
+ * Description: bounded lock-free message queue for many producers and a
+ * single consumer, sleeping on a futex only if it is empty or full.
+ *
+ */
+
+#ifndef MPSC_QUEUE_H_INCLUDED
+#define MPSC_QUEUE_H_INCLUDED
+
+#include "ud3tn/result.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Every slot carries a sequence number telling whether it is free for the
+ * producer claiming position n (sequence == 2n) or holds the item of position
+ * n for the consumer (sequence == 2n + 1). Producers and the consumer claim
+ * positions with a CAS on tail and head, respectively, so a queue that is
+ * (unexpectedly) shared by several consumers still works correctly.
+ */
+struct mpsc_queue {
+	// producer side, modified by every push
+	size_t tail __attribute__((aligned(64)));
+	// bumped when an item is published, futex word of waiting consumers
+	uint32_t items_event;
+	uint32_t pop_waiters;
+
+	// consumer side, modified by every pop
+	size_t head __attribute__((aligned(64)));
+	// bumped when a slot is freed, futex word of waiting producers
+	uint32_t space_event;
+	uint32_t push_waiters;
+
+	size_t length __attribute__((aligned(64)));
+	size_t item_size;
+	size_t slot_size;
+	uint8_t *slots;
+};
+
+/**
+ * Creates a queue holding up to length items of item_size bytes each.
+ * Returns NULL if the memory could not be allocated.
+ */
+struct mpsc_queue *mpsc_queue_create(size_t length, size_t item_size);
+
+/**
+ * Frees the queue. No other thread may use it anymore.
+ */
+void mpsc_queue_delete(struct mpsc_queue *queue);
+
+/**
+ * Drops all items which are currently in the queue.
+ */
+void mpsc_queue_reset(struct mpsc_queue *queue);
+
+/**
+ * Returns the number of items in the queue. This is a snapshot that may be
+ * outdated as soon as it is returned.
+ */
+size_t mpsc_queue_items_waiting(struct mpsc_queue *queue);
+
+/**
+ * Appends a copy of the item, waiting up to timeout_ms milliseconds for a
+ * free slot (forever if negative).
+ */
+enum ud3tn_result mpsc_queue_push(struct mpsc_queue *queue, const void *item,
+				  int timeout_ms);
+
+/**
+ * Appends a copy of the item. If the queue is full, the most recently
+ * appended item is replaced instead.
+ */
+enum ud3tn_result mpsc_queue_override(struct mpsc_queue *queue,
+				      const void *item);
+
+/**
+ * Removes the oldest item and copies it to target, waiting up to
+ * timeout_ms milliseconds for one to arrive (forever if negative).
+ */
+enum ud3tn_result mpsc_queue_pop(struct mpsc_queue *queue, void *target,
+				 int timeout_ms);
+
+/**
+ * Appends copies of count consecutive items, waiting up to timeout_ms
+ * milliseconds (forever if negative) for free slots. Waiting consumers are
+ * woken once per run of items that fits into the queue instead of once per
+ * item. Returns the number of items appended, which is less than count
+ * only if the timeout expired.
+ */
+size_t mpsc_queue_push_batch(struct mpsc_queue *queue, const void *items,
+			     size_t count, int timeout_ms);
+
+/**
+ * Removes up to max_count of the oldest items and copies them to the array
+ * at targets, waiting up to timeout_ms milliseconds for the first one to
+ * arrive (forever if negative). Returns the number of items removed.
+ */
+size_t mpsc_queue_pop_batch(struct mpsc_queue *queue, void *targets,
+			    size_t max_count, int timeout_ms);
+
+#endif /* MPSC_QUEUE_H_INCLUDED */
@@ -14,6 +14,7 @@
 #define CONTACT_MANAGER_TASK_PRIORITY 1
 #define CONTACT_TX_TASK_PRIORITY 3
 #define ROUTER_OPTIMIZER_TASK_PRIORITY 0
+#define PERSISTENT_STORAGE_TASK_PRIORITY 0
 
 // NOTE: Stack size is in 4 byte units!!!
 #define DEFAULT_TASK_STACK_SIZE 1024
@@ -29,4 +30,7 @@
 // this amount of time. Specified in ms.
 #define COMM_RX_TIMEOUT 100
 
+/* There is no shared executor, every component blocks in its own task */
+#define HAL_EXECUTOR_WORKERS 0
+
 #endif /* HAL_CONFIG_H_INCLUDED */
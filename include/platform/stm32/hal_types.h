@@ -9,5 +9,6 @@
 #define QueueIdentifier_t QueueHandle_t
 #define Semaphore_t SemaphoreHandle_t
 #define Task_t TaskHandle_t
+#define ReplyWaiter_t TaskHandle_t
 
 #endif // HAL_TYPES_H_INCLUDED
@@ -14,6 +14,7 @@
 #define CONTACT_MANAGER_TASK_PRIORITY 2
 #define CONTACT_TX_TASK_PRIORITY 4
 #define ROUTER_OPTIMIZER_TASK_PRIORITY 1
+#define PERSISTENT_STORAGE_TASK_PRIORITY 1
 
 // TODO: Rework these
 #define CONTACT_LISTEN_TASK_PRIORITY 3
@@ -38,4 +39,7 @@
 // this amount of time. Specified in ms.
 #define COMM_RX_TIMEOUT 100
 
+// There is no shared executor, every component blocks in its own task
+#define HAL_EXECUTOR_WORKERS 0
+
 #endif /* HAL_CONFIG_H_INCLUDED */
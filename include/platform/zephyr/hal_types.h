@@ -15,5 +15,6 @@ struct zephyr_task {
 #define QueueIdentifier_t struct k_msgq *
 #define Semaphore_t struct k_sem *
 #define Task_t struct zephyr_task*
+#define ReplyWaiter_t struct k_sem
 
 #endif // HAL_TYPES_H_INCLUDED
@@ -6,6 +6,7 @@
 #include "ud3tn/bundle_processor.h"
 #include "ud3tn/bundle.h"
 #include "ud3tn/node.h"
+#include "ud3tn/timer_service.h"
 #include "platform/hal_task.h"
 #include "platform/hal_time.h"
 #include "platform/hal_io.h"
@@ -25,6 +26,8 @@ struct bundle_info_list_entry {
     uint64_t exp_time;
     char *destination;
     struct bundle_info_list_entry *next;
+    struct bundle_info_list_entry *prev;
+    struct timer expiry_timer; // fires as soon as exp_time has passed
 };
 
 struct bundle_info_list {
@@ -54,6 +57,7 @@ struct router_config {
     struct router_contact *router_contacts[CONFIG_BT_MAX_CONN];
     uint16_t num_router_contacts;
     uint64_t next_bundle_update;
+    struct timer_queue expired_bundles; // popped with router_contact_htab_sem held
 };
 
 enum ud3tn_result router_init(const struct bundle_agent_interface *bundle_agent_interface);
@@ -17,6 +17,11 @@ struct agent_list {
 	struct agent_list *next;
 };
 
+/*
+ * The functions below operate on the list referenced by agents, which has to
+ * be NULL initially. Every bundle processor shard keeps a list of its own.
+ */
+
 /**
  * @brief agent_forward Invoke the callback associated with the specified
  *	sink_identifier in the thread of the caller
@@ -25,7 +30,8 @@ struct agent_list {
  *
  * @not_thread_safe
  */
-int agent_forward(const char *sink_identifier, struct bundle_adu data);
+int agent_forward(struct agent_list **agents, const char *sink_identifier,
+		  struct bundle_adu data);
 
 
 /**
@@ -41,7 +47,7 @@ int agent_forward(const char *sink_identifier, struct bundle_adu data);
  *
  * @not_thread_safe
  */
-int agent_register(const char *sink_identifier,
+int agent_register(struct agent_list **agents, const char *sink_identifier,
 		   void (*const callback)(struct bundle_adu data, void *param),
 		   void *param);
 
@@ -53,6 +59,6 @@ int agent_register(const char *sink_identifier,
  *
  * @not_thread_safe
  */
-int agent_deregister(const char *sink_identifier);
+int agent_deregister(struct agent_list **agents, const char *sink_identifier);
 
 #endif /* AGENT_MANAGER_H_INCLUDED */
@@ -2,6 +2,7 @@
 #define BUNDLE_H_INCLUDED
 
 #include "ud3tn/common.h"
+#include "ud3tn/payload_buffer.h"
 #include "ud3tn/result.h"
 
 #include <stdbool.h>  // bool
@@ -11,7 +12,7 @@
 
 #define BUNDLE_INVALID_ID 0
 
-typedef uint16_t bundleid_t;
+typedef uint32_t bundleid_t;
 
 struct endpoint_list {
 	char *eid;
@@ -115,6 +116,8 @@ struct bundle_block {
 
 	uint32_t length;
 	uint8_t *data;
+	/* If set, data is a slice of this buffer and not owned by the block */
+	struct payload_buffer *buffer;
 
 	/* RFC 5050: EID references associated to the block */
 	struct endpoint_list *eid_refs;
@@ -134,6 +137,23 @@ struct bundle_block_list {
 	struct bundle_block_list *next;
 };
 
+/**
+ * Memory layout of a bundle
+ *
+ * Bundles are created with separately allocated EIDs, block descriptors and
+ * block data. bundle_compact() moves a bundle into a single allocation.
+ * Compact bundles must not be modified except for in-place changes of
+ * fixed-size fields, use bundle_expand() before replacing any of their parts.
+ */
+enum bundle_layout {
+	/* Struct from the bundle pool, all parts allocated separately */
+	BUNDLE_LAYOUT_GRAPH = 0,
+	/* Struct, EIDs, block descriptors and block data in one allocation */
+	BUNDLE_LAYOUT_COMPACT,
+	/* Struct in a compact allocation, parts allocated separately */
+	BUNDLE_LAYOUT_EXPANDED,
+};
+
 struct bundle {
 	bundleid_t id;
 
@@ -143,6 +163,7 @@ struct bundle {
 	enum bundle_retention_constraints ret_constraints;
 	enum bundle_crc_type crc_type;
 
+	// Interned EIDs, see eid_table.h
 	char *destination;
 	char *source;
 	char *report_to;
@@ -166,11 +187,17 @@ struct bundle {
 
 	struct bundle_block_list *blocks;
 	struct bundle_block *payload_block;
+
+	enum bundle_layout layout;
+	/* Size of the allocation of compact bundles */
+	size_t compact_size;
+	/* Set if the compact allocation is kept alive by its shared payload */
+	struct payload_buffer *shared_allocation;
 };
 
 struct bundle_unique_identifier {
 	uint8_t protocol_version;
-	char *source;
+	char *source; // interned
 	uint64_t creation_timestamp_ms;
 	uint64_t sequence_number;
 	uint32_t fragment_offset;
@@ -300,6 +327,18 @@ enum bundle_routing_priority {
 	BUNDLE_RPRIO_MAX
 };
 
+/**
+ * A part of the payload of a reassembled ADU. The buffer is the payload of
+ * one of the fragments and owned by the segment, unless it is a slice of a
+ * shared payload buffer the segment holds a reference to.
+ */
+struct bundle_adu_segment {
+	uint8_t *buffer;
+	size_t offset;
+	size_t length;
+	struct payload_buffer *shared;
+};
+
 /**
  * A structure that can be leveraged to represent a bundle ADU for exchange
  * with connected bundle applications. The most important feature is that an
@@ -309,10 +348,15 @@ enum bundle_routing_priority {
 struct bundle_adu {
 	uint8_t protocol_version;
 	enum bundle_proc_flags proc_flags;
+	// Interned EIDs, see eid_table.h
 	char *source;
 	char *destination;
 	uint8_t *payload;
 	size_t length;
+	// Reassembled ADUs reference the payloads of their fragments instead
+	// of a contiguous payload (which is NULL then), see bundle_adu_flatten()
+	struct bundle_adu_segment *segments;
+	size_t segment_count;
 };
 
 
@@ -344,6 +388,14 @@ void bundle_reset(struct bundle *bundle);
 void bundle_free(struct bundle *bundle);
 void bundle_drop(struct bundle *bundle);
 
+/**
+ * Bundles, blocks and list entries are allocated from object pools.
+ * Returns the sum of the statistics of these pools.
+ */
+struct pool_stats;
+void bundle_get_pool_stats(struct pool_stats *stats);
+void bundle_log_pool_stats(void);
+
 /**
  * Copy bundle's primary block
  *
@@ -353,8 +405,54 @@ void bundle_drop(struct bundle *bundle);
 void bundle_copy_headers(struct bundle *to, const struct bundle *from);
 
 enum ud3tn_result bundle_recalculate_header_length(struct bundle *bundle);
+
+/**
+ * Duplicates the bundle. The payload is not copied but shared with the
+ * duplicate, see bundle_share_payload().
+ */
 struct bundle *bundle_dup(const struct bundle *bundle);
 
+/**
+ * Moves the payload of the bundle into a payload buffer (if it is not yet
+ * backed by one), so that duplicates and fragments reference its bytes
+ * instead of copying them. The allocation of a compact bundle is shared as a
+ * whole and only freed after the bundle and all views of its payload.
+ */
+enum ud3tn_result bundle_share_payload(struct bundle *bundle);
+
+/**
+ * Copies the bundle into a single allocation, which references the interned
+ * EIDs and shared payloads of the original anew, so the latter stays intact.
+ *
+ * Returns NULL if the bundle is already compact, its payload is larger than
+ * BUNDLE_COMPACT_MAX_PAYLOAD_SIZE, it is a fragment (whose payload is taken
+ * over on reassembly) or the allocation fails.
+ */
+struct bundle *bundle_compact_dup(const struct bundle *bundle);
+
+/**
+ * Moves the bundle into a single allocation and returns the new pointer.
+ *
+ * The passed bundle is freed. If the payload is larger than
+ * BUNDLE_COMPACT_MAX_PAYLOAD_SIZE, the bundle is a fragment (whose payload is
+ * taken over on reassembly) or the allocation fails, it is returned
+ * unchanged. Use bundle_storage_compact() for stored bundles.
+ */
+struct bundle *bundle_compact(struct bundle *bundle);
+
+/**
+ * Allocates the parts of a compact bundle separately, so they can be
+ * replaced or freed. Does nothing for bundles that are not compact.
+ */
+enum ud3tn_result bundle_expand(struct bundle *bundle);
+
+/**
+ * Unlinks the block entry from the bundle's block list and frees it.
+ * Returns the next entry. This does not require expanding compact bundles.
+ */
+struct bundle_block_list *bundle_block_entry_remove(
+	struct bundle *bundle, struct bundle_block_list *e);
+
 enum bundle_routing_priority bundle_get_routing_priority(
 	struct bundle *bundle);
 
@@ -401,6 +499,8 @@ struct bundle_adu bundle_adu_init(const struct bundle *bundle);
 /**
  * Initialize a new bundle ADU struct from the given bundle data, take over
  * the payload and remove it from the bundle. Note that the bundle is not freed.
+ * A payload that is still shared with other bundles is referenced by a single
+ * segment instead of being copied.
  */
 struct bundle_adu bundle_to_adu(struct bundle *bundle);
 
@@ -409,4 +509,11 @@ struct bundle_adu bundle_to_adu(struct bundle *bundle);
  */
 void bundle_adu_free_members(struct bundle_adu adu);
 
+/**
+ * Move the segments of a reassembled ADU into a contiguous payload, for
+ * consumers which cannot process the segments one by one. Does nothing if
+ * the payload already is contiguous.
+ */
+enum ud3tn_result bundle_adu_flatten(struct bundle_adu *adu);
+
 #endif /* BUNDLE_H_INCLUDED */
@@ -6,6 +6,8 @@
 
 #include "platform/hal_types.h"
 
+#include <stddef.h>
+
 enum bundle_processor_signal_type {
 	BP_SIGNAL_BUNDLE_INCOMING,
 	BP_SIGNAL_BUNDLE_ROUTED,
@@ -16,7 +18,14 @@ enum bundle_processor_signal_type {
 	BP_SIGNAL_TRANSMISSION_FAILURE,
 	BP_SIGNAL_BUNDLE_LOCAL_DISPATCH,
 	BP_SIGNAL_AGENT_REGISTER,
-	BP_SIGNAL_AGENT_DEREGISTER
+	BP_SIGNAL_AGENT_DEREGISTER,
+	/* Passes a custody signal to the shard processing its bundle */
+	BP_SIGNAL_CUSTODY_SUCCESS,
+	BP_SIGNAL_CUSTODY_FAILURE,
+	/* The bundle storage selected the bundle to make room for a new one */
+	BP_SIGNAL_BUNDLE_EVICTED,
+	/* Wakes a shard to retry its restored bundles, see below */
+	BP_SIGNAL_ROUTES_CHANGED
 };
 
 struct bundle_processor_signal {
@@ -33,15 +42,44 @@ struct bundle_processor_task_parameters {
 	bool status_reporting;
 };
 
+/**
+ * @brief Forward the signal to the BP
+ *
+ * Signals sent via the signaling queue passed to bundle_processor_start()
+ * are handed to the shard which processes the referenced bundle.
+ */
 void bundle_processor_inform(
 	QueueIdentifier_t bundle_processor_signaling_queue, bundleid_t bundle,
 	enum bundle_processor_signal_type type,
 	enum bundle_status_report_reason reason);
 
+/**
+ * @brief Forward the signal to the BP without waiting for space in the queue
+ *
+ * @return UD3TN_FAIL if the signaling queue of the shard is full.
+ */
+enum ud3tn_result bundle_processor_try_inform(
+	QueueIdentifier_t bundle_processor_signaling_queue, bundleid_t bundle,
+	enum bundle_processor_signal_type type,
+	enum bundle_status_report_reason reason);
+
+
+/**
+ * @brief Notify the BP that bundles may be routable which were not before
+ *
+ * Bundles restored from the persistent storage are kept, instead of being
+ * dropped, until they could be routed or delivered once. Every shard retries
+ * them when notified and after an agent has been registered. Does not block,
+ * thus, it may be called by the router task.
+ */
+void bundle_processor_notify_routes_changed(void);
 
 /**
  * @brief Instruct the BP to interact with the agent manager state
  *
+ * The action is performed by all shards. Thus, the callback of an agent may
+ * be invoked concurrently if more than one shard is configured.
+ *
  * @param bundle_processor_signaling_queue Handle to the signaling queue of
  *	the BP task
  * @param type BP_SIGNAL_AGENT_REGISTER or BP_SIGNAL_AGENT_DRREGISTER
@@ -61,7 +99,42 @@ int bundle_processor_perform_agent_action(
 	bool wait_for_feedback);
 
 
-void bundle_processor_task(void *param);
+/**
+ * @brief Initialize the BP and start BUNDLE_PROCESSOR_SHARDS tasks
+ *
+ * Every shard processes the bundles which hash into it, based on their
+ * source, creation timestamp and sequence number. The first shard receives
+ * its signals via p->signaling_queue, the others get queues of their own.
+ *
+ * @param p Parameters, copied by the BP
+ * @return UD3TN_FAIL if the BP could not be initialized
+ */
+enum ud3tn_result bundle_processor_start(
+	const struct bundle_processor_task_parameters *p);
+
+/**
+ * @brief Wait for a signal and take further waiting ones without blocking
+ *
+ * @param signaling_queue Handle to the signaling queue of the BP task
+ * @param signals Array receiving the signals
+ * @param max Maximum number of signals to be received, at least 1
+ * @return The number of signals received
+ */
+size_t bundle_processor_receive_signals(
+	QueueIdentifier_t signaling_queue,
+	struct bundle_processor_signal *signals, size_t max);
+
+/**
+ * @brief Remove signals which repeat the preceding signal for their bundle
+ *
+ * Only signals whose repeated handling has no further effect, e.g. multiple
+ * BP_SIGNAL_TRANSMISSION_SUCCESS for one bundle, are removed. The order of
+ * the remaining signals is kept.
+ *
+ * @return The number of remaining signals
+ */
+size_t bundle_processor_coalesce_signals(
+	struct bundle_processor_signal *signals, size_t count);
 
 /**
  * Use to access the list of known bundles
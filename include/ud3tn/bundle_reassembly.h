@@ -0,0 +1,79 @@
+#ifndef BUNDLE_REASSEMBLY_H_INCLUDED
+#define BUNDLE_REASSEMBLY_H_INCLUDED
+
+#include "ud3tn/bundle.h"
+#include "ud3tn/result.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fragments waiting for reassembly, grouped by the ADU they belong to. The
+ * ADUs are found via a hash index keyed by (source, creation timestamp,
+ * sequence number). Each ADU keeps the byte ranges received so far as a
+ * sorted array of disjoint intervals, so that an arriving fragment updates
+ * the coverage without looking at the other fragments.
+ */
+
+struct reassembly_interval {
+	size_t start;
+	size_t end;
+};
+
+struct reassembly_entry {
+	/* Next entry in the same hash bucket */
+	struct reassembly_entry *next;
+	uint32_t digest;
+	size_t total_adu_length;
+	/* Number of distinct payload bytes received */
+	size_t covered;
+	/* Fragments in the order of their arrival */
+	struct bundle **fragments;
+	uint32_t fragment_count;
+	uint32_t fragment_capacity;
+	struct reassembly_interval *intervals;
+	uint32_t interval_count;
+	uint32_t interval_capacity;
+};
+
+struct reassembly_table {
+	struct reassembly_entry **buckets;
+	uint32_t bucket_count;
+	uint32_t count;
+};
+
+enum ud3tn_result bundle_reassembly_init(struct reassembly_table *table);
+
+/* Frees the table, the pending fragments are passed to release_fragment */
+void bundle_reassembly_destroy(
+	struct reassembly_table *table,
+	void (*release_fragment)(struct bundle *fragment, void *param),
+	void *param);
+
+/*
+ * Adds a fragment to the ADU it belongs to and returns the entry of the ADU.
+ * Returns NULL if memory is exhausted, the fragment is not added then.
+ */
+struct reassembly_entry *bundle_reassembly_add(
+	struct reassembly_table *table, struct bundle *fragment);
+
+static inline bool bundle_reassembly_is_complete(
+	const struct reassembly_entry *entry)
+{
+	return entry->covered == entry->total_adu_length;
+}
+
+/*
+ * Removes a complete entry from the table and builds the ADU from the
+ * fragment payloads without copying them. Afterwards, the fragments are
+ * passed to release_fragment, in the order of their offsets. If memory is
+ * exhausted, UD3TN_FAIL is returned and the entry is left untouched.
+ */
+enum ud3tn_result bundle_reassembly_take_adu(
+	struct reassembly_table *table, struct reassembly_entry *entry,
+	struct bundle_adu *adu,
+	void (*release_fragment)(struct bundle *fragment, void *param),
+	void *param);
+
+#endif /* BUNDLE_REASSEMBLY_H_INCLUDED */
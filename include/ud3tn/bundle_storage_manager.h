@@ -2,14 +2,71 @@
 #define BUNDLESTORAGEMANAGER_H_INCLUDED
 
 #include "ud3tn/bundle.h"
+#include "ud3tn/persistent_storage.h"
 
 #include <stdint.h>
 
+/* Bundles selected for eviction if a new one would exceed BUNDLE_QUOTA */
+enum bundle_storage_eviction_policy {
+	/* New bundles are rejected if the quota is exceeded */
+	BUNDLE_STORAGE_EVICT_NONE,
+	BUNDLE_STORAGE_EVICT_OLDEST,
+	BUNDLE_STORAGE_EVICT_SOONEST_EXPIRING,
+	/* See bundle_get_routing_priority() */
+	BUNDLE_STORAGE_EVICT_LOWEST_PRIORITY,
+	/* See bundle_storage_note_transmission() */
+	BUNDLE_STORAGE_EVICT_MOST_FORWARDED,
+};
+
+/* Has to delete the bundle or call bundle_storage_cancel_eviction() */
+typedef void (*bundle_storage_evict_t)(bundleid_t id, void *param);
+
+/* Fails if the quota is exceeded and no bundles could be evicted */
 bundleid_t bundle_storage_add(struct bundle *bundle);
+/* Adds a bundle regardless of the quota, e.g. a fragment replacing a */
+/* stored bundle which is deleted afterwards */
+bundleid_t bundle_storage_add_exempt(struct bundle *bundle);
+/* Adds a bundle restored from the persistent storage under the given PID */
+bundleid_t bundle_storage_add_persisted(struct bundle *bundle,
+					persistentid_t pid);
 int8_t bundle_storage_contains(bundleid_t id);
+/* Returns the bundle without pinning it, only for the task owning it */
+/* while it is acquired, as other bundles may be unloaded at any time */
 struct bundle *bundle_storage_get(bundleid_t id);
+/* Returns the bundle, loading it again if it has been unloaded, and */
+/* prevents it from being freed via bundle_storage_drop() or unloaded */
+/* until bundle_storage_release() is called */
+struct bundle *bundle_storage_acquire(bundleid_t id);
+void bundle_storage_release(bundleid_t id);
 int8_t bundle_storage_delete(bundleid_t id);
+/* Deletes the bundle and frees it as soon as it is no longer acquired */
+int8_t bundle_storage_drop(bundleid_t id);
+/* Writes the bundle to the persistent storage, if enabled */
 int8_t bundle_storage_persist(bundleid_t id);
+/* Copies the bundle into a single allocation, see bundle_compact(), and */
+/* returns the new pointer; tasks which acquired the ID before keep */
+/* accessing the former bundle, which is freed after the last release */
+struct bundle *bundle_storage_compact(bundleid_t id);
+/* Bytes of the primary blocks and block data of all stored bundles */
 uint32_t bundle_storage_get_usage(void);
+/* Bytes of the stored bundles which are kept in memory */
+uint32_t bundle_storage_get_resident_usage(void);
+/* Persisted bundles are unloaded while the resident bytes exceed the quota */
+void bundle_storage_set_resident_quota(uint32_t bytes);
+
+/* Custody-accepted bundles and fragments pending reassembly are never */
+/* evicted; eviction is disabled until a handler has been set */
+void bundle_storage_set_eviction_policy(
+	enum bundle_storage_eviction_policy policy);
+enum bundle_storage_eviction_policy bundle_storage_get_eviction_policy(void);
+void bundle_storage_set_eviction_handler(bundle_storage_evict_t handler,
+					 void *param);
+/* Keeps a bundle handed to the eviction handler, e.g. if it gained custody */
+void bundle_storage_cancel_eviction(bundleid_t id);
+/* Counts a successful transmission for BUNDLE_STORAGE_EVICT_MOST_FORWARDED */
+void bundle_storage_note_transmission(bundleid_t id);
+/* Keeps a bundle changed after it was persisted in memory, as its */
+/* persistent copy cannot replace it anymore */
+void bundle_storage_note_modification(bundleid_t id);
 
 #endif /* BUNDLESTORAGEMANAGER_H_INCLUDED */
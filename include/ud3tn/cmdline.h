@@ -10,6 +10,7 @@ struct ud3tn_cmdline_options {
 	char *aap_socket; // e.g.: /tmp/ud3tn.socket
 	char *aap_node; // e.g.: 127.0.0.1
 	char *aap_service; // e.g.: 4242
+	char *storage_dir; // e.g.: /var/lib/ud3tn, NULL if not persistent
 	uint8_t bundle_version;
 	bool status_reporting;
 	bool exit_immediately; // after parsing --help or --usage etc.
@@ -80,6 +80,27 @@ enum failed_forwarding_policy {
 /* If a custody signal is pending, but the router is blocked => drop */
 /* Set this to 0 for an infinite delay - which implies a possible deadlock! */
 #define CUSTODY_SIGNAL_TIMEOUT 1000
+/* Signals the bundle processor handles per wakeup; status reports resulting */
+/* from a batch are sent after it has been processed. 1 disables batching. */
+#if defined(PLATFORM_STM32) || defined(PLATFORM_ZEPHYR)
+#define BUNDLE_PROCESSOR_SIGNAL_BATCH_SIZE 4
+#else
+#define BUNDLE_PROCESSOR_SIGNAL_BATCH_SIZE 32
+#endif
+
+/* Signals the router task takes from its queue per wakeup */
+#if defined(PLATFORM_STM32) || defined(PLATFORM_ZEPHYR)
+#define ROUTER_SIGNAL_BATCH_SIZE 4
+#else
+#define ROUTER_SIGNAL_BATCH_SIZE 16
+#endif
+
+/* Number of bundle processor tasks, each processing a part of the bundles */
+#if defined(PLATFORM_STM32) || defined(PLATFORM_ZEPHYR)
+#define BUNDLE_PROCESSOR_SHARDS 1
+#else
+#define BUNDLE_PROCESSOR_SHARDS 4
+#endif
 
 
 
@@ -96,6 +117,77 @@ enum failed_forwarding_policy {
 #define BUNDLE_QUOTA 1073741824
 #endif
 
+/* Stored bundles evicted to admit new ones if the quota would be exceeded, */
+/* see enum bundle_storage_eviction_policy */
+#define BUNDLE_STORAGE_EVICTION_POLICY BUNDLE_STORAGE_EVICT_NONE
+/* Maximum number of bundles evicted to admit a single new one */
+#define BUNDLE_STORAGE_MAX_EVICTIONS 16
+
+/* Number of bundle ID bits addressing a slot in the bundle storage, */
+/* the remaining bits of the ID are used as generation counter */
+#define BUNDLE_STORAGE_INDEX_BITS 22
+/* Slots allocated on first use, the slot table doubles when it is full */
+#define BUNDLE_STORAGE_INITIAL_SLOTS 32
+/* If the persistent storage is enabled, persisted bundles which are not */
+/* in use are unloaded while the bundles in memory exceed this many bytes */
+/* and loaded again when they are acquired */
+#define BUNDLE_STORAGE_RESIDENT_QUOTA 67108864
+
+/* A new segment file of the persistent storage is started above this size */
+#define PERSISTENT_STORAGE_SEGMENT_SIZE 4194304
+/* Segments with less than this percentage of live data are compacted */
+#define PERSISTENT_STORAGE_COMPACTION_THRESHOLD 50
+/* Interval (ms) in which the compaction task checks the segments */
+#define PERSISTENT_STORAGE_COMPACTION_INTERVAL 10000
+/* Bytes of records the compaction copies per batch, the lock of the */
+/* persistent storage is released between the batches */
+#define PERSISTENT_STORAGE_COMPACTION_BATCH_SIZE 65536
+/* Initial slot count of the persistent storage index, doubles when full */
+#define PERSISTENT_STORAGE_INITIAL_INDEX_SLOTS 64
+/* If set to 1, every record is synced to disk before returning. Records */
+/* always survive a crash of the process, this also covers power losses. */
+#define PERSISTENT_STORAGE_SYNC 0
+
+/* Objects allocated at once by the pools for bundles, blocks and routing */
+/* list nodes; if set to 0, every object is allocated from the heap */
+#if defined(PLATFORM_STM32) || defined(PLATFORM_ZEPHYR)
+#define OBJECT_POOL_CHUNK_SIZE 8
+#else
+#define OBJECT_POOL_CHUNK_SIZE 64
+#endif
+
+/* Bundles to be forwarded with a payload up to this size are moved into a */
+/* single allocation; set to 0 to disable the compact layout */
+#if defined(PLATFORM_STM32) || defined(PLATFORM_ZEPHYR)
+#define BUNDLE_COMPACT_MAX_PAYLOAD_SIZE 1024
+#else
+#define BUNDLE_COMPACT_MAX_PAYLOAD_SIZE 4096
+#endif
+
+/* Initial bucket count of the table of interned EIDs; it is doubled */
+/* whenever it holds more EIDs than buckets (must be a power of two) */
+#if defined(PLATFORM_STM32) || defined(PLATFORM_ZEPHYR)
+#define EID_TABLE_INITIAL_BUCKETS 16
+#else
+#define EID_TABLE_INITIAL_BUCKETS 64
+#endif
+
+/* Initial bucket count of the set of known bundles; it is doubled */
+/* whenever it holds more bundles than buckets (must be a power of two) */
+#if defined(PLATFORM_STM32) || defined(PLATFORM_ZEPHYR)
+#define KNOWN_BUNDLE_LIST_INITIAL_BUCKETS 32
+#else
+#define KNOWN_BUNDLE_LIST_INITIAL_BUCKETS 256
+#endif
+
+/* Initial bucket count of the index of ADUs pending reassembly; it is */
+/* doubled whenever it holds more ADUs than buckets (must be a power of two) */
+#if defined(PLATFORM_STM32) || defined(PLATFORM_ZEPHYR)
+#define BUNDLE_REASSEMBLY_INITIAL_BUCKETS 8
+#else
+#define BUNDLE_REASSEMBLY_INITIAL_BUCKETS 32
+#endif
+
 /* The maximum count of bundles for which we have custody at a time */
 #define CUSTODY_MAX_BUNDLE_COUNT 16
 /* The maximum size of a bundle for which custody will be accepted */
@@ -106,8 +198,24 @@ enum failed_forwarding_policy {
 /*
  * [CLA] convergence layer related configuration
  */
-// Length of the outgoing-bundle queue (contact manager to TX task)
+// Initial transmit window of a link, i.e., the number of bundles that may be
+// queued for or in transmission (see cla_contact_tx_task_push())
 #define CONTACT_TX_TASK_QUEUE_LENGTH 3
+// Maximum size the transmit window grows to while the link keeps up
+#define CLA_TX_WINDOW_MAX 32
+// Number of transmitted bundles reported to the router at once
+#define CLA_TX_COMPLETION_BATCH 8
+// Bytes a lane of the TX scheduler may send per round and unit of its weight
+#define CLA_TX_SCHEDULER_QUANTUM 1024
+// Shares of the link for each flow of normal and low priority bundles
+#define CLA_TX_WEIGHT_NORMAL 4
+#define CLA_TX_WEIGHT_LOW 1
+// Number of flows per priority among which the link is shared fairly, bundles
+// are assigned to a flow by the hash of their destination EID
+#define CLA_TX_SCHEDULER_FLOWS 4
+// Bytes of high priority bundles (e.g., administrative records or bundles in
+// custody) which may be sent in a row while other bundles are waiting
+#define CLA_TX_HIGH_BURST (16 * CLA_TX_SCHEDULER_QUANTUM)
 // Length of the listen backlog for single-connection CLAs
 #define CLA_TCP_SINGLE_BACKLOG 1
 // Length of the listen backlog for multi-connection CLAs
@@ -121,6 +229,28 @@ enum failed_forwarding_policy {
 #define CLA_TCP_PARAM_HTAB_SLOT_COUNT 32
 // Whether or not to close active TCP connections after a contact
 #define CLA_MTCP_CLOSE_AFTER_CONTACT 0
+// Number of chunks an event-driven link reads before letting the worker
+// serve other links
+#define CLA_RX_WORK_CHUNK_BUDGET 16
+// Number of received bundles an event-driven link holds back while the
+// signaling queue of the bundle processor is full
+#define CLA_RX_PENDING_BUNDLES 8
+// Delay before an event-driven link retries to hand over held-back bundles
+#define CLA_RX_RETRY_DELAY_MS 5
+// Maximum number of socket events handled per wakeup of the TCP reactor
+#define CLA_TCP_REACTOR_EVENT_BATCH 64
+// Size of the submission queue of the io_uring backend (CLA_TCP_IO_URING)
+#define CLA_TCP_URING_ENTRIES 256
+// Number of receive buffers shared by all links, must be a power of two
+#define CLA_TCP_URING_BUFFER_COUNT 512
+// Size of every receive buffer in bytes
+#define CLA_TCP_URING_BUFFER_SIZE 4096
+// Size of the chunks of the per-link output queue, which coalesce the small
+// writes of outgoing packets
+#define CLA_TCP_TX_BUFFER_SIZE 4096
+// Bytes in the output queue of a link above which no further bundle is
+// serialized until the socket has taken some of them
+#define CLA_TCP_TX_QUEUE_LIMIT 65536
 
 
 
@@ -162,6 +292,8 @@ enum failed_forwarding_policy {
  */
 /* Maximum period (in ms) for checking */
 #define CONTACT_CHECKING_MAX_PERIOD 600000
+/* Period (in ms) after which bundles refused by a full link are offered again */
+#define CONTACT_TX_RETRY_PERIOD 10
 /* Maximum number of concurrent contacts that can be handled by CM */
 #define MAX_CONCURRENT_CONTACTS 257
 
@@ -9,12 +9,15 @@
 bool custody_manager_has_redundant_bundle(struct bundle *bundle);
 bool custody_manager_storage_is_acceptable(struct bundle *bundle);
 bool custody_manager_has_accepted(struct bundle *bundle);
-struct bundle *custody_manager_get_by_record(
+/* Returns the ID of the bundle in custody the record refers to, if any */
+bundleid_t custody_manager_get_by_record(
 	struct bundle_administrative_record *record);
 
 enum ud3tn_result custody_manager_accept(struct bundle *bundle);
 void custody_manager_release(struct bundle *bundle);
+enum ud3tn_result custody_manager_restore(struct bundle *bundle);
 
+/* Has to be called before any other function, from a single task */
 void custody_manager_init(const char *local_eid);
 
 #endif /* CUSTODYMANAGER_H_INCLUDED */
@@ -0,0 +1,46 @@
+#ifndef EID_TABLE_H_INCLUDED
+#define EID_TABLE_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Interned EIDs are reference-counted strings which exist only once in
+ * memory. They can be used everywhere a read-only C string is expected.
+ * Two interned EIDs are equal if and only if their pointers are equal.
+ * The length and the split between the node part ("dtn://node",
+ * "ipn:1") and the service part are determined once on interning.
+ */
+
+struct eid_table_stats {
+	/* Distinct EIDs currently stored in the table */
+	uint32_t entries;
+	/* References held to all stored EIDs */
+	uint32_t references;
+	/* Heap memory used by the entries and the bucket array */
+	uint32_t bytes;
+	/* Number of eid_intern() calls which found an existing entry */
+	uint32_t hits;
+};
+
+/* Returns a new reference to the interned copy of eid, NULL if eid is NULL */
+char *eid_intern(const char *eid);
+/* Adds a reference to an interned EID, NULL is passed through */
+char *eid_ref(char *eid);
+/* Drops a reference to an interned EID, NULL is ignored */
+void eid_release(char *eid);
+
+/* Length of an interned EID, without the terminating zero byte */
+size_t eid_length(const char *eid);
+/* Length of the node part of an interned EID */
+size_t eid_node_length(const char *eid);
+/* The service part of an interned EID, an empty string if it has none */
+const char *eid_service(const char *eid);
+/* Checks whether an interned EID belongs to the node of another EID */
+bool eid_has_node(const char *eid, const char *node_eid);
+
+void eid_table_get_stats(struct eid_table_stats *stats);
+void eid_table_log_stats(void);
+
+#endif /* EID_TABLE_H_INCLUDED */
@@ -3,6 +3,7 @@
 
 #include "platform/hal_semaphore.h"
 #include "ud3tn/bundle.h"
+#include "ud3tn/timer_service.h"
 
 // This requires manual locking before and after the loop!
 #define KNOWN_BUNDLE_LIST_FOREACH(l, e) for(struct known_bundle_list_entry *(e) = (l)->head; (e) != NULL; (e) = (e)->next)
@@ -11,14 +12,30 @@ struct known_bundle_list_entry {
     struct bundle_unique_identifier unique_identifier;
     bundleid_t id;
     uint64_t deadline;
+    // digest of the identifier of the (parent) bundle, see get_digest()
+    uint32_t digest;
+    // whether the entry only stands for a fragment of the (parent) bundle
+    bool is_fragment;
+    // list of all entries, in insertion order
     struct known_bundle_list_entry *next;
+    struct known_bundle_list_entry *prev;
+    // next entry in the same hash bucket
+    struct known_bundle_list_entry *bucket_next;
+    struct timer expiry_timer;
 };
 
 /**
- * Bundles are ordered from oldest to most recent deadline
+ * Entries are found via a hash set keyed by the digest of the parent bundle
+ * identifier; a timer of the shared timer service per entry allows removing
+ * expired entries without walking all of them.
  */
 struct known_bundle_list {
     struct known_bundle_list_entry *head;
+    struct known_bundle_list_entry **buckets;
+    uint32_t bucket_count;
+    // timers of the expired entries which have not been popped yet
+    struct timer_queue expired;
+    uint32_t count;
     Semaphore_t sem;
 };
 
@@ -38,6 +55,11 @@ void known_bundle_list_lock(struct known_bundle_list *list);
 void known_bundle_list_unlock(struct known_bundle_list *list);
 
 
+/**
+ * Returns the number of entries in the list
+ */
+uint32_t known_bundle_list_count(struct known_bundle_list *list);
+
 /**
  * Checks the oldest deadline, if the deadline is smaller than remove_before_ts, the entry will be removed from the list and returned
  * the entry needs to be freed using known_bundle_list_free_entry after processing is done!
@@ -54,6 +76,12 @@ bool known_bundle_list_add_reassembled_parent(struct known_bundle_list *list, co
 
 bool known_bundle_list_contains_reassembled_parent(struct known_bundle_list *list, const struct bundle *bundle);
 
+/**
+ * Checks whether the whole (parent) bundle is known, using only the fields of
+ * its primary block. Thus, this can be used before the payload is received.
+ */
+bool known_bundle_list_contains_primary(struct known_bundle_list *list, const struct bundle *bundle);
+
 /*
 bool known_bundle_list_contains(struct known_bundle_list *list, const struct bundle *bundle);
 
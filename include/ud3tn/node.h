@@ -12,7 +12,7 @@
 
 struct routed_bundle {
 	bundleid_t id;
-	char *destination; /* TODO: Optimize */
+	char *destination; /* Interned EID, see eid_table.h */
 	uint8_t preemption_improvement;
 	enum bundle_routing_priority prio;
 	uint32_t size;
@@ -117,4 +117,12 @@ int add_contact_to_ordered_assoc_list(
 int remove_contact_from_assoc_list(
 	struct associated_contact_list **list, struct contact *contact);
 
+/* Routed bundles and their list entries are allocated from object pools, */
+/* freeing them does not free the referenced destination or contacts */
+struct routed_bundle *routed_bundle_alloc(void);
+void routed_bundle_free(struct routed_bundle *rb);
+struct routed_bundle_list *routed_bundle_list_alloc(void);
+void routed_bundle_list_free(struct routed_bundle_list *entry);
+void routed_bundle_log_pool_stats(void);
+
 #endif // NODE_H_INCLUDED
@@ -42,6 +42,8 @@ struct parser {
 	 * input processor forwards the data to the parser.
 	 * If a parser is performing subparser forwarding, this field states
 	 * the amount of bytes to be forwarded.
+	 * A bulk read with a NULL "next_buffer" requests the bytes to be
+	 * consumed and discarded, e.g. if the bundle is dropped anyway.
 	 */
 	size_t next_bytes;
 };
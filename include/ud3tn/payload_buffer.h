@@ -0,0 +1,54 @@
+#ifndef PAYLOAD_BUFFER_H_INCLUDED
+#define PAYLOAD_BUFFER_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A reference-counted payload allocation. Bundle blocks, fragments and ADU
+ * segments may reference any slice of the same buffer instead of owning a
+ * copy of it; the bytes are freed together with the last reference.
+ * The bytes of a shared buffer must not be modified.
+ */
+struct payload_buffer {
+	uint8_t *data;
+	size_t length;
+	uint32_t refcount;
+	/* The heap allocation freed with the last reference, contains data */
+	void *allocation;
+};
+
+/**
+ * Takes over the given heap allocation into a new buffer with a reference
+ * count of one. On failure, NULL is returned and the data is left untouched.
+ */
+struct payload_buffer *payload_buffer_adopt(uint8_t *data, size_t length);
+
+/**
+ * Like payload_buffer_adopt(), but the data is part of a larger allocation
+ * (e.g. that of a compact bundle) which is kept until the last reference is
+ * dropped.
+ */
+struct payload_buffer *payload_buffer_wrap(void *allocation, uint8_t *data,
+					   size_t length);
+
+/**
+ * Increments the reference count and returns the passed buffer.
+ */
+struct payload_buffer *payload_buffer_ref(struct payload_buffer *buffer);
+
+/**
+ * Drops a reference, freeing the buffer and its data if it was the last one.
+ * Accepts NULL.
+ */
+void payload_buffer_release(struct payload_buffer *buffer);
+
+/**
+ * Returns the data and frees the buffer if the caller holds the only
+ * reference, so the allocation can be handed on without copying it.
+ * Returns NULL (and keeps the reference) if the buffer is shared or the
+ * data is only a part of its allocation.
+ */
+uint8_t *payload_buffer_steal(struct payload_buffer *buffer);
+
+#endif // PAYLOAD_BUFFER_H_INCLUDED
@@ -0,0 +1,105 @@
+#ifndef PERSISTENTSTORAGE_H_INCLUDED
+#define PERSISTENTSTORAGE_H_INCLUDED
+
+#include "ud3tn/bundle.h"
+#include "ud3tn/result.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Log-structured persistent bundle store.
+ *
+ * Bundles are appended in serialized form to segment files inside the
+ * configured directory. Deletions are recorded as tombstones. An in-memory
+ * index maps persistent IDs to their latest record. Segments containing
+ * mostly deleted or expired records are compacted in the background by
+ * copying the remaining live records to the current segment.
+ *
+ * Every record is protected by a CRC-32, so a record that was torn by a
+ * crash during a write is detected and cut off on the next startup.
+ *
+ * Currently, only POSIX provides an implementation; on all other platforms
+ * persistent_storage_init() fails.
+ */
+
+#define PERSISTENT_INVALID_ID 0
+
+/* The retention constraints of a bundle which are retained over a restart */
+#define PERSISTENT_STORAGE_RETAINED_CONSTRAINTS ( \
+	BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED | \
+	BUNDLE_RET_CONSTRAINT_FLAG_OWN)
+
+typedef uint32_t persistentid_t;
+
+/**
+ * @brief Open (or create) the store in the given directory and rebuild the
+ *	  in-memory index from the segment files found there.
+ */
+enum ud3tn_result persistent_storage_init(const char *directory);
+
+/**
+ * @brief Close the store. Previously stored bundles stay on disk.
+ */
+void persistent_storage_deinit(void);
+
+/**
+ * @brief Whether persistent_storage_init() succeeded before.
+ */
+bool persistent_storage_is_enabled(void);
+
+/**
+ * @brief Append the bundle to the store.
+ * @param pid The persistent ID of an earlier version of the bundle which is
+ *	      replaced, or PERSISTENT_INVALID_ID to store a new bundle
+ * @return The persistent ID or PERSISTENT_INVALID_ID on failure
+ */
+persistentid_t persistent_storage_add(struct bundle *bundle,
+				      persistentid_t pid);
+
+/**
+ * @brief Mark the bundle with the given persistent ID as deleted.
+ */
+void persistent_storage_delete(persistentid_t pid);
+
+/**
+ * @brief Load the bundle with the given persistent ID again, e.g. after
+ *	  its copy in memory has been freed.
+ *
+ * The record is read without blocking concurrent additions. The retention
+ * constraints are set as by persistent_storage_restore().
+ *
+ * @return The bundle or NULL if it is not stored or cannot be read
+ */
+struct bundle *persistent_storage_load(persistentid_t pid);
+
+/**
+ * @brief Load all non-expired bundles from the store.
+ *
+ * The callback takes over the ownership of each bundle. The retention
+ * constraints of the bundle are set to those it had when it was stored,
+ * limited to PERSISTENT_STORAGE_RETAINED_CONSTRAINTS.
+ * Expired bundles are deleted from the store instead of being passed on.
+ *
+ * @return The number of bundles passed to the callback
+ */
+uint32_t persistent_storage_restore(
+	void (*callback)(struct bundle *bundle, persistentid_t pid,
+			 void *param),
+	void *param);
+
+/**
+ * @brief Compact at most one segment that mostly contains records of
+ *	  deleted or expired bundles. The records are copied in batches of
+ *	  PERSISTENT_STORAGE_COMPACTION_BATCH_SIZE bytes, so bundles can be
+ *	  added and deleted concurrently.
+ * @return Whether a segment was compacted
+ */
+bool persistent_storage_compact(void);
+
+/**
+ * @brief Task periodically calling persistent_storage_compact().
+ */
+void persistent_storage_compaction_task(void *param);
+
+#endif /* PERSISTENTSTORAGE_H_INCLUDED */
@@ -0,0 +1,46 @@
+#ifndef POOL_H_INCLUDED
+#define POOL_H_INCLUDED
+
+#include "platform/hal_types.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct pool_stats {
+	/* Objects currently handed out */
+	uint32_t in_use;
+	/* Maximum of in_use since the pool has been created */
+	uint32_t peak;
+	/* Objects backed by heap memory, i.e. in use or in the free list */
+	uint32_t capacity;
+	/* Number of successful pool_alloc() calls */
+	uint32_t allocations;
+	/* Number of chunks requested from the heap */
+	uint32_t heap_allocations;
+};
+
+/**
+ * A pool of fixed-size objects. Objects are taken from a free list, which is
+ * refilled with chunks of OBJECT_POOL_CHUNK_SIZE objects from the heap.
+ * Chunks are never returned to the heap, keeping its fragmentation low.
+ * Pools have to be defined statically using POOL_INITIALIZER.
+ */
+struct pool {
+	const char *name;
+	size_t object_size;
+	Semaphore_t semaphore;
+	void *free_list;
+	struct pool_stats stats;
+};
+
+#define POOL_INITIALIZER(type, pool_name) { \
+	.name = (pool_name), \
+	.object_size = sizeof(type), \
+}
+
+void *pool_alloc(struct pool *pool);
+void pool_free(struct pool *pool, void *object);
+void pool_get_stats(struct pool *pool, struct pool_stats *stats);
+void pool_log_stats(struct pool *pool);
+
+#endif /* POOL_H_INCLUDED */
@@ -0,0 +1,66 @@
+#ifndef TIMER_SERVICE_H_INCLUDED
+#define TIMER_SERVICE_H_INCLUDED
+
+#include "ud3tn/timing_wheel.h"
+
+#include <stdint.h>
+
+/*
+ * The timing wheel shared by all subsystems which expire objects, e.g., the
+ * known bundle lists of the bundle processor shards and the epidemic router.
+ * It is advanced by whichever subsystem asks for the current time first, so
+ * the due slots are processed once per second, no matter how many
+ * subsystems have timers in the wheel.
+ *
+ * As the wheel may be advanced in the context of any task, expired timers
+ * are not handed to callbacks but moved to the queue they have been
+ * initialized with. The owning subsystem pops them under its own lock. The
+ * lock of the service is always taken last, i.e., all functions may be called
+ * while holding the lock of a subsystem.
+ */
+
+struct timer_queue {
+	struct timer *head;
+	struct timer *tail;
+};
+
+void timer_queue_init(struct timer_queue *queue);
+
+/* Initializes the timer to be moved to the queue as soon as it expires */
+void timer_service_init_timer(struct timer *timer, struct timer_queue *queue);
+
+/*
+ * Arms (or re-arms) the timer to expire as soon as the time passes deadline.
+ * It must not be in its queue, i.e., it has to be popped after expiring.
+ */
+void timer_service_add(struct timer *timer, uint64_t deadline);
+
+/* Disarms the timer, does nothing if it has already expired */
+void timer_service_cancel(struct timer *timer);
+
+/*
+ * Moves the timers with a deadline before now to their queues and returns
+ * how many have expired. The time of the service never goes back, earlier
+ * values of now are ignored.
+ */
+uint32_t timer_service_advance(uint64_t now);
+
+/*
+ * Removes the first expired timer from the queue if its deadline is before
+ * now, otherwise or if the queue is empty, NULL is returned.
+ */
+struct timer *timer_service_pop(struct timer_queue *queue, uint64_t now);
+
+/*
+ * Forgets all expired timers which have not been popped yet, e.g., because
+ * the objects containing them are freed.
+ */
+void timer_service_clear(struct timer_queue *queue);
+
+/* Returns the number of armed timers */
+uint32_t timer_service_count(void);
+
+/* Returns the first second which has not been processed yet */
+uint64_t timer_service_time(void);
+
+#endif /* TIMER_SERVICE_H_INCLUDED */
@@ -0,0 +1,81 @@
+#ifndef TIMING_WHEEL_H_INCLUDED
+#define TIMING_WHEEL_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A hierarchical timing wheel with a resolution of one second. Timers are
+ * embedded into the objects they belong to and sorted into slots of the
+ * level matching their distance to the current time; on advancing the
+ * wheel, only the slots which are due are touched and the timers of
+ * higher levels are cascaded down once per rotation. Thus, expiring
+ * timers costs O(expired) instead of O(stored).
+ *
+ * A wheel is not synchronized, the owner has to hold its own lock while
+ * adding, canceling and advancing. Callbacks are invoked in the context of
+ * timing_wheel_advance() and may add or cancel timers. The subsystems
+ * expiring their objects share one wheel, see timer_service.h.
+ */
+
+#define TIMING_WHEEL_SLOT_BITS 6
+#define TIMING_WHEEL_SLOTS (1 << TIMING_WHEEL_SLOT_BITS)
+/* Four levels cover 2^24 s (~194 days), later timers are re-sorted */
+#define TIMING_WHEEL_LEVELS 4
+
+struct timer;
+
+typedef void (*timer_callback_t)(struct timer *timer, void *context);
+
+struct timer {
+	struct timer *next;
+	/* Points to the pointer referencing the timer, NULL if not pending */
+	struct timer **pprev;
+	uint64_t deadline;
+	timer_callback_t callback;
+	void *context;
+};
+
+struct timing_wheel {
+	struct timer *slots[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS];
+	/* A bit is set for every non-empty slot */
+	uint64_t occupied[TIMING_WHEEL_LEVELS];
+	/* The next second which has not been processed yet */
+	uint64_t time;
+	uint32_t count;
+};
+
+void timer_init(struct timer *timer, timer_callback_t callback,
+		void *context);
+
+static inline bool timer_is_pending(const struct timer *timer)
+{
+	return timer->pprev != NULL;
+}
+
+/* Initializes an empty wheel starting at the given second */
+void timing_wheel_init(struct timing_wheel *wheel, uint64_t now);
+
+/*
+ * Arms (or re-arms) the timer to expire as soon as the time passes deadline.
+ * Deadlines which are already over expire with the next second processed.
+ */
+void timing_wheel_add(struct timing_wheel *wheel, struct timer *timer,
+		      uint64_t deadline);
+
+/* Disarms the timer, does nothing if it is not pending */
+void timing_wheel_cancel(struct timing_wheel *wheel, struct timer *timer);
+
+/*
+ * Invokes the callbacks of all timers with a deadline before now, second
+ * by second, and returns how many timers have expired.
+ */
+uint32_t timing_wheel_advance(struct timing_wheel *wheel, uint64_t now);
+
+static inline uint32_t timing_wheel_count(const struct timing_wheel *wheel)
+{
+	return wheel->count;
+}
+
+#endif /* TIMING_WHEEL_H_INCLUDED */
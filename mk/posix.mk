@@ -29,3 +29,9 @@ ifeq "$(type)" "release"
   LDFLAGS += -Wl,--gc-sections,--sort-common,--as-needed -flto \
              -Wl,-z,relro,-z,now,-z,noexecstack
 endif
+
+# Send and receive via io_uring in the TCP-based CLAs, falling back to epoll at
+# runtime if the kernel does not support the required features (Linux >= 6.0)
+ifeq "$(io_uring)" "yes"
+  CPPFLAGS += -DCLA_TCP_IO_URING
+endif
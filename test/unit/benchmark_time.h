@@ -0,0 +1,25 @@
+#ifndef BENCHMARK_TIME_H_INCLUDED
+#define BENCHMARK_TIME_H_INCLUDED
+
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Monotonic time for the POSIX benchmarks of the unit tests. In contrast to
+ * hal_time, it is not subject to the coarse clock and DTN time offset.
+ */
+
+static inline uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline uint64_t now_us(void)
+{
+	return now_ns() / 1000;
+}
+
+#endif /* BENCHMARK_TIME_H_INCLUDED */
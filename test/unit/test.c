@@ -8,9 +8,19 @@ void testud3tn(void)
 	RUN_TEST_GROUP(node);
 	RUN_TEST_GROUP(routingTable);
 	RUN_TEST_GROUP(bundleStorageManager);
+	RUN_TEST_GROUP(bundleProcessor);
 	RUN_TEST_GROUP(eidList);
 	RUN_TEST_GROUP(random);
 	RUN_TEST_GROUP(malloc);
+	RUN_TEST_GROUP(pool);
+	RUN_TEST_GROUP(eidTable);
+	RUN_TEST_GROUP(knownBundleList);
+	RUN_TEST_GROUP(timingWheel);
+	RUN_TEST_GROUP(timerService);
+	RUN_TEST_GROUP(txScheduler);
+	RUN_TEST_GROUP(txWindow);
+	RUN_TEST_GROUP(bundleReassembly);
+	RUN_TEST_GROUP(payloadBuffer);
 	RUN_TEST_GROUP(crc);
 	RUN_TEST_GROUP(bundle6Create);
 	RUN_TEST_GROUP(bundle6ParserSerializer);
@@ -27,5 +37,8 @@ void testud3tn(void)
 	RUN_TEST_GROUP(aap_serializer);
 #ifdef PLATFORM_POSIX
 	RUN_TEST_GROUP(simple_queue);
+	RUN_TEST_GROUP(halReply);
+	RUN_TEST_GROUP(halExecutor);
+	RUN_TEST_GROUP(persistentStorage);
 #endif // PLATFORM_POSIX
 }
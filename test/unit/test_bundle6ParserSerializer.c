@@ -3,6 +3,7 @@
 #include "bundle6/parser.h"
 
 #include "ud3tn/bundle.h"
+#include "ud3tn/eid_table.h"
 #include "ud3tn/node.h"
 
 #include "platform/hal_time.h"
@@ -34,8 +35,8 @@ TEST_SETUP(bundle6ParserSerializer)
 		BUNDLE_FLAG_REPORT_DELIVERY |
 		BUNDLE_V6_FLAG_CUSTODY_TRANSFER_REQUESTED
 	);
-	b->report_to = strdup("dtn:reportto");
-	b->current_custodian = strdup("dtn:custodian");
+	b->report_to = eid_intern("dtn:reportto");
+	b->current_custodian = eid_intern("dtn:custodian");
 
 	struct bundle_block *block = bundle_block_create(
 		BUNDLE_BLOCK_TYPE_HOP_COUNT
@@ -185,7 +186,93 @@ TEST(bundle6ParserSerializer, parse_and_serialize)
 	free(serializebuffer);
 }
 
+static int admit_calls;
+
+static bool reject_after_primary(const struct bundle *b, void *param)
+{
+	(void)param;
+	admit_calls++;
+	TEST_ASSERT_EQUAL_STRING("dtn:sourceeid", b->source);
+	TEST_ASSERT_EQUAL(1, b->sequence_number);
+	/* No block has been read yet */
+	TEST_ASSERT_NULL(b->blocks);
+	return false;
+}
+
+TEST(bundle6ParserSerializer, skip_rejected_bundle)
+{
+	const size_t serialized_size = bundle_get_serialized_size(b);
+	uint8_t *serializebuffer = malloc(serialized_size);
+	struct buf_info bi = {
+		.buf = serializebuffer,
+		.pos = 0,
+	};
+	struct bundle6_parser p;
+
+	TEST_ASSERT_NOT_NULL(serializebuffer);
+	bundle6_serialize(b, _write, &bi);
+	bundle6_parser_init(&p, verify_and_free_bundle, NULL);
+
+	/* The rejected bundle is consumed completely but not handed over */
+	p.admit_callback = reject_after_primary;
+	admit_calls = 0;
+	verify_ok = false;
+	TEST_ASSERT_EQUAL(serialized_size,
+			  bundle6_parser_read(&p, serializebuffer,
+					      serialized_size));
+	TEST_ASSERT_EQUAL(PARSER_STATUS_DONE, p.basedata->status);
+	TEST_ASSERT_EQUAL(1, admit_calls);
+	TEST_ASSERT_FALSE(verify_ok);
+
+	/* The next bundle is parsed as usual */
+	p.admit_callback = NULL;
+	bundle6_parser_reset(&p);
+	bundle6_parser_read(&p, serializebuffer, serialized_size);
+	TEST_ASSERT_EQUAL(PARSER_STATUS_DONE, p.basedata->status);
+	TEST_ASSERT_TRUE(verify_ok);
+
+	bundle6_parser_deinit(&p);
+	free(serializebuffer);
+}
+
+TEST(bundle6ParserSerializer, compact_layout)
+{
+	struct bundle *dup;
+
+	b = bundle_compact(b);
+	TEST_ASSERT_EQUAL(BUNDLE_LAYOUT_COMPACT, b->layout);
+	verify_ok = false;
+	verify_bundle(b);
+	TEST_ASSERT_TRUE(verify_ok);
+
+	/* Duplicates of compact bundles are compact, too */
+	dup = bundle_dup(b);
+	TEST_ASSERT_EQUAL(BUNDLE_LAYOUT_COMPACT, dup->layout);
+	TEST_ASSERT_TRUE(dup->payload_block->data != b->payload_block->data);
+	/* EIDs are interned and thus shared by both bundles */
+	TEST_ASSERT_TRUE(dup->source == b->source);
+	verify_ok = false;
+	verify_bundle(dup);
+	TEST_ASSERT_TRUE(verify_ok);
+
+	/* Parts of expanded bundles can be replaced */
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_expand(dup));
+	TEST_ASSERT_EQUAL(BUNDLE_LAYOUT_EXPANDED, dup->layout);
+	eid_release(dup->current_custodian);
+	dup->current_custodian = eid_intern("dtn:custodian");
+	verify_ok = false;
+	verify_bundle(dup);
+	TEST_ASSERT_TRUE(verify_ok);
+	bundle_free(dup);
+
+	/* Blocks can be removed without expanding */
+	b->blocks->next = bundle_block_entry_remove(b, b->blocks->next);
+	TEST_ASSERT_NULL(b->blocks->next);
+}
+
 TEST_GROUP_RUNNER(bundle6ParserSerializer)
 {
 	RUN_TEST_CASE(bundle6ParserSerializer, parse_and_serialize);
+	RUN_TEST_CASE(bundle6ParserSerializer, skip_rejected_bundle);
+	RUN_TEST_CASE(bundle6ParserSerializer, compact_layout);
 }
@@ -3,6 +3,7 @@
 #include "bundle7/fragment.h"
 
 #include "ud3tn/bundle.h"
+#include "ud3tn/eid_table.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,9 +39,9 @@ TEST(bundle7Fragmentation, fragment_bundle)
 	bundle->protocol_version = 7;
 	bundle->crc_type = BUNDLE_CRC_TYPE_32;
 
-	bundle->destination = strdup("dtn:GS2");
-	bundle->source = strdup("ipn:243.350");
-	bundle->report_to = strdup("dtn:none");
+	bundle->destination = eid_intern("dtn:GS2");
+	bundle->source = eid_intern("ipn:243.350");
+	bundle->report_to = eid_intern("dtn:none");
 
 	bundle->creation_timestamp_ms = 0;
 	bundle->sequence_number = 0;
@@ -349,6 +349,61 @@ TEST(bundle7Parser, crc32_verification)
 	bundle = NULL;
 }
 
+// ----------------------
+// Admission after header
+// ----------------------
+
+static int admit_calls;
+
+static bool reject_after_primary(const struct bundle *b, void *param)
+{
+	(void)param;
+	admit_calls++;
+
+	// No block has been read yet
+	TEST_ASSERT_NOT_NULL(b->source);
+	TEST_ASSERT_NULL(b->blocks);
+	return false;
+}
+
+TEST(bundle7Parser, skip_rejected_bundle)
+{
+	struct bundle7_parser state;
+	struct parser *parser = bundle7_parser_init(
+		&state,
+		&send_callback,
+		NULL
+	);
+
+	TEST_ASSERT_NOT_NULL(parser);
+	state.admit_callback = &reject_after_primary;
+	admit_calls = 0;
+
+	// The bundle is consumed completely (including the block CRC)
+	size_t parsed = bundle7_parser_read(&state, cbor_crc16_payload_block,
+		len_crc16_payload_block);
+
+	TEST_ASSERT_EQUAL(PARSER_STATUS_DONE, state.basedata->status);
+	TEST_ASSERT_EQUAL(parsed, len_crc16_payload_block);
+	TEST_ASSERT_EQUAL(1, admit_calls);
+
+	// but the send callback must not be called
+	TEST_ASSERT_NULL(state.bundle);
+	TEST_ASSERT_NULL(bundle);
+
+	// The next bundle is parsed as usual
+	state.admit_callback = NULL;
+	bundle7_parser_reset(&state);
+	parsed = bundle7_parser_read(&state, cbor_crc16_payload_block,
+		len_crc16_payload_block);
+
+	TEST_ASSERT_EQUAL(PARSER_STATUS_DONE, state.basedata->status);
+	TEST_ASSERT_NOT_NULL(bundle);
+	TEST_ASSERT_EQUAL(bundle->payload_block->crc.checksum, 0x60d7);
+
+	bundle7_parser_deinit(&state);
+}
+
 // --------------------
 // Invalid CRC Handling
 // --------------------
@@ -484,6 +539,7 @@ TEST_GROUP_RUNNER(bundle7Parser)
 	RUN_TEST_CASE(bundle7Parser, bundle_parser);
 	RUN_TEST_CASE(bundle7Parser, crc16_verification);
 	RUN_TEST_CASE(bundle7Parser, crc32_verification);
+	RUN_TEST_CASE(bundle7Parser, skip_rejected_bundle);
 	RUN_TEST_CASE(bundle7Parser, invalid_crc_handling);
 	RUN_TEST_CASE(bundle7Parser, status_report_parser);
 	RUN_TEST_CASE(bundle7Parser, hop_count);
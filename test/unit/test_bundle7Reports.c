@@ -1,6 +1,7 @@
 #include "bundle7/reports.h"
 
 #include "ud3tn/bundle.h"
+#include "ud3tn/eid_table.h"
 
 #include "unity_fixture.h"
 
@@ -23,9 +24,9 @@ static struct bundle *create_bundle(void)
 	bundle->protocol_version = 7;
 	bundle->proc_flags |= BUNDLE_FLAG_REPORT_STATUS_TIME;
 
-	bundle->destination = strdup("dtn:GS1");
-	bundle->source = strdup("ipn:243.350");
-	bundle->report_to = strdup("dtn:GS2");
+	bundle->destination = eid_intern("dtn:GS1");
+	bundle->source = eid_intern("ipn:243.350");
+	bundle->report_to = eid_intern("dtn:GS2");
 
 	struct bundle_block_list *entry;
 	struct bundle_block *block;
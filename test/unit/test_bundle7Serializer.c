@@ -11,6 +11,7 @@
 #include "platform/hal_io.h"
 
 #include "ud3tn/bundle.h"
+#include "ud3tn/eid_table.h"
 
 #include "unity_fixture.h"
 
@@ -70,9 +71,9 @@ TEST(bundle7Serializer, simple_bundle)
 		| BUNDLE_V6_FLAG_NORMAL_PRIORITY;
 	bundle->crc_type = BUNDLE_CRC_TYPE_NONE;
 
-	bundle->destination = strdup("dtn:GS2");
-	bundle->source = strdup("ipn:243.350");
-	bundle->report_to = strdup("dtn:none");
+	bundle->destination = eid_intern("dtn:GS2");
+	bundle->source = eid_intern("ipn:243.350");
+	bundle->report_to = eid_intern("dtn:none");
 
 	bundle->creation_timestamp_ms = 658489863000; // 2020-11-12T09:51:03
 	bundle->sequence_number = 0;
@@ -220,9 +221,9 @@ TEST(bundle7Serializer, crc16_generation)
 	bundle->proc_flags = BUNDLE_FLAG_NONE;
 	bundle->crc_type = BUNDLE_CRC_TYPE_16;
 
-	bundle->destination = strdup("dtn:GS2");
-	bundle->source = strdup("dtn:none");
-	bundle->report_to = strdup("dtn:none");
+	bundle->destination = eid_intern("dtn:GS2");
+	bundle->source = eid_intern("dtn:none");
+	bundle->report_to = eid_intern("dtn:none");
 
 	bundle->creation_timestamp_ms = 0;
 	bundle->sequence_number = 0;
@@ -335,9 +336,9 @@ TEST(bundle7Serializer, crc32_generation)
 	bundle->proc_flags = BUNDLE_FLAG_NONE;
 	bundle->crc_type = BUNDLE_CRC_TYPE_32;
 
-	bundle->destination = strdup("dtn:GS2");
-	bundle->source = strdup("dtn:none");
-	bundle->report_to = strdup("dtn:none");
+	bundle->destination = eid_intern("dtn:GS2");
+	bundle->source = eid_intern("dtn:none");
+	bundle->report_to = eid_intern("dtn:none");
 
 	bundle->creation_timestamp_ms = 0;
 	bundle->sequence_number = 0;
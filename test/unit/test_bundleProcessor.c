@@ -0,0 +1,326 @@
+#include "ud3tn/bundle.h"
+#include "ud3tn/bundle_processor.h"
+#include "ud3tn/bundle_storage_manager.h"
+#include "ud3tn/config.h"
+
+#include "bundle7/create.h"
+
+#include "routing/router_task.h"
+
+#include "platform/hal_io.h"
+#include "platform/hal_queue.h"
+#include "platform/hal_task.h"
+#include "platform/hal_time.h"
+
+#include "unity_fixture.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef PLATFORM_POSIX
+#include "benchmark_time.h"
+
+#include <pthread.h>
+#endif // PLATFORM_POSIX
+
+static QueueIdentifier_t queue;
+
+static struct bundle_processor_signal make_signal(
+	enum bundle_processor_signal_type type, bundleid_t bundle)
+{
+	return (struct bundle_processor_signal){
+		.type = type,
+		.reason = BUNDLE_SR_REASON_NO_INFO,
+		.bundle = bundle,
+		.extra = NULL,
+	};
+}
+
+TEST_GROUP(bundleProcessor);
+
+TEST_SETUP(bundleProcessor)
+{
+	queue = hal_queue_create(BUNDLE_QUEUE_LENGTH,
+				 sizeof(struct bundle_processor_signal));
+}
+
+TEST_TEAR_DOWN(bundleProcessor)
+{
+	hal_queue_delete(queue);
+}
+
+TEST(bundleProcessor, receive_signals)
+{
+	struct bundle_processor_signal signals[4];
+	struct bundle_processor_signal signal;
+	int i;
+
+	for (i = 0; i < 6; i++) {
+		signal = make_signal(BP_SIGNAL_BUNDLE_INCOMING, i + 1);
+		hal_queue_push_to_back(queue, &signal);
+	}
+	/* Waiting signals are taken up to the given maximum */
+	TEST_ASSERT_EQUAL(4, bundle_processor_receive_signals(
+		queue, signals, 4));
+	for (i = 0; i < 4; i++)
+		TEST_ASSERT_EQUAL(i + 1, signals[i].bundle);
+	TEST_ASSERT_EQUAL(2, bundle_processor_receive_signals(
+		queue, signals, 4));
+	TEST_ASSERT_EQUAL(6, signals[1].bundle);
+}
+
+TEST(bundleProcessor, coalesce_signals)
+{
+	struct bundle_processor_signal signals[] = {
+		make_signal(BP_SIGNAL_TRANSMISSION_SUCCESS, 1),
+		make_signal(BP_SIGNAL_TRANSMISSION_SUCCESS, 2),
+		/* Repeats the preceding signal for bundle 1 */
+		make_signal(BP_SIGNAL_TRANSMISSION_SUCCESS, 1),
+		make_signal(BP_SIGNAL_RESCHEDULE_BUNDLE, 2),
+		/* Bundle 2 has been re-scheduled in between */
+		make_signal(BP_SIGNAL_TRANSMISSION_SUCCESS, 2),
+		make_signal(BP_SIGNAL_BUNDLE_EXPIRED, 3),
+		make_signal(BP_SIGNAL_BUNDLE_EXPIRED, 3),
+		/* Not idempotent */
+		make_signal(BP_SIGNAL_RESCHEDULE_BUNDLE, 2),
+		make_signal(BP_SIGNAL_RESCHEDULE_BUNDLE, 2),
+	};
+	static const bundleid_t expected[] = { 1, 2, 2, 2, 3, 2, 2 };
+	const size_t count = sizeof(signals) / sizeof(signals[0]);
+	size_t kept, i;
+
+	kept = bundle_processor_coalesce_signals(signals, count);
+	TEST_ASSERT_EQUAL(sizeof(expected) / sizeof(expected[0]), kept);
+	for (i = 0; i < kept; i++)
+		TEST_ASSERT_EQUAL(expected[i], signals[i].bundle);
+	TEST_ASSERT_EQUAL(BP_SIGNAL_RESCHEDULE_BUNDLE, signals[2].type);
+	TEST_ASSERT_EQUAL(BP_SIGNAL_BUNDLE_EXPIRED, signals[4].type);
+}
+
+#ifdef PLATFORM_POSIX
+
+#define BENCHMARK_PRODUCERS 4
+#define BENCHMARK_BUNDLES_PER_PRODUCER 5000
+#define BENCHMARK_BUNDLES (BENCHMARK_PRODUCERS * BENCHMARK_BUNDLES_PER_PRODUCER)
+
+static const char *const benchmark_sink = "benchmark";
+static uint64_t latencies_ns[BENCHMARK_BUNDLES];
+static uint32_t benchmark_delivered;
+
+struct producer {
+	pthread_t thread;
+	QueueIdentifier_t bp_queue;
+	int index;
+};
+
+/* The BP tasks cannot be stopped, thus, they are shared by the tests below */
+static QueueIdentifier_t start_bundle_processor(void)
+{
+	static struct bundle_processor_task_parameters params;
+
+	if (params.signaling_queue != NULL)
+		return params.signaling_queue;
+	params.router_signaling_queue = hal_queue_create(
+		ROUTER_QUEUE_LENGTH, sizeof(struct router_signal));
+	params.signaling_queue = hal_queue_create(
+		BUNDLE_QUEUE_LENGTH, sizeof(struct bundle_processor_signal));
+	params.local_eid = "dtn://ud3tn.dtn";
+	params.status_reporting = false;
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_processor_start(&params));
+	return params.signaling_queue;
+}
+
+/* The payload carries the time the bundle has been handed to the BP */
+static void deliver_timed(struct bundle_adu data, void *param)
+{
+	uint64_t sent_ns;
+	uint32_t n;
+
+	(void)param;
+	if (bundle_adu_flatten(&data) == UD3TN_OK &&
+	    data.length == sizeof(sent_ns)) {
+		memcpy(&sent_ns, data.payload, sizeof(sent_ns));
+		n = __atomic_fetch_add(&benchmark_delivered, 1,
+				       __ATOMIC_RELAXED);
+		if (n < BENCHMARK_BUNDLES)
+			latencies_ns[n] = now_ns() - sent_ns;
+	}
+	bundle_adu_free_members(data);
+}
+
+/* Like a CLA handing over received bundles destined to a local agent */
+static void *produce(void *param)
+{
+	const struct producer *producer = param;
+	struct bundle *bundle;
+	uint64_t *payload;
+	bundleid_t id;
+	int i;
+
+	for (i = 0; i < BENCHMARK_BUNDLES_PER_PRODUCER; i++) {
+		payload = malloc(sizeof(*payload));
+		TEST_ASSERT_NOT_NULL(payload);
+		bundle = bundle7_create_local(
+			(uint8_t *)payload, sizeof(*payload),
+			"dtn://benchmark.dtn/", "dtn://ud3tn.dtn/benchmark",
+			hal_time_get_timestamp_s(), 3600, 0);
+		TEST_ASSERT_NOT_NULL(bundle);
+		bundle->sequence_number = (uint64_t)producer->index *
+			BENCHMARK_BUNDLES_PER_PRODUCER + i;
+		id = bundle_storage_add(bundle);
+		TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID, id);
+		*payload = now_ns();
+		bundle_processor_inform(producer->bp_queue, id,
+					BP_SIGNAL_BUNDLE_INCOMING,
+					BUNDLE_SR_REASON_NO_INFO);
+	}
+	return NULL;
+}
+
+static int compare_latencies(const void *a, const void *b)
+{
+	const uint64_t la = *(const uint64_t *)a, lb = *(const uint64_t *)b;
+
+	return la < lb ? -1 : la > lb;
+}
+
+/*
+ * Measures the signal handling of the running shards, i.e., the batched
+ * receiving, bundle_receive() up to the delivery to the agent.
+ */
+TEST(bundleProcessor, benchmark)
+{
+	QueueIdentifier_t bp_queue = start_bundle_processor();
+	struct producer producers[BENCHMARK_PRODUCERS];
+	uint64_t start, duration;
+	int p, i;
+
+	TEST_ASSERT_EQUAL(0, bundle_processor_perform_agent_action(
+		bp_queue, BP_SIGNAL_AGENT_REGISTER, benchmark_sink,
+		deliver_timed, NULL, true));
+
+	start = now_ns();
+	for (p = 0; p < BENCHMARK_PRODUCERS; p++) {
+		producers[p].bp_queue = bp_queue;
+		producers[p].index = p;
+		TEST_ASSERT_EQUAL(0, pthread_create(&producers[p].thread, NULL,
+						    produce, &producers[p]));
+	}
+	for (p = 0; p < BENCHMARK_PRODUCERS; p++)
+		pthread_join(producers[p].thread, NULL);
+	for (i = 0; i < 30000; i++) {
+		if (__atomic_load_n(&benchmark_delivered, __ATOMIC_RELAXED) ==
+				BENCHMARK_BUNDLES)
+			break;
+		hal_task_delay(1);
+	}
+	duration = now_ns() - start;
+	TEST_ASSERT_EQUAL(BENCHMARK_BUNDLES, benchmark_delivered);
+
+	TEST_ASSERT_EQUAL(0, bundle_processor_perform_agent_action(
+		bp_queue, BP_SIGNAL_AGENT_DEREGISTER, benchmark_sink,
+		NULL, NULL, true));
+
+	qsort(latencies_ns, BENCHMARK_BUNDLES, sizeof(uint64_t),
+	      compare_latencies);
+	LOGF("BundleProcessor: %d shard(s), batches of %d: %llu bundles/s, p50 latency %llu us, p99 latency %llu us",
+	     BUNDLE_PROCESSOR_SHARDS, BUNDLE_PROCESSOR_SIGNAL_BATCH_SIZE,
+	     (unsigned long long)BENCHMARK_BUNDLES * 1000000000 / duration,
+	     (unsigned long long)latencies_ns[BENCHMARK_BUNDLES / 2] / 1000,
+	     (unsigned long long)latencies_ns[BENCHMARK_BUNDLES * 99 / 100] /
+	     1000);
+}
+
+#define SHARDING_ADUS 64
+#define SHARDING_ADU_LENGTH 100
+
+static const char *const sharding_sink = "sink";
+static uint8_t sharding_adu[SHARDING_ADU_LENGTH];
+static uint32_t delivered;
+static uint32_t corrupted;
+
+static void deliver(struct bundle_adu data, void *param)
+{
+	(void)param;
+	if (bundle_adu_flatten(&data) != UD3TN_OK ||
+	    data.length != SHARDING_ADU_LENGTH ||
+	    memcmp(data.payload, sharding_adu, SHARDING_ADU_LENGTH) != 0)
+		__atomic_add_fetch(&corrupted, 1, __ATOMIC_RELAXED);
+	bundle_adu_free_members(data);
+	__atomic_add_fetch(&delivered, 1, __ATOMIC_RELAXED);
+}
+
+static void send_fragment(QueueIdentifier_t bp_queue,
+			  uint64_t sequence_number, size_t offset,
+			  size_t length)
+{
+	uint8_t *payload = malloc(length);
+	struct bundle *fragment;
+	bundleid_t id;
+
+	memcpy(payload, &sharding_adu[offset], length);
+	fragment = bundle7_create_local(
+		payload, length, "dtn://source.dtn/", "dtn://ud3tn.dtn/sink",
+		hal_time_get_timestamp_s(), 3600, 0);
+	TEST_ASSERT_NOT_NULL(fragment);
+	fragment->proc_flags |= BUNDLE_FLAG_IS_FRAGMENT;
+	fragment->sequence_number = sequence_number;
+	fragment->fragment_offset = offset;
+	fragment->total_adu_length = SHARDING_ADU_LENGTH;
+	id = bundle_storage_add(fragment);
+	TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID, id);
+	bundle_processor_inform(bp_queue, id, BP_SIGNAL_BUNDLE_INCOMING,
+				BUNDLE_SR_REASON_NO_INFO);
+}
+
+/*
+ * The fragments of an ADU are only reassembled if they are processed by the
+ * same shard.
+ */
+TEST(bundleProcessor, sharded_reassembly)
+{
+	QueueIdentifier_t bp_queue = start_bundle_processor();
+	int i;
+
+	for (i = 0; i < SHARDING_ADU_LENGTH; i++)
+		sharding_adu[i] = (uint8_t)(i * 3);
+
+	/* The agent is registered with every shard */
+	TEST_ASSERT_EQUAL(0, bundle_processor_perform_agent_action(
+		bp_queue, BP_SIGNAL_AGENT_REGISTER,
+		sharding_sink, deliver, NULL, true));
+	TEST_ASSERT_NOT_EQUAL(0, bundle_processor_perform_agent_action(
+		bp_queue, BP_SIGNAL_AGENT_REGISTER,
+		sharding_sink, deliver, NULL, true));
+
+	for (i = 0; i < SHARDING_ADUS; i++) {
+		send_fragment(bp_queue, i, 40, 60);
+		send_fragment(bp_queue, i, 0, 50);
+	}
+	for (i = 0; i < 5000; i++) {
+		if (__atomic_load_n(&delivered, __ATOMIC_RELAXED) ==
+				SHARDING_ADUS)
+			break;
+		hal_task_delay(1);
+	}
+	TEST_ASSERT_EQUAL(SHARDING_ADUS, delivered);
+	TEST_ASSERT_EQUAL(0, corrupted);
+
+	TEST_ASSERT_EQUAL(0, bundle_processor_perform_agent_action(
+		bp_queue, BP_SIGNAL_AGENT_DEREGISTER,
+		sharding_sink, NULL, NULL, true));
+}
+
+#endif // PLATFORM_POSIX
+
+TEST_GROUP_RUNNER(bundleProcessor)
+{
+	RUN_TEST_CASE(bundleProcessor, receive_signals);
+	RUN_TEST_CASE(bundleProcessor, coalesce_signals);
+#ifdef PLATFORM_POSIX
+	RUN_TEST_CASE(bundleProcessor, benchmark);
+	RUN_TEST_CASE(bundleProcessor, sharded_reassembly);
+#endif // PLATFORM_POSIX
+}
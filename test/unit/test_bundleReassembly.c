@@ -0,0 +1,264 @@
+#include "ud3tn/bundle.h"
+#include "ud3tn/bundle_reassembly.h"
+
+#include "bundle7/create.h"
+
+#include "platform/hal_io.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef PLATFORM_POSIX
+#include "benchmark_time.h"
+#endif // PLATFORM_POSIX
+
+#define ADU_LENGTH 1000
+#define MAX_ADU_LENGTH 65536
+#define CREATION_TIME 1000
+
+static struct reassembly_table table;
+static uint8_t adu_data[MAX_ADU_LENGTH];
+static size_t adu_length;
+static uint32_t released;
+
+static void release_fragment(struct bundle *fragment, void *param)
+{
+	(void)param;
+	bundle_free(fragment);
+	released++;
+}
+
+static struct bundle *create_fragment(uint64_t sequence_number,
+				      size_t offset, size_t length)
+{
+	uint8_t *payload = malloc(length);
+	struct bundle *fragment;
+
+	memcpy(payload, &adu_data[offset], length);
+	fragment = bundle7_create_local(
+		payload, length, "dtn://source.dtn/", "dtn://destination.dtn/",
+		CREATION_TIME, 100, 0);
+	fragment->proc_flags |= BUNDLE_FLAG_IS_FRAGMENT;
+	fragment->sequence_number = sequence_number;
+	fragment->fragment_offset = offset;
+	fragment->total_adu_length = adu_length;
+	return fragment;
+}
+
+TEST_GROUP(bundleReassembly);
+
+TEST_SETUP(bundleReassembly)
+{
+	int i;
+
+	for (i = 0; i < MAX_ADU_LENGTH; i++)
+		adu_data[i] = (uint8_t)(i * 7);
+	adu_length = ADU_LENGTH;
+	released = 0;
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_reassembly_init(&table));
+}
+
+TEST_TEAR_DOWN(bundleReassembly)
+{
+	bundle_reassembly_destroy(&table, release_fragment, NULL);
+}
+
+TEST(bundleReassembly, out_of_order_and_overlapping)
+{
+	static const size_t ranges[][2] = {
+		{ 500, 200 },
+		{ 0, 300 },
+		{ 250, 270 },
+		/* Duplicate */
+		{ 0, 300 },
+		{ 700, 300 },
+	};
+	const int count = sizeof(ranges) / sizeof(ranges[0]);
+	struct reassembly_entry *entry;
+	struct bundle_adu adu;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		entry = bundle_reassembly_add(
+			&table, create_fragment(1, ranges[i][0], ranges[i][1]));
+		TEST_ASSERT_NOT_NULL(entry);
+		TEST_ASSERT_EQUAL(i == count - 1,
+				  bundle_reassembly_is_complete(entry));
+	}
+	TEST_ASSERT_EQUAL(1, entry->interval_count);
+	TEST_ASSERT_EQUAL(ADU_LENGTH, entry->covered);
+
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_reassembly_take_adu(
+		&table, entry, &adu, release_fragment, NULL));
+	TEST_ASSERT_EQUAL(count, released);
+	TEST_ASSERT_EQUAL(0, table.count);
+
+	/* The duplicate does not contribute a segment */
+	TEST_ASSERT_NULL(adu.payload);
+	TEST_ASSERT_EQUAL(4, adu.segment_count);
+	TEST_ASSERT_EQUAL(ADU_LENGTH, adu.length);
+	TEST_ASSERT_FALSE(HAS_FLAG(adu.proc_flags, BUNDLE_FLAG_IS_FRAGMENT));
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_adu_flatten(&adu));
+	TEST_ASSERT_NULL(adu.segments);
+	TEST_ASSERT_EQUAL_MEMORY(adu_data, adu.payload, ADU_LENGTH);
+	bundle_adu_free_members(adu);
+}
+
+TEST(bundleReassembly, separate_adus)
+{
+	struct reassembly_entry *first, *second;
+	struct bundle_adu adu;
+
+	first = bundle_reassembly_add(&table, create_fragment(1, 0, 600));
+	second = bundle_reassembly_add(&table, create_fragment(2, 400, 600));
+	TEST_ASSERT_TRUE(first != second);
+	TEST_ASSERT_EQUAL(2, table.count);
+
+	/* Touching intervals are merged, gaps are kept */
+	TEST_ASSERT_TRUE(second == bundle_reassembly_add(
+		&table, create_fragment(2, 100, 200)));
+	TEST_ASSERT_TRUE(second == bundle_reassembly_add(
+		&table, create_fragment(2, 0, 100)));
+	TEST_ASSERT_EQUAL(2, second->interval_count);
+	TEST_ASSERT_EQUAL(900, second->covered);
+	TEST_ASSERT_FALSE(bundle_reassembly_is_complete(second));
+	TEST_ASSERT_TRUE(second == bundle_reassembly_add(
+		&table, create_fragment(2, 250, 200)));
+	TEST_ASSERT_EQUAL(1, second->interval_count);
+	TEST_ASSERT_TRUE(bundle_reassembly_is_complete(second));
+	TEST_ASSERT_FALSE(bundle_reassembly_is_complete(first));
+
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_reassembly_take_adu(
+		&table, second, &adu, release_fragment, NULL));
+	TEST_ASSERT_EQUAL(4, released);
+	TEST_ASSERT_EQUAL(1, table.count);
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_adu_flatten(&adu));
+	TEST_ASSERT_EQUAL_MEMORY(adu_data, adu.payload, ADU_LENGTH);
+	bundle_adu_free_members(adu);
+
+	/* Pending fragments are released on destruction */
+	bundle_reassembly_destroy(&table, release_fragment, NULL);
+	TEST_ASSERT_EQUAL(5, released);
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_reassembly_init(&table));
+}
+
+#ifdef PLATFORM_POSIX
+
+#define BENCHMARK_FRAGMENT_LENGTH 16
+#define BENCHMARK_FRAGMENTS (MAX_ADU_LENGTH / BENCHMARK_FRAGMENT_LENGTH)
+#define BENCHMARK_ROUNDS 10
+
+struct ordered_fragment {
+	struct bundle *bundle;
+	struct ordered_fragment *next;
+};
+
+/*
+ * Formerly, every fragment was sorted into a list which was then rescanned,
+ * and the payloads were copied into a new buffer once complete.
+ */
+static bool add_ordered_and_rescan(struct ordered_fragment **list,
+				   struct ordered_fragment *item)
+{
+	struct ordered_fragment **cur = list;
+	size_t position = 0;
+
+	while (*cur != NULL &&
+	       (*cur)->bundle->fragment_offset <= item->bundle->fragment_offset)
+		cur = &(*cur)->next;
+	item->next = *cur;
+	*cur = item;
+
+	for (item = *list; item != NULL; item = item->next) {
+		if (item->bundle->fragment_offset > position)
+			return false;
+		position = item->bundle->fragment_offset +
+			item->bundle->payload_block->length;
+		if (position >= item->bundle->total_adu_length)
+			return true;
+	}
+	return false;
+}
+
+static void copy_ordered(const struct ordered_fragment *list, uint8_t *buffer)
+{
+	for (; list != NULL; list = list->next)
+		memcpy(&buffer[list->bundle->fragment_offset],
+		       list->bundle->payload_block->data,
+		       list->bundle->payload_block->length);
+}
+
+TEST(bundleReassembly, benchmark)
+{
+	static struct bundle *fragments[BENCHMARK_FRAGMENTS];
+	static struct ordered_fragment items[BENCHMARK_FRAGMENTS];
+	static uint8_t copy[MAX_ADU_LENGTH];
+	struct ordered_fragment *list;
+	struct reassembly_entry *entry;
+	struct bundle_adu adu;
+	struct bundle *tmp;
+	uint64_t start, list_us = 0, table_us = 0;
+	uint32_t random_state = 2463534242;
+	int round, i, j;
+
+	adu_length = MAX_ADU_LENGTH;
+	for (round = 0; round < BENCHMARK_ROUNDS; round++) {
+		for (i = 0; i < BENCHMARK_FRAGMENTS; i++)
+			fragments[i] = create_fragment(
+				round, i * BENCHMARK_FRAGMENT_LENGTH,
+				BENCHMARK_FRAGMENT_LENGTH);
+		/* Fragments arrive in random order */
+		for (i = BENCHMARK_FRAGMENTS - 1; i > 0; i--) {
+			random_state ^= random_state << 13;
+			random_state ^= random_state >> 17;
+			random_state ^= random_state << 5;
+			j = random_state % (i + 1);
+			tmp = fragments[i];
+			fragments[i] = fragments[j];
+			fragments[j] = tmp;
+		}
+
+		list = NULL;
+		start = now_us();
+		for (i = 0; i < BENCHMARK_FRAGMENTS; i++) {
+			items[i].bundle = fragments[i];
+			TEST_ASSERT_EQUAL(i == BENCHMARK_FRAGMENTS - 1,
+					  add_ordered_and_rescan(&list, &items[i]));
+		}
+		copy_ordered(list, copy);
+		list_us += now_us() - start;
+		TEST_ASSERT_EQUAL_MEMORY(adu_data, copy, MAX_ADU_LENGTH);
+
+		start = now_us();
+		for (i = 0; i < BENCHMARK_FRAGMENTS; i++)
+			entry = bundle_reassembly_add(&table, fragments[i]);
+		TEST_ASSERT_TRUE(bundle_reassembly_is_complete(entry));
+		TEST_ASSERT_EQUAL(UD3TN_OK, bundle_reassembly_take_adu(
+			&table, entry, &adu, release_fragment, NULL));
+		table_us += now_us() - start;
+
+		TEST_ASSERT_EQUAL(UD3TN_OK, bundle_adu_flatten(&adu));
+		TEST_ASSERT_EQUAL_MEMORY(adu_data, adu.payload, MAX_ADU_LENGTH);
+		bundle_adu_free_members(adu);
+	}
+	TEST_ASSERT_EQUAL(BENCHMARK_ROUNDS * BENCHMARK_FRAGMENTS, released);
+
+	LOGF("BundleReassembly: %d fragments, %llu us per ADU (ordered list with rescan: %llu us)",
+	     BENCHMARK_FRAGMENTS,
+	     (unsigned long long)table_us / BENCHMARK_ROUNDS,
+	     (unsigned long long)list_us / BENCHMARK_ROUNDS);
+}
+
+#endif // PLATFORM_POSIX
+
+TEST_GROUP_RUNNER(bundleReassembly)
+{
+	RUN_TEST_CASE(bundleReassembly, out_of_order_and_overlapping);
+	RUN_TEST_CASE(bundleReassembly, separate_adus);
+#ifdef PLATFORM_POSIX
+	RUN_TEST_CASE(bundleReassembly, benchmark);
+#endif // PLATFORM_POSIX
+}
@@ -1,13 +1,25 @@
 #include "ud3tn/bundle.h"
 #include "ud3tn/bundle_storage_manager.h"
+#include "ud3tn/common.h"
+#include "ud3tn/config.h"
+#include "ud3tn/eid_table.h"
 
+#include "platform/hal_io.h"
 #include "platform/hal_random.h"
+#include "platform/hal_semaphore.h"
 
 #include "unity_fixture.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef PLATFORM_POSIX
+#include "benchmark_time.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#endif // PLATFORM_POSIX
+
 TEST_GROUP(bundleStorageManager);
 
 static const int BCNT = 32;
@@ -32,6 +44,8 @@ TEST_TEAR_DOWN(bundleStorageManager)
 {
 	uint16_t i;
 
+	bundle_storage_set_eviction_policy(BUNDLE_STORAGE_EVICT_NONE);
+	bundle_storage_set_eviction_handler(NULL, NULL);
 	for (i = 0; i < BCNT; i++)
 		bundle_free(test_bundles[i]);
 	free(test_bundles);
@@ -43,8 +57,11 @@ TEST(bundleStorageManager, add)
 	uint16_t i;
 
 	for (i = 0; i < BCNT; i++)
-		TEST_ASSERT_EQUAL_INT(i + 1,
+		TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID,
 			bundle_storage_add(test_bundles[i]));
+	for (i = 1; i < BCNT; i++)
+		TEST_ASSERT_NOT_EQUAL(test_bundles[i - 1]->id,
+			test_bundles[i]->id);
 	for (i = 0; i < BCNT; i++)
 		TEST_ASSERT_TRUE(bundle_storage_contains(test_bundles[i]->id));
 	for (i = 0; i < BCNT; i++)
@@ -62,7 +79,7 @@ TEST(bundleStorageManager, add_persistent)
 	struct bundle *bdl;
 
 	for (i = 0; i < BCNT; i++)
-		TEST_ASSERT_EQUAL_INT(i + 1 + BCNT,
+		TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID,
 			bundle_storage_add(test_bundles[i]));
 	for (i = 0; i < BCNT; i++)
 		TEST_ASSERT_TRUE(bundle_storage_persist(test_bundles[i]->id));
@@ -147,9 +164,679 @@ TEST(bundleStorageManager, rand)
 	}
 }
 
+TEST(bundleStorageManager, stale_id)
+{
+	bundleid_t old_id;
+
+	TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID,
+		bundle_storage_add(test_bundles[0]));
+	old_id = test_bundles[0]->id;
+	TEST_ASSERT_TRUE(bundle_storage_delete(old_id));
+	TEST_ASSERT_FALSE(bundle_storage_delete(old_id));
+
+	/* The freed slot must not be addressable by the old ID anymore */
+	test_bundles[0]->id = BUNDLE_INVALID_ID;
+	TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID,
+		bundle_storage_add(test_bundles[0]));
+	TEST_ASSERT_NOT_EQUAL(old_id, test_bundles[0]->id);
+	TEST_ASSERT_FALSE(bundle_storage_contains(old_id));
+	TEST_ASSERT_NULL(bundle_storage_get(old_id));
+	TEST_ASSERT_TRUE(bundle_storage_delete(test_bundles[0]->id));
+}
+
+/* Four of them fill the storage, the block data is never accessed */
+#define EVICT_BCNT 5
+#define EVICT_SIZE (BUNDLE_QUOTA / 4)
+
+static bundleid_t evicted[EVICT_BCNT];
+static int evicted_count;
+
+static void evict_sync(bundleid_t id, void *param)
+{
+	(void)param;
+	evicted[evicted_count++] = id;
+	TEST_ASSERT_TRUE(bundle_storage_delete(id));
+}
+
+static void evict_deferred(bundleid_t id, void *param)
+{
+	(void)param;
+	evicted[evicted_count++] = id;
+}
+
+static struct bundle *create_sized_bundle(void)
+{
+	struct bundle *b = bundle_init();
+
+	b->payload_block = bundle_block_create(BUNDLE_BLOCK_TYPE_PAYLOAD);
+	b->blocks = bundle_block_entry_create(b->payload_block);
+	b->payload_block->length = EVICT_SIZE;
+	b->creation_timestamp_ms = 1000000;
+	b->lifetime_ms = 1000000;
+	return b;
+}
+
+/* Fills the storage, adds the last bundle and returns the evicted index */
+static int fill_and_evict(struct bundle **b)
+{
+	int i;
+
+	evicted_count = 0;
+	for (i = 0; i < EVICT_BCNT; i++)
+		TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID,
+				      bundle_storage_add(b[i]));
+	TEST_ASSERT_EQUAL(1, evicted_count);
+	TEST_ASSERT_EQUAL((EVICT_BCNT - 1) * EVICT_SIZE,
+			  bundle_storage_get_usage());
+	for (i = 0; i < EVICT_BCNT; i++) {
+		if (b[i]->id == evicted[0])
+			break;
+	}
+	TEST_ASSERT_FALSE(bundle_storage_contains(evicted[0]));
+	return i;
+}
+
+static void free_sized_bundles(struct bundle **b)
+{
+	int i;
+
+	for (i = 0; i < EVICT_BCNT; i++) {
+		bundle_storage_delete(b[i]->id);
+		bundle_free(b[i]);
+	}
+	TEST_ASSERT_EQUAL(0, bundle_storage_get_usage());
+}
+
+TEST(bundleStorageManager, quota_without_eviction)
+{
+	struct bundle *b[EVICT_BCNT];
+	int i;
+
+	for (i = 0; i < EVICT_BCNT; i++)
+		b[i] = create_sized_bundle();
+	for (i = 0; i < EVICT_BCNT - 1; i++)
+		TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID,
+				      bundle_storage_add(b[i]));
+	TEST_ASSERT_EQUAL(BUNDLE_INVALID_ID, bundle_storage_add(b[i]));
+	TEST_ASSERT_EQUAL((EVICT_BCNT - 1) * EVICT_SIZE,
+			  bundle_storage_get_usage());
+	free_sized_bundles(b);
+}
+
+TEST(bundleStorageManager, evict_by_policy)
+{
+	struct bundle *b[EVICT_BCNT];
+	int i;
+
+	bundle_storage_set_eviction_handler(evict_sync, NULL);
+
+	bundle_storage_set_eviction_policy(BUNDLE_STORAGE_EVICT_OLDEST);
+	for (i = 0; i < EVICT_BCNT; i++)
+		b[i] = create_sized_bundle();
+	TEST_ASSERT_EQUAL(0, fill_and_evict(b));
+	free_sized_bundles(b);
+
+	bundle_storage_set_eviction_policy(
+		BUNDLE_STORAGE_EVICT_SOONEST_EXPIRING);
+	for (i = 0; i < EVICT_BCNT; i++)
+		b[i] = create_sized_bundle();
+	b[2]->lifetime_ms /= 2;
+	TEST_ASSERT_EQUAL(2, fill_and_evict(b));
+	free_sized_bundles(b);
+
+	bundle_storage_set_eviction_policy(
+		BUNDLE_STORAGE_EVICT_LOWEST_PRIORITY);
+	for (i = 0; i < EVICT_BCNT; i++) {
+		b[i] = create_sized_bundle();
+		b[i]->proc_flags = BUNDLE_V6_FLAG_NORMAL_PRIORITY;
+	}
+	b[1]->proc_flags = BUNDLE_FLAG_NONE;
+	TEST_ASSERT_EQUAL(1, fill_and_evict(b));
+	free_sized_bundles(b);
+
+	bundle_storage_set_eviction_policy(
+		BUNDLE_STORAGE_EVICT_MOST_FORWARDED);
+	for (i = 0; i < EVICT_BCNT; i++)
+		b[i] = create_sized_bundle();
+	for (i = 0; i < EVICT_BCNT - 1; i++)
+		bundle_storage_add(b[i]);
+	bundle_storage_note_transmission(b[3]->id);
+	bundle_storage_note_transmission(b[3]->id);
+	bundle_storage_note_transmission(b[1]->id);
+	evicted_count = 0;
+	TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID, bundle_storage_add(b[4]));
+	TEST_ASSERT_EQUAL(1, evicted_count);
+	TEST_ASSERT_EQUAL(b[3]->id, evicted[0]);
+	free_sized_bundles(b);
+}
+
+TEST(bundleStorageManager, evict_multiple)
+{
+	struct bundle *b[EVICT_BCNT];
+	int i;
+
+	bundle_storage_set_eviction_handler(evict_sync, NULL);
+	bundle_storage_set_eviction_policy(
+		BUNDLE_STORAGE_EVICT_SOONEST_EXPIRING);
+	for (i = 0; i < EVICT_BCNT; i++)
+		b[i] = create_sized_bundle();
+	b[3]->lifetime_ms /= 4;
+	b[1]->lifetime_ms /= 2;
+	/* The last bundle takes the space of two, the victims come in order */
+	b[EVICT_BCNT - 1]->payload_block->length = 2 * EVICT_SIZE;
+	for (i = 0; i < EVICT_BCNT - 1; i++)
+		bundle_storage_add(b[i]);
+	evicted_count = 0;
+	TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID, bundle_storage_add(b[i]));
+	TEST_ASSERT_EQUAL(2, evicted_count);
+	TEST_ASSERT_EQUAL(b[3]->id, evicted[0]);
+	TEST_ASSERT_EQUAL(b[1]->id, evicted[1]);
+	TEST_ASSERT_EQUAL((EVICT_BCNT - 1) * EVICT_SIZE,
+			  bundle_storage_get_usage());
+	free_sized_bundles(b);
+}
+
+TEST(bundleStorageManager, custody_is_never_evicted)
+{
+	struct bundle *b[EVICT_BCNT];
+	int i;
+
+	bundle_storage_set_eviction_handler(evict_sync, NULL);
+	bundle_storage_set_eviction_policy(BUNDLE_STORAGE_EVICT_OLDEST);
+	for (i = 0; i < EVICT_BCNT; i++)
+		b[i] = create_sized_bundle();
+	b[0]->ret_constraints = BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED;
+	TEST_ASSERT_EQUAL(1, fill_and_evict(b));
+	free_sized_bundles(b);
+
+	/* Nothing can be evicted, the new bundle is rejected */
+	for (i = 0; i < EVICT_BCNT; i++) {
+		b[i] = create_sized_bundle();
+		b[i]->ret_constraints = BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED;
+	}
+	for (i = 0; i < EVICT_BCNT - 1; i++)
+		bundle_storage_add(b[i]);
+	evicted_count = 0;
+	TEST_ASSERT_EQUAL(BUNDLE_INVALID_ID, bundle_storage_add(b[i]));
+	TEST_ASSERT_EQUAL(0, evicted_count);
+	free_sized_bundles(b);
+}
+
+TEST(bundleStorageManager, deferred_eviction)
+{
+	struct bundle *b[EVICT_BCNT + 1];
+	int i;
+
+	bundle_storage_set_eviction_handler(evict_deferred, NULL);
+	bundle_storage_set_eviction_policy(BUNDLE_STORAGE_EVICT_OLDEST);
+	for (i = 0; i <= EVICT_BCNT; i++)
+		b[i] = create_sized_bundle();
+	evicted_count = 0;
+	for (i = 0; i < EVICT_BCNT; i++)
+		bundle_storage_add(b[i]);
+
+	/* The victim stays stored until the handler deletes it... */
+	TEST_ASSERT_EQUAL(1, evicted_count);
+	TEST_ASSERT_EQUAL(b[0]->id, evicted[0]);
+	TEST_ASSERT_TRUE(bundle_storage_contains(b[0]->id));
+	/* ...but its bytes are considered free, it is not selected again */
+	TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID, bundle_storage_add(b[5]));
+	TEST_ASSERT_EQUAL(2, evicted_count);
+	TEST_ASSERT_EQUAL(b[1]->id, evicted[1]);
+
+	/* A cancelled eviction takes up space again */
+	bundle_storage_cancel_eviction(b[1]->id);
+	TEST_ASSERT_TRUE(bundle_storage_delete(b[0]->id));
+	TEST_ASSERT_EQUAL(EVICT_BCNT * EVICT_SIZE, bundle_storage_get_usage());
+	for (i = 0; i <= EVICT_BCNT; i++) {
+		bundle_storage_delete(b[i]->id);
+		bundle_free(b[i]);
+	}
+	TEST_ASSERT_EQUAL(0, bundle_storage_get_usage());
+}
+
+#ifdef PLATFORM_POSIX
+
+/* More bundles than could be addressed by a 16 bit ID */
+static const uint32_t MANY_BCNT = 70000;
+
+TEST(bundleStorageManager, many)
+{
+	struct bundle *bundles = calloc(MANY_BCNT, sizeof(struct bundle));
+	uint32_t i;
+
+	TEST_ASSERT_NOT_NULL(bundles);
+	for (i = 0; i < MANY_BCNT; i++)
+		TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID,
+			bundle_storage_add(&bundles[i]));
+	for (i = 0; i < MANY_BCNT; i++)
+		TEST_ASSERT_EQUAL_PTR(&bundles[i],
+			bundle_storage_get(bundles[i].id));
+	for (i = 0; i < MANY_BCNT; i += 2)
+		TEST_ASSERT_TRUE(bundle_storage_delete(bundles[i].id));
+	for (i = 0; i < MANY_BCNT; i++)
+		TEST_ASSERT_EQUAL(i % 2 != 0,
+			bundle_storage_contains(bundles[i].id));
+	for (i = 1; i < MANY_BCNT; i += 2)
+		TEST_ASSERT_TRUE(bundle_storage_delete(bundles[i].id));
+	free(bundles);
+}
+
+TEST(bundleStorageManager, acquire_drop)
+{
+	struct bundle *b = bundle_init();
+	bundleid_t id;
+
+	TEST_ASSERT_NOT_NULL(b);
+	id = bundle_storage_add(b);
+	TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID, id);
+	TEST_ASSERT_EQUAL_PTR(b, bundle_storage_acquire(id));
+	TEST_ASSERT_EQUAL_PTR(b, bundle_storage_acquire(id));
+
+	/* The bundle is gone from the storage but must stay accessible */
+	TEST_ASSERT_TRUE(bundle_storage_drop(id));
+	TEST_ASSERT_FALSE(bundle_storage_contains(id));
+	TEST_ASSERT_NULL(bundle_storage_acquire(id));
+	TEST_ASSERT_EQUAL(id, b->id);
+	bundle_storage_release(id);
+	TEST_ASSERT_EQUAL(id, b->id);
+
+	/* The slot is recycled after the last release, freeing the bundle */
+	bundle_storage_release(id);
+	TEST_ASSERT_NULL(bundle_storage_get(id));
+}
+
+TEST(bundleStorageManager, compact)
+{
+	static const uint8_t data[] = "PAYLOAD";
+	struct bundle *b = bundle_init();
+	struct bundle *compact;
+	bundleid_t id;
+
+	TEST_ASSERT_NOT_NULL(b);
+	b->payload_block = bundle_block_create(BUNDLE_BLOCK_TYPE_PAYLOAD);
+	b->blocks = bundle_block_entry_create(b->payload_block);
+	b->payload_block->data = malloc(sizeof(data));
+	memcpy(b->payload_block->data, data, sizeof(data));
+	b->payload_block->length = sizeof(data);
+	id = bundle_storage_add(b);
+	TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID, id);
+
+	/* The ID now resolves to the compact copy, the original is freed */
+	compact = bundle_storage_compact(id);
+	TEST_ASSERT_NOT_NULL(compact);
+	TEST_ASSERT_EQUAL(BUNDLE_LAYOUT_COMPACT, compact->layout);
+	TEST_ASSERT_EQUAL(id, compact->id);
+	TEST_ASSERT_EQUAL_PTR(compact, bundle_storage_get(id));
+	TEST_ASSERT_EQUAL_MEMORY(data, compact->payload_block->data,
+				 sizeof(data));
+	TEST_ASSERT_EQUAL(sizeof(data), bundle_storage_get_usage());
+
+	/* Compacting again keeps the bundle */
+	TEST_ASSERT_EQUAL_PTR(compact, bundle_storage_compact(id));
+	TEST_ASSERT_TRUE(bundle_storage_delete(id));
+	TEST_ASSERT_NULL(bundle_storage_compact(id));
+	bundle_free(compact);
+}
+
+TEST(bundleStorageManager, compact_while_acquired)
+{
+	static const uint8_t data[] = "PAYLOAD";
+	struct bundle *b = bundle_init();
+	struct bundle *compact;
+	bundleid_t id;
+
+	TEST_ASSERT_NOT_NULL(b);
+	b->source = eid_intern("dtn://source/");
+	b->payload_block = bundle_block_create(BUNDLE_BLOCK_TYPE_PAYLOAD);
+	b->blocks = bundle_block_entry_create(b->payload_block);
+	b->payload_block->data = malloc(sizeof(data));
+	memcpy(b->payload_block->data, data, sizeof(data));
+	b->payload_block->length = sizeof(data);
+	id = bundle_storage_add(b);
+	TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID, id);
+
+	/* E.g., a CLA task determining the shard of the bundle */
+	TEST_ASSERT_EQUAL_PTR(b, bundle_storage_acquire(id));
+	compact = bundle_storage_compact(id);
+	TEST_ASSERT_NOT_NULL(compact);
+	TEST_ASSERT_TRUE(b != compact);
+	TEST_ASSERT_EQUAL_PTR(compact, bundle_storage_get(id));
+
+	/* The former bundle stays intact until it is released */
+	TEST_ASSERT_EQUAL_PTR(compact->source, b->source);
+	TEST_ASSERT_EQUAL_MEMORY(data, b->payload_block->data, sizeof(data));
+	TEST_ASSERT_EQUAL_PTR(compact, bundle_storage_compact(id));
+	bundle_storage_release(id);
+
+	TEST_ASSERT_EQUAL_PTR(compact, bundle_storage_acquire(id));
+	bundle_storage_release(id);
+	TEST_ASSERT_TRUE(bundle_storage_delete(id));
+	bundle_free(compact);
+}
+
+#define STRESS_BCNT 1024
+#define STRESS_MAX_THREADS 8
+#define STRESS_DURATION_MS 500
+
+static struct {
+	bundleid_t ids[STRESS_BCNT];
+	bool stop;
+	bool failed;
+} stress;
+
+struct stress_reader {
+	pthread_t thread;
+	uint32_t seed;
+	uint64_t lookups;
+};
+
+static void *stress_read(void *param)
+{
+	struct stress_reader *reader = param;
+	struct bundle *b;
+	bundleid_t id;
+
+	while (!__atomic_load_n(&stress.stop, __ATOMIC_RELAXED)) {
+		reader->seed = reader->seed * 1103515245 + 12345;
+		id = __atomic_load_n(&stress.ids[reader->seed % STRESS_BCNT],
+				     __ATOMIC_RELAXED);
+		b = bundle_storage_acquire(id);
+		if (b != NULL) {
+			/* The bundle must not be freed or re-used meanwhile */
+			if (b->id != id)
+				__atomic_store_n(&stress.failed, true,
+						 __ATOMIC_RELAXED);
+			bundle_storage_release(id);
+		}
+		reader->lookups++;
+	}
+	return NULL;
+}
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t run_stress(int threads)
+{
+	struct stress_reader readers[STRESS_MAX_THREADS];
+	struct bundle *b;
+	uint64_t start, lookups = 0;
+	uint32_t i = 0;
+	int t;
+
+	stress.stop = false;
+	for (t = 0; t < threads; t++) {
+		readers[t].seed = t + 1;
+		readers[t].lookups = 0;
+		TEST_ASSERT_EQUAL(0, pthread_create(&readers[t].thread, NULL,
+						    stress_read, &readers[t]));
+	}
+	/* Concurrently replace bundles while the readers look them up */
+	start = now_ms();
+	while (now_ms() - start < STRESS_DURATION_MS) {
+		b = bundle_init();
+		TEST_ASSERT_NOT_NULL(b);
+		TEST_ASSERT_TRUE(bundle_storage_drop(stress.ids[i]));
+		__atomic_store_n(&stress.ids[i], bundle_storage_add(b),
+				 __ATOMIC_RELAXED);
+		i = (i + 1) % STRESS_BCNT;
+	}
+	__atomic_store_n(&stress.stop, true, __ATOMIC_RELAXED);
+	for (t = 0; t < threads; t++) {
+		pthread_join(readers[t].thread, NULL);
+		lookups += readers[t].lookups;
+	}
+	TEST_ASSERT_FALSE(stress.failed);
+	return lookups;
+}
+
+TEST(bundleStorageManager, concurrent_lookup)
+{
+	uint64_t lookups;
+	uint32_t i;
+	int threads;
+
+	for (i = 0; i < STRESS_BCNT; i++) {
+		stress.ids[i] = bundle_storage_add(bundle_init());
+		TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID, stress.ids[i]);
+	}
+	for (threads = 1; threads <= STRESS_MAX_THREADS; threads *= 2) {
+		lookups = run_stress(threads);
+		LOGF("bundleStorageManager: %d reader(s), %llu lookups/s",
+		     threads, (unsigned long long)lookups * 1000 /
+		     STRESS_DURATION_MS);
+	}
+	for (i = 0; i < STRESS_BCNT; i++)
+		TEST_ASSERT_TRUE(bundle_storage_drop(stress.ids[i]));
+}
+
+/*
+ * Reference for the lookup benchmark: the AVL tree the bundle storage used
+ * before the slot table. As there, every operation takes a semaphore.
+ */
+struct avl_node {
+	bundleid_t id;
+	struct bundle *bundle;
+	struct avl_node *child[2];
+	int8_t height;
+};
+
+static int8_t avl_height(const struct avl_node *node)
+{
+	return node == NULL ? 0 : node->height;
+}
+
+static void avl_update(struct avl_node *node)
+{
+	const int8_t left = avl_height(node->child[0]);
+	const int8_t right = avl_height(node->child[1]);
+
+	node->height = 1 + (left > right ? left : right);
+}
+
+/* Lifts the child on the given side, 0 rotates right, 1 rotates left */
+static struct avl_node *avl_rotate(struct avl_node *top, int side)
+{
+	struct avl_node *const new_top = top->child[side];
+
+	top->child[side] = new_top->child[!side];
+	new_top->child[!side] = top;
+	avl_update(top);
+	avl_update(new_top);
+	return new_top;
+}
+
+static struct avl_node *avl_balance(struct avl_node *node)
+{
+	const int balance = avl_height(node->child[0]) -
+		avl_height(node->child[1]);
+	int side;
+
+	avl_update(node);
+	if (balance >= -1 && balance <= 1)
+		return node;
+	side = balance < 0;
+	if (avl_height(node->child[side]->child[!side]) >
+	    avl_height(node->child[side]->child[side]))
+		node->child[side] = avl_rotate(node->child[side], !side);
+	return avl_rotate(node, side);
+}
+
+static struct avl_node *avl_insert(struct avl_node *root,
+				   struct avl_node *node)
+{
+	if (root == NULL)
+		return node;
+	root->child[node->id > root->id] =
+		avl_insert(root->child[node->id > root->id], node);
+	return avl_balance(root);
+}
+
+static struct avl_node *avl_remove(struct avl_node *root, bundleid_t id,
+				   struct avl_node **removed)
+{
+	struct avl_node *next;
+
+	if (root == NULL)
+		return NULL;
+	if (id != root->id) {
+		root->child[id > root->id] =
+			avl_remove(root->child[id > root->id], id, removed);
+		return avl_balance(root);
+	}
+	*removed = root;
+	if (root->child[0] == NULL || root->child[1] == NULL)
+		return root->child[root->child[0] == NULL];
+	/* Replace the node by its in-order successor */
+	next = root->child[1];
+	while (next->child[0] != NULL)
+		next = next->child[0];
+	next->child[1] = avl_remove(root->child[1], next->id, &next);
+	next->child[0] = root->child[0];
+	return avl_balance(next);
+}
+
+static struct bundle *avl_find(const struct avl_node *root, bundleid_t id)
+{
+	while (root != NULL && root->id != id)
+		root = root->child[id > root->id];
+	return root == NULL ? NULL : root->bundle;
+}
+
+/* Nanoseconds per add, get and delete */
+struct storage_costs {
+	uint64_t add, get, delete;
+};
+
+/* Bundles are looked up in an order spreading the accesses over memory */
+#define LOOKUP_STRIDE 7919
+
+static void bench_avl(struct bundle *bundles, uint32_t count,
+		      struct storage_costs *costs)
+{
+	struct avl_node *nodes = calloc(count, sizeof(struct avl_node));
+	Semaphore_t sem = hal_semaphore_init_binary();
+	struct avl_node *root = NULL, *removed;
+	uint64_t start;
+	uint32_t i, j;
+
+	TEST_ASSERT_NOT_NULL(nodes);
+	TEST_ASSERT_NOT_NULL(sem);
+	hal_semaphore_release(sem);
+
+	start = now_ns();
+	for (i = 0; i < count; i++) {
+		hal_semaphore_take_blocking(sem);
+		nodes[i].id = i + 1;
+		nodes[i].bundle = &bundles[i];
+		nodes[i].height = 1;
+		root = avl_insert(root, &nodes[i]);
+		hal_semaphore_release(sem);
+	}
+	costs->add = (now_ns() - start) / count;
+
+	start = now_ns();
+	for (i = 0, j = 0; i < count; i++, j = (j + LOOKUP_STRIDE) % count) {
+		hal_semaphore_take_blocking(sem);
+		TEST_ASSERT_EQUAL_PTR(&bundles[j], avl_find(root, j + 1));
+		hal_semaphore_release(sem);
+	}
+	costs->get = (now_ns() - start) / count;
+
+	start = now_ns();
+	for (i = 0, j = 0; i < count; i++, j = (j + LOOKUP_STRIDE) % count) {
+		hal_semaphore_take_blocking(sem);
+		removed = NULL;
+		root = avl_remove(root, j + 1, &removed);
+		TEST_ASSERT_EQUAL_PTR(&nodes[j], removed);
+		hal_semaphore_release(sem);
+	}
+	costs->delete = (now_ns() - start) / count;
+	TEST_ASSERT_NULL(root);
+
+	hal_semaphore_delete(sem);
+	free(nodes);
+}
+
+static void bench_slots(struct bundle *bundles, uint32_t count,
+			struct storage_costs *costs)
+{
+	uint64_t start;
+	uint32_t i, j;
+
+	for (i = 0; i < count; i++)
+		bundles[i].id = BUNDLE_INVALID_ID;
+
+	start = now_ns();
+	for (i = 0; i < count; i++)
+		bundle_storage_add(&bundles[i]);
+	costs->add = (now_ns() - start) / count;
+
+	start = now_ns();
+	for (i = 0, j = 0; i < count; i++, j = (j + LOOKUP_STRIDE) % count)
+		TEST_ASSERT_EQUAL_PTR(&bundles[j],
+				      bundle_storage_get(bundles[j].id));
+	costs->get = (now_ns() - start) / count;
+
+	start = now_ns();
+	for (i = 0, j = 0; i < count; i++, j = (j + LOOKUP_STRIDE) % count)
+		TEST_ASSERT_TRUE(bundle_storage_delete(bundles[j].id));
+	costs->delete = (now_ns() - start) / count;
+}
+
+TEST(bundleStorageManager, lookup_benchmark)
+{
+	static const uint32_t counts[] = { 1000, 65536, 1048576 };
+	const uint32_t max_count = counts[ARRAY_LENGTH(counts) - 1];
+	struct bundle *bundles = calloc(max_count, sizeof(struct bundle));
+	struct storage_costs avl, slots;
+	size_t i;
+
+	TEST_ASSERT_NOT_NULL(bundles);
+	for (i = 0; i < ARRAY_LENGTH(counts); i++) {
+		bench_avl(bundles, counts[i], &avl);
+		bench_slots(bundles, counts[i], &slots);
+		LOGF("bundleStorageManager: %lu bundles, AVL tree: add %llu ns, get %llu ns, delete %llu ns",
+		     (unsigned long)counts[i], (unsigned long long)avl.add,
+		     (unsigned long long)avl.get,
+		     (unsigned long long)avl.delete);
+		LOGF("bundleStorageManager: %lu bundles, slot table: add %llu ns, get %llu ns, delete %llu ns",
+		     (unsigned long)counts[i], (unsigned long long)slots.add,
+		     (unsigned long long)slots.get,
+		     (unsigned long long)slots.delete);
+		/* The lookup does not depend on the number of bundles */
+		if (counts[i] >= 65536)
+			TEST_ASSERT_TRUE(slots.get < avl.get);
+	}
+	TEST_ASSERT_EQUAL(0, bundle_storage_get_usage());
+	free(bundles);
+}
+
+#endif // PLATFORM_POSIX
+
 TEST_GROUP_RUNNER(bundleStorageManager)
 {
 	RUN_TEST_CASE(bundleStorageManager, add);
 	/*RUN_TEST_CASE(bundleStorageManager, add_persistent);*/
 	RUN_TEST_CASE(bundleStorageManager, rand);
+	RUN_TEST_CASE(bundleStorageManager, stale_id);
+	RUN_TEST_CASE(bundleStorageManager, quota_without_eviction);
+	RUN_TEST_CASE(bundleStorageManager, evict_by_policy);
+	RUN_TEST_CASE(bundleStorageManager, evict_multiple);
+	RUN_TEST_CASE(bundleStorageManager, custody_is_never_evicted);
+	RUN_TEST_CASE(bundleStorageManager, deferred_eviction);
+#ifdef PLATFORM_POSIX
+	RUN_TEST_CASE(bundleStorageManager, many);
+	RUN_TEST_CASE(bundleStorageManager, acquire_drop);
+	RUN_TEST_CASE(bundleStorageManager, compact);
+	RUN_TEST_CASE(bundleStorageManager, compact_while_acquired);
+	RUN_TEST_CASE(bundleStorageManager, concurrent_lookup);
+	RUN_TEST_CASE(bundleStorageManager, lookup_benchmark);
+#endif // PLATFORM_POSIX
 }
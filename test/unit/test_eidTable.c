@@ -0,0 +1,196 @@
+#include "ud3tn/bundle.h"
+#include "ud3tn/eid_table.h"
+
+#include "bundle7/create.h"
+
+#include "platform/hal_io.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EID_COUNT 1000
+
+static struct bundle *create_bundle(const char *source,
+				    const char *destination)
+{
+	char *payload = malloc(8);
+
+	memset(payload, 0x42, 8);
+	return bundle7_create_local(
+		payload, 8, source, destination, 0, 3600, 0);
+}
+
+TEST_GROUP(eidTable);
+
+TEST_SETUP(eidTable)
+{
+}
+
+TEST_TEAR_DOWN(eidTable)
+{
+}
+
+TEST(eidTable, intern_and_release)
+{
+	struct eid_table_stats before, after;
+	char buf[] = "dtn://node.dtn/agent";
+	char *a, *b, *c;
+
+	eid_table_get_stats(&before);
+	a = eid_intern("dtn://node.dtn/agent");
+	TEST_ASSERT_NOT_NULL(a);
+	TEST_ASSERT_EQUAL_STRING("dtn://node.dtn/agent", a);
+	b = eid_intern(buf);
+	TEST_ASSERT_TRUE(a == b);
+	c = eid_intern("dtn://node.dtn/other");
+	TEST_ASSERT_TRUE(a != c);
+	TEST_ASSERT_TRUE(eid_ref(c) == c);
+	TEST_ASSERT_NULL(eid_intern(NULL));
+	TEST_ASSERT_NULL(eid_ref(NULL));
+
+	eid_table_get_stats(&after);
+	TEST_ASSERT_EQUAL(before.entries + 2, after.entries);
+	TEST_ASSERT_EQUAL(before.references + 4, after.references);
+	TEST_ASSERT_EQUAL(before.hits + 1, after.hits);
+
+	eid_release(a);
+	eid_release(c);
+	eid_table_get_stats(&after);
+	TEST_ASSERT_EQUAL(before.entries + 2, after.entries);
+	eid_release(b);
+	eid_release(c);
+	eid_release(NULL);
+	eid_table_get_stats(&after);
+	TEST_ASSERT_EQUAL(before.entries, after.entries);
+	TEST_ASSERT_EQUAL(before.references, after.references);
+}
+
+TEST(eidTable, node_split)
+{
+	char *dtn = eid_intern("dtn://node.dtn/agent/sub");
+	char *dtn_node = eid_intern("dtn://node.dtn");
+	char *ipn = eid_intern("ipn:243.350");
+	char *none = eid_intern("dtn:none");
+
+	TEST_ASSERT_EQUAL(24, eid_length(dtn));
+	TEST_ASSERT_EQUAL(14, eid_node_length(dtn));
+	TEST_ASSERT_EQUAL_STRING("agent/sub", eid_service(dtn));
+	TEST_ASSERT_EQUAL(14, eid_node_length(dtn_node));
+	TEST_ASSERT_EQUAL_STRING("", eid_service(dtn_node));
+	TEST_ASSERT_EQUAL(7, eid_node_length(ipn));
+	TEST_ASSERT_EQUAL_STRING("350", eid_service(ipn));
+	TEST_ASSERT_EQUAL(8, eid_node_length(none));
+	TEST_ASSERT_EQUAL_STRING("", eid_service(none));
+
+	TEST_ASSERT_TRUE(eid_has_node(dtn, "dtn://node.dtn"));
+	TEST_ASSERT_TRUE(eid_has_node(dtn, "dtn://node.dtn/"));
+	TEST_ASSERT_TRUE(eid_has_node(dtn_node, "dtn://node.dtn/other"));
+	TEST_ASSERT_FALSE(eid_has_node(dtn, "dtn://node"));
+	TEST_ASSERT_FALSE(eid_has_node(dtn, "dtn://node.dtn2"));
+	TEST_ASSERT_TRUE(eid_has_node(ipn, "ipn:243.0"));
+	TEST_ASSERT_FALSE(eid_has_node(ipn, "ipn:24.350"));
+
+	eid_release(dtn);
+	eid_release(dtn_node);
+	eid_release(ipn);
+	eid_release(none);
+}
+
+TEST(eidTable, many_eids)
+{
+	static char *eids[EID_COUNT];
+	struct eid_table_stats before, after;
+	char buf[32];
+	int i;
+
+	eid_table_get_stats(&before);
+	for (i = 0; i < EID_COUNT; i++) {
+		snprintf(buf, sizeof(buf), "ipn:%d.1", i);
+		eids[i] = eid_intern(buf);
+		TEST_ASSERT_NOT_NULL(eids[i]);
+	}
+	eid_table_get_stats(&after);
+	TEST_ASSERT_EQUAL(before.entries + EID_COUNT, after.entries);
+	for (i = 0; i < EID_COUNT; i++) {
+		snprintf(buf, sizeof(buf), "ipn:%d.1", i);
+		TEST_ASSERT_TRUE(eid_intern(buf) == eids[i]);
+		eid_release(eids[i]);
+		eid_release(eids[i]);
+	}
+	eid_table_get_stats(&after);
+	TEST_ASSERT_EQUAL(before.entries, after.entries);
+}
+
+TEST(eidTable, shared_by_bundles)
+{
+	struct bundle *b1, *b2, *dup;
+
+	b1 = create_bundle("dtn://source.dtn/", "dtn://destination.dtn/");
+	b2 = create_bundle("dtn://source.dtn/", "dtn://destination.dtn/");
+	TEST_ASSERT_NOT_NULL(b1);
+	TEST_ASSERT_NOT_NULL(b2);
+	TEST_ASSERT_TRUE(b1->source == b2->source);
+	TEST_ASSERT_TRUE(b1->destination == b2->destination);
+	dup = bundle_dup(b1);
+	TEST_ASSERT_NOT_NULL(dup);
+	TEST_ASSERT_TRUE(dup->source == b1->source);
+	bundle_free(b1);
+	bundle_free(b2);
+	TEST_ASSERT_EQUAL_STRING("dtn://source.dtn/", dup->source);
+	bundle_free(dup);
+}
+
+#ifdef PLATFORM_POSIX
+
+#define BENCHMARK_BUNDLES 1000
+#define BENCHMARK_ENDPOINTS 4
+
+TEST(eidTable, benchmark)
+{
+	static struct bundle *bundles[BENCHMARK_BUNDLES];
+	struct eid_table_stats before, after;
+	char source[32], destination[32];
+	unsigned long string_bytes = 0;
+	int i;
+
+	eid_table_get_stats(&before);
+	for (i = 0; i < BENCHMARK_BUNDLES; i++) {
+		snprintf(source, sizeof(source), "dtn://node%d.dtn/agent",
+			 i % BENCHMARK_ENDPOINTS);
+		snprintf(destination, sizeof(destination),
+			 "dtn://node%d.dtn/agent",
+			 (i + 1) % BENCHMARK_ENDPOINTS);
+		bundles[i] = create_bundle(source, destination);
+		TEST_ASSERT_NOT_NULL(bundles[i]);
+		/* Formerly, every bundle had its own copy of its EIDs */
+		string_bytes += strlen(bundles[i]->source) + 1 +
+			strlen(bundles[i]->destination) + 1 +
+			strlen(bundles[i]->report_to) + 1;
+	}
+	eid_table_get_stats(&after);
+	LOGF("EID table: %d bundles with %d endpoints use %lu bytes for EIDs, formerly %lu bytes in %d allocations",
+	     BENCHMARK_BUNDLES, BENCHMARK_ENDPOINTS,
+	     (unsigned long)(after.bytes - before.bytes), string_bytes,
+	     BENCHMARK_BUNDLES * 3);
+	TEST_ASSERT_TRUE(after.bytes - before.bytes < string_bytes);
+	eid_table_log_stats();
+	for (i = 0; i < BENCHMARK_BUNDLES; i++)
+		bundle_free(bundles[i]);
+}
+
+#endif // PLATFORM_POSIX
+
+TEST_GROUP_RUNNER(eidTable)
+{
+	RUN_TEST_CASE(eidTable, intern_and_release);
+	RUN_TEST_CASE(eidTable, node_split);
+	RUN_TEST_CASE(eidTable, many_eids);
+	RUN_TEST_CASE(eidTable, shared_by_bundles);
+#ifdef PLATFORM_POSIX
+	RUN_TEST_CASE(eidTable, benchmark);
+#endif // PLATFORM_POSIX
+}
@@ -0,0 +1,165 @@
+#ifdef PLATFORM_POSIX
+
+#include "platform/hal_config.h"
+#include "platform/hal_executor.h"
+#include "platform/hal_io.h"
+
+#include "unity_fixture.h"
+
+#include <pthread.h>
+#include <time.h>
+
+TEST_GROUP(halExecutor);
+
+TEST_SETUP(halExecutor)
+{
+}
+
+TEST_TEAR_DOWN(halExecutor)
+{
+}
+
+#define EXECUTOR_THREADS 4
+#define EXECUTOR_SUBMISSIONS 10000
+
+struct counting_work {
+	struct hal_work work;
+	// submissions announced before hal_work_submit()
+	int submitted;
+	// submissions seen by the latest run
+	int seen;
+	int runs;
+	int in_run;
+	int overlaps;
+	// time each run blocks the worker
+	int run_duration_ms;
+};
+
+static void count_run(struct hal_work *work)
+{
+	struct counting_work *cw = (struct counting_work *)work;
+
+	if (__atomic_exchange_n(&cw->in_run, 1, __ATOMIC_ACQ_REL))
+		__atomic_add_fetch(&cw->overlaps, 1, __ATOMIC_RELAXED);
+	if (cw->run_duration_ms)
+		nanosleep(&(struct timespec){
+			.tv_nsec = cw->run_duration_ms * 1000000L }, NULL);
+	__atomic_store_n(&cw->seen,
+			 __atomic_load_n(&cw->submitted, __ATOMIC_ACQUIRE),
+			 __ATOMIC_RELEASE);
+	__atomic_add_fetch(&cw->runs, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&cw->in_run, 0, __ATOMIC_RELEASE);
+}
+
+static void *submit_work(void *param)
+{
+	struct counting_work *cw = param;
+	int i;
+
+	for (i = 0; i < EXECUTOR_SUBMISSIONS; i++) {
+		__atomic_add_fetch(&cw->submitted, 1, __ATOMIC_RELEASE);
+		hal_work_submit(&cw->work);
+	}
+	return NULL;
+}
+
+TEST(halExecutor, test_ExecutorRunsAfterSubmit)
+{
+#if HAL_EXECUTOR_WORKERS
+	const int total = EXECUTOR_THREADS * EXECUTOR_SUBMISSIONS;
+	struct counting_work cw = { .run_duration_ms = 0 };
+	pthread_t threads[EXECUTOR_THREADS];
+	int i;
+
+	hal_work_init(&cw.work, count_run);
+	for (i = 0; i < EXECUTOR_THREADS; i++)
+		TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL,
+						    submit_work, &cw));
+	for (i = 0; i < EXECUTOR_THREADS; i++)
+		pthread_join(threads[i], NULL);
+	// the last submission is followed by a run seeing all of them
+	for (i = 0; i < 1000; i++) {
+		if (__atomic_load_n(&cw.seen, __ATOMIC_ACQUIRE) == total)
+			break;
+		nanosleep(&(struct timespec){ .tv_nsec = 1000000L }, NULL);
+	}
+	hal_work_cancel_sync(&cw.work);
+	TEST_ASSERT_EQUAL_INT(total, cw.seen);
+	TEST_ASSERT_EQUAL_INT(0, cw.overlaps);
+	// submissions during a pending run were coalesced
+	TEST_ASSERT_TRUE(cw.runs >= 1 && cw.runs <= total);
+	LOGF("Executor: %d submissions led to %d runs", total, cw.runs);
+#endif // HAL_EXECUTOR_WORKERS
+}
+
+TEST(halExecutor, test_ExecutorCancelSync)
+{
+#if HAL_EXECUTOR_WORKERS
+	struct counting_work cw = { .run_duration_ms = 50 };
+
+	hal_work_init(&cw.work, count_run);
+	hal_work_submit(&cw.work);
+	while (!__atomic_load_n(&cw.in_run, __ATOMIC_ACQUIRE))
+		nanosleep(&(struct timespec){ .tv_nsec = 1000000L }, NULL);
+	// requests a rerun which is dropped by the cancellation
+	hal_work_submit(&cw.work);
+	hal_work_cancel_sync(&cw.work);
+	TEST_ASSERT_EQUAL_INT(0, cw.in_run);
+	TEST_ASSERT_EQUAL_INT(1, cw.runs);
+	nanosleep(&(struct timespec){ .tv_nsec = 100000000L }, NULL);
+	TEST_ASSERT_EQUAL_INT(1, cw.runs);
+
+	// a queued item is removed without running
+	cw.run_duration_ms = 0;
+	hal_work_submit(&cw.work);
+	hal_work_cancel_sync(&cw.work);
+	TEST_ASSERT_TRUE(cw.runs <= 2);
+	TEST_ASSERT_EQUAL_INT(0, cw.in_run);
+#endif // HAL_EXECUTOR_WORKERS
+}
+
+static void wait_for_runs(struct counting_work *cw, int runs, int max_ms)
+{
+	int i;
+
+	for (i = 0; i < max_ms; i++) {
+		if (__atomic_load_n(&cw->runs, __ATOMIC_ACQUIRE) >= runs)
+			break;
+		nanosleep(&(struct timespec){ .tv_nsec = 1000000L }, NULL);
+	}
+}
+
+TEST(halExecutor, test_ExecutorSubmitDelayed)
+{
+#if HAL_EXECUTOR_WORKERS
+	struct counting_work cw = { .run_duration_ms = 0 };
+
+	hal_work_init(&cw.work, count_run);
+	hal_work_submit_delayed(&cw.work, 100);
+	nanosleep(&(struct timespec){ .tv_nsec = 20000000L }, NULL);
+	TEST_ASSERT_EQUAL_INT(0, cw.runs);
+	wait_for_runs(&cw, 1, 1000);
+	TEST_ASSERT_EQUAL_INT(1, cw.runs);
+
+	// a submission without delay overrides the pending deadline
+	hal_work_submit_delayed(&cw.work, 10000);
+	hal_work_submit(&cw.work);
+	wait_for_runs(&cw, 2, 1000);
+	TEST_ASSERT_EQUAL_INT(2, cw.runs);
+
+	// a delayed item is removed by the cancellation
+	hal_work_submit_delayed(&cw.work, 50);
+	hal_work_cancel_sync(&cw.work);
+	nanosleep(&(struct timespec){ .tv_nsec = 100000000L }, NULL);
+	TEST_ASSERT_EQUAL_INT(2, cw.runs);
+#endif // HAL_EXECUTOR_WORKERS
+}
+
+TEST_GROUP_RUNNER(halExecutor)
+{
+	RUN_TEST_CASE(halExecutor, test_ExecutorRunsAfterSubmit);
+	RUN_TEST_CASE(halExecutor, test_ExecutorCancelSync);
+	RUN_TEST_CASE(halExecutor, test_ExecutorSubmitDelayed);
+}
+
+#endif // PLATFORM_POSIX
@@ -0,0 +1,75 @@
+#ifdef PLATFORM_POSIX
+
+#include "platform/hal_reply.h"
+#include "platform/hal_semaphore.h"
+
+#include "ud3tn/result.h"
+
+#include "unity_fixture.h"
+
+#include <pthread.h>
+
+TEST_GROUP(halReply);
+
+TEST_SETUP(halReply)
+{
+}
+
+TEST_TEAR_DOWN(halReply)
+{
+}
+
+#define REPLY_THREADS 3
+#define REPLY_ROUNDS 1000
+
+struct reply_poster {
+	pthread_t thread;
+	struct hal_reply *reply;
+	int result;
+};
+
+static void *post_reply(void *param)
+{
+	struct reply_poster *p = param;
+
+	hal_reply_post(p->reply, p->result);
+	return NULL;
+}
+
+TEST(halReply, test_ReplyFromThreads)
+{
+	struct reply_poster posters[REPLY_THREADS];
+	struct hal_reply reply;
+	Semaphore_t waiter = NULL;
+	int i, round;
+
+	// the slot can be reused without setting up a new semaphore
+	for (round = 0; round < REPLY_ROUNDS; round++) {
+		TEST_ASSERT_EQUAL(UD3TN_OK,
+				  hal_reply_init(&reply, REPLY_THREADS));
+		if (round == 0)
+			waiter = reply.waiter;
+		TEST_ASSERT_EQUAL_PTR(waiter, reply.waiter);
+		for (i = 0; i < REPLY_THREADS; i++) {
+			posters[i] = (struct reply_poster){
+				.reply = &reply,
+				// one of them fails every other round
+				.result = (i == 1 && round % 2) ? -1 : 0,
+			};
+			TEST_ASSERT_EQUAL(0, pthread_create(
+				&posters[i].thread, NULL, post_reply,
+				&posters[i]));
+		}
+		TEST_ASSERT_EQUAL_INT(round % 2 ? -1 : 0,
+				      hal_reply_wait(&reply));
+		for (i = 0; i < REPLY_THREADS; i++)
+			pthread_join(posters[i].thread, NULL);
+	}
+}
+
+TEST_GROUP_RUNNER(halReply)
+{
+	RUN_TEST_CASE(halReply, test_ReplyFromThreads);
+}
+
+#endif // PLATFORM_POSIX
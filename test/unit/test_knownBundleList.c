@@ -0,0 +1,202 @@
+#include "ud3tn/bundle.h"
+#include "ud3tn/known_bundle_list.h"
+#include "ud3tn/timer_service.h"
+
+#include "bundle7/create.h"
+
+#include "platform/hal_io.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef PLATFORM_POSIX
+#include "benchmark_time.h"
+#endif // PLATFORM_POSIX
+
+static uint64_t creation_time_s;
+static struct known_bundle_list *list;
+static struct bundle *bundle;
+
+TEST_GROUP(knownBundleList);
+
+TEST_SETUP(knownBundleList)
+{
+	char *payload = malloc(8);
+
+	/*
+	 * Expiry follows the shared timer service, which previous tests may
+	 * have advanced beyond the current time
+	 */
+	list = known_bundle_list_create();
+	creation_time_s = timer_service_time();
+	memset(payload, 0x42, 8);
+	bundle = bundle7_create_local(
+		payload, 8, "dtn://source.dtn/", "dtn://destination.dtn/",
+		creation_time_s, 100, 0);
+}
+
+TEST_TEAR_DOWN(knownBundleList)
+{
+	known_bundle_list_destroy(list);
+	bundle_free(bundle);
+}
+
+static uint32_t count_entries(void)
+{
+	uint32_t count = 0;
+
+	known_bundle_list_lock(list);
+	KNOWN_BUNDLE_LIST_FOREACH(list, entry) {
+		count++;
+	}
+	known_bundle_list_unlock(list);
+	return count;
+}
+
+TEST(knownBundleList, add_and_expire)
+{
+	int i;
+
+	TEST_ASSERT_NOT_NULL(list);
+	for (i = 0; i < 1000; i++) {
+		bundle->sequence_number = i;
+		/* Deadlines are not inserted in order */
+		bundle->lifetime_ms = ((i * 7) % 1000) * 1000;
+		TEST_ASSERT_FALSE(known_bundle_list_add(list, bundle));
+	}
+	TEST_ASSERT_EQUAL(1000, known_bundle_list_count(list));
+	TEST_ASSERT_EQUAL(1000, count_entries());
+	for (i = 0; i < 1000; i++) {
+		bundle->sequence_number = i;
+		TEST_ASSERT_TRUE(known_bundle_list_add(list, bundle));
+	}
+	TEST_ASSERT_EQUAL(1000, known_bundle_list_count(list));
+
+	/* Different fragments of the same bundle are distinct */
+	bundle->sequence_number = 0;
+	bundle->fragment_offset = 8;
+	TEST_ASSERT_FALSE(known_bundle_list_add(list, bundle));
+	bundle->fragment_offset = 0;
+	known_bundle_list_remove_before(list, creation_time_s + 1);
+	TEST_ASSERT_EQUAL(1000, known_bundle_list_count(list));
+
+	/* Entries are popped in the order of their deadline */
+	struct known_bundle_list_entry *e = known_bundle_list_pop_before(
+		list, creation_time_s + 2);
+
+	TEST_ASSERT_NOT_NULL(e);
+	TEST_ASSERT_EQUAL(creation_time_s + 1, e->deadline);
+	known_bundle_list_free_entry(e);
+	known_bundle_list_remove_before(list, creation_time_s + 500);
+	TEST_ASSERT_EQUAL(501, known_bundle_list_count(list));
+	TEST_ASSERT_EQUAL(501, count_entries());
+	known_bundle_list_lock(list);
+	KNOWN_BUNDLE_LIST_FOREACH(list, entry) {
+		TEST_ASSERT_TRUE(entry->deadline >= creation_time_s + 500);
+	}
+	known_bundle_list_unlock(list);
+
+	/* Expired entries are forgotten */
+	bundle->sequence_number = 1;
+	TEST_ASSERT_FALSE(known_bundle_list_add(list, bundle));
+	known_bundle_list_remove_before(list, creation_time_s + 1000);
+	TEST_ASSERT_EQUAL(0, known_bundle_list_count(list));
+	TEST_ASSERT_EQUAL(0, count_entries());
+}
+
+TEST(knownBundleList, reassembled_parent)
+{
+	bundle->proc_flags |= BUNDLE_FLAG_IS_FRAGMENT;
+	bundle->total_adu_length = 64;
+	TEST_ASSERT_FALSE(
+		known_bundle_list_contains_reassembled_parent(list, bundle));
+	TEST_ASSERT_FALSE(known_bundle_list_add(list, bundle));
+	TEST_ASSERT_FALSE(
+		known_bundle_list_contains_reassembled_parent(list, bundle));
+	TEST_ASSERT_FALSE(
+		known_bundle_list_add_reassembled_parent(list, bundle));
+	TEST_ASSERT_TRUE(
+		known_bundle_list_contains_reassembled_parent(list, bundle));
+	TEST_ASSERT_TRUE(
+		known_bundle_list_add_reassembled_parent(list, bundle));
+	bundle->sequence_number++;
+	TEST_ASSERT_FALSE(
+		known_bundle_list_contains_reassembled_parent(list, bundle));
+}
+
+#ifdef PLATFORM_POSIX
+
+#define BENCHMARK_ENTRIES 100000
+#define BENCHMARK_LINEAR_LOOKUPS 100
+
+TEST(knownBundleList, benchmark)
+{
+	uint64_t start, add_us, lookup_us, linear_us, expire_us;
+	bool found;
+	int i;
+
+	start = now_us();
+	for (i = 0; i < BENCHMARK_ENTRIES; i++) {
+		bundle->sequence_number = i;
+		bundle->lifetime_ms = (i % 3600) * 1000;
+		TEST_ASSERT_FALSE(known_bundle_list_add(list, bundle));
+	}
+	add_us = now_us() - start;
+	TEST_ASSERT_EQUAL(BENCHMARK_ENTRIES, known_bundle_list_count(list));
+
+	/* Every incoming bundle is checked against the list */
+	start = now_us();
+	for (i = 0; i < BENCHMARK_ENTRIES; i++) {
+		bundle->sequence_number = i;
+		TEST_ASSERT_TRUE(known_bundle_list_add(list, bundle));
+	}
+	lookup_us = now_us() - start;
+
+	/* A linear walk, as done by the former sorted list */
+	start = now_us();
+	for (i = 0; i < BENCHMARK_LINEAR_LOOKUPS; i++) {
+		bundle->sequence_number = i * (BENCHMARK_ENTRIES /
+					       BENCHMARK_LINEAR_LOOKUPS);
+		found = false;
+		known_bundle_list_lock(list);
+		KNOWN_BUNDLE_LIST_FOREACH(list, entry) {
+			if (bundle_is_equal(bundle,
+					    &entry->unique_identifier)) {
+				found = true;
+				break;
+			}
+		}
+		known_bundle_list_unlock(list);
+		TEST_ASSERT_TRUE(found);
+	}
+	linear_us = now_us() - start;
+
+	start = now_us();
+	known_bundle_list_remove_before(list, creation_time_s + 3600);
+	expire_us = now_us() - start;
+	TEST_ASSERT_EQUAL(0, known_bundle_list_count(list));
+
+	LOGF("KnownBundleList: %d entries, %llu adds/s, %llu lookups/s (linear walk: %llu lookups/s), expired in %llu ms",
+	     BENCHMARK_ENTRIES,
+	     (unsigned long long)BENCHMARK_ENTRIES * 1000000 /
+	     (add_us ? add_us : 1),
+	     (unsigned long long)BENCHMARK_ENTRIES * 1000000 /
+	     (lookup_us ? lookup_us : 1),
+	     (unsigned long long)BENCHMARK_LINEAR_LOOKUPS * 1000000 /
+	     (linear_us ? linear_us : 1),
+	     (unsigned long long)expire_us / 1000);
+}
+
+#endif // PLATFORM_POSIX
+
+TEST_GROUP_RUNNER(knownBundleList)
+{
+	RUN_TEST_CASE(knownBundleList, add_and_expire);
+	RUN_TEST_CASE(knownBundleList, reassembled_parent);
+#ifdef PLATFORM_POSIX
+	RUN_TEST_CASE(knownBundleList, benchmark);
+#endif // PLATFORM_POSIX
+}
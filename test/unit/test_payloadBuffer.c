@@ -0,0 +1,242 @@
+#include "ud3tn/bundle.h"
+#include "ud3tn/bundle_fragmenter.h"
+#include "ud3tn/bundle_reassembly.h"
+#include "ud3tn/payload_buffer.h"
+
+#include "bundle7/create.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAYLOAD_LENGTH 4000
+#define FRAGMENT_PAYLOAD_LENGTH 1000
+#define FRAGMENT_COUNT (PAYLOAD_LENGTH / FRAGMENT_PAYLOAD_LENGTH)
+
+static uint8_t payload_data[PAYLOAD_LENGTH];
+
+static struct bundle *create_bundle(void)
+{
+	uint8_t *payload = malloc(PAYLOAD_LENGTH);
+
+	memcpy(payload, payload_data, PAYLOAD_LENGTH);
+	return bundle7_create_local(
+		payload, PAYLOAD_LENGTH, "dtn://source.dtn/",
+		"dtn://destination.dtn/", 1000, 100, 0);
+}
+
+static bool is_slice_of(const struct bundle *bundle,
+			const struct payload_buffer *buffer)
+{
+	const struct bundle_block *payload = bundle->payload_block;
+
+	return payload->buffer == buffer &&
+		payload->data >= buffer->data &&
+		payload->data + payload->length <=
+			buffer->data + buffer->length;
+}
+
+static void release_fragment(struct bundle *fragment, void *param)
+{
+	(void)param;
+	bundle_free(fragment);
+}
+
+TEST_GROUP(payloadBuffer);
+
+TEST_SETUP(payloadBuffer)
+{
+	int i;
+
+	for (i = 0; i < PAYLOAD_LENGTH; i++)
+		payload_data[i] = (uint8_t)(i * 13);
+}
+
+TEST_TEAR_DOWN(payloadBuffer)
+{
+}
+
+TEST(payloadBuffer, reference_counting)
+{
+	uint8_t *data = malloc(16);
+	struct payload_buffer *buffer = payload_buffer_adopt(data, 16);
+
+	TEST_ASSERT_NOT_NULL(buffer);
+	TEST_ASSERT_EQUAL(1, buffer->refcount);
+	TEST_ASSERT_TRUE(buffer == payload_buffer_ref(buffer));
+	TEST_ASSERT_EQUAL(2, buffer->refcount);
+	/* Shared buffers cannot be handed over */
+	TEST_ASSERT_NULL(payload_buffer_steal(buffer));
+	payload_buffer_release(buffer);
+	TEST_ASSERT_TRUE(data == payload_buffer_steal(buffer));
+	free(data);
+	payload_buffer_release(NULL);
+}
+
+TEST(payloadBuffer, dup_shares_payload)
+{
+	struct bundle *bundle = create_bundle();
+	struct bundle *dup = bundle_dup(bundle);
+	struct bundle_adu adu;
+
+	TEST_ASSERT_NOT_NULL(dup);
+	TEST_ASSERT_NOT_NULL(bundle->payload_block->buffer);
+	TEST_ASSERT_TRUE(dup->payload_block->data ==
+			 bundle->payload_block->data);
+	TEST_ASSERT_EQUAL(2, bundle->payload_block->buffer->refcount);
+
+	/* The ADU references the payload while it is still shared... */
+	adu = bundle_to_adu(dup);
+	bundle_free(dup);
+	TEST_ASSERT_NULL(adu.payload);
+	TEST_ASSERT_EQUAL(1, adu.segment_count);
+	TEST_ASSERT_TRUE(adu.segments[0].buffer ==
+			 bundle->payload_block->data);
+	bundle_adu_free_members(adu);
+
+	/* ...and takes it over once it is the last reference */
+	adu = bundle_to_adu(bundle);
+	bundle_free(bundle);
+	TEST_ASSERT_NULL(adu.segments);
+	TEST_ASSERT_EQUAL(PAYLOAD_LENGTH, adu.length);
+	TEST_ASSERT_EQUAL_MEMORY(payload_data, adu.payload, PAYLOAD_LENGTH);
+	bundle_adu_free_members(adu);
+}
+
+TEST(payloadBuffer, compact_keeps_reference)
+{
+	struct bundle *bundle = create_bundle();
+	struct bundle *dup = bundle_dup(bundle);
+	struct payload_buffer *buffer = bundle->payload_block->buffer;
+
+	dup = bundle_compact(dup);
+	TEST_ASSERT_EQUAL(BUNDLE_LAYOUT_COMPACT, dup->layout);
+	TEST_ASSERT_TRUE(is_slice_of(dup, buffer));
+	TEST_ASSERT_EQUAL(2, buffer->refcount);
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_expand(dup));
+	TEST_ASSERT_TRUE(is_slice_of(dup, buffer));
+	TEST_ASSERT_EQUAL(2, buffer->refcount);
+	bundle_free(dup);
+	TEST_ASSERT_EQUAL(1, buffer->refcount);
+	bundle_free(bundle);
+}
+
+TEST(payloadBuffer, fragments_reference_parent)
+{
+	struct bundle *bundle = create_bundle();
+	struct bundle *frags[FRAGMENT_COUNT];
+	struct payload_buffer *buffer;
+	struct reassembly_table table;
+	struct reassembly_entry *entry = NULL;
+	struct bundle_adu adu;
+	size_t i;
+
+	frags[0] = bundlefragmenter_initialize_first_fragment(bundle);
+	TEST_ASSERT_NOT_NULL(frags[0]);
+	buffer = bundle->payload_block->buffer;
+	TEST_ASSERT_NOT_NULL(buffer);
+	for (i = 0; i < FRAGMENT_COUNT - 1; i++) {
+		frags[i + 1] = bundlefragmenter_fragment_bundle(
+			frags[i],
+			bundle_get_first_fragment_min_size(frags[i]) +
+				FRAGMENT_PAYLOAD_LENGTH);
+		TEST_ASSERT_NOT_NULL(frags[i + 1]);
+	}
+	/* No fragment allocated payload bytes of its own */
+	for (i = 0; i < FRAGMENT_COUNT; i++) {
+		TEST_ASSERT_TRUE(is_slice_of(frags[i], buffer));
+		TEST_ASSERT_EQUAL(FRAGMENT_PAYLOAD_LENGTH,
+				  frags[i]->payload_block->length);
+		TEST_ASSERT_EQUAL(i * FRAGMENT_PAYLOAD_LENGTH,
+				  frags[i]->fragment_offset);
+	}
+	TEST_ASSERT_EQUAL(FRAGMENT_COUNT + 1, buffer->refcount);
+	/* The fragments outlive the original bundle */
+	bundle_free(bundle);
+
+	/* Reassembly takes over the references */
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_reassembly_init(&table));
+	for (i = FRAGMENT_COUNT; i > 0; i--)
+		entry = bundle_reassembly_add(&table, frags[i - 1]);
+	TEST_ASSERT_NOT_NULL(entry);
+	TEST_ASSERT_TRUE(bundle_reassembly_is_complete(entry));
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_reassembly_take_adu(
+		&table, entry, &adu, release_fragment, NULL));
+	TEST_ASSERT_EQUAL(FRAGMENT_COUNT, adu.segment_count);
+	for (i = 0; i < FRAGMENT_COUNT; i++)
+		TEST_ASSERT_TRUE(adu.segments[i].shared == buffer);
+	TEST_ASSERT_EQUAL(FRAGMENT_COUNT, buffer->refcount);
+	TEST_ASSERT_EQUAL(UD3TN_OK, bundle_adu_flatten(&adu));
+	TEST_ASSERT_EQUAL_MEMORY(payload_data, adu.payload, PAYLOAD_LENGTH);
+	bundle_adu_free_members(adu);
+	bundle_reassembly_destroy(&table, release_fragment, NULL);
+}
+
+TEST(payloadBuffer, views_of_compact_bundle)
+{
+	struct bundle *bundle = bundle_compact(create_bundle());
+	struct bundle *frags[FRAGMENT_COUNT];
+	const uint8_t *allocation = (const uint8_t *)bundle;
+	struct bundle_adu adu;
+	size_t i;
+
+	TEST_ASSERT_EQUAL(BUNDLE_LAYOUT_COMPACT, bundle->layout);
+	frags[0] = bundlefragmenter_initialize_first_fragment(bundle);
+	TEST_ASSERT_NOT_NULL(frags[0]);
+	TEST_ASSERT_NOT_NULL(bundle->shared_allocation);
+	for (i = 0; i < FRAGMENT_COUNT - 1; i++) {
+		frags[i + 1] = bundlefragmenter_fragment_bundle(
+			frags[i],
+			bundle_get_first_fragment_min_size(frags[i]) +
+				FRAGMENT_PAYLOAD_LENGTH);
+		TEST_ASSERT_NOT_NULL(frags[i + 1]);
+	}
+	/* The views point into the allocation of the parent... */
+	for (i = 0; i < FRAGMENT_COUNT; i++) {
+		TEST_ASSERT_TRUE(is_slice_of(frags[i],
+					     bundle->payload_block->buffer));
+		TEST_ASSERT_TRUE(frags[i]->payload_block->data > allocation);
+		TEST_ASSERT_TRUE(frags[i]->payload_block->data <
+				 allocation + bundle->compact_size);
+	}
+	/* ...which is kept until the last of them is gone */
+	bundle_free(bundle);
+	for (i = 0; i < FRAGMENT_COUNT; i++) {
+		adu = bundle_to_adu(frags[i]);
+		bundle_free(frags[i]);
+		TEST_ASSERT_EQUAL(1, adu.segment_count);
+		TEST_ASSERT_EQUAL_MEMORY(
+			&payload_data[i * FRAGMENT_PAYLOAD_LENGTH],
+			adu.segments[0].buffer, FRAGMENT_PAYLOAD_LENGTH);
+		bundle_adu_free_members(adu);
+	}
+}
+
+TEST(payloadBuffer, compact_adu_without_copy)
+{
+	struct bundle *bundle = bundle_compact(create_bundle());
+	struct bundle_adu adu;
+
+	TEST_ASSERT_EQUAL(BUNDLE_LAYOUT_COMPACT, bundle->layout);
+	adu = bundle_to_adu(bundle);
+	TEST_ASSERT_NULL(adu.payload);
+	TEST_ASSERT_EQUAL(1, adu.segment_count);
+	TEST_ASSERT_TRUE(adu.segments[0].shared == bundle->shared_allocation);
+	bundle_free(bundle);
+	TEST_ASSERT_EQUAL(PAYLOAD_LENGTH, adu.length);
+	TEST_ASSERT_EQUAL_MEMORY(payload_data, adu.segments[0].buffer,
+				 PAYLOAD_LENGTH);
+	bundle_adu_free_members(adu);
+}
+
+TEST_GROUP_RUNNER(payloadBuffer)
+{
+	RUN_TEST_CASE(payloadBuffer, reference_counting);
+	RUN_TEST_CASE(payloadBuffer, dup_shares_payload);
+	RUN_TEST_CASE(payloadBuffer, compact_keeps_reference);
+	RUN_TEST_CASE(payloadBuffer, fragments_reference_parent);
+	RUN_TEST_CASE(payloadBuffer, views_of_compact_bundle);
+	RUN_TEST_CASE(payloadBuffer, compact_adu_without_copy);
+}
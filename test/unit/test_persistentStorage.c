@@ -0,0 +1,412 @@
+#ifdef PLATFORM_POSIX
+
+#include "bundle7/create.h"
+
+#include "ud3tn/bundle.h"
+#include "ud3tn/bundle_storage_manager.h"
+#include "ud3tn/config.h"
+#include "ud3tn/persistent_storage.h"
+
+#include "platform/hal_time.h"
+
+#include "unity_fixture.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_BUNDLES 128
+
+static char storage_dir[] = "/tmp/ud3tn-persistent-XXXXXX";
+
+/* Bundles passed to the restore callback, indexed by their payload number */
+static struct bundle *restored[MAX_BUNDLES];
+static uint32_t restored_count;
+static bool restored_invalid;
+
+static struct bundle *create_bundle(uint32_t number, size_t length)
+{
+	char *payload = malloc(length);
+	size_t i;
+
+	for (i = 0; i < length; i++)
+		payload[i] = (char)(number + i);
+	memcpy(payload, &number, sizeof(number));
+	return bundle7_create_local(
+		payload, length,
+		"dtn://source.dtn/", "dtn://destination.dtn/",
+		hal_time_get_timestamp_s(), 3600, 0);
+}
+
+static bool payload_is_valid(const struct bundle *bundle)
+{
+	uint32_t number;
+	size_t i;
+
+	if (bundle->payload_block == NULL ||
+	    bundle->payload_block->length < sizeof(number))
+		return false;
+	memcpy(&number, bundle->payload_block->data, sizeof(number));
+	for (i = sizeof(number); i < bundle->payload_block->length; i++) {
+		if (bundle->payload_block->data[i] != (uint8_t)(number + i))
+			return false;
+	}
+	return true;
+}
+
+static void restore_callback(struct bundle *bundle, persistentid_t pid,
+			     void *param)
+{
+	uint32_t number;
+
+	(void)pid;
+	(void)param;
+	restored_count++;
+	memcpy(&number, bundle->payload_block->data, sizeof(number));
+	if (!payload_is_valid(bundle) || number >= MAX_BUNDLES ||
+	    restored[number] != NULL) {
+		restored_invalid = true;
+		bundle_free(bundle);
+		return;
+	}
+	restored[number] = bundle;
+}
+
+static void clear_restored(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < MAX_BUNDLES; i++) {
+		bundle_free(restored[i]);
+		restored[i] = NULL;
+	}
+	restored_count = 0;
+	restored_invalid = false;
+}
+
+static uint32_t reopen_and_restore(void)
+{
+	persistent_storage_deinit();
+	clear_restored();
+	TEST_ASSERT_EQUAL(UD3TN_OK, persistent_storage_init(storage_dir));
+	persistent_storage_restore(restore_callback, NULL);
+	TEST_ASSERT_FALSE(restored_invalid);
+	return restored_count;
+}
+
+static void get_last_segment(char *path, off_t *size)
+{
+	DIR *dir = opendir(storage_dir);
+	struct dirent *e;
+	char last[NAME_MAX + 1] = "";
+	struct stat st;
+
+	TEST_ASSERT_NOT_NULL(dir);
+	while ((e = readdir(dir)) != NULL) {
+		if (e->d_name[0] != '.' && strcmp(e->d_name, last) > 0)
+			strcpy(last, e->d_name);
+	}
+	closedir(dir);
+	TEST_ASSERT_NOT_EQUAL(0, strlen(last));
+	snprintf(path, PATH_MAX, "%s/%s", storage_dir, last);
+	TEST_ASSERT_EQUAL(0, stat(path, &st));
+	*size = st.st_size;
+}
+
+static int count_segments(void)
+{
+	DIR *dir = opendir(storage_dir);
+	struct dirent *e;
+	int count = 0;
+
+	TEST_ASSERT_NOT_NULL(dir);
+	while ((e = readdir(dir)) != NULL) {
+		if (e->d_name[0] != '.')
+			count++;
+	}
+	closedir(dir);
+	return count;
+}
+
+TEST_GROUP(persistentStorage);
+
+TEST_SETUP(persistentStorage)
+{
+	strcpy(storage_dir + strlen(storage_dir) - 6, "XXXXXX");
+	TEST_ASSERT_NOT_NULL(mkdtemp(storage_dir));
+	TEST_ASSERT_EQUAL(UD3TN_OK, persistent_storage_init(storage_dir));
+	TEST_ASSERT_TRUE(persistent_storage_is_enabled());
+}
+
+TEST_TEAR_DOWN(persistentStorage)
+{
+	DIR *dir;
+	struct dirent *e;
+	char path[PATH_MAX];
+
+	persistent_storage_deinit();
+	clear_restored();
+	dir = opendir(storage_dir);
+	while (dir != NULL && (e = readdir(dir)) != NULL) {
+		if (e->d_name[0] == '.')
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", storage_dir, e->d_name);
+		unlink(path);
+	}
+	if (dir != NULL)
+		closedir(dir);
+	rmdir(storage_dir);
+}
+
+TEST(persistentStorage, add_delete_restore)
+{
+	persistentid_t pids[16];
+	struct bundle *b;
+	uint32_t i;
+
+	for (i = 0; i < 16; i++) {
+		b = create_bundle(i, 100 + i);
+		TEST_ASSERT_NOT_NULL(b);
+		b->ret_constraints = BUNDLE_RET_CONSTRAINT_FLAG_OWN |
+			BUNDLE_RET_CONSTRAINT_FORWARD_PENDING;
+		pids[i] = persistent_storage_add(b, PERSISTENT_INVALID_ID);
+		TEST_ASSERT_NOT_EQUAL(PERSISTENT_INVALID_ID, pids[i]);
+		bundle_free(b);
+	}
+	for (i = 0; i < 16; i += 2)
+		persistent_storage_delete(pids[i]);
+
+	/* Replacing a bundle must not duplicate it */
+	b = create_bundle(1, 101);
+	b->ret_constraints = BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED;
+	TEST_ASSERT_EQUAL(pids[1], persistent_storage_add(b, pids[1]));
+	bundle_free(b);
+
+	TEST_ASSERT_EQUAL(8, reopen_and_restore());
+	for (i = 0; i < 16; i++)
+		TEST_ASSERT_EQUAL(i % 2 != 0, restored[i] != NULL);
+	/* Only the retained constraints survive a restart */
+	TEST_ASSERT_EQUAL(BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED,
+			  restored[1]->ret_constraints);
+	TEST_ASSERT_EQUAL(BUNDLE_RET_CONSTRAINT_FLAG_OWN,
+			  restored[3]->ret_constraints);
+}
+
+TEST(persistentStorage, torn_record)
+{
+	char path[PATH_MAX];
+	uint8_t garbage[40];
+	off_t size, torn_size;
+	struct bundle *b;
+	uint32_t i;
+	int fd;
+
+	for (i = 0; i < 3; i++) {
+		b = create_bundle(i, 64);
+		TEST_ASSERT_NOT_EQUAL(PERSISTENT_INVALID_ID,
+			persistent_storage_add(b, PERSISTENT_INVALID_ID));
+		bundle_free(b);
+	}
+	persistent_storage_deinit();
+
+	/* Simulate a record which was only partially written */
+	get_last_segment(path, &size);
+	fd = open(path, O_RDWR);
+	TEST_ASSERT_TRUE(fd >= 0);
+	TEST_ASSERT_EQUAL(sizeof(garbage), pread(fd, garbage,
+		sizeof(garbage), 0));
+	TEST_ASSERT_EQUAL(sizeof(garbage), pwrite(fd, garbage,
+		sizeof(garbage), size));
+	close(fd);
+	get_last_segment(path, &torn_size);
+	TEST_ASSERT_EQUAL(size + (off_t)sizeof(garbage), torn_size);
+
+	TEST_ASSERT_EQUAL(UD3TN_OK, persistent_storage_init(storage_dir));
+	get_last_segment(path, &torn_size);
+	TEST_ASSERT_EQUAL(size, torn_size);
+	TEST_ASSERT_EQUAL(3, reopen_and_restore());
+
+	/* Records appended after the recovery have to be readable */
+	b = create_bundle(3, 64);
+	TEST_ASSERT_NOT_EQUAL(PERSISTENT_INVALID_ID,
+		persistent_storage_add(b, PERSISTENT_INVALID_ID));
+	bundle_free(b);
+	TEST_ASSERT_EQUAL(4, reopen_and_restore());
+}
+
+TEST(persistentStorage, compaction)
+{
+	/* Enough data to fill more than two segments */
+	const uint32_t count = 100;
+	const size_t length = PERSISTENT_STORAGE_SEGMENT_SIZE / 40;
+	persistentid_t pids[100];
+	struct bundle *b;
+	uint32_t i;
+	int segments_before;
+
+	for (i = 0; i < count; i++) {
+		b = create_bundle(i, length);
+		pids[i] = persistent_storage_add(b, PERSISTENT_INVALID_ID);
+		TEST_ASSERT_NOT_EQUAL(PERSISTENT_INVALID_ID, pids[i]);
+		bundle_free(b);
+	}
+	segments_before = count_segments();
+	TEST_ASSERT_TRUE(segments_before > 2);
+
+	for (i = 0; i < count; i++) {
+		if (i % 10 != 0)
+			persistent_storage_delete(pids[i]);
+	}
+	TEST_ASSERT_TRUE(persistent_storage_compact());
+	while (persistent_storage_compact())
+		;
+	TEST_ASSERT_TRUE(count_segments() < segments_before);
+
+	TEST_ASSERT_EQUAL(count / 10, reopen_and_restore());
+	for (i = 0; i < count; i++)
+		TEST_ASSERT_EQUAL(i % 10 == 0, restored[i] != NULL);
+}
+
+static void *compaction_thread(void *param)
+{
+	uint32_t *compacted = param;
+
+	while (persistent_storage_compact())
+		(*compacted)++;
+	return NULL;
+}
+
+TEST(persistentStorage, compaction_while_adding)
+{
+	const uint32_t count = 100;
+	const size_t length = PERSISTENT_STORAGE_SEGMENT_SIZE / 40;
+	persistentid_t pids[100];
+	struct bundle *b;
+	uint32_t i, compacted = 0;
+	pthread_t thread;
+
+	for (i = 0; i < count; i++) {
+		b = create_bundle(i, length);
+		pids[i] = persistent_storage_add(b, PERSISTENT_INVALID_ID);
+		TEST_ASSERT_NOT_EQUAL(PERSISTENT_INVALID_ID, pids[i]);
+		bundle_free(b);
+	}
+	for (i = 0; i < count; i++) {
+		if (i % 10 != 0)
+			persistent_storage_delete(pids[i]);
+	}
+
+	/* The compaction releases the lock between its batches */
+	TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL,
+					    compaction_thread, &compacted));
+	for (i = 0; i < count; i++) {
+		if (i % 10 == 0)
+			continue;
+		b = create_bundle(i, length / 4);
+		pids[i] = persistent_storage_add(b, PERSISTENT_INVALID_ID);
+		TEST_ASSERT_NOT_EQUAL(PERSISTENT_INVALID_ID, pids[i]);
+		bundle_free(b);
+		if (i % 10 == 5)
+			persistent_storage_delete(pids[i]);
+	}
+	TEST_ASSERT_EQUAL(0, pthread_join(thread, NULL));
+	TEST_ASSERT_TRUE(compacted > 0);
+
+	TEST_ASSERT_EQUAL(count - count / 10, reopen_and_restore());
+	for (i = 0; i < count; i++)
+		TEST_ASSERT_EQUAL(i % 10 != 5, restored[i] != NULL);
+}
+
+TEST(persistentStorage, unload_cold_bundles)
+{
+	const uint32_t count = 32;
+	const size_t length = 4096;
+	bundleid_t ids[32];
+	struct bundle *b;
+	uint32_t i;
+
+	bundle_storage_set_resident_quota(4 * length);
+	for (i = 0; i < count; i++) {
+		b = create_bundle(i, length);
+		ids[i] = bundle_storage_add(b);
+		TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID, ids[i]);
+		TEST_ASSERT_TRUE(bundle_storage_persist(ids[i]));
+	}
+	/* Only the index of most bundles is kept in memory */
+	TEST_ASSERT_TRUE(bundle_storage_get_resident_usage() <
+			 bundle_storage_get_usage() / 4);
+
+	/* Unloaded bundles are loaded again from the segments */
+	for (i = 0; i < count; i++) {
+		b = bundle_storage_acquire(ids[i]);
+		TEST_ASSERT_NOT_NULL(b);
+		TEST_ASSERT_EQUAL(ids[i], b->id);
+		TEST_ASSERT_TRUE(payload_is_valid(b));
+		bundle_storage_release(ids[i]);
+	}
+	TEST_ASSERT_TRUE(bundle_storage_get_resident_usage() <
+			 bundle_storage_get_usage() / 4);
+
+	for (i = 0; i < count; i++)
+		TEST_ASSERT_TRUE(bundle_storage_delete(ids[i]));
+	TEST_ASSERT_EQUAL(0, bundle_storage_get_usage());
+	TEST_ASSERT_EQUAL(0, bundle_storage_get_resident_usage());
+	bundle_storage_set_resident_quota(BUNDLE_STORAGE_RESIDENT_QUOTA);
+}
+
+TEST(persistentStorage, killed_while_writing)
+{
+	persistentid_t pids[MAX_BUNDLES] = { PERSISTENT_INVALID_ID };
+	struct bundle *b;
+	uint32_t i;
+	int status;
+	pid_t child;
+
+	persistent_storage_deinit();
+	child = fork();
+	TEST_ASSERT_TRUE(child >= 0);
+	if (child == 0) {
+		/* Write until killed, replacing older bundles */
+		if (persistent_storage_init(storage_dir) != UD3TN_OK)
+			_exit(EXIT_FAILURE);
+		for (i = 0; ; i = (i + 1) % MAX_BUNDLES) {
+			persistent_storage_delete(pids[i]);
+			b = create_bundle(i, 1000 + i * 100);
+			pids[i] = persistent_storage_add(
+				b, PERSISTENT_INVALID_ID);
+			bundle_free(b);
+		}
+	}
+	usleep(200000);
+	kill(child, SIGKILL);
+	TEST_ASSERT_EQUAL(child, waitpid(child, &status, 0));
+	TEST_ASSERT_TRUE(WIFSIGNALED(status));
+
+	/* Every recovered bundle has to be complete */
+	TEST_ASSERT_EQUAL(UD3TN_OK, persistent_storage_init(storage_dir));
+	persistent_storage_restore(restore_callback, NULL);
+	TEST_ASSERT_TRUE(restored_count > 0);
+	TEST_ASSERT_FALSE(restored_invalid);
+}
+
+TEST_GROUP_RUNNER(persistentStorage)
+{
+	RUN_TEST_CASE(persistentStorage, add_delete_restore);
+	RUN_TEST_CASE(persistentStorage, torn_record);
+	RUN_TEST_CASE(persistentStorage, compaction);
+	RUN_TEST_CASE(persistentStorage, compaction_while_adding);
+	RUN_TEST_CASE(persistentStorage, unload_cold_bundles);
+	RUN_TEST_CASE(persistentStorage, killed_while_writing);
+}
+
+#endif // PLATFORM_POSIX
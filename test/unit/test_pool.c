@@ -0,0 +1,203 @@
+#include "ud3tn/bundle.h"
+#include "ud3tn/config.h"
+#include "ud3tn/pool.h"
+
+#include "bundle7/create.h"
+
+#include "platform/hal_io.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef PLATFORM_POSIX
+#include "benchmark_time.h"
+#endif // PLATFORM_POSIX
+
+#define OBJECT_COUNT 100
+
+struct test_object {
+	uint64_t value;
+	uint8_t data[13];
+};
+
+static struct pool test_pool = POOL_INITIALIZER(
+	struct test_object, "test_object");
+
+TEST_GROUP(pool);
+
+TEST_SETUP(pool)
+{
+}
+
+TEST_TEAR_DOWN(pool)
+{
+}
+
+TEST(pool, alloc_free)
+{
+	struct test_object *objects[OBJECT_COUNT];
+	struct pool_stats stats;
+	uint32_t heap_allocations;
+	int i;
+
+	for (i = 0; i < OBJECT_COUNT; i++) {
+		objects[i] = pool_alloc(&test_pool);
+		TEST_ASSERT_NOT_NULL(objects[i]);
+		TEST_ASSERT_EQUAL(0, (uintptr_t)objects[i] % sizeof(uint64_t));
+		memset(objects[i], i, sizeof(struct test_object));
+	}
+	for (i = 0; i < OBJECT_COUNT; i++)
+		TEST_ASSERT_EQUAL(i, objects[i]->data[12]);
+	pool_get_stats(&test_pool, &stats);
+	TEST_ASSERT_EQUAL(OBJECT_COUNT, stats.in_use);
+	TEST_ASSERT_EQUAL(OBJECT_COUNT, stats.peak);
+	TEST_ASSERT_EQUAL(OBJECT_COUNT, stats.allocations);
+	TEST_ASSERT_TRUE(stats.capacity >= OBJECT_COUNT);
+	heap_allocations = stats.heap_allocations;
+
+	for (i = 0; i < OBJECT_COUNT; i++)
+		pool_free(&test_pool, objects[i]);
+	pool_get_stats(&test_pool, &stats);
+	TEST_ASSERT_EQUAL(0, stats.in_use);
+	TEST_ASSERT_EQUAL(OBJECT_COUNT, stats.peak);
+
+	/* Freed objects are re-used without touching the heap */
+	for (i = 0; i < OBJECT_COUNT; i++)
+		objects[i] = pool_alloc(&test_pool);
+	pool_get_stats(&test_pool, &stats);
+	if (OBJECT_POOL_CHUNK_SIZE != 0)
+		TEST_ASSERT_EQUAL(heap_allocations, stats.heap_allocations);
+	TEST_ASSERT_EQUAL(2 * OBJECT_COUNT, stats.allocations);
+	for (i = 0; i < OBJECT_COUNT; i++)
+		pool_free(&test_pool, objects[i]);
+}
+
+TEST(pool, bundle_objects)
+{
+	struct pool_stats before, after;
+	struct bundle *b;
+
+	bundle_get_pool_stats(&before);
+	b = bundle_init();
+	TEST_ASSERT_NOT_NULL(b);
+	b->blocks = bundle_block_entry_create(
+		bundle_block_create(BUNDLE_BLOCK_TYPE_PAYLOAD));
+	TEST_ASSERT_NOT_NULL(b->blocks);
+	bundle_get_pool_stats(&after);
+	TEST_ASSERT_EQUAL(before.in_use + 3, after.in_use);
+	bundle_free(b);
+	bundle_get_pool_stats(&after);
+	TEST_ASSERT_EQUAL(before.in_use, after.in_use);
+}
+
+#ifdef PLATFORM_POSIX
+
+#define BENCHMARK_BUNDLES 1000
+#define BENCHMARK_RUNS 100
+
+static struct bundle *create_bundle(void)
+{
+	char *payload = malloc(64);
+
+	memset(payload, 0x42, 64);
+	return bundle7_create_local(
+		payload, 64, "dtn://source.dtn/", "dtn://destination.dtn/",
+		0, 3600, 0);
+}
+
+/* Allocates the pooled objects of a bundle directly from the heap */
+static void heap_cycle(void **objects, uint32_t count)
+{
+	static const size_t sizes[] = {
+		sizeof(struct bundle),
+		sizeof(struct bundle_block_list),
+		sizeof(struct bundle_block),
+	};
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		objects[i] = malloc(sizes[i % 3]);
+	for (i = 0; i < count; i++)
+		free(objects[i]);
+}
+
+static void pool_cycle(void **objects, uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i += 3) {
+		objects[i] = bundle_init();
+		objects[i + 1] = bundle_block_entry_create(
+			bundle_block_create(BUNDLE_BLOCK_TYPE_PAYLOAD));
+	}
+	for (i = 0; i < count; i += 3) {
+		((struct bundle *)objects[i])->blocks = objects[i + 1];
+		bundle_free(objects[i]);
+	}
+}
+
+TEST(pool, benchmark)
+{
+	static void *objects[BENCHMARK_BUNDLES * 3];
+	struct bundle *bundles[BENCHMARK_BUNDLES];
+	struct pool_stats before, after;
+	uint64_t start, heap_us, pool_us;
+	int i, run;
+
+	/* Count the allocations of a bundle created via the BPv7 API */
+	bundle_get_pool_stats(&before);
+	for (i = 0; i < BENCHMARK_BUNDLES; i++) {
+		bundles[i] = create_bundle();
+		TEST_ASSERT_NOT_NULL(bundles[i]);
+	}
+	for (i = 0; i < BENCHMARK_BUNDLES; i++)
+		bundle_free(bundles[i]);
+	bundle_get_pool_stats(&after);
+	LOGF("Pool: %lu pooled objects per bundle, formerly from the heap",
+	     (unsigned long)(after.allocations - before.allocations) /
+	     BENCHMARK_BUNDLES);
+	LOGF("Pool: %lu heap allocations for %d bundles (first run)",
+	     (unsigned long)(after.heap_allocations -
+			     before.heap_allocations),
+	     BENCHMARK_BUNDLES);
+
+	bundle_get_pool_stats(&before);
+	for (i = 0; i < BENCHMARK_BUNDLES; i++)
+		bundles[i] = create_bundle();
+	for (i = 0; i < BENCHMARK_BUNDLES; i++)
+		bundle_free(bundles[i]);
+	bundle_get_pool_stats(&after);
+	if (OBJECT_POOL_CHUNK_SIZE != 0)
+		TEST_ASSERT_EQUAL(before.heap_allocations,
+				  after.heap_allocations);
+
+	/* Compare the throughput of the heap and the pools */
+	start = now_us();
+	for (run = 0; run < BENCHMARK_RUNS; run++)
+		heap_cycle(objects, BENCHMARK_BUNDLES * 3);
+	heap_us = now_us() - start;
+	start = now_us();
+	for (run = 0; run < BENCHMARK_RUNS; run++)
+		pool_cycle(objects, BENCHMARK_BUNDLES * 3);
+	pool_us = now_us() - start;
+	LOGF("Pool: %llu bundle allocations/s from heap, %llu from pools",
+	     (unsigned long long)BENCHMARK_BUNDLES * BENCHMARK_RUNS *
+	     1000000 / (heap_us ? heap_us : 1),
+	     (unsigned long long)BENCHMARK_BUNDLES * BENCHMARK_RUNS *
+	     1000000 / (pool_us ? pool_us : 1));
+	bundle_log_pool_stats();
+}
+
+#endif // PLATFORM_POSIX
+
+TEST_GROUP_RUNNER(pool)
+{
+	RUN_TEST_CASE(pool, alloc_free);
+	RUN_TEST_CASE(pool, bundle_objects);
+#ifdef PLATFORM_POSIX
+	RUN_TEST_CASE(pool, benchmark);
+#endif // PLATFORM_POSIX
+}
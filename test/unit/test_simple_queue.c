@@ -1,9 +1,14 @@
 #ifdef PLATFORM_POSIX
 
+#include "platform/hal_config.h"
+#include "platform/hal_io.h"
+#include "platform/hal_queue.h"
+#include "platform/posix/mpsc_queue.h"
 #include "platform/posix/simple_queue.h"
 
 #include "unity_fixture.h"
 
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -336,6 +341,309 @@ TEST(simple_queue, test_SemaphoreTimingBehaviour)
 	TEST_ASSERT_TRUE(ms_diff(&ts1, &ts2) < 2002);
 }
 
+#if HAL_QUEUE_LOCK_FREE
+
+TEST(simple_queue, test_MpscPushFullPopFull)
+{
+	struct mpsc_queue *q = mpsc_queue_create(10, sizeof(int));
+	int i, j, round;
+
+	TEST_ASSERT_NOT_NULL(q);
+	// run through the ring several times
+	for (round = 0; round < 3; round++) {
+		for (i = 0; i <= 9; i++)
+			TEST_ASSERT_EQUAL(UD3TN_OK, mpsc_queue_push(q, &i, 0));
+		// the eleventh insertion should fail
+		TEST_ASSERT_EQUAL(UD3TN_FAIL, mpsc_queue_push(q, &i, 0));
+		TEST_ASSERT_EQUAL_UINT(10, mpsc_queue_items_waiting(q));
+
+		for (i = 0; i <= 9; i++) {
+			TEST_ASSERT_EQUAL(UD3TN_OK, mpsc_queue_pop(q, &j, 0));
+			TEST_ASSERT_EQUAL_INT(i, j);
+		}
+		// the eleventh removal should fail
+		TEST_ASSERT_EQUAL(UD3TN_FAIL, mpsc_queue_pop(q, &j, 0));
+		TEST_ASSERT_EQUAL_UINT(0, mpsc_queue_items_waiting(q));
+	}
+	mpsc_queue_delete(q);
+}
+
+TEST(simple_queue, test_MpscOverrideAndReset)
+{
+	struct mpsc_queue *q = mpsc_queue_create(3, sizeof(int));
+	int i, j;
+
+	// without being full, the item is appended
+	i = 0;
+	TEST_ASSERT_EQUAL(UD3TN_OK, mpsc_queue_override(q, &i));
+	for (i = 1; i <= 2; i++)
+		TEST_ASSERT_EQUAL(UD3TN_OK, mpsc_queue_push(q, &i, 0));
+	// when full, the last item is replaced
+	i = 42;
+	TEST_ASSERT_EQUAL(UD3TN_OK, mpsc_queue_override(q, &i));
+	TEST_ASSERT_EQUAL_UINT(3, mpsc_queue_items_waiting(q));
+	TEST_ASSERT_EQUAL(UD3TN_OK, mpsc_queue_pop(q, &j, 0));
+	TEST_ASSERT_EQUAL_INT(0, j);
+	TEST_ASSERT_EQUAL(UD3TN_OK, mpsc_queue_pop(q, &j, 0));
+	TEST_ASSERT_EQUAL_INT(1, j);
+	TEST_ASSERT_EQUAL(UD3TN_OK, mpsc_queue_pop(q, &j, 0));
+	TEST_ASSERT_EQUAL_INT(42, j);
+
+	for (i = 0; i <= 1; i++)
+		TEST_ASSERT_EQUAL(UD3TN_OK, mpsc_queue_push(q, &i, 0));
+	mpsc_queue_reset(q);
+	TEST_ASSERT_EQUAL_UINT(0, mpsc_queue_items_waiting(q));
+	TEST_ASSERT_EQUAL(UD3TN_FAIL, mpsc_queue_pop(q, &j, 0));
+	mpsc_queue_delete(q);
+}
+
+TEST(simple_queue, test_MpscTimingBehaviour)
+{
+	struct timespec ts1, ts2;
+	struct mpsc_queue *q = mpsc_queue_create(1, sizeof(int));
+	int i = 0, j;
+
+	// a removal with timeout 100ms should fail eventually
+	clock_gettime(CLOCK_REALTIME, &ts1);
+	TEST_ASSERT_EQUAL(UD3TN_FAIL, mpsc_queue_pop(q, &j, 100));
+	clock_gettime(CLOCK_REALTIME, &ts2);
+	TEST_ASSERT_TRUE(ms_diff(&ts1, &ts2) > 98);
+	TEST_ASSERT_TRUE(ms_diff(&ts1, &ts2) < 102);
+
+	// a insertion with timeout 100ms should fail eventually
+	TEST_ASSERT_EQUAL(UD3TN_OK, mpsc_queue_push(q, &i, 0));
+	clock_gettime(CLOCK_REALTIME, &ts1);
+	TEST_ASSERT_EQUAL(UD3TN_FAIL, mpsc_queue_push(q, &i, 100));
+	clock_gettime(CLOCK_REALTIME, &ts2);
+	TEST_ASSERT_TRUE(ms_diff(&ts1, &ts2) > 98);
+	TEST_ASSERT_TRUE(ms_diff(&ts1, &ts2) < 102);
+	mpsc_queue_delete(q);
+}
+
+#endif // HAL_QUEUE_LOCK_FREE
+
+TEST(simple_queue, test_HalQueueBatch)
+{
+	QueueIdentifier_t q = hal_queue_create(5, sizeof(int));
+	int items[7] = { 0, 1, 2, 3, 4, 5, 6 };
+	int received[7];
+	size_t i;
+
+	TEST_ASSERT_NOT_NULL(q);
+	// only the items which fit are inserted
+	TEST_ASSERT_EQUAL_UINT(5, hal_queue_push_batch(q, items, 7, 0));
+	TEST_ASSERT_EQUAL_UINT(5, hal_queue_nr_of_items_waiting(q));
+
+	// at most the requested number of items is received, in order
+	TEST_ASSERT_EQUAL_UINT(3, hal_queue_receive_batch(q, received, 3, 0));
+	for (i = 0; i < 3; i++)
+		TEST_ASSERT_EQUAL_INT(i, received[i]);
+	// the batch continues behind the end of the ring
+	TEST_ASSERT_EQUAL_UINT(2, hal_queue_push_batch(q, &items[5], 2, 0));
+	TEST_ASSERT_EQUAL_UINT(4, hal_queue_receive_batch(q, received, 7, 0));
+	for (i = 0; i < 4; i++)
+		TEST_ASSERT_EQUAL_INT(i + 3, received[i]);
+
+	// without waiting items, nothing is received
+	TEST_ASSERT_EQUAL_UINT(0, hal_queue_receive_batch(q, received, 7, 10));
+	TEST_ASSERT_EQUAL_UINT(0, hal_queue_push_batch(q, items, 0, 0));
+	hal_queue_delete(q);
+}
+
+#if HAL_QUEUE_LOCK_FREE
+
+TEST(simple_queue, test_MpscBatchOverride)
+{
+	struct mpsc_queue *q = mpsc_queue_create(4, sizeof(int));
+	int items[4] = { 0, 1, 2, 3 };
+	int received[4];
+	int i = 42;
+
+	TEST_ASSERT_EQUAL_UINT(4, mpsc_queue_push_batch(q, items, 4, 0));
+	// the newest item of the batch is replaced
+	TEST_ASSERT_EQUAL(UD3TN_OK, mpsc_queue_override(q, &i));
+	TEST_ASSERT_EQUAL_UINT(4, mpsc_queue_pop_batch(q, received, 4, 0));
+	TEST_ASSERT_EQUAL_INT(2, received[2]);
+	TEST_ASSERT_EQUAL_INT(42, received[3]);
+	mpsc_queue_delete(q);
+}
+
+#endif // HAL_QUEUE_LOCK_FREE
+
+#define CONTENTION_PRODUCERS 4
+#define CONTENTION_ITEMS 100000
+#define CONTENTION_QUEUE_LENGTH 64
+#define CONTENTION_BATCH_SIZE 16
+
+struct contention_item {
+	int producer;
+	int sequence;
+};
+
+struct queue_ops {
+	void *(*create)(void);
+	void (*push)(void *queue, const struct contention_item *items,
+		     size_t count);
+	size_t (*pop)(void *queue, struct contention_item *items,
+		      size_t max_count);
+	void (*delete)(void *queue);
+	// number of items pushed and popped at once
+	size_t batch_size;
+};
+
+struct contention_producer {
+	pthread_t thread;
+	const struct queue_ops *ops;
+	void *queue;
+	int index;
+};
+
+static void *simple_create(void)
+{
+	return queueCreate(CONTENTION_QUEUE_LENGTH,
+			   sizeof(struct contention_item));
+}
+
+static void simple_push(void *queue, const struct contention_item *items,
+			size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		queuePush(queue, &items[i], -1, false);
+}
+
+static size_t simple_pop(void *queue, struct contention_item *items,
+			 size_t max_count)
+{
+	(void)max_count;
+	queuePop(queue, items, -1);
+	return 1;
+}
+
+static void simple_delete(void *queue)
+{
+	queueDelete(queue);
+}
+
+static const struct queue_ops simple_ops = {
+	simple_create, simple_push, simple_pop, simple_delete, 1,
+};
+
+#if HAL_QUEUE_LOCK_FREE
+
+static void *mpsc_create(void)
+{
+	return mpsc_queue_create(CONTENTION_QUEUE_LENGTH,
+				 sizeof(struct contention_item));
+}
+
+static void mpsc_push(void *queue, const struct contention_item *items,
+		      size_t count)
+{
+	if (count == 1)
+		mpsc_queue_push(queue, items, -1);
+	else
+		mpsc_queue_push_batch(queue, items, count, -1);
+}
+
+static size_t mpsc_pop(void *queue, struct contention_item *items,
+		       size_t max_count)
+{
+	if (max_count == 1)
+		return mpsc_queue_pop(queue, items, -1) == UD3TN_OK ? 1 : 0;
+	return mpsc_queue_pop_batch(queue, items, max_count, -1);
+}
+
+static void mpsc_delete(void *queue)
+{
+	mpsc_queue_delete(queue);
+}
+
+static const struct queue_ops mpsc_ops = {
+	mpsc_create, mpsc_push, mpsc_pop, mpsc_delete, 1,
+};
+
+static const struct queue_ops mpsc_batch_ops = {
+	mpsc_create, mpsc_push, mpsc_pop, mpsc_delete, CONTENTION_BATCH_SIZE,
+};
+
+#endif // HAL_QUEUE_LOCK_FREE
+
+static void *contention_produce(void *param)
+{
+	struct contention_producer *p = param;
+	struct contention_item items[CONTENTION_BATCH_SIZE];
+	size_t count = 0;
+	int sequence;
+
+	for (sequence = 0; sequence < CONTENTION_ITEMS; sequence++) {
+		items[count].producer = p->index;
+		items[count].sequence = sequence;
+		if (++count == p->ops->batch_size ||
+		    sequence == CONTENTION_ITEMS - 1) {
+			p->ops->push(p->queue, items, count);
+			count = 0;
+		}
+	}
+	return NULL;
+}
+
+// Returns the number of items per second, checking the order per producer
+static uint64_t run_contention(const struct queue_ops *ops)
+{
+	struct contention_producer producers[CONTENTION_PRODUCERS];
+	int next_sequence[CONTENTION_PRODUCERS] = { 0 };
+	struct contention_item items[CONTENTION_BATCH_SIZE];
+	struct timespec ts1, ts2;
+	void *queue = ops->create();
+	size_t count, j;
+	int i, ms;
+
+	TEST_ASSERT_NOT_NULL(queue);
+	clock_gettime(CLOCK_REALTIME, &ts1);
+	for (i = 0; i < CONTENTION_PRODUCERS; i++) {
+		producers[i] = (struct contention_producer){
+			.ops = ops, .queue = queue, .index = i,
+		};
+		TEST_ASSERT_EQUAL(0, pthread_create(&producers[i].thread,
+						    NULL, contention_produce,
+						    &producers[i]));
+	}
+	for (i = 0; i < CONTENTION_PRODUCERS * CONTENTION_ITEMS; ) {
+		count = ops->pop(queue, items, ops->batch_size);
+		for (j = 0; j < count; j++, i++) {
+			TEST_ASSERT_EQUAL_INT(
+				next_sequence[items[j].producer],
+				items[j].sequence);
+			next_sequence[items[j].producer]++;
+		}
+	}
+	clock_gettime(CLOCK_REALTIME, &ts2);
+	for (i = 0; i < CONTENTION_PRODUCERS; i++)
+		pthread_join(producers[i].thread, NULL);
+	ops->delete(queue);
+
+	ms = ms_diff(&ts1, &ts2);
+	return (uint64_t)CONTENTION_PRODUCERS * CONTENTION_ITEMS * 1000 /
+		(ms > 0 ? ms : 1);
+}
+
+TEST(simple_queue, test_ContentionBenchmark)
+{
+	LOGF("simple_queue: %d producers: %llu items/s",
+	     CONTENTION_PRODUCERS,
+	     (unsigned long long)run_contention(&simple_ops));
+#if HAL_QUEUE_LOCK_FREE
+	LOGF("mpsc_queue: %d producers: %llu items/s",
+	     CONTENTION_PRODUCERS,
+	     (unsigned long long)run_contention(&mpsc_ops));
+	LOGF("mpsc_queue: %d producers, batches of %d: %llu items/s",
+	     CONTENTION_PRODUCERS, CONTENTION_BATCH_SIZE,
+	     (unsigned long long)run_contention(&mpsc_batch_ops));
+#endif // HAL_QUEUE_LOCK_FREE
+}
+
 TEST_GROUP_RUNNER(simple_queue)
 {
 	RUN_TEST_CASE(simple_queue, test_createQueue);
@@ -347,6 +655,16 @@ TEST_GROUP_RUNNER(simple_queue)
 	RUN_TEST_CASE(simple_queue, test_NrOfWaitingElements);
 	RUN_TEST_CASE(simple_queue, test_ForcePush);
 	RUN_TEST_CASE(simple_queue, test_SemaphoreTimingBehaviour);
+#if HAL_QUEUE_LOCK_FREE
+	RUN_TEST_CASE(simple_queue, test_MpscPushFullPopFull);
+	RUN_TEST_CASE(simple_queue, test_MpscOverrideAndReset);
+	RUN_TEST_CASE(simple_queue, test_MpscTimingBehaviour);
+#endif // HAL_QUEUE_LOCK_FREE
+	RUN_TEST_CASE(simple_queue, test_HalQueueBatch);
+#if HAL_QUEUE_LOCK_FREE
+	RUN_TEST_CASE(simple_queue, test_MpscBatchOverride);
+#endif // HAL_QUEUE_LOCK_FREE
+	RUN_TEST_CASE(simple_queue, test_ContentionBenchmark);
 }
 
 #endif // PLATFORM_POSIX
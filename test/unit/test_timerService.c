@@ -0,0 +1,196 @@
+#include "ud3tn/timer_service.h"
+#include "ud3tn/timing_wheel.h"
+
+#include "platform/hal_io.h"
+
+#include "unity_fixture.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef PLATFORM_POSIX
+#include "benchmark_time.h"
+#endif // PLATFORM_POSIX
+
+#define TIMER_COUNT 100
+
+static struct timer_queue queues[2];
+static struct timer *timers;
+/* Previous tests may have advanced the service beyond the current time */
+static uint64_t base_time;
+static uint32_t base_count;
+
+TEST_GROUP(timerService);
+
+TEST_SETUP(timerService)
+{
+	timer_queue_init(&queues[0]);
+	timer_queue_init(&queues[1]);
+	timers = calloc(TIMER_COUNT, sizeof(struct timer));
+	base_time = timer_service_time();
+	base_count = timer_service_count();
+}
+
+TEST_TEAR_DOWN(timerService)
+{
+	free(timers);
+}
+
+static int pop_index(int queue, uint64_t now)
+{
+	struct timer *timer = timer_service_pop(&queues[queue], now);
+
+	return timer != NULL ? (int)(timer - timers) : -1;
+}
+
+TEST(timerService, expire_into_queues)
+{
+	int count, i;
+
+	/* E.g., two subsystems sharing the service */
+	for (i = 0; i < TIMER_COUNT; i++) {
+		timer_service_init_timer(&timers[i], &queues[i % 2]);
+		timer_service_add(&timers[i], base_time + i);
+	}
+	TEST_ASSERT_EQUAL(base_count + TIMER_COUNT, timer_service_count());
+	timer_service_cancel(&timers[TIMER_COUNT - 1]);
+	TEST_ASSERT_EQUAL(base_count + TIMER_COUNT - 1,
+			  timer_service_count());
+
+	TEST_ASSERT_EQUAL(50, timer_service_advance(base_time + 50));
+	TEST_ASSERT_EQUAL(0, timer_service_advance(base_time + 50));
+	TEST_ASSERT_EQUAL(0, timer_service_advance(base_time + 10));
+	TEST_ASSERT_EQUAL(base_time + 50, timer_service_time());
+
+	/* Every subsystem only gets its own timers, oldest first */
+	for (i = 0; i < 10; i += 2)
+		TEST_ASSERT_EQUAL(i, pop_index(0, base_time + 10));
+	TEST_ASSERT_EQUAL(-1, pop_index(0, base_time + 10));
+	for (i = 10; i < 50; i += 2)
+		TEST_ASSERT_EQUAL(i, pop_index(0, base_time + 50));
+	TEST_ASSERT_EQUAL(-1, pop_index(0, base_time + 50));
+	for (i = 1; i < 50; i += 2)
+		TEST_ASSERT_EQUAL(i, pop_index(1, base_time + 50));
+	TEST_ASSERT_EQUAL(-1, pop_index(1, base_time + 50));
+
+	/* Popped timers can be re-armed */
+	timer_service_add(&timers[0], base_time + 60);
+	TEST_ASSERT_EQUAL(50, timer_service_advance(base_time + 100));
+	count = 0;
+	while (pop_index(0, base_time + 100) >= 0)
+		count++;
+	TEST_ASSERT_EQUAL(26, count);
+
+	/* Expired timers which are not popped anymore can be dropped */
+	timer_service_clear(&queues[1]);
+	TEST_ASSERT_EQUAL(-1, pop_index(0, UINT64_MAX));
+	TEST_ASSERT_EQUAL(-1, pop_index(1, UINT64_MAX));
+	TEST_ASSERT_EQUAL(base_count, timer_service_count());
+}
+
+#ifdef PLATFORM_POSIX
+
+/*
+ * The known bundle lists of four bundle processor shards and the epidemic
+ * router expire their entries once per second. This compares a wheel per
+ * subsystem with the shared service.
+ */
+#define BENCHMARK_SUBSYSTEMS 5
+#define BENCHMARK_TIMERS 20000
+#define BENCHMARK_SECONDS 86400
+
+static uint32_t expired_in_wheels;
+
+static void count_expiry(struct timer *timer, void *context)
+{
+	expired_in_wheels++;
+}
+
+TEST(timerService, benchmark)
+{
+	static struct timing_wheel wheels[BENCHMARK_SUBSYSTEMS];
+	static struct timer bench[BENCHMARK_SUBSYSTEMS][BENCHMARK_TIMERS];
+	static uint64_t deadline[BENCHMARK_SUBSYSTEMS][BENCHMARK_TIMERS];
+	struct timer_queue bench_queues[BENCHMARK_SUBSYSTEMS];
+	uint64_t start, wheels_add_us, wheels_us, service_add_us, service_us;
+	uint64_t t;
+	uint32_t expired = 0, random_state = 2463534242;
+	int s, i;
+
+	/* Deadlines spread over one day */
+	for (s = 0; s < BENCHMARK_SUBSYSTEMS; s++) {
+		for (i = 0; i < BENCHMARK_TIMERS; i++) {
+			random_state ^= random_state << 13;
+			random_state ^= random_state >> 17;
+			random_state ^= random_state << 5;
+			deadline[s][i] = random_state % BENCHMARK_SECONDS;
+		}
+	}
+
+	/* Formerly, every subsystem advanced a wheel of its own */
+	expired_in_wheels = 0;
+	start = now_us();
+	for (s = 0; s < BENCHMARK_SUBSYSTEMS; s++) {
+		timing_wheel_init(&wheels[s], base_time);
+		for (i = 0; i < BENCHMARK_TIMERS; i++) {
+			timer_init(&bench[s][i], count_expiry, NULL);
+			timing_wheel_add(&wheels[s], &bench[s][i],
+					 base_time + deadline[s][i]);
+		}
+	}
+	wheels_add_us = now_us() - start;
+	start = now_us();
+	for (t = base_time + 1; t <= base_time + BENCHMARK_SECONDS; t++) {
+		for (s = 0; s < BENCHMARK_SUBSYSTEMS; s++)
+			timing_wheel_advance(&wheels[s], t);
+	}
+	wheels_us = now_us() - start;
+	TEST_ASSERT_EQUAL(BENCHMARK_SUBSYSTEMS * BENCHMARK_TIMERS,
+			  expired_in_wheels);
+
+	/* Now, the first subsystem asking advances the shared wheel */
+	start = now_us();
+	for (s = 0; s < BENCHMARK_SUBSYSTEMS; s++) {
+		timer_queue_init(&bench_queues[s]);
+		for (i = 0; i < BENCHMARK_TIMERS; i++) {
+			timer_service_init_timer(&bench[s][i],
+						 &bench_queues[s]);
+			timer_service_add(&bench[s][i],
+					  base_time + deadline[s][i]);
+		}
+	}
+	service_add_us = now_us() - start;
+	start = now_us();
+	for (t = base_time + 1; t <= base_time + BENCHMARK_SECONDS; t++) {
+		for (s = 0; s < BENCHMARK_SUBSYSTEMS; s++) {
+			timer_service_advance(t);
+			while (timer_service_pop(&bench_queues[s], t) != NULL)
+				expired++;
+		}
+	}
+	service_us = now_us() - start;
+	TEST_ASSERT_EQUAL(BENCHMARK_SUBSYSTEMS * BENCHMARK_TIMERS, expired);
+	TEST_ASSERT_EQUAL(base_count, timer_service_count());
+
+	LOGF("TimerService: %d subsystems with %d timers, wheel per subsystem: %llu adds/s, %llu ns per second of expiry",
+	     BENCHMARK_SUBSYSTEMS, BENCHMARK_TIMERS,
+	     (unsigned long long)BENCHMARK_SUBSYSTEMS * BENCHMARK_TIMERS *
+	     1000000 / (wheels_add_us ? wheels_add_us : 1),
+	     (unsigned long long)wheels_us * 1000 / BENCHMARK_SECONDS);
+	LOGF("TimerService: %d subsystems with %d timers, shared service: %llu adds/s, %llu ns per second of expiry",
+	     BENCHMARK_SUBSYSTEMS, BENCHMARK_TIMERS,
+	     (unsigned long long)BENCHMARK_SUBSYSTEMS * BENCHMARK_TIMERS *
+	     1000000 / (service_add_us ? service_add_us : 1),
+	     (unsigned long long)service_us * 1000 / BENCHMARK_SECONDS);
+}
+
+#endif // PLATFORM_POSIX
+
+TEST_GROUP_RUNNER(timerService)
+{
+	RUN_TEST_CASE(timerService, expire_into_queues);
+#ifdef PLATFORM_POSIX
+	RUN_TEST_CASE(timerService, benchmark);
+#endif // PLATFORM_POSIX
+}
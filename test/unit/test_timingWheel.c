@@ -0,0 +1,233 @@
+#include "ud3tn/timing_wheel.h"
+
+#include "platform/hal_io.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef PLATFORM_POSIX
+#include "benchmark_time.h"
+#endif // PLATFORM_POSIX
+
+#define TIMER_COUNT 2000
+#define START_TIME 1000
+
+struct test_timer {
+	struct timer timer;
+	uint64_t expired_at;
+	int rearm;
+};
+
+static struct timing_wheel wheel;
+static struct test_timer *timers;
+static uint64_t current_time;
+static uint32_t fired;
+static uint32_t random_state;
+
+static uint32_t next_random(void)
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+static void on_expiry(struct timer *timer, void *context)
+{
+	struct test_timer *t = context;
+
+	TEST_ASSERT_TRUE(timer == &t->timer);
+	TEST_ASSERT_FALSE(timer_is_pending(timer));
+	t->expired_at = current_time;
+	fired++;
+	if (t->rearm > 0) {
+		t->rearm--;
+		timing_wheel_add(&wheel, timer, timer->deadline + 100);
+	}
+}
+
+TEST_GROUP(timingWheel);
+
+TEST_SETUP(timingWheel)
+{
+	int i;
+
+	timers = calloc(TIMER_COUNT, sizeof(struct test_timer));
+	for (i = 0; i < TIMER_COUNT; i++)
+		timer_init(&timers[i].timer, on_expiry, &timers[i]);
+	timing_wheel_init(&wheel, START_TIME);
+	current_time = START_TIME;
+	fired = 0;
+	random_state = 2463534242;
+}
+
+TEST_TEAR_DOWN(timingWheel)
+{
+	free(timers);
+}
+
+static void advance_to(uint64_t now)
+{
+	current_time = now;
+	timing_wheel_advance(&wheel, now);
+}
+
+TEST(timingWheel, expire_exactly_once)
+{
+	uint64_t previous, deadline;
+	int i;
+
+	for (i = 0; i < TIMER_COUNT; i++) {
+		/* Spread over all levels, including beyond the last one */
+		switch (i % 5) {
+		case 0:
+			deadline = START_TIME + next_random() % 64;
+			break;
+		case 1:
+			deadline = START_TIME + next_random() % 4096;
+			break;
+		case 2:
+			deadline = START_TIME + next_random() % 1000000;
+			break;
+		case 3:
+			deadline = START_TIME + 20000000 +
+				next_random() % 100000000;
+			break;
+		default:
+			/* Already in the past */
+			deadline = next_random() % START_TIME;
+			break;
+		}
+		timing_wheel_add(&wheel, &timers[i].timer, deadline);
+		TEST_ASSERT_TRUE(timer_is_pending(&timers[i].timer));
+	}
+	TEST_ASSERT_EQUAL(TIMER_COUNT, timing_wheel_count(&wheel));
+
+	previous = START_TIME;
+	while (timing_wheel_count(&wheel) != 0) {
+		/* Small steps as well as large jumps */
+		advance_to(previous + 1 + (next_random() % 8 == 0
+			? next_random() % 5000000 : next_random() % 300));
+		for (i = 0; i < TIMER_COUNT; i++) {
+			deadline = timers[i].timer.deadline;
+			if (deadline >= current_time) {
+				TEST_ASSERT_TRUE(
+					timer_is_pending(&timers[i].timer));
+				continue;
+			}
+			TEST_ASSERT_FALSE(timer_is_pending(&timers[i].timer));
+			/* Neither too early nor too late */
+			if (deadline >= previous)
+				TEST_ASSERT_EQUAL(current_time,
+						  timers[i].expired_at);
+			else
+				TEST_ASSERT_TRUE(timers[i].expired_at != 0);
+		}
+		previous = current_time;
+	}
+	TEST_ASSERT_EQUAL(TIMER_COUNT, fired);
+}
+
+TEST(timingWheel, cancel_and_rearm)
+{
+	/* Not due as long as the deadline has not passed */
+	timing_wheel_add(&wheel, &timers[0].timer, START_TIME + 10);
+	timing_wheel_add(&wheel, &timers[1].timer, START_TIME + 5000);
+	timing_wheel_add(&wheel, &timers[2].timer, START_TIME + 70);
+	advance_to(START_TIME + 10);
+	TEST_ASSERT_EQUAL(0, fired);
+	advance_to(START_TIME + 11);
+	TEST_ASSERT_EQUAL(1, fired);
+
+	/* Canceled timers do not expire, re-added ones are moved */
+	timing_wheel_cancel(&wheel, &timers[2].timer);
+	timing_wheel_cancel(&wheel, &timers[2].timer);
+	TEST_ASSERT_FALSE(timer_is_pending(&timers[2].timer));
+	timing_wheel_add(&wheel, &timers[1].timer, START_TIME + 20);
+	TEST_ASSERT_EQUAL(1, timing_wheel_count(&wheel));
+	advance_to(START_TIME + 100);
+	TEST_ASSERT_EQUAL(2, fired);
+	TEST_ASSERT_EQUAL(0, timing_wheel_count(&wheel));
+
+	/* Callbacks may re-arm their own timer */
+	timers[3].rearm = 2;
+	timing_wheel_add(&wheel, &timers[3].timer, START_TIME + 100);
+	TEST_ASSERT_EQUAL(1, timing_wheel_advance(&wheel, START_TIME + 101));
+	TEST_ASSERT_EQUAL(2, timing_wheel_advance(&wheel, START_TIME + 400));
+	TEST_ASSERT_FALSE(timer_is_pending(&timers[3].timer));
+	TEST_ASSERT_EQUAL(0, timing_wheel_advance(&wheel, UINT64_MAX));
+}
+
+#ifdef PLATFORM_POSIX
+
+#define BENCHMARK_TIMERS 100000
+#define BENCHMARK_SECONDS 3600
+#define BENCHMARK_LINEAR_SECONDS 60
+
+TEST(timingWheel, benchmark)
+{
+	static struct test_timer bench[BENCHMARK_TIMERS];
+	uint64_t start, add_us, wheel_us, linear_us, t;
+	uint32_t expired = 0, linear_expired = 0;
+	int i;
+
+	for (i = 0; i < BENCHMARK_TIMERS; i++)
+		timer_init(&bench[i].timer, on_expiry, &bench[i]);
+
+	/* Deadlines spread over one day */
+	start = now_us();
+	for (i = 0; i < BENCHMARK_TIMERS; i++)
+		timing_wheel_add(&wheel, &bench[i].timer,
+				 START_TIME + next_random() % 86400);
+	add_us = now_us() - start;
+
+	/* Formerly, all stored items were checked every second */
+	start = now_us();
+	for (t = START_TIME + 1; t <= START_TIME + BENCHMARK_LINEAR_SECONDS;
+	     t++) {
+		for (i = 0; i < BENCHMARK_TIMERS; i++) {
+			if (bench[i].timer.deadline < t &&
+					bench[i].expired_at == 0) {
+				bench[i].expired_at = t;
+				linear_expired++;
+			}
+		}
+	}
+	linear_us = now_us() - start;
+	for (i = 0; i < BENCHMARK_TIMERS; i++)
+		bench[i].expired_at = 0;
+
+	start = now_us();
+	for (t = START_TIME + 1; t <= START_TIME + BENCHMARK_SECONDS; t++) {
+		current_time = t;
+		expired += timing_wheel_advance(&wheel, t);
+	}
+	wheel_us = now_us() - start;
+	TEST_ASSERT_EQUAL(expired, fired);
+	TEST_ASSERT_EQUAL(BENCHMARK_TIMERS - expired,
+			  timing_wheel_count(&wheel));
+	TEST_ASSERT_TRUE(linear_expired <= expired);
+
+	LOGF("TimingWheel: %d timers, %llu adds/s, %llu ns per second of expiry (linear scan: %llu ns)",
+	     BENCHMARK_TIMERS,
+	     (unsigned long long)BENCHMARK_TIMERS * 1000000 /
+	     (add_us ? add_us : 1),
+	     (unsigned long long)wheel_us * 1000 / BENCHMARK_SECONDS,
+	     (unsigned long long)linear_us * 1000 / BENCHMARK_LINEAR_SECONDS);
+
+	timing_wheel_advance(&wheel, UINT64_MAX);
+	TEST_ASSERT_EQUAL(0, timing_wheel_count(&wheel));
+}
+
+#endif // PLATFORM_POSIX
+
+TEST_GROUP_RUNNER(timingWheel)
+{
+	RUN_TEST_CASE(timingWheel, expire_exactly_once);
+	RUN_TEST_CASE(timingWheel, cancel_and_rearm);
+#ifdef PLATFORM_POSIX
+	RUN_TEST_CASE(timingWheel, benchmark);
+#endif // PLATFORM_POSIX
+}
@@ -0,0 +1,442 @@
+#include "cla/cla_tx_scheduler.h"
+
+#include "ud3tn/bundle.h"
+#include "ud3tn/config.h"
+#include "ud3tn/node.h"
+
+#include "platform/hal_io.h"
+
+#include "util/htab_hash.h"
+
+#include "unity_fixture.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef PLATFORM_POSIX
+#include "benchmark_time.h"
+#endif // PLATFORM_POSIX
+
+#define ENTRY_COUNT 200
+
+static struct cla_tx_scheduler scheduler;
+static struct routed_bundle *bundles;
+static struct routed_bundle_list *entries;
+
+static struct routed_bundle_list *make_list(int first, int count,
+					    enum bundle_routing_priority prio,
+					    uint32_t size)
+{
+	int i;
+
+	for (i = first; i < first + count; i++) {
+		bundles[i].id = i;
+		bundles[i].prio = prio;
+		bundles[i].size = size;
+		entries[i].data = &bundles[i];
+		entries[i].next = (i + 1 < first + count)
+			? &entries[i + 1] : NULL;
+	}
+	return &entries[first];
+}
+
+/* Returns a copy of a destination which is not in the flow of the given one */
+static char *other_flow(const char *destination)
+{
+	char other[32];
+	const uint32_t flow = hashlittle(destination, strlen(destination), 0)
+		% CLA_TX_SCHEDULER_FLOWS;
+	int i;
+
+	for (i = 0; i < 1000; i++) {
+		snprintf(other, sizeof(other), "dtn://node%d.dtn/", i);
+		if (hashlittle(other, strlen(other), 0) %
+		    CLA_TX_SCHEDULER_FLOWS != flow)
+			return strdup(other);
+	}
+	return NULL;
+}
+
+static int dequeue_id(void)
+{
+	struct routed_bundle_list *entry =
+		cla_tx_scheduler_dequeue(&scheduler);
+
+	if (entry == NULL)
+		return -1;
+	TEST_ASSERT_NULL(entry->next);
+	return entry->data->id;
+}
+
+TEST_GROUP(txScheduler);
+
+TEST_SETUP(txScheduler)
+{
+	bundles = calloc(ENTRY_COUNT, sizeof(struct routed_bundle));
+	entries = calloc(ENTRY_COUNT, sizeof(struct routed_bundle_list));
+	cla_tx_scheduler_init(&scheduler);
+}
+
+TEST_TEAR_DOWN(txScheduler)
+{
+	free(bundles);
+	free(entries);
+}
+
+TEST(txScheduler, strict_priority_and_fifo)
+{
+	int i;
+
+	TEST_ASSERT_TRUE(cla_tx_scheduler_is_empty(&scheduler));
+	TEST_ASSERT_EQUAL(-1, dequeue_id());
+
+	/* A mixed list is split into the lanes of its bundles */
+	make_list(0, 6, BUNDLE_RPRIO_NORMAL, 100);
+	bundles[1].prio = BUNDLE_RPRIO_HIGH;
+	bundles[4].prio = BUNDLE_RPRIO_HIGH;
+	cla_tx_scheduler_enqueue(&scheduler, &entries[0]);
+	TEST_ASSERT_FALSE(cla_tx_scheduler_is_empty(&scheduler));
+
+	TEST_ASSERT_EQUAL(1, dequeue_id());
+	TEST_ASSERT_EQUAL(4, dequeue_id());
+	TEST_ASSERT_EQUAL(0, dequeue_id());
+
+	/* Bundles of a higher priority overtake those already queued */
+	cla_tx_scheduler_enqueue(&scheduler,
+				 make_list(10, 2, BUNDLE_RPRIO_HIGH, 100));
+	TEST_ASSERT_EQUAL(10, dequeue_id());
+	TEST_ASSERT_EQUAL(11, dequeue_id());
+	for (i = 2; i < 6; i++) {
+		if (i != 4)
+			TEST_ASSERT_EQUAL(i, dequeue_id());
+	}
+	TEST_ASSERT_EQUAL(-1, dequeue_id());
+	TEST_ASSERT_TRUE(cla_tx_scheduler_is_empty(&scheduler));
+}
+
+TEST(txScheduler, weighted_fair_share)
+{
+	int normal = 0, low = 0, id, i;
+
+	cla_tx_scheduler_enqueue(&scheduler,
+				 make_list(0, 100, BUNDLE_RPRIO_LOW, 1000));
+	cla_tx_scheduler_enqueue(&scheduler,
+				 make_list(100, 100, BUNDLE_RPRIO_NORMAL, 1000));
+
+	/* The share is proportional to the weights while both are queued */
+	for (i = 0; i < 50; i++) {
+		id = dequeue_id();
+		if (id >= 100) {
+			TEST_ASSERT_EQUAL(100 + normal, id);
+			normal++;
+		} else {
+			TEST_ASSERT_EQUAL(low, id);
+			low++;
+		}
+	}
+	TEST_ASSERT_EQUAL(50 * CLA_TX_WEIGHT_NORMAL /
+			  (CLA_TX_WEIGHT_NORMAL + CLA_TX_WEIGHT_LOW), normal);
+
+	/* Large bundles are not starved and drain the lanes completely */
+	bundles[low].size = 50 * CLA_TX_SCHEDULER_QUANTUM;
+	for (i = 50; i < ENTRY_COUNT; i++)
+		TEST_ASSERT_TRUE(dequeue_id() >= 0);
+	TEST_ASSERT_EQUAL(-1, dequeue_id());
+}
+
+TEST(txScheduler, fair_share_among_flows)
+{
+	char *bulk = "dtn://bulk.dtn/";
+	char *other = other_flow(bulk);
+	int first = 0, second = 0, id, i;
+
+	TEST_ASSERT_NOT_NULL(other);
+	/* A transfer queued earlier does not delay another destination */
+	make_list(0, 100, BUNDLE_RPRIO_NORMAL, 1000);
+	make_list(100, 100, BUNDLE_RPRIO_NORMAL, 1000);
+	for (i = 0; i < 100; i++) {
+		bundles[i].destination = bulk;
+		bundles[100 + i].destination = other;
+	}
+	cla_tx_scheduler_enqueue(&scheduler, &entries[0]);
+	cla_tx_scheduler_enqueue(&scheduler, &entries[100]);
+
+	/* Both get an equal share, each in the order of its bundles */
+	for (i = 0; i < 40; i++) {
+		id = dequeue_id();
+		if (id >= 100) {
+			TEST_ASSERT_EQUAL(100 + second, id);
+			second++;
+		} else {
+			TEST_ASSERT_EQUAL(first, id);
+			first++;
+		}
+	}
+	TEST_ASSERT_EQUAL(first, second);
+	for (i = 40; i < ENTRY_COUNT; i++)
+		TEST_ASSERT_TRUE(dequeue_id() >= 0);
+	TEST_ASSERT_EQUAL(-1, dequeue_id());
+	free(other);
+}
+
+TEST(txScheduler, high_priority_burst_limit)
+{
+	const int burst = (CLA_TX_HIGH_BURST + 4095) / 4096;
+	int i, j;
+
+	/* E.g., a bulk transfer of bundles for which custody was accepted */
+	cla_tx_scheduler_enqueue(&scheduler,
+				 make_list(0, 100, BUNDLE_RPRIO_HIGH, 4096));
+	cla_tx_scheduler_enqueue(&scheduler,
+				 make_list(100, 5, BUNDLE_RPRIO_LOW, 100));
+
+	for (i = 0; i < 5; i++) {
+		for (j = 0; j < burst; j++)
+			TEST_ASSERT_EQUAL(i * burst + j, dequeue_id());
+		TEST_ASSERT_EQUAL(100 + i, dequeue_id());
+	}
+	/* Without other bundles waiting, there is no limit */
+	for (i = 5 * burst; i < 100; i++)
+		TEST_ASSERT_EQUAL(i, dequeue_id());
+	TEST_ASSERT_EQUAL(-1, dequeue_id());
+}
+
+#ifdef PLATFORM_POSIX
+
+/*
+ * A bulk transfer is queued at once for a 1 Mbit/s link, while status reports
+ * and bundles for another destination arrive periodically. As with BPv7, all
+ * bundles except the status reports are of normal priority. The queueing
+ * delay of each class is simulated for transmission in arrival order and with
+ * the scheduler.
+ */
+#define BENCHMARK_BULK_BUNDLES 1000
+#define BENCHMARK_BULK_SIZE 65536
+#define BENCHMARK_HIGH_PERIOD_US 50000
+#define BENCHMARK_HIGH_SIZE 100
+#define BENCHMARK_PERIODIC_PERIOD_US 200000
+#define BENCHMARK_PERIODIC_SIZE 4096
+#define BENCHMARK_LINK_BYTES_PER_S 125000
+#define BENCHMARK_DURATION_US \
+	((uint64_t)BENCHMARK_BULK_BUNDLES * BENCHMARK_BULK_SIZE * 1000000 / \
+	 BENCHMARK_LINK_BYTES_PER_S)
+
+enum benchmark_class {
+	BENCHMARK_CLASS_BULK,
+	BENCHMARK_CLASS_PERIODIC,
+	BENCHMARK_CLASS_STATUS_REPORT,
+	BENCHMARK_CLASS_MAX
+};
+
+struct delay_stats {
+	uint64_t total_us;
+	uint64_t max_us;
+	uint32_t count;
+};
+
+static char *bulk_destination = "dtn://bulk.dtn/";
+static char *periodic_destination;
+
+static int generate_traffic(struct routed_bundle *rbs, uint64_t *arrival)
+{
+	uint64_t next_high = 0, next_periodic = 0;
+	int i, count = 0;
+
+	for (i = 0; i < BENCHMARK_BULK_BUNDLES; i++) {
+		rbs[count] = (struct routed_bundle){
+			.id = count,
+			.destination = bulk_destination,
+			.prio = BUNDLE_RPRIO_NORMAL,
+			.size = BENCHMARK_BULK_SIZE,
+		};
+		arrival[count++] = 0;
+	}
+	/* Merge both periodic flows in the order of their arrival */
+	while (next_high < BENCHMARK_DURATION_US ||
+	       next_periodic < BENCHMARK_DURATION_US) {
+		if (next_high <= next_periodic) {
+			rbs[count] = (struct routed_bundle){
+				.id = count,
+				.prio = BUNDLE_RPRIO_HIGH,
+				.size = BENCHMARK_HIGH_SIZE,
+			};
+			arrival[count++] = next_high;
+			next_high += BENCHMARK_HIGH_PERIOD_US;
+		} else {
+			rbs[count] = (struct routed_bundle){
+				.id = count,
+				.destination = periodic_destination,
+				.prio = BUNDLE_RPRIO_NORMAL,
+				.size = BENCHMARK_PERIODIC_SIZE,
+			};
+			arrival[count++] = next_periodic;
+			next_periodic += BENCHMARK_PERIODIC_PERIOD_US;
+		}
+	}
+	return count;
+}
+
+static enum benchmark_class get_class(const struct routed_bundle *rb)
+{
+	if (rb->prio == BUNDLE_RPRIO_HIGH)
+		return BENCHMARK_CLASS_STATUS_REPORT;
+	if (rb->destination == bulk_destination)
+		return BENCHMARK_CLASS_BULK;
+	return BENCHMARK_CLASS_PERIODIC;
+}
+
+static struct routed_bundle_list *fifo_head;
+static struct routed_bundle_list *fifo_tail;
+
+static void fifo_enqueue(struct routed_bundle_list *entry)
+{
+	if (fifo_tail == NULL)
+		fifo_head = entry;
+	else
+		fifo_tail->next = entry;
+	fifo_tail = entry;
+}
+
+static struct routed_bundle_list *fifo_dequeue(void)
+{
+	struct routed_bundle_list *entry = fifo_head;
+
+	if (entry != NULL) {
+		fifo_head = entry->next;
+		if (fifo_head == NULL)
+			fifo_tail = NULL;
+		entry->next = NULL;
+	}
+	return entry;
+}
+
+/* Returns the nanoseconds spent in dequeue operations */
+static uint64_t simulate_link(struct routed_bundle_list *list,
+			      const uint64_t *arrival, int count,
+			      bool use_scheduler,
+			      struct delay_stats stats[BENCHMARK_CLASS_MAX])
+{
+	struct routed_bundle_list *entry;
+	uint64_t now = 0, delay, start, spent = 0;
+	int next = 0, id, class;
+
+	fifo_head = NULL;
+	fifo_tail = NULL;
+	cla_tx_scheduler_init(&scheduler);
+	for (;;) {
+		/* Everything which arrived while the link was busy */
+		while (next < count && arrival[next] <= now) {
+			list[next].next = NULL;
+			if (use_scheduler)
+				cla_tx_scheduler_enqueue(&scheduler,
+							 &list[next]);
+			else
+				fifo_enqueue(&list[next]);
+			next++;
+		}
+		start = now_ns();
+		entry = use_scheduler
+			? cla_tx_scheduler_dequeue(&scheduler)
+			: fifo_dequeue();
+		spent += now_ns() - start;
+		if (entry == NULL) {
+			if (next == count)
+				break;
+			/* The link is idle until the next arrival */
+			now = arrival[next];
+			continue;
+		}
+		id = entry->data->id;
+		class = get_class(entry->data);
+		delay = now - arrival[id];
+		stats[class].total_us += delay;
+		stats[class].count++;
+		if (delay > stats[class].max_us)
+			stats[class].max_us = delay;
+		now += (uint64_t)entry->data->size * 1000000 /
+			BENCHMARK_LINK_BYTES_PER_S;
+	}
+	return spent;
+}
+
+static void log_stats(const char *name,
+		      const struct delay_stats stats[BENCHMARK_CLASS_MAX])
+{
+	static const char *const classes[BENCHMARK_CLASS_MAX] = {
+		"bulk", "periodic", "status reports"
+	};
+	int i;
+
+	for (i = BENCHMARK_CLASS_MAX - 1; i >= 0; i--) {
+		LOGF("TxScheduler: %s, %s: %lu bundles, mean delay %llu ms, max delay %llu ms",
+		     name, classes[i], (unsigned long)stats[i].count,
+		     (unsigned long long)(stats[i].count
+			? stats[i].total_us / stats[i].count / 1000 : 0),
+		     (unsigned long long)stats[i].max_us / 1000);
+	}
+}
+
+TEST(txScheduler, queueing_delay_benchmark)
+{
+	struct delay_stats fifo[BENCHMARK_CLASS_MAX] = { { 0 } };
+	struct delay_stats prio[BENCHMARK_CLASS_MAX] = { { 0 } };
+	const int max_count = BENCHMARK_BULK_BUNDLES +
+		BENCHMARK_DURATION_US / BENCHMARK_HIGH_PERIOD_US +
+		BENCHMARK_DURATION_US / BENCHMARK_PERIODIC_PERIOD_US + 2;
+	struct routed_bundle *rbs = calloc(max_count, sizeof(*rbs));
+	struct routed_bundle_list *list = calloc(max_count, sizeof(*list));
+	uint64_t *arrival = calloc(max_count, sizeof(*arrival));
+	uint64_t spent;
+	int count, i;
+
+	TEST_ASSERT_NOT_NULL(rbs);
+	TEST_ASSERT_NOT_NULL(list);
+	TEST_ASSERT_NOT_NULL(arrival);
+	periodic_destination = other_flow(bulk_destination);
+	TEST_ASSERT_NOT_NULL(periodic_destination);
+	count = generate_traffic(rbs, arrival);
+	for (i = 0; i < count; i++)
+		list[i].data = &rbs[i];
+
+	simulate_link(list, arrival, count, false, fifo);
+	spent = simulate_link(list, arrival, count, true, prio);
+
+	log_stats("arrival order", fifo);
+	log_stats("scheduler", prio);
+	LOGF("TxScheduler: %llu ns per dequeue",
+	     (unsigned long long)spent / count);
+
+	for (i = 0; i < BENCHMARK_CLASS_MAX; i++) {
+		TEST_ASSERT_EQUAL(fifo[i].count, prio[i].count);
+		TEST_ASSERT_TRUE(prio[i].count != 0);
+	}
+	/* Status reports wait for one bulk bundle at most */
+	TEST_ASSERT_TRUE(prio[BENCHMARK_CLASS_STATUS_REPORT].max_us <=
+			 (uint64_t)BENCHMARK_BULK_SIZE * 1000000 /
+			 BENCHMARK_LINK_BYTES_PER_S);
+	TEST_ASSERT_TRUE(prio[BENCHMARK_CLASS_STATUS_REPORT].max_us <
+			 fifo[BENCHMARK_CLASS_STATUS_REPORT].max_us);
+	TEST_ASSERT_TRUE(prio[BENCHMARK_CLASS_PERIODIC].max_us <
+			 fifo[BENCHMARK_CLASS_PERIODIC].max_us);
+
+	free(periodic_destination);
+	free(rbs);
+	free(list);
+	free(arrival);
+}
+
+#endif // PLATFORM_POSIX
+
+TEST_GROUP_RUNNER(txScheduler)
+{
+	RUN_TEST_CASE(txScheduler, strict_priority_and_fifo);
+	RUN_TEST_CASE(txScheduler, weighted_fair_share);
+	RUN_TEST_CASE(txScheduler, fair_share_among_flows);
+	RUN_TEST_CASE(txScheduler, high_priority_burst_limit);
+#ifdef PLATFORM_POSIX
+	RUN_TEST_CASE(txScheduler, queueing_delay_benchmark);
+#endif // PLATFORM_POSIX
+}
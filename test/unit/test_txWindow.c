@@ -0,0 +1,120 @@
+#include "cla/cla_tx_window.h"
+
+#include "ud3tn/common.h"
+#include "ud3tn/config.h"
+
+#include "unity_fixture.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+static struct cla_tx_window window;
+
+/* Acquires single bundles until the window refuses one */
+static uint32_t fill_window(void)
+{
+	uint32_t count = 0;
+
+	while (cla_tx_window_acquire(&window, 1))
+		count++;
+	return count;
+}
+
+TEST_GROUP(txWindow);
+
+TEST_SETUP(txWindow)
+{
+	cla_tx_window_init(&window);
+}
+
+TEST_TEAR_DOWN(txWindow)
+{
+}
+
+TEST(txWindow, acquire_and_release)
+{
+	TEST_ASSERT_EQUAL(CONTACT_TX_TASK_QUEUE_LENGTH, fill_window());
+	TEST_ASSERT_FALSE(cla_tx_window_acquire(&window, 1));
+
+	/* Cancelled bundles free their space without adapting the window */
+	cla_tx_window_cancel(&window, 1);
+	TEST_ASSERT_TRUE(window.limited);
+	TEST_ASSERT_TRUE(cla_tx_window_acquire(&window, 1));
+	TEST_ASSERT_EQUAL(CONTACT_TX_TASK_QUEUE_LENGTH, window.size);
+
+	cla_tx_window_release(&window, CONTACT_TX_TASK_QUEUE_LENGTH, false);
+	TEST_ASSERT_EQUAL(0, window.outstanding);
+}
+
+TEST(txWindow, grows_while_limited)
+{
+	uint32_t expected = CONTACT_TX_TASK_QUEUE_LENGTH;
+	uint32_t count;
+
+	while (expected < CLA_TX_WINDOW_MAX) {
+		count = fill_window();
+		TEST_ASSERT_EQUAL(expected, count);
+		cla_tx_window_release(&window, count, false);
+		expected = MIN(expected * 2, CLA_TX_WINDOW_MAX);
+		TEST_ASSERT_EQUAL(expected, window.size);
+	}
+	/* It does not grow beyond its maximum... */
+	count = fill_window();
+	cla_tx_window_release(&window, count, false);
+	TEST_ASSERT_EQUAL(CLA_TX_WINDOW_MAX, window.size);
+
+	/* ...nor if no bundle has been refused */
+	cla_tx_window_init(&window);
+	TEST_ASSERT_TRUE(cla_tx_window_acquire(&window, 1));
+	cla_tx_window_release(&window, 1, false);
+	TEST_ASSERT_EQUAL(CONTACT_TX_TASK_QUEUE_LENGTH, window.size);
+}
+
+TEST(txWindow, halves_on_failure)
+{
+	uint32_t count;
+
+	while (window.size < CLA_TX_WINDOW_MAX) {
+		count = fill_window();
+		cla_tx_window_release(&window, count, false);
+	}
+	TEST_ASSERT_TRUE(cla_tx_window_acquire(&window, 1));
+	cla_tx_window_release(&window, 1, true);
+	TEST_ASSERT_EQUAL(CLA_TX_WINDOW_MAX / 2, window.size);
+
+	/* It never shrinks below its initial size */
+	while (window.size > CONTACT_TX_TASK_QUEUE_LENGTH) {
+		TEST_ASSERT_TRUE(cla_tx_window_acquire(&window, 1));
+		cla_tx_window_release(&window, 1, true);
+	}
+	TEST_ASSERT_TRUE(cla_tx_window_acquire(&window, 1));
+	cla_tx_window_release(&window, 1, true);
+	TEST_ASSERT_EQUAL(CONTACT_TX_TASK_QUEUE_LENGTH, window.size);
+	TEST_ASSERT_EQUAL(0, window.outstanding);
+}
+
+TEST(txWindow, oversized_command_admitted_alone)
+{
+	const uint32_t oversized = CLA_TX_WINDOW_MAX + 1;
+
+	/* Admitted if nothing else is outstanding... */
+	TEST_ASSERT_TRUE(cla_tx_window_acquire(&window, oversized));
+	TEST_ASSERT_EQUAL(oversized, window.outstanding);
+	/* ...but it blocks everything else until it has been processed */
+	TEST_ASSERT_FALSE(cla_tx_window_acquire(&window, 1));
+	cla_tx_window_release(&window, oversized, false);
+
+	/* Refused while other bundles are outstanding */
+	TEST_ASSERT_TRUE(cla_tx_window_acquire(&window, 1));
+	TEST_ASSERT_FALSE(cla_tx_window_acquire(&window, oversized));
+	cla_tx_window_release(&window, 1, false);
+	TEST_ASSERT_EQUAL(0, window.outstanding);
+}
+
+TEST_GROUP_RUNNER(txWindow)
+{
+	RUN_TEST_CASE(txWindow, acquire_and_release);
+	RUN_TEST_CASE(txWindow, grows_while_limited);
+	RUN_TEST_CASE(txWindow, halves_on_failure);
+	RUN_TEST_CASE(txWindow, oversized_command_admitted_alone);
+}
@@ -1,3 +1,4 @@
+#include "platform/hal_io.h"
 #include "platform/hal_time.h"
 
 #include "unity_fixture.h"
@@ -20,7 +21,54 @@ TEST(ud3tn, hal_time)
 	TEST_ASSERT_EQUAL_UINT64(0, hal_time_get_timestamp_s());
 }
 
+TEST(ud3tn, hal_time_precise)
+{
+	uint64_t s, ms, precise_ms, us;
+
+	hal_time_init(1234);
+	s = hal_time_get_timestamp_s();
+	ms = hal_time_get_timestamp_ms();
+	precise_ms = hal_time_get_timestamp_ms_precise();
+	us = hal_time_get_timestamp_us();
+	/* The coarse clock lags behind by at most one tick */
+	TEST_ASSERT_TRUE(s <= ms / 1000);
+	TEST_ASSERT_TRUE(ms <= precise_ms);
+	TEST_ASSERT_TRUE(precise_ms - ms <= 20);
+	TEST_ASSERT_TRUE(precise_ms <= us / 1000);
+	TEST_ASSERT_TRUE(us / 1000 - precise_ms <= 20);
+	hal_time_init(0);
+}
+
+#define HAL_TIME_BENCHMARK_CALLS 100000
+
+static uint64_t time_calls(uint64_t (*get_time)(void))
+{
+	const uint64_t start = hal_time_get_timestamp_us();
+	volatile uint64_t sink;
+	int i;
+
+	for (i = 0; i < HAL_TIME_BENCHMARK_CALLS; i++)
+		sink = get_time();
+	(void)sink;
+	/* Nanoseconds per call */
+	return (hal_time_get_timestamp_us() - start) * 1000 /
+		HAL_TIME_BENCHMARK_CALLS;
+}
+
+TEST(ud3tn, hal_time_benchmark)
+{
+	LOGF("hal_time: coarse s: %llu ns/call, coarse ms: %llu ns/call",
+	     (unsigned long long)time_calls(hal_time_get_timestamp_s),
+	     (unsigned long long)time_calls(hal_time_get_timestamp_ms));
+	LOGF("hal_time: precise ms: %llu ns/call, precise us: %llu ns/call",
+	     (unsigned long long)time_calls(
+		     hal_time_get_timestamp_ms_precise),
+	     (unsigned long long)time_calls(hal_time_get_timestamp_us));
+}
+
 TEST_GROUP_RUNNER(ud3tn)
 {
 	RUN_TEST_CASE(ud3tn, hal_time);
+	RUN_TEST_CASE(ud3tn, hal_time_precise);
+	RUN_TEST_CASE(ud3tn, hal_time_benchmark);
 }
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+# encoding: utf-8
+
+"""
+Loopback benchmark for the number of concurrent MTCP connections uD3TN can
+serve. Opens the given number of connections, sends bundles over all of them
+in a round-robin fashion and reports the achieved rates. If the PID of the
+uD3TN process is given, its resident memory and thread count are sampled
+from /proc before and after the connections have been established.
+"""
+
+import resource
+import time
+
+from pyd3tn.bundle7 import serialize_bundle7
+from pyd3tn.bundle6 import serialize_bundle6
+from pyd3tn.mtcp import MTCPConnection
+
+
+def read_proc_status(pid):
+    result = {}
+    with open("/proc/{}/status".format(pid)) as f:
+        for line in f:
+            key, _, value = line.partition(":")
+            if key in ("VmRSS", "Threads"):
+                result[key] = value.strip()
+    return result
+
+
+def print_proc_status(pid, label):
+    if pid is None:
+        return
+    status = read_proc_status(pid)
+    print("{}: RSS = {}, threads = {}".format(
+        label,
+        status.get("VmRSS", "?"),
+        status.get("Threads", "?"),
+    ))
+
+
+def raise_fd_limit(count):
+    soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+    wanted = count + 64
+    if soft < wanted:
+        if hard != resource.RLIM_INFINITY:
+            wanted = min(wanted, hard)
+        resource.setrlimit(resource.RLIMIT_NOFILE, (wanted, hard))
+
+
+def main():
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "-l", "--host",
+        default="127.0.0.1",
+        help="IP address to connect to (defaults to 127.0.0.1)",
+    )
+    parser.add_argument(
+        "-p", "--port",
+        type=int,
+        default=4224,
+        help="Port of the MTCP CLA (defaults to 4224)",
+    )
+    parser.add_argument(
+        "-n", "--connections",
+        type=int,
+        default=1000,
+        help="Number of concurrent connections (defaults to 1000)",
+    )
+    parser.add_argument(
+        "-c", "--count",
+        type=int,
+        default=10,
+        help="Number of bundles sent per connection (defaults to 10)",
+    )
+    parser.add_argument(
+        "-s", "--size",
+        type=int,
+        default=200,
+        help="Payload size of the bundles in bytes (defaults to 200)",
+    )
+    parser.add_argument(
+        "-b", "--bundle-version",
+        default="7",
+        choices="67",
+        help="Version of the bundle protocol to use (defaults to 7): "
+        "6 == RFC 5050, 7 == BPv7-bis"
+    )
+    parser.add_argument(
+        "-d", "--destination",
+        default="dtn://ud3tn.dtn/sink",
+        help="Destination EID of the bundles",
+    )
+    parser.add_argument(
+        "--pid",
+        type=int, default=None,
+        help="PID of uD3TN to sample memory and thread count from /proc",
+    )
+    parser.add_argument(
+        "--timeout",
+        type=int, default=3000,
+        help="TCP timeout in ms (default: 3000)"
+    )
+
+    args = parser.parse_args()
+
+    serialize_bundle = {
+        "6": serialize_bundle6,
+        "7": serialize_bundle7,
+    }[args.bundle_version]
+
+    raise_fd_limit(args.connections)
+    print_proc_status(args.pid, "Before connecting")
+
+    connections = []
+    try:
+        start = time.monotonic()
+        for _ in range(args.connections):
+            conn = MTCPConnection(args.host, args.port, timeout=args.timeout)
+            conn.__enter__()
+            connections.append(conn)
+        setup_time = time.monotonic() - start
+        print("Established {} connections in {:.3f} s ({:.0f} conn/s)".format(
+            len(connections),
+            setup_time,
+            len(connections) / setup_time if setup_time else 0,
+        ))
+        print_proc_status(args.pid, "Connected")
+
+        bundles = [
+            serialize_bundle(
+                "dtn://bench-{}.dtn/".format(i),
+                args.destination,
+                b"\x42" * args.size,
+            )
+            for i in range(len(connections))
+        ]
+        start = time.monotonic()
+        for _ in range(args.count):
+            for conn, bundle in zip(connections, bundles):
+                conn.send_bundle(bundle)
+        send_time = time.monotonic() - start
+        total = args.count * len(connections)
+        print("Sent {} bundles in {:.3f} s ({:.0f} bundles/s, {:.2f} MiB/s)"
+              .format(
+                  total,
+                  send_time,
+                  total / send_time if send_time else 0,
+                  total * len(bundles[0]) / send_time / 2 ** 20
+                  if send_time else 0,
+              ))
+        print_proc_status(args.pid, "After sending")
+    finally:
+        for conn in connections:
+            conn.__exit__(None, None, None)
+
+
+if __name__ == "__main__":
+    main()